@@ -0,0 +1,83 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef QCLOUD_IOT_EXPORT_CRYPTO_H_
+#define QCLOUD_IOT_EXPORT_CRYPTO_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CPU crypto instructions the SDK hashing and AES utilities can run on */
+#define IOT_CRYPTO_ACCEL_SHA1   (1 << 0)  // x86 SHA extensions (SHA-NI)
+#define IOT_CRYPTO_ACCEL_AES    (1 << 1)  // x86 AES-NI
+#define IOT_CRYPTO_ACCEL_SHA256 (1 << 2)  // x86 SHA extensions (SHA-NI)
+
+/**
+ * @brief algorithms measured by IOT_Crypto_Benchmark
+ */
+typedef enum {
+    IOT_CRYPTO_MD5 = 0,         // OTA firmware digest checked by the cloud
+    IOT_CRYPTO_SHA1,            // digest behind HMAC-SHA1
+    IOT_CRYPTO_HMAC_SHA1,       // MQTT password and sign of gateway/log requests, one MAC per buffer
+    IOT_CRYPTO_AES128_CBC_ENC,  // AES-128-CBC encryption
+    IOT_CRYPTO_AES128_CBC_DEC,  // AES-128-CBC decryption, as for dynamic register reply
+    IOT_CRYPTO_SHA256,          // OTA firmware digest
+    IOT_CRYPTO_ALGO_MAX
+} IotCryptoAlgo;
+
+/**
+ * @brief Get the crypto instructions in use
+ *
+ * They are probed from the CPU on first use, only when the SDK is built with CRYPTO_HW_ACCEL
+ *
+ * @return      mask of IOT_CRYPTO_ACCEL_*, 0 means portable C code only
+ */
+uint32_t IOT_Crypto_Get_Accel(void);
+
+/**
+ * @brief Restrict the crypto instructions in use, eg. to compare with the portable code
+ *
+ * Call it before any client is constructed, instructions the CPU lacks are never used
+ *
+ * @param mask  mask of IOT_CRYPTO_ACCEL_* allowed, 0 for portable C code only
+ * @return      mask of IOT_CRYPTO_ACCEL_* in use from now on
+ */
+uint32_t IOT_Crypto_Set_Accel(uint32_t mask);
+
+/**
+ * @brief Get the printable name of an algorithm
+ */
+const char *IOT_Crypto_Algo_Name(IotCryptoAlgo algo);
+
+/**
+ * @brief Measure the throughput of one algorithm with the instructions in use
+ *
+ * @param algo          algorithm to run
+ * @param buf_len       bytes processed per call, multiple of 16 for AES
+ * @param duration_ms   how long to run
+ * @param kb_per_sec    output throughput, in 1000 bytes per second
+ * @return              QCLOUD_RET_SUCCESS for success, or err code for failure
+ */
+int IOT_Crypto_Benchmark(IotCryptoAlgo algo, size_t buf_len, uint32_t duration_ms, uint32_t *kb_per_sec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QCLOUD_IOT_EXPORT_CRYPTO_H_ */
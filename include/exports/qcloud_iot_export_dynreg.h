@@ -32,6 +32,19 @@ extern "C" {
  */
 int IOT_DynReg_Device(DeviceInfo *pDevInfo);
 
+/**
+ * @brief Do dynamic register for many devices over one keep-alive connection,
+ *        with requests pipelined ahead of the replies
+ *
+ * @param pDevInfos In:     array of device info with [ProductId, ProductKey, DeviceName]
+ *                  Out:    device info of registered devices filled as IOT_DynReg_Device
+ * @param dev_num   number of devices in pDevInfos
+ * @param results   Out:    result of each device, QCLOUD_RET_SUCCESS or err code
+ *
+ * @return QCLOUD_RET_SUCCESS if all devices registered, or err code for failure
+ */
+int IOT_DynReg_Device_Batch(DeviceInfo *pDevInfos, int dev_num, int *results);
+
 #ifdef __cplusplus
 }
 #endif
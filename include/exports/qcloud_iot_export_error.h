@@ -66,6 +66,8 @@ typedef enum {
     QCLOUD_ERR_BUF_TOO_SHORT                              = -119,  // MQTT recv buffer not enough
     QCLOUD_ERR_MQTT_QOS_NOT_SUPPORT                       = -120,  // MQTT QoS level not supported
     QCLOUD_ERR_MQTT_UNSUB_FAIL                            = -121,  // MQTT unsubscribe failed
+    QCLOUD_ERR_MQTT_FLOW_CONTROL                          = -122,  // MQTT 5 server receive maximum reached
+    QCLOUD_ERR_MQTT_PACKET_TOO_LARGE                      = -123,  // MQTT 5 packet over server maximum packet size
     QCLOUD_ERR_JSON_PARSE                                 = -132,  // JSON parsing error
     QCLOUD_ERR_JSON_BUFFER_TRUNCATED                      = -133,  // JSON buffer truncated
     QCLOUD_ERR_JSON_BUFFER_TOO_SMALL                      = -134,  // JSON parsing buffer not enough
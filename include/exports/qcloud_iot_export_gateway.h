@@ -72,7 +72,7 @@ typedef struct {
 void *IOT_Gateway_Construct(GatewayInitParam *init_param);
 
 /**
- * @brief Close connection and destroy gateway client
+ * @brief Close connection and destroy gateway client, destroy its virtual clients first
  *
  * @param client    handle to gateway client
  *
@@ -133,6 +133,17 @@ int IOT_Gateway_Subdev_Unbind(void *client, GatewayParam *param, DeviceInfo *pSu
  */
 int IOT_Gateway_Publish(void *client, char *topic_name, PublishParams *params);
 
+/**
+ * @brief Publish gateway MQTT message to a topic encoded by IOT_MQTT_Topic_Init
+ *
+ * @param client        handle to gateway client
+ * @param topic         topic handle, eg. one per sub-device
+ * @param params        publish parameters
+ *
+ * @return packet id (>=0) when success, or err code (<0) for failure
+ */
+int IOT_Gateway_Publish_Topic(void *client, const MQTTTopicHandle *topic, PublishParams *params);
+
 /**
  * @brief Subscribe gateway MQTT topic
  *
@@ -217,6 +228,73 @@ int IOT_Gateway_Subdev_GetBindList(void *client, GatewayParam *param, SubdevBind
  */
 void IOT_Gateway_Subdev_DestoryBindList(SubdevBindList *subdev_bindlist);
 
+/**
+ * @brief Create a virtual client of a sub-device and make the sub-device online. The virtual client publishes and
+ * subscribes through the MQTT connection of the gateway, it keeps only the device identity and its subscriptions.
+ * Destroy virtual clients before the gateway. Ones still alive when the gateway is destroyed lose their
+ * subscriptions, their calls fail, and IOT_Gateway_Virtual_Destroy only frees them.
+ *
+ * @param client                handle to gateway client
+ * @param subdev_product_id     product ID of the sub-device
+ * @param subdev_device_name    device name of the sub-device
+ *
+ * @return a valid virtual client handle when success, or NULL otherwise
+ */
+void *IOT_Gateway_Virtual_Construct(void *client, const char *subdev_product_id, const char *subdev_device_name);
+
+/**
+ * @brief Unsubscribe all topics of a virtual client, make the sub-device offline and free the virtual client
+ *
+ * @param vclient   handle to virtual client
+ *
+ * @return QCLOUD_RET_SUCCESS for success, or err code of the offline request
+ */
+int IOT_Gateway_Virtual_Destroy(void *vclient);
+
+/**
+ * @brief Publish MQTT message for the sub-device of a virtual client
+ *
+ * @param vclient       handle to virtual client
+ * @param topic_name    MQTT topic name
+ * @param params        publish parameters
+ *
+ * @return packet id (>=0) when success, or err code (<0) for failure
+ */
+int IOT_Gateway_Virtual_Publish(void *vclient, char *topic_name, PublishParams *params);
+
+/**
+ * @brief Subscribe MQTT topic for a virtual client. Callbacks get the virtual client as pClient. The SUBSCRIBE is
+ * sent as soon as few enough are waiting for SUBACK, and again after reconnect; a subscription timeout is reported
+ * by on_sub_event_handler and retried.
+ *
+ * @param vclient       handle to virtual client
+ * @param topic_filter  MQTT topic filter, one virtual client at most for each filter
+ * @param params        subscribe parameters
+ *
+ * @return QCLOUD_RET_SUCCESS when queued, or err code (<0) for failure
+ */
+int IOT_Gateway_Virtual_Subscribe(void *vclient, char *topic_filter, SubscribeParams *params);
+
+/**
+ * @brief Unsubscribe MQTT topic of a virtual client
+ *
+ * @param vclient       handle to virtual client
+ * @param topic_filter  MQTT topic filter
+ *
+ * @return QCLOUD_RET_SUCCESS for success, or err code (<0) for failure
+ */
+int IOT_Gateway_Virtual_Unsubscribe(void *vclient, char *topic_filter);
+
+/**
+ * @brief Check if MQTT topic of a virtual client has been subscribed or not
+ *
+ * @param vclient       handle to virtual client
+ * @param topic_filter  MQTT topic filter
+ *
+ * @return true when successfully subscribed, or false if not yet
+ */
+bool IOT_Gateway_Virtual_IsSubReady(void *vclient, char *topic_filter);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,98 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef QCLOUD_IOT_EXPORT_MEM_H_
+#define QCLOUD_IOT_EXPORT_MEM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief owner of the memory allocated inside the SDK
+ */
+typedef enum {
+    MEM_TAG_OTHER = 0,
+    MEM_TAG_MQTT,     // MQTT pub/sub info waiting for ack, messages queued for dispatch
+    MEM_TAG_COAP,     // CoAP messages waiting for ack
+    MEM_TAG_SHADOW,   // shadow requests and property handlers
+    MEM_TAG_OTA,      // OTA handles
+    MEM_TAG_GATEWAY,  // gateway virtual clients and their subscription routes
+    MEM_TAG_MAX
+} MemTag;
+
+/**
+ * @brief memory accounting of one tag
+ */
+typedef struct {
+    uint32_t cur_bytes;   // bytes in use
+    uint32_t peak_bytes;  // max of cur_bytes
+    uint32_t alloc_cnt;   // successful allocations
+    uint32_t heap_cnt;    // allocations served by HAL_Malloc instead of a pool
+    uint32_t fail_cnt;    // failed allocations
+} MemStat;
+
+/**
+ * @brief state of one fixed-size block pool
+ */
+typedef struct {
+    uint16_t block_size;  // payload size of a block
+    uint16_t block_num;   // blocks in the pool
+    uint16_t used;        // blocks in use
+    uint16_t peak;        // max of used
+    uint32_t exhausted;   // allocations which fell back to HAL_Malloc for lack of a free block
+} MemPoolStat;
+
+/**
+ * @brief Get the memory accounting of one tag
+ *
+ * @param tag       owner of the memory
+ * @param stat      output stat
+ * @return          QCLOUD_RET_SUCCESS for success, or err code for failure
+ */
+int IOT_Mem_Get_Stat(MemTag tag, MemStat *stat);
+
+/**
+ * @brief Get the state of one block pool, pools are ordered by block size
+ *
+ * @param index     pool index, from 0
+ * @param stat      output stat
+ * @return          QCLOUD_RET_SUCCESS for success, QCLOUD_ERR_INVAL past the last pool
+ */
+int IOT_Mem_Get_Pool_Stat(int index, MemPoolStat *stat);
+
+/**
+ * @brief Count and log every SDK allocation served by HAL_Malloc from now on
+ *
+ * Enable it once the device reached steady state, a zero IOT_Mem_Strict_Violations()
+ * afterwards shows publish and receive ran out of the pools only.
+ *
+ * @param enable    true to enable
+ */
+void IOT_Mem_Set_Strict(bool enable);
+
+/**
+ * @brief Get the number of HAL_Malloc allocations done while strict mode was enabled
+ */
+uint32_t IOT_Mem_Strict_Violations(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QCLOUD_IOT_EXPORT_MEM_H_ */
@@ -56,6 +56,17 @@ typedef MQTTMessage PublishParams;
         QOS0, 0, 0, 0, NULL, 0, NULL, 0 \
     }
 
+/* Max length of a topic name */
+#define MAX_SIZE_OF_MQTT_TOPIC ((MAX_SIZE_OF_DEVICE_NAME) + (MAX_SIZE_OF_PRODUCT_ID) + 64 + 6)
+
+/**
+ * @brief A publish topic checked and encoded once by IOT_MQTT_Topic_Init
+ */
+typedef struct {
+    uint16_t      len;                              // length of the topic name
+    unsigned char wire[MAX_SIZE_OF_MQTT_TOPIC + 3];  // 2-byte length and topic name as sent, then '\0'
+} MQTTTopicHandle;
+
 typedef enum {
 
     /* MQTT undefined event */
@@ -173,24 +184,27 @@ typedef struct {
     uint32_t         keep_alive_interval_ms;  // MQTT keep alive time interval in millisecond
     uint8_t          clean_session;           // flag of clean session, 1 clean, 0 not clean
     uint8_t          auto_connect_enable;     // flag of auto reconnection, 1 is enable and recommended
+    uint8_t          mqtt_version;            // MQTT protocol version, 4 = 3.1.1, 5 = 5.0 (needs MQTT5_ENABLED)
     MQTTEventHandler event_handle;            // event callback
 
     int err_code;
 
+    char *host;  // server host name or address, NULL for <product_id>.QCLOUD_IOT_MQTT_DIRECT_DOMAIN
+
 } MQTTInitParams;
 
 /**
  * Default MQTT init parameters
  */
 #ifdef AUTH_MODE_CERT
-#define DEFAULT_MQTTINIT_PARAMS                              \
-    {                                                        \
-        NULL, NULL, {0}, {0}, 5000, 240 * 1000, 1, 1, {0}, 0 \
+#define DEFAULT_MQTTINIT_PARAMS                                       \
+    {                                                                 \
+        NULL, NULL, {0}, {0}, 5000, 240 * 1000, 1, 1, 4, {0}, 0, NULL \
     }
 #else
-#define DEFAULT_MQTTINIT_PARAMS                          \
-    {                                                    \
-        NULL, NULL, NULL, 5000, 240 * 1000, 1, 1, {0}, 0 \
+#define DEFAULT_MQTTINIT_PARAMS                                   \
+    {                                                             \
+        NULL, NULL, NULL, 5000, 240 * 1000, 1, 1, 4, {0}, 0, NULL \
     }
 #endif
 
@@ -234,6 +248,30 @@ int IOT_MQTT_Yield(void *pClient, uint32_t timeout_ms);
  */
 int IOT_MQTT_Publish(void *pClient, char *topicName, PublishParams *pParams);
 
+/**
+ * @brief Check a publish topic and encode it for IOT_MQTT_Publish_Topic
+ *
+ * Services publishing to the same topic again and again keep the handle, so each
+ * publish copies the encoded topic instead of formatting, measuring and encoding it.
+ *
+ * @param pTopic        topic handle to fill
+ * @param topicName     MQTT topic name, no wildcards
+ *
+ * @return QCLOUD_RET_SUCCESS for success, or err code for failure
+ */
+int IOT_MQTT_Topic_Init(MQTTTopicHandle *pTopic, const char *topicName);
+
+/**
+ * @brief Publish MQTT message to a topic encoded by IOT_MQTT_Topic_Init
+ *
+ * @param pClient       handle to MQTT client
+ * @param pTopic        topic handle
+ * @param pParams       publish parameters
+ *
+ * @return packet id (>=0) when success, or err code (<0) for failure
+ */
+int IOT_MQTT_Publish_Topic(void *pClient, const MQTTTopicHandle *pTopic, PublishParams *pParams);
+
 /**
  * @brief Subscribe MQTT topic
  *
@@ -273,6 +311,26 @@ bool IOT_MQTT_IsSubReady(void *pClient, char *topicFilter);
  */
 bool IOT_MQTT_IsConnected(void *pClient);
 
+/**
+ * @brief Get the socket of the MQTT connection, to wait for its readability together with other clients
+ *
+ * One thread can then serve many clients, calling IOT_MQTT_Yield only on those with data to read.
+ * Wait on the socket only when IOT_MQTT_ReadPending() is false, and still yield every client within
+ * its keep alive interval, as the ping and the ack timeouts are handled in yield.
+ *
+ * @param pClient       handle to MQTT client
+ * @return socket descriptor (>=0) when connected, or err code (<0) when not connected or not a socket
+ */
+int IOT_MQTT_GetFd(void *pClient);
+
+/**
+ * @brief Check if received data is already buffered under the MQTT client, where its socket won't signal it
+ *
+ * @param pClient       handle to MQTT client
+ * @return true when IOT_MQTT_Yield has data to handle at once
+ */
+bool IOT_MQTT_ReadPending(void *pClient);
+
 /**
  * @brief Get error code of last IOT_MQTT_Construct operation
  *
@@ -288,6 +346,39 @@ int IOT_MQTT_GetErrCode(void);
  */
 DeviceInfo *IOT_MQTT_GetDeviceInfo(void *pClient);
 
+/**
+ * @brief counters of reconnection
+ */
+typedef struct {
+    uint32_t disconnects;  // connections lost
+    uint32_t reconnects;   // connections restored
+    uint32_t attempts;     // connect attempts while reconnecting, one for each server tried
+    uint32_t failovers;    // switches to another server after a failed attempt
+    uint32_t last_ms;      // time from losing the connection to restoring it, the last time
+    uint32_t max_ms;       // max of last_ms
+    uint32_t total_ms;     // sum of last_ms, divide by reconnects for the average
+} MQTTReconnectStat;
+
+/**
+ * @brief Set backup MQTT servers. When reconnecting fails, the next server is tried at once, the one
+ * connected last is tried first next time. Call it before IOT_MQTT_StartLoop.
+ *
+ * @param pClient       handle to MQTT client
+ * @param hosts         host names or addresses, the port of the main server is used
+ * @param num           number of hosts, MAX_MQTT_BACKUP_HOSTS at most, 0 to clear
+ * @return QCLOUD_RET_SUCCESS when success, err code for failure
+ */
+int IOT_MQTT_Set_Backup_Hosts(void *pClient, const char *hosts[], int num);
+
+/**
+ * @brief Get the counters of reconnection
+ *
+ * @param pClient       handle to MQTT client
+ * @param pStat         output counters
+ * @return QCLOUD_RET_SUCCESS when success, err code for failure
+ */
+int IOT_MQTT_Get_Reconnect_Stat(void *pClient, MQTTReconnectStat *pStat);
+
 #ifdef MULTITHREAD_ENABLED
 /**
  * @brief Start the default loop thread to read and handle MQTT packet
@@ -314,6 +405,68 @@ void IOT_MQTT_StopLoop(void *pClient);
 bool IOT_MQTT_GetLoopStatus(void *pClient, int *exit_code);
 
 void IOT_MQTT_SetLoopStatus(void *pClient, bool loop_status);
+
+/**
+ * @brief What to do with an inbound message when its dispatch queue is full
+ */
+typedef enum {
+    eMQTT_DISPATCH_DROP_NEW = 0,  // drop the new message
+    eMQTT_DISPATCH_BLOCK    = 1,  // hold the yield thread up to block_ms for room, then drop
+} MQTTDispatchPolicy;
+
+/**
+ * @brief Define structure to dispatch message callbacks off the yield thread
+ */
+typedef struct {
+    uint16_t           worker_num;  // worker threads, one topic is always handled by the same worker
+    uint16_t           queue_len;   // messages each worker can hold
+    MQTTDispatchPolicy policy;      // policy when the queue of a worker is full
+    uint32_t           block_ms;    // max wait of eMQTT_DISPATCH_BLOCK
+    uint32_t           stack_size;  // stack of a worker thread, 0 for default
+} MQTTDispatchParams;
+
+/**
+ * Default MQTT dispatch parameters
+ */
+#define DEFAULT_MQTT_DISPATCH_PARAMS           \
+    {                                          \
+        2, 16, eMQTT_DISPATCH_DROP_NEW, 100, 0 \
+    }
+
+/**
+ * @brief counters of the dispatch queue
+ */
+typedef struct {
+    uint32_t enqueued;    // messages copied into the queue
+    uint32_t delivered;   // messages handed to the subscription callback
+    uint32_t dropped;     // messages dropped for a full queue or malloc failure
+    uint32_t blocked;     // times the yield thread waited for room
+    uint16_t depth;       // messages in the queue now
+    uint16_t peak_depth;  // max of depth
+} MQTTDispatchStat;
+
+/**
+ * @brief Run subscription callbacks on a pool of worker threads instead of the yield thread
+ *
+ * Inbound messages are copied into a bounded queue per worker, so a slow callback no longer
+ * delays keep alive, acks and retransmission. Messages of one topic go to the same worker
+ * and are handled in arrival order. Messages matching no subscription still go to the
+ * event handler on the yield thread. The workers are stopped by IOT_MQTT_Destroy.
+ *
+ * @param pClient       handle to MQTT client
+ * @param pParams       dispatch parameters
+ * @return QCLOUD_RET_SUCCESS when success, err code for failure
+ */
+int IOT_MQTT_Dispatch_Start(void *pClient, MQTTDispatchParams *pParams);
+
+/**
+ * @brief Get the counters of the dispatch queue
+ *
+ * @param pClient       handle to MQTT client
+ * @param pStat         output counters
+ * @return QCLOUD_RET_SUCCESS when success, err code for failure
+ */
+int IOT_MQTT_Dispatch_Get_Stat(void *pClient, MQTTDispatchStat *pStat);
 #endif
 
 #ifdef __cplusplus
@@ -75,14 +75,23 @@ typedef enum {
 
 typedef enum {
 
-    IOT_OTAG_FETCHED_SIZE,  /* Size of firmware fetched */
-    IOT_OTAG_FILE_SIZE,     /* Total size of firmware */
-    IOT_OTAG_MD5SUM,        /* firmware md5 checksum (string) */
-    IOT_OTAG_VERSION,       /* firmware version (string) */
-    IOT_OTAG_CHECK_FIRMWARE /* check firmware */
+    IOT_OTAG_FETCHED_SIZE,   /* Size of firmware fetched */
+    IOT_OTAG_FILE_SIZE,      /* Total size of firmware */
+    IOT_OTAG_MD5SUM,         /* firmware md5 checksum (string) */
+    IOT_OTAG_VERSION,        /* firmware version (string) */
+    IOT_OTAG_CHECK_FIRMWARE, /* check firmware */
+    IOT_OTAG_SHA256SUM       /* firmware sha256 checksum from cloud (string), empty if not provided */
 
 } IOT_OTA_CmdType;
 
+/* digests computed over the firmware in one pass while it is fetched */
+typedef enum {
+
+    IOT_OTA_DIGEST_MD5    = (1 << 0), /* checked against md5sum from cloud, always computed */
+    IOT_OTA_DIGEST_SHA256 = (1 << 1), /* checked against sha256sum when cloud provides it */
+
+} IOT_OTA_DigestType;
+
 typedef enum {
 
     IOT_OTAR_DOWNLOAD_TIMEOUT = -1,
@@ -90,6 +99,7 @@ typedef enum {
     IOT_OTAR_AUTH_FAIL        = -3,
     IOT_OTAR_MD5_NOT_MATCH    = -4,
     IOT_OTAR_UPGRADE_FAIL     = -5,
+    IOT_OTAR_SHA256_NOT_MATCH = -6,
     IOT_OTAR_NONE             = 0,
     IOT_OTAR_DOWNLOAD_BEGIN   = 1,
     IOT_OTAR_DOWNLOADING      = 2,
@@ -142,6 +152,41 @@ void IOT_OTA_UpdateClientMd5(void *handle, char *buff, uint32_t size);
 
 int IOT_OTA_ResetClientMD5(void *handle);
 
+/**
+ * @brief Select the digests computed over the firmware, in addition to MD5
+ *        SHA256 is selected automatically when the cloud provides sha256sum
+ *        NOTE: the digests are restarted, so it can't be called while the firmware is being fetched
+ *
+ * @param handle: OTA module handle
+ * @param digests: mask of IOT_OTA_DigestType
+ *
+ * @return QCLOUD_RET_SUCCESS when success, IOT_OTA_ERR_INVALID_STATE while fetching, or err code for failure
+ */
+int IOT_OTA_SetDigest(void *handle, uint32_t digests);
+
+/**
+ * @brief Get one digest of the firmware fetched so far, eg. to verify it against a signed manifest
+ *
+ * @param handle: OTA module handle
+ * @param type: digest to get, must be selected
+ * @param buf: buffer for hex string, 33 bytes for MD5 and 65 bytes for SHA256
+ * @param buf_len: length of buffer
+ *
+ * @return QCLOUD_RET_SUCCESS when success, or err code for failure
+ */
+int IOT_OTA_GetDigest(void *handle, IOT_OTA_DigestType type, char *buf, size_t buf_len);
+
+/**
+ * @brief Get the cost of hashing the firmware fetched so far
+ *
+ * @param handle: OTA module handle
+ * @param hashed_bytes: bytes run through the digests
+ * @param hash_ms: time spent in the digests, hashed_bytes / hash_ms is the throughput in kB/s
+ *
+ * @return QCLOUD_RET_SUCCESS when success, or err code for failure
+ */
+int IOT_OTA_GetDigestStat(void *handle, uint32_t *hashed_bytes, uint32_t *hash_ms);
+
 /**
  * @brief Report local firmware version to server
  *        NOTE: do this report before real download
@@ -230,6 +275,7 @@ int IOT_OTA_FetchYield(void *handle, char *buf, uint32_t buf_len, uint32_t timeo
       3) if type==IOT_OTAG_MD5SUM, 'buf' = char array buffer, 'buf_len = 33
       4) if type==IOT_OTAG_VERSION, 'buf'= char array buffer, 'buf_len = OTA_VERSION_LEN_MAX
       5) if type==IOT_OTAG_CHECK_FIRMWARE, 'buf' = uint32_t pointer, 'buf_len' = 4
+      6) if type==IOT_OTAG_SHA256SUM, 'buf' = char array buffer, 'buf_len = 65
  *
  * @retval   0 : success
  * @retval < 0 : error code for failure
@@ -62,12 +62,100 @@ int IOT_Subscribe_Config(void *client, ConfigSubscirbeUserData *config_sub_userd
  * @param client            MQTTClient pointer
  * @param json_buffer       store create json string
  * @param buffer_size       pJsonBuffer len min 20B
- * @param reply_timeout		wait cloud platform reply max time, ms
+ * @param reply_timeout		wait cloud platform reply max time, ms; 0 to return once the request is sent
  * @return                  QCLOUD_RET_SUCCESS for success
  *                          otherwise, failure
  */
 int IOT_Get_Config(void *client, char *json_buffer, int buffer_size, int reply_timeout);
 
+/* max number of key watchers per config cache */
+#ifndef MAX_CONFIG_KEY_WATCHERS
+#define MAX_CONFIG_KEY_WATCHERS 8
+#endif
+
+/* max length of a watched config key */
+#ifndef MAX_CONFIG_KEY_LEN
+#define MAX_CONFIG_KEY_LEN 32
+#endif
+
+/**
+ * @brief called for each top level key that changed in the config document
+ *
+ * @param cache                config cache handle
+ * @param key                  the key changed
+ * @param value                new value in the cached document, not '\0' terminated; NULL if the key was removed
+ * @param value_len            length of value
+ * @param user_data            user data given to IOT_Config_Cache_Watch
+ * @return                     void
+ */
+typedef void (*OnConfigKeyChangedHandler)(void *cache, const char *key, const char *value, int value_len,
+                                          void *user_data);
+
+/**
+ * @brief Create a config cache and load the last config saved by HAL_Config_Save, no network access
+ *
+ * @param config_max_len       max length of the config json document
+ * @return                     config cache handle when success, or NULL otherwise
+ */
+void *IOT_Config_Cache_Init(int config_max_len);
+
+/**
+ * @brief Destroy the config cache, unbinding it from its MQTT client
+ *
+ * @param cache                config cache handle
+ */
+void IOT_Config_Cache_Deinit(void *cache);
+
+/**
+ * @brief Register a callback for changes of one key, register before IOT_Config_Cache_Bind
+ *
+ * @param cache                config cache handle
+ * @param key                  top level key to watch, NULL for every key
+ * @param handler              callback when the key changed
+ * @param user_data            user data for the callback
+ * @return                     QCLOUD_RET_SUCCESS for success
+ *                             otherwise, failure
+ */
+int IOT_Config_Cache_Watch(void *cache, const char *key, OnConfigKeyChangedHandler handler, void *user_data);
+
+/**
+ * @brief Keep the config cache in sync with the cloud through an MQTT client
+ *
+ * Subscribes the config topic and returns without waiting. The config is requested
+ * each time the subscription is acked (also after reconnect), and updates are
+ * applied and notified asynchronously from the yield context.
+ *
+ * @param client               MQTTClient pointer
+ * @param cache                config cache handle
+ * @return                     QCLOUD_RET_SUCCESS for success
+ *                             otherwise, failure
+ */
+int IOT_Config_Cache_Bind(void *client, void *cache);
+
+/**
+ * @brief Copy the cached config document
+ *
+ * @param cache                config cache handle
+ * @param json_buffer          buffer for the config json document, "" if none cached yet
+ * @param buffer_size          buffer size
+ * @param version              output local version of the document, increased on every change; NULL if not needed
+ * @return                     QCLOUD_RET_SUCCESS for success
+ *                             otherwise, failure
+ */
+int IOT_Config_Cache_Get(void *cache, char *json_buffer, int buffer_size, uint32_t *version);
+
+/**
+ * @brief Copy the value of one top level key from the cached config
+ *
+ * @param cache                config cache handle
+ * @param key                  top level key
+ * @param value                buffer for the value, string values without quotes
+ * @param value_size           buffer size
+ * @return                     length of the value for success
+ *                             otherwise, failure
+ */
+int IOT_Config_Cache_Get_Value(void *cache, const char *key, char *value, int value_size);
+
 #ifdef __cplusplus
 }
 #endif
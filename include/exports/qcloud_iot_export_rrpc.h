@@ -32,6 +32,12 @@ extern "C" {
 /* Max len of process id*/
 #define MAX_RRPC_PROCESS_ID_LEN 16
 
+/* Default max RRPC requests in flight, a request is in flight until replied or expired */
+#define DEFAULT_RRPC_CONCURRENCY 4
+
+/* Default time allowed to reply a RRPC request, the cloud stops waiting after 5s */
+#define DEFAULT_RRPC_DEADLINE_MS 5000
+
 typedef enum _eRRPCReplyCode_ {
     eRRPC_SUCCESS = 0,
     eRRPC_FAIL    = -1,
@@ -52,6 +58,35 @@ typedef struct _sRRPCReplyPara {
  */
 typedef void (*OnRRPCMessageCallback)(void *pClient, const char *msg, uint32_t msgLen);
 
+/**
+ * @brief context of one RRPC request, needed to reply it
+ *
+ * It is a plain value: copy it to reply later or from another thread.
+ */
+typedef struct _sRRPCContext {
+    uint32_t seq;                                      // request sequence, tells stale contexts apart
+    char     process_id[MAX_RRPC_PROCESS_ID_LEN + 1];  // process id from the request topic
+} sRRPCContext;
+
+/**
+ * @brief RRPC request callback, msg is only valid during the callback
+ */
+typedef void (*OnRRPCRequestCallback)(void *pClient, const sRRPCContext *ctx, const char *msg, uint32_t msgLen,
+                                      void *userContext);
+
+/**
+ * @brief RRPC dispatcher parameters
+ */
+typedef struct {
+    OnRRPCRequestCallback callback;      // request handler
+    void *                user_context;  // passed to callback
+    uint16_t              concurrency;   // max requests in flight, 0 for DEFAULT_RRPC_CONCURRENCY
+    uint16_t              worker_num;    // handler threads, 0 to run handlers on the yield thread
+    uint32_t              deadline_ms;   // time to reply a request, 0 for DEFAULT_RRPC_DEADLINE_MS
+} RRPCInitParams;
+
+#define DEFAULT_RRPC_INIT_PARAMS {NULL, NULL, 0, 0, 0}
+
 /**
  * @brief Subscribe rrpc topic with message callback
  *
@@ -61,6 +96,19 @@ typedef void (*OnRRPCMessageCallback)(void *pClient, const char *msg, uint32_t m
  */
 int IOT_RRPC_Init(void *pClient, OnRRPCMessageCallback callback);
 
+/**
+ * @brief Subscribe rrpc topic and dispatch requests with their own context
+ *
+ * Requests beyond the concurrency limit are dropped. With worker_num > 0
+ * (MULTITHREAD_ENABLED only) handlers run on a pool of threads, so a slow
+ * handler no longer blocks the yield thread.
+ *
+ * @param pClient pointer of handle to MQTT client
+ * @param params  dispatcher parameters
+ * @return  QCLOUD_RET_SUCCESS when success, otherwise fail
+ */
+int IOT_RRPC_Init_Dispatcher(void *pClient, RRPCInitParams *params);
+
 /**
  * @brief  reply to the rrpc msg
  * @param pClient       handle to mqtt client
@@ -73,6 +121,19 @@ int IOT_RRPC_Init(void *pClient, OnRRPCMessageCallback callback);
  */
 int IOT_RRPC_Reply(void *pClient, char *pJsonDoc, size_t sizeOfBuffer, sRRPCReplyPara *replyPara);
 
+/**
+ * @brief  reply to the rrpc request identified by ctx, from any thread
+ * @param pClient       handle to mqtt client
+ * @param ctx           context given to the request callback
+ * @param pJsonDoc      data buffer for reply
+ * @param sizeOfBuffer  length of data buffer
+ * @param replyPara     rrpc reply info
+ * @return	        QCLOUD_RET_SUCCESS when success, QCLOUD_ERR_RRPC_REPLY_TIMEOUT when
+ * the request expired or was already replied, or err code for failure
+ */
+int IOT_RRPC_Reply_Request(void *pClient, const sRRPCContext *ctx, char *pJsonDoc, size_t sizeOfBuffer,
+                           sRRPCReplyPara *replyPara);
+
 #endif
 
 #ifdef __cplusplus
@@ -27,6 +27,11 @@ typedef enum _eShadowType_ {
     eTEMPLATE = 1,  // data template
 } eShadowType;
 
+typedef enum _eShadowPayloadFormat_ {
+    eSHADOW_PAYLOAD_JSON = 0,  // text JSON
+    eSHADOW_PAYLOAD_CBOR = 1,  // CBOR (RFC 8949), needs FEATURE_CBOR_PAYLOAD_ENABLED and a cloud side decoding it
+} eShadowPayloadFormat;
+
 /* The structure of MQTT shadow init parameters */
 typedef struct {
     /* device info */
@@ -40,23 +45,26 @@ typedef struct {
     char *device_secret;  // device secret
 #endif
 
-    uint32_t         command_timeout;         // timeout value (unit: ms) for MQTT connect/pub/sub/yield
-    uint32_t         keep_alive_interval_ms;  // MQTT keep alive time interval in millisecond
-    uint8_t          clean_session;           // flag of clean session, 1 clean, 0 not clean
-    uint8_t          auto_connect_enable;     // flag of auto reconnection, 1 is enable and recommended
-    MQTTEventHandler event_handle;            // event callback
-    eShadowType      shadow_type;             // shadow type
+    uint32_t             command_timeout;         // timeout value (unit: ms) for MQTT connect/pub/sub/yield
+    uint32_t             keep_alive_interval_ms;  // MQTT keep alive time interval in millisecond
+    uint8_t              clean_session;           // flag of clean session, 1 clean, 0 not clean
+    uint8_t              auto_connect_enable;     // flag of auto reconnection, 1 is enable and recommended
+    uint8_t              mqtt_version;            // MQTT protocol version, 4 = 3.1.1, 5 = 5.0 (needs MQTT5_ENABLED)
+    MQTTEventHandler     event_handle;            // event callback
+    eShadowType          shadow_type;             // shadow type
+    eShadowPayloadFormat payload_format;          // format of get requests, replies in either format are accepted
+    char *               host;                    // server host name or address, NULL for the default one
 } ShadowInitParams;
 
 #ifdef AUTH_MODE_CERT
-#define DEFAULT_SHAWDOW_INIT_PARAMS                          \
-    {                                                        \
-        NULL, NULL, {0}, {0}, 5000, 240 * 1000, 1, 1, {0}, 0 \
+#define DEFAULT_SHAWDOW_INIT_PARAMS                                      \
+    {                                                                    \
+        NULL, NULL, {0}, {0}, 5000, 240 * 1000, 1, 1, 4, {0}, 0, 0, NULL \
     }
 #else
-#define DEFAULT_SHAWDOW_INIT_PARAMS                      \
-    {                                                    \
-        NULL, NULL, NULL, 5000, 240 * 1000, 1, 1, {0}, 0 \
+#define DEFAULT_SHAWDOW_INIT_PARAMS                                  \
+    {                                                                \
+        NULL, NULL, NULL, 5000, 240 * 1000, 1, 1, 4, {0}, 0, 0, NULL \
     }
 #endif
 
@@ -151,6 +159,25 @@ typedef void (*OnRequestCallback)(void *pClient, Method method, RequestAck reque
 typedef void (*OnPropRegCallback)(void *pClient, const char *pJsonValueBuffer, uint32_t valueLength,
                                   DeviceProperty *pProperty);
 
+/**
+ * @brief Define callback when delta arrived, with the whole delta object
+ *
+ * @param pJsonDelta    delta JSON object, eg. {"color":1,"brightness":50}
+ * @param deltaLength   delta length
+ * @param userContext   user context
+ */
+typedef void (*OnShadowDeltaCallback)(void *pClient, char *pJsonDelta, uint32_t deltaLength, void *userContext);
+
+/**
+ * @brief Define encoder writing the members of reported object
+ *
+ * @param pJsonBuffer   where to write members, each one as "key":value,
+ * @param sizeOfBuffer  size left in the buffer
+ * @param userContext   user context
+ * @return              length written, or err code for failure
+ */
+typedef int (*OnShadowReportEncode)(char *pJsonBuffer, size_t sizeOfBuffer, void *userContext);
+
 /**
  * @brief Create MQTT Shadow client and connect to MQTT server
  *
@@ -254,6 +281,24 @@ int IOT_Shadow_Update(void *pClient, char *pJsonDoc, size_t sizeOfBuffer, OnRequ
  */
 int IOT_Shadow_Update_Sync(void *pClient, char *pJsonDoc, size_t sizeOfBuffer, uint32_t timeout_ms);
 
+#ifdef CBOR_PAYLOAD_ENABLED
+/**
+ * @brief Update device shadow with a CBOR document in asynchronized way, the
+ *        document is sent as is and has to carry type and clientToken, as the
+ *        ones of IOT_Shadow_CBOR_ConstructReportArray
+ *
+ * @param pClient           handle to shadow client
+ * @param pCborDoc          CBOR document for update
+ * @param docLength         length of CBOR document
+ * @param callback          callback when response arrive
+ * @param userContext       user data for callback
+ * @param timeout_ms        timeout value for this operation (unit: ms)
+ * @return                  QCLOUD_RET_SUCCESS when success, or err code for failure
+ */
+int IOT_Shadow_Update_CBOR(void *pClient, const uint8_t *pCborDoc, size_t docLength, OnRequestCallback callback,
+                           void *userContext, uint32_t timeout_ms);
+#endif
+
 /**
  * @brief Get device shadow document in asynchronized way
  *
@@ -293,6 +338,17 @@ int IOT_Shadow_Register_Property(void *pClient, DeviceProperty *pProperty, OnPro
  */
 int IOT_Shadow_UnRegister_Property(void *pClient, DeviceProperty *pProperty);
 
+/**
+ * @brief Register callback for the whole delta, eg. a codec generated by tools/codegen.py,
+ *        called before the callbacks of registered properties
+ *
+ * @param pClient           handle to shadow client
+ * @param callback          callback when delta arrived, NULL to unregister
+ * @param userContext       user context for callback
+ * @return                  QCLOUD_RET_SUCCESS when success, or err code for failure
+ */
+int IOT_Shadow_Register_Delta(void *pClient, OnShadowDeltaCallback callback, void *userContext);
+
 /**
  * @brief Add reported fields in JSON document, don't overwrite
  *
@@ -317,6 +373,35 @@ int IOT_Shadow_JSON_ConstructReport(void *pClient, char *jsonBuffer, size_t size
 int IOT_Shadow_JSON_ConstructReportArray(void *pClient, char *jsonBuffer, size_t sizeOfBuffer, uint8_t count,
                                          DeviceProperty *pDeviceProperties[]);
 
+/**
+ * @brief Add reported fields written by encoder in JSON document, don't overwrite
+ *
+ * @param pClient       handle to shadow client
+ * @param jsonBuffer    string buffer to store JSON document
+ * @param sizeOfBuffer  size of string buffer
+ * @param encoder       writes the reported members in place
+ * @param userContext   user context for encoder
+ * @return              QCLOUD_RET_SUCCESS when success, or err code for failure
+ */
+int IOT_Shadow_JSON_ConstructReportEncoded(void *pClient, char *jsonBuffer, size_t sizeOfBuffer,
+                                           OnShadowReportEncode encoder, void *userContext);
+
+#ifdef CBOR_PAYLOAD_ENABLED
+/**
+ * @brief Construct a CBOR update request with reported fields, for IOT_Shadow_Update_CBOR.
+ *        Numbers keep their binary form, floats take 3 or 5 bytes instead of up to 16 chars.
+ *
+ * @param pClient       handle to shadow client
+ * @param cborBuffer    buffer to store CBOR document
+ * @param sizeOfBuffer  size of buffer
+ * @param count         number of properties
+ * @param pDeviceProperties array of properties
+ * @return              length of document when success, or err code for failure
+ */
+int IOT_Shadow_CBOR_ConstructReportArray(void *pClient, uint8_t *cborBuffer, size_t sizeOfBuffer, uint8_t count,
+                                         DeviceProperty *pDeviceProperties[]);
+#endif
+
 /**
  * @brief Add reported fields in JSON document, overwrite
  *
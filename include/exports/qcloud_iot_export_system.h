@@ -20,6 +20,26 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include <stdint.h>
+
+/* exchanges per IOT_Sync_Clock() round, the one with the smallest round trip wins */
+#define DEFAULT_CLOCK_SYNC_SAMPLES (4)
+#define MAX_CLOCK_SYNC_SAMPLES     (8)
+
+/* max time to wait for the reply of one time exchange */
+#define SYS_TIME_WAIT_TIMEOUT_MS (2000)
+
+/**
+ * @brief state of the SDK clock disciplined by IOT_Sync_Clock()
+ */
+typedef struct {
+    bool     synced;         // synced with the cloud at least once
+    uint32_t rtt_ms;         // round trip of the exchange the clock is anchored on
+    int32_t  drift_ppb;      // rate correction applied to HAL_GetTimeMs(), parts per billion
+    uint32_t since_sync_ms;  // time since the last sync
+} ClockStatus;
+
 /**
  * @brief Get system timestamp from MQTT server
  *
@@ -33,12 +53,48 @@ int IOT_Get_SysTime(void* pClient, long* time);
 /**
  * @brief sync ntp timestamp from MQTT server
  *
+ * Syncs the SDK clock (see IOT_Sync_Clock) and then sets the OS time with HAL_Timer_set_systime_sec/ms.
+ * A failure to set the OS time, e.g. for lack of permission, is logged but not returned, as the SDK clock
+ * is synced anyway.
+ *
  * @param pClient           MQTTClient pointer
- * @return                  QCLOUD_RET_SUCCESS for success
+ * @return                  QCLOUD_RET_SUCCESS when the SDK clock is synced
  *                          otherwise, failure
  */
 int IOT_Sync_NTPTime(void* pClient);
 
+/**
+ * @brief Sync the SDK clock with MQTT server, without touching the OS clock
+ *
+ * Does several time exchanges, anchors the SDK clock on the one with the
+ * smallest round trip and tracks the drift of HAL_GetTimeMs() across syncs.
+ * Call it again every few hours to keep the drift estimate fresh.
+ *
+ * @param pClient           MQTTClient pointer
+ * @param samples           exchanges to do, <= 0 for DEFAULT_CLOCK_SYNC_SAMPLES
+ * @return                  QCLOUD_RET_SUCCESS for success
+ *                          otherwise, failure
+ */
+int IOT_Sync_Clock(void* pClient, int samples);
+
+/**
+ * @brief Get cloud time in millisecond from the SDK clock, no network access
+ *
+ * Before the first sync this is the local time of HAL_Timer_current_sec().
+ *
+ * @return                  UTC timestamp in millisecond
+ */
+uint64_t IOT_Get_Clock_Ms(void);
+
+/**
+ * @brief Get the state of the SDK clock
+ *
+ * @param status            output status
+ * @return                  QCLOUD_RET_SUCCESS for success
+ *                          otherwise, failure
+ */
+int IOT_Get_Clock_Status(ClockStatus* status);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,107 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __LITE_CBOR_H__
+#define __LITE_CBOR_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* count of LITE_cbor_begin_array/map for a container closed by LITE_cbor_end */
+#define LITE_CBOR_INDEFINITE ((size_t)-1)
+
+/* nesting deeper than this is rejected when skipping items */
+#ifndef LITE_CBOR_MAX_DEPTH
+#define LITE_CBOR_MAX_DEPTH (16)
+#endif
+
+typedef enum {
+    LITE_CBOR_UINT,
+    LITE_CBOR_NINT,
+    LITE_CBOR_BYTES,
+    LITE_CBOR_TEXT,
+    LITE_CBOR_ARRAY,
+    LITE_CBOR_MAP,
+    LITE_CBOR_TAG,
+    LITE_CBOR_FALSE,
+    LITE_CBOR_TRUE,
+    LITE_CBOR_NULL,
+    LITE_CBOR_UNDEFINED,
+    LITE_CBOR_FLOAT,
+    LITE_CBOR_BREAK,
+} LITE_cbor_type;
+
+/* streaming encoder (RFC 8949), overflow is sticky and checked once by LITE_cbor_writer_finish */
+typedef struct {
+    uint8_t *buf;
+    size_t   size;
+    size_t   len;  // bytes written, or needed when beyond size
+} LITE_cbor_writer;
+
+typedef struct {
+    LITE_cbor_type type;
+    uint64_t       u;    // UINT value, NINT as -1 - u, TAG number, ARRAY/MAP count or LITE_CBOR_INDEFINITE
+    double         d;    // FLOAT value
+    const uint8_t *ptr;  // BYTES/TEXT content, ARRAY/MAP encoding from its head
+    size_t         len;  // BYTES/TEXT length, ARRAY/MAP encoded length once skipped
+} LITE_cbor_item;
+
+/* pull decoder over a buffer, items are never copied */
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+} LITE_cbor_reader;
+
+void LITE_cbor_writer_init(LITE_cbor_writer *w, void *buf, size_t size);
+/* length written, or QCLOUD_ERR_BUF_TOO_SHORT if any item did not fit */
+int LITE_cbor_writer_finish(LITE_cbor_writer *w);
+
+void LITE_cbor_put_uint(LITE_cbor_writer *w, uint64_t value);
+void LITE_cbor_put_int(LITE_cbor_writer *w, int64_t value);
+/* shortest of half/single/double precision holding value exactly */
+void LITE_cbor_put_float(LITE_cbor_writer *w, float value);
+void LITE_cbor_put_double(LITE_cbor_writer *w, double value);
+void LITE_cbor_put_bool(LITE_cbor_writer *w, bool value);
+void LITE_cbor_put_null(LITE_cbor_writer *w);
+void LITE_cbor_put_text(LITE_cbor_writer *w, const char *str, size_t len);
+void LITE_cbor_put_string(LITE_cbor_writer *w, const char *str);
+void LITE_cbor_put_bytes(LITE_cbor_writer *w, const void *data, size_t len);
+/* count items/pairs follow, or LITE_CBOR_INDEFINITE and LITE_cbor_end after them */
+void LITE_cbor_begin_array(LITE_cbor_writer *w, size_t count);
+void LITE_cbor_begin_map(LITE_cbor_writer *w, size_t count);
+void LITE_cbor_end(LITE_cbor_writer *w);
+
+void LITE_cbor_reader_init(LITE_cbor_reader *r, const void *buf, size_t len);
+/* next item, containers are entered, QCLOUD_ERR_FAILURE on malformed or truncated data */
+int LITE_cbor_read(LITE_cbor_reader *r, LITE_cbor_item *item);
+/* after LITE_cbor_read of a container, move past its children and fill item->len */
+int LITE_cbor_skip(LITE_cbor_reader *r, LITE_cbor_item *item);
+
+/* numeric item as int64/double, QCLOUD_ERR_FAILURE for other types or out of range */
+int LITE_cbor_item_to_int64(const LITE_cbor_item *item, int64_t *value);
+int LITE_cbor_item_to_double(const LITE_cbor_item *item, double *value);
+
+/* true if buf starts with a CBOR map, which a JSON document never does */
+bool LITE_cbor_is_map(const void *buf, size_t len);
+/* value of key in the CBOR map buf, key may be a path as "payload.state" like LITE_json_value_of */
+int LITE_cbor_map_find(const void *buf, size_t len, const char *key, LITE_cbor_item *value);
+
+/* member of a CBOR map with a text key, return non zero to stop */
+typedef int (*LITE_cbor_member_cb)(const char *key, int key_len, const LITE_cbor_item *value, void *ctx);
+/* call cb for each member of the CBOR map buf in one pass */
+int LITE_cbor_for_each_member(const void *buf, size_t len, LITE_cbor_member_cb cb, void *ctx);
+
+#endif /* __LITE_CBOR_H__ */
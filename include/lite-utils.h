@@ -62,6 +62,11 @@ list_head_t *LITE_json_keys_of(char *src, char *prefix);
 void         LITE_json_keys_release(list_head_t *keylist);
 char *       LITE_json_string_value_strip_transfer(char *key, char *src);
 
+/* member of a JSON object, string values without quotes, return non zero to stop */
+typedef int (*LITE_json_member_cb)(const char *key, int key_len, const char *value, int value_len, void *ctx);
+/* call cb for each member of the JSON object src in one pass, QCLOUD_ERR_FAILURE if there is none */
+int LITE_json_for_each_member(char *src, int src_len, LITE_json_member_cb cb, void *ctx);
+
 int LITE_get_int32(int32_t *value, char *src);
 int LITE_get_int16(int16_t *value, char *src);
 int LITE_get_int8(int8_t *value, char *src);
@@ -72,6 +77,22 @@ int LITE_get_float(float *value, char *src);
 int LITE_get_double(double *value, char *src);
 int LITE_get_boolean(bool *value, char *src);
 
+/* longest output of LITE_xxx_to_str, with the terminating '\0' */
+#define LITE_NUMBER_STR_MAX_LEN (32)
+
+/* parse the leading decimal integer of src, QCLOUD_ERR_FAILURE if there is none or out of [min, max] */
+int LITE_str_to_int64(const char *src, int64_t min, int64_t max, int64_t *value);
+int LITE_str_to_uint64(const char *src, uint64_t max, uint64_t *value);
+/* parse the leading JSON number of src, no hex/inf/nan; beyond 19 digits or 1e22 falls back to strtod */
+int LITE_str_to_double(const char *src, double *value);
+
+/* write value and '\0' to buf, return length written or QCLOUD_ERR_FAILURE if size is too small */
+int LITE_int64_to_str(int64_t value, char *buf, size_t size);
+int LITE_uint64_to_str(uint64_t value, char *buf, size_t size);
+/* shortest digits reading back to value, NaN and infinity as "null" */
+int LITE_double_to_str(double value, char *buf, size_t size);
+int LITE_float_to_str(float value, char *buf, size_t size);
+
 typedef struct _json_key_t {
     char *      key;
     list_head_t list;
@@ -79,10 +79,12 @@ typedef struct {
 #include "qcloud_iot_export_rrpc.h"
 #include "qcloud_iot_export_broadcast.h"
 #include "qcloud_iot_export_coap.h"
+#include "qcloud_iot_export_crypto.h"
 #include "qcloud_iot_export_dynreg.h"
 #include "qcloud_iot_export_error.h"
 #include "qcloud_iot_export_gateway.h"
 #include "qcloud_iot_export_log.h"
+#include "qcloud_iot_export_mem.h"
 #include "qcloud_iot_export_mqtt.h"
 #include "qcloud_iot_export_ota.h"
 #include "qcloud_iot_export_shadow.h"
@@ -33,6 +33,9 @@
 /* default MQTT Rx buffer size, MAX: 16*1024 */
 #define QCLOUD_IOT_MQTT_RX_BUF_LEN (2048)
 
+/* TLS record payload limit MQTT asks the server for (512/1024/2048/4096), 0 for no limit */
+#define QCLOUD_IOT_MQTT_TLS_MAX_FRAG_LEN (0)
+
 /* default COAP Tx buffer size, MAX: 1*1024 */
 #define COAP_SENDMSG_MAX_BUFLEN (512)
 
@@ -42,6 +45,9 @@
 /* MAX MQTT reconnect interval (unit: ms) */
 #define MAX_RECONNECT_WAIT_INTERVAL (60 * 1000)
 
+/* MAX number of backup MQTT servers set by IOT_MQTT_Set_Backup_Hosts */
+#define MAX_MQTT_BACKUP_HOSTS (2)
+
 /* MAX valid time when connect to MQTT server. 0: always valid */
 /* Use this only if the device has accurate UTC time. Otherwise, set to 0 */
 #define MAX_ACCESS_EXPIRE_TIMEOUT (0)
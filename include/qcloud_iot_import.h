@@ -127,6 +127,17 @@ int HAL_MutexTryLock(_IN_ void *mutex);
  */
 void HAL_MutexUnlock(_IN_ void *mutex);
 
+/**
+ * @brief Run an init routine exactly once
+ *
+ * Concurrent callers return only after the routine has finished. Used for SDK globals (locks, pools, library hooks)
+ * that are set up on first use. The routine must not call HAL_Once itself.
+ *
+ * @param once          once flag, a static int initialized to 0
+ * @param init_routine  routine to run
+ */
+void HAL_Once(_IN_ int *once, _IN_ void (*init_routine)(void));
+
 /**
  * @brief Malloc memory
  *
@@ -176,6 +187,9 @@ int HAL_Vsnprintf(_OU_ char *str, _IN_ const int len, _IN_ const char *fmt, _IN_
 /**
  * @brief Get timestamp in millisecond
  *
+ * The counter should be monotonic (eg. a tick counter) and may wrap around,
+ * the SDK only relies on differences between two readings.
+ *
  * @return   timestamp in millisecond
  */
 uint32_t HAL_GetTimeMs(void);
@@ -360,10 +374,27 @@ typedef struct {
 
     unsigned int timeout_ms;  // SSL handshake timeout in millisecond
 
+    /**
+     * Record payload limit to negotiate with max_fragment_length:
+     * 512/1024/2048/4096, or 0 to keep the default of 16384.
+     * Small-message links like MQTT can use a small value, bulk downloads should keep 0.
+     */
+    uint16_t max_frag_len;
+
 } SSLConnectParams;
 
 typedef SSLConnectParams TLSConnectParams;
 
+/**
+ * @brief Memory footprint of one TLS/DTLS connection
+ */
+typedef struct {
+    size_t heap_cur;        // bytes held by the connection now, record buffers included
+    size_t heap_peak;       // high-water mark, normally reached during the handshake
+    size_t record_buf_len;  // size of each of the input and output record buffers
+    size_t max_frag_len;    // record payload limit in effect after negotiation
+} TLSMemStat;
+
 /**
  * @brief Setup TLS connection with server
  *
@@ -405,6 +436,34 @@ int HAL_TLS_Write(uintptr_t handle, unsigned char *data, size_t totalLen, uint32
  */
 int HAL_TLS_Read(uintptr_t handle, unsigned char *data, size_t totalLen, uint32_t timeout_ms, size_t *read_len);
 
+/**
+ * @brief Get the socket fd under a TLS connection, for poll/epoll in an outer event loop
+ *
+ * Wait for readability on the fd only when HAL_TLS_Pending() is 0, as
+ * decrypted data already buffered in the TLS layer will not wake the fd.
+ *
+ * @param handle        TLS connect handle
+ * @return              socket fd, or -1 if not available
+ */
+int HAL_TLS_GetFd(uintptr_t handle);
+
+/**
+ * @brief Get the number of decrypted bytes that can be read without touching the socket
+ *
+ * @param handle        TLS connect handle
+ * @return              bytes buffered in the TLS layer
+ */
+size_t HAL_TLS_Pending(uintptr_t handle);
+
+/**
+ * @brief Report the memory used by a TLS connection
+ *
+ * @param handle        TLS connect handle
+ * @param stat          filled with the connection's heap usage
+ * @return              QCLOUD_RET_SUCCESS for success, or err code if the TLS library can't account it
+ */
+int HAL_TLS_GetMemStat(uintptr_t handle, TLSMemStat *stat);
+
 /********** DTLS network **********/
 #ifdef COAP_COMM_ENABLED
 typedef SSLConnectParams DTLSConnectParams;
@@ -450,6 +509,15 @@ int HAL_DTLS_Write(uintptr_t handle, const unsigned char *data, size_t datalen,
  */
 int HAL_DTLS_Read(uintptr_t handle, unsigned char *data, size_t datalen, uint32_t timeout_ms, size_t *read_len);
 
+/**
+ * @brief Report the memory used by a DTLS connection
+ *
+ * @param handle        DTLS connect handle
+ * @param stat          filled with the connection's heap usage
+ * @return              QCLOUD_RET_SUCCESS for success, or err code if the TLS library can't account it
+ */
+int HAL_DTLS_GetMemStat(uintptr_t handle, TLSMemStat *stat);
+
 #endif  // COAP_COMM_ENABLED
 #endif  // AUTH_WITH_NOTLS
 
@@ -463,6 +531,19 @@ int HAL_DTLS_Read(uintptr_t handle, unsigned char *data, size_t datalen, uint32_
  */
 uintptr_t HAL_TCP_Connect(const char *host, uint16_t port);
 
+#ifdef HAL_TCP_SOCKET_ENABLED
+/**
+ * @brief Setup TCP connection with server and return the socket itself, for platforms whose HAL_TCP_Connect
+ *        hands out plain sockets. The mbedtls TLS layer connects through it instead of mbedtls_net_connect
+ *
+ * @host    server address
+ * @port    server port
+ * @fd      socket connected, in blocking mode
+ * @return  QCLOUD_RET_SUCCESS, QCLOUD_ERR_TCP_UNKNOWN_HOST, QCLOUD_ERR_TCP_SOCKET_FAILED or QCLOUD_ERR_TCP_CONNECT
+ */
+int HAL_TCP_ConnectSocket(const char *host, uint16_t port, int *fd);
+#endif
+
 /**
  * @brief Disconnect with server and release resource
  *
@@ -577,6 +658,25 @@ int HAL_Log_Del(void);
 size_t HAL_Log_Get_Size(void);
 #endif
 
+#ifdef REMOTE_CONFIG_MQTT
+/* Functions for saving/reading the cached remote config into/from NVS(files/FLASH) */
+/**
+ * @brief Functions for saving the remote config cache into NVS(files/FLASH), replacing the previous one
+ * @param config        source config buffer
+ * @param len           length of config to save
+ * @return              length of data save when success, or 0 for failure
+ */
+size_t HAL_Config_Save(const char *config, size_t len);
+
+/**
+ * @brief Functions for reading the remote config cache from NVS(files/FLASH) at startup
+ * @param buf           destination config buffer
+ * @param len           size of the buffer
+ * @return              length of data read when success, or 0 when nothing saved
+ */
+size_t HAL_Config_Read(char *buf, size_t len);
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
@@ -22,6 +22,7 @@
 #include "qcloud_iot_export.h"
 #include "qcloud_iot_import.h"
 #include "utils_param_check.h"
+#include "utils_timer.h"
 
 #define WIFI_CONN_FLAG (1 << 0)
 #define SEND_OK_FLAG   (1 << 1)
@@ -95,9 +96,8 @@ static void urc_close_func(const char *data, size_t size)
 static void urc_recv_func(const char *data, size_t size)
 {
     int      fd;
-    size_t   bfsz = 0, temp_size = 0;
+    size_t   bfsz = 0;
     uint32_t timeout;
-    char *   recv_buf, temp[8];
 
     POINTER_SANITY_CHECK_RTN(data);
 
@@ -110,32 +110,8 @@ static void urc_recv_func(const char *data, size_t size)
     if (fd < 0 || bfsz == 0)
         return;
 
-    recv_buf = HAL_Malloc(bfsz);
-    if (NULL == recv_buf) {
-        Log_e("no memory for URC receive buffer (%d)!", bfsz);
-        /* read and clean the coming data */
-        while (temp_size < bfsz) {
-            if (bfsz - temp_size > sizeof(temp)) {
-                at_client_recv(temp, sizeof(temp), timeout);
-            } else {
-                at_client_recv(temp, bfsz - temp_size, timeout);
-            }
-            temp_size += sizeof(temp);
-        }
-        return;
-    }
-
-    /* sync receive data */
-    if (at_client_recv(recv_buf, bfsz, timeout) != bfsz) {
-        Log_e("receive size(%d) data failed!", bfsz);
-        HAL_Free(recv_buf);
-        return;
-    }
-
-    /* notice the receive buffer and buffer size */
-    if (at_evt_cb_table[AT_SOCKET_EVT_RECV]) {
-        at_evt_cb_table[AT_SOCKET_EVT_RECV](fd, AT_SOCKET_EVT_RECV, recv_buf, bfsz);
-    }
+    /* read payload straight into socket receive blocks, no intermediate buffer */
+    at_socket_recv_data(fd, bfsz, at_client_obj_recv, timeout);
 }
 
 static void urc_busy_p_func(const char *data, size_t size)
@@ -354,6 +330,21 @@ __exit:
     return fd;
 }
 
+#ifdef AT_OS_USED
+/* at_waitFlag() needs all bits, here either SEND OK or SEND FAIL ends the wait */
+static bool esp8266_wait_send_result(uint32_t timeout)
+{
+    Timer timer;
+
+    countdown_ms(&timer, timeout);
+    while (!(at_getFlag() & (SEND_OK_FLAG | SEND_FAIL_FLAG)) && !expired(&timer)) {
+        at_delayms(1);
+    }
+
+    return (at_getFlag() & SEND_OK_FLAG) ? true : false;
+}
+#endif
+
 static int esp8266_send(int fd, const void *buff, size_t len)
 {
     int           ret;
@@ -405,12 +396,10 @@ static int esp8266_send(int fd, const void *buff, size_t len)
             goto __exit;
         }
 #else
-        if (at_waitFlag(SEND_OK_FLAG | SEND_FAIL_FLAG, AT_RESP_TIMEOUT_MS)) {
-            if (at_waitFlag(SEND_FAIL_FLAG, AT_RESP_TIMEOUT_MS)) {
-                Log_e("send fail");
-                ret = QCLOUD_ERR_FAILURE;
-                goto __exit;
-            }
+        if (!esp8266_wait_send_result(AT_RESP_TIMEOUT_MS)) {
+            Log_e("send fail");
+            ret = QCLOUD_ERR_FAILURE;
+            goto __exit;
         }
 #endif
         sent_size += cur_pkt_size;
@@ -430,7 +419,9 @@ __exit:
 static int esp8266_recv_timeout(int fd, void *buf, size_t len, uint32_t timeout)
 {
 #ifndef AT_OS_USED
-    at_client_yeild(NULL, timeout);
+    /* return as soon as one +IPD is landed instead of waiting out the timeout */
+    at_urc urc_recv = {.cmd_prefix = "+IPD", .cmd_suffix = ":", NULL};
+    at_client_yeild(&urc_recv, timeout);
 #endif
     return QCLOUD_RET_SUCCESS;
 }
@@ -159,6 +159,38 @@ void HAL_MutexUnlock(_IN_ void *mutex)
 #endif
 }
 
+void HAL_Once(_IN_ int *once, _IN_ void (*init_routine)(void))
+{
+#ifdef MULTITHREAD_ENABLED
+    /* 0: not run, 1: running, 2: done. The claim is made with the scheduler suspended, the routine runs without */
+    int state;
+
+    for (;;) {
+        vTaskSuspendAll();
+        state = *once;
+        if (0 == state) {
+            *once = 1;
+        }
+        xTaskResumeAll();
+
+        if (2 == state) {
+            return;
+        }
+        if (0 == state) {
+            init_routine();
+            *(volatile int *)once = 2;
+            return;
+        }
+        vTaskDelay(1);
+    }
+#else
+    if (!*once) {
+        init_routine();
+        *once = 1;
+    }
+#endif
+}
+
 #ifdef MULTITHREAD_ENABLED
 
 // platform-dependant thread routine/entry function
@@ -194,7 +226,7 @@ int HAL_ThreadCreate(ThreadParams *params)
 
 #endif
 
-#if defined(PLATFORM_HAS_CMSIS) && defined(AT_TCP_ENABLED)
+#if defined(PLATFORM_HAS_CMSIS) && (defined(AT_TCP_ENABLED) || defined(MULTITHREAD_ENABLED))
 
 void *HAL_SemaphoreCreate(void)
 {
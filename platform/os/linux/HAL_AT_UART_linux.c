@@ -39,7 +39,17 @@
 static void at_uart_irq_recv(void *userContex);
 #endif
 
+#ifndef AT_UART_LINUX_DEV
 #define AT_UART_LINUX_DEV "/dev/ttyUSB0"
+#endif
+
+/* the device can be overridden at runtime, eg. to point at tools/at_modem_sim.py */
+static const char *_at_uart_dev_name(void)
+{
+    const char *dev = getenv("AT_UART_LINUX_DEV");
+
+    return (dev && dev[0]) ? dev : AT_UART_LINUX_DEV;
+}
 
 static uart_dev_t sg_at_uart = {
     .fd     = -1,
@@ -52,12 +62,12 @@ int HAL_AT_Uart_Init(void)
     speed_t        baud;
 
     if (sg_at_uart.state == eOPENED) {
-        Log_w("%s already opened", AT_UART_LINUX_DEV);
+        Log_w("%s already opened", _at_uart_dev_name());
         return QCLOUD_ERR_FAILURE;
     }
 
-    if ((sg_at_uart.fd = open(AT_UART_LINUX_DEV, O_RDWR | O_NOCTTY | O_NDELAY)) == -1) {
-        Log_e("open at uart failed\r\n");
+    if ((sg_at_uart.fd = open(_at_uart_dev_name(), O_RDWR | O_NOCTTY | O_NDELAY)) == -1) {
+        Log_e("open at uart %s failed\r\n", _at_uart_dev_name());
         return QCLOUD_ERR_FAILURE;
     }
 
@@ -199,14 +209,17 @@ int HAL_AT_Uart_Send(void *data, uint32_t size)
 int HAL_AT_Uart_Recv(void *data, uint32_t expect_size, uint32_t *recv_size, uint32_t timeout)
 {
     int readlen;
-    int ret;
+    int ret = QCLOUD_RET_SUCCESS;
+
+    if (recv_size) {
+        *recv_size = 0;
+    }
 
     if (sg_at_uart.state == eOPENED) {
+        /* returns what is available, blocking at most VTIME when there is nothing */
         if ((readlen = read(sg_at_uart.fd, data, expect_size)) == -1) {
             ret = QCLOUD_ERR_FAILURE;
-        }
-
-        if (recv_size) {
+        } else if (recv_size) {
             *recv_size = readlen;
         }
 
@@ -223,10 +236,10 @@ int HAL_AT_Uart_Recv(void *data, uint32_t expect_size, uint32_t *recv_size, uint
 extern void at_client_uart_rx_isr_cb(uint8_t *pdata, uint8_t len);
 static void at_uart_irq_recv(void *userContex)
 {
-    uint8_t data[64];
+    uint8_t data[255];
     int     readlen;
     while (1) {
-        if ((readlen = read(sg_at_uart.fd, data, sizeof(data))) == -1) {
+        if ((readlen = read(sg_at_uart.fd, data, sizeof(data))) <= 0) {
             continue;
         }
         at_client_uart_rx_isr_cb(data, readlen);  // push
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -95,6 +96,31 @@ void HAL_MutexUnlock(_IN_ void *mutex)
 #endif
 }
 
+#ifdef MULTITHREAD_ENABLED
+static pthread_mutex_t sg_once_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void HAL_Once(_IN_ int *once, _IN_ void (*init_routine)(void))
+{
+#ifdef MULTITHREAD_ENABLED
+    if (__atomic_load_n(once, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    pthread_mutex_lock(&sg_once_lock);
+    if (!*once) {
+        init_routine();
+        __atomic_store_n(once, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&sg_once_lock);
+#else
+    if (!*once) {
+        init_routine();
+        *once = 1;
+    }
+#endif
+}
+
 void *HAL_Malloc(_IN_ uint32_t size)
 {
     return malloc(size);
@@ -136,13 +162,12 @@ int HAL_Vsnprintf(_IN_ char *str, _IN_ const int len, _IN_ const char *format, v
 
 uint32_t HAL_GetTimeMs(void)
 {
-    struct timeval time_val = {0};
-    uint32_t       time_ms;
+    struct timespec ts = {0};
 
-    gettimeofday(&time_val, NULL);
-    time_ms = time_val.tv_sec * 1000 + time_val.tv_usec / 1000;
+    /* monotonic like the tick counters of the RTOS ports, so stepping the wall clock does not disturb it */
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    return time_ms;
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
 }
 
 void HAL_SleepMs(_IN_ uint32_t ms)
@@ -190,6 +215,10 @@ void HAL_DelayMs(_IN_ uint32_t ms)
     usleep(1000 * ms);
 }
 
+#endif
+
+#if defined(AT_TCP_ENABLED) || defined(MULTITHREAD_ENABLED)
+
 void *HAL_SemaphoreCreate(void)
 {
     sem_t *sem = (sem_t *)malloc(sizeof(sem_t));
@@ -19,6 +19,9 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -56,13 +59,45 @@ static uint64_t _linux_time_left(uint64_t t_end, uint64_t t_now)
     return t_left;
 }
 
-uintptr_t HAL_TCP_Connect(const char *host, uint16_t port)
+/* resolved addresses are reused for this long, getaddrinfo does not tell the TTL of the records */
+#define TCP_DNS_CACHE_MAX_AGE_MS (60 * 1000)
+
+/* number of host:port kept in the address cache */
+#define TCP_DNS_CACHE_SIZE (4)
+
+/* max addresses kept and tried for one host:port */
+#define TCP_DNS_CACHE_ADDR_NUM (8)
+
+/* RFC 8305 connection attempt delay, the next address is tried when the last one has not connected by then */
+#define TCP_CONNECT_ATTEMPT_DELAY_MS (250)
+
+/* max time to connect to one host:port over all its addresses */
+#define TCP_CONNECT_TIMEOUT_MS (10 * 1000)
+
+typedef struct {
+    struct sockaddr_storage addr[TCP_DNS_CACHE_ADDR_NUM];
+    socklen_t               addr_len[TCP_DNS_CACHE_ADDR_NUM];
+    int                     addr_num;
+} TCPAddrList;
+
+typedef struct {
+    char        host[HOST_STR_LENGTH];
+    uint16_t    port;
+    uint64_t    expire_ms;
+    TCPAddrList list;
+} TCPDnsCacheEntry;
+
+static TCPDnsCacheEntry s_dns_cache[TCP_DNS_CACHE_SIZE];
+static pthread_mutex_t  s_dns_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* resolve host, the addresses alternate between the families starting with the first one returned */
+static int _tcp_resolve(const char *host, uint16_t port, TCPAddrList *list)
 {
-    int             ret;
-    struct addrinfo hints, *addr_list, *cur;
-    int             fd = 0;
+    struct addrinfo  hints, *addr_list, *cur;
+    struct addrinfo *first[TCP_DNS_CACHE_ADDR_NUM], *other[TCP_DNS_CACHE_ADDR_NUM];
+    int              ret, first_num = 0, other_num = 0, i;
+    char             port_str[6];
 
-    char port_str[6];
     HAL_Snprintf(port_str, 6, "%d", port);
 
     memset(&hints, 0x00, sizeof(hints));
@@ -80,34 +115,251 @@ uintptr_t HAL_TCP_Connect(const char *host, uint16_t port)
     }
 
     for (cur = addr_list; cur != NULL; cur = cur->ai_next) {
-        fd = (int)socket(cur->ai_family, cur->ai_socktype, cur->ai_protocol);
-        if (fd < 0) {
-            ret = 0;
+        if (cur->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
+        }
+        if (cur->ai_family == addr_list->ai_family) {
+            if (first_num < TCP_DNS_CACHE_ADDR_NUM)
+                first[first_num++] = cur;
+        } else if (other_num < TCP_DNS_CACHE_ADDR_NUM) {
+            other[other_num++] = cur;
+        }
+    }
+
+    list->addr_num = 0;
+    for (i = 0; (i < first_num || i < other_num) && list->addr_num < TCP_DNS_CACHE_ADDR_NUM; i++) {
+        if (i < first_num) {
+            memcpy(&list->addr[list->addr_num], first[i]->ai_addr, first[i]->ai_addrlen);
+            list->addr_len[list->addr_num++] = first[i]->ai_addrlen;
+        }
+        if (i < other_num && list->addr_num < TCP_DNS_CACHE_ADDR_NUM) {
+            memcpy(&list->addr[list->addr_num], other[i]->ai_addr, other[i]->ai_addrlen);
+            list->addr_len[list->addr_num++] = other[i]->ai_addrlen;
+        }
+    }
+
+    freeaddrinfo(addr_list);
+
+    return list->addr_num;
+}
+
+static TCPDnsCacheEntry *_tcp_dns_cache_find(const char *host, uint16_t port)
+{
+    int i;
+
+    for (i = 0; i < TCP_DNS_CACHE_SIZE; i++) {
+        if (s_dns_cache[i].list.addr_num > 0 && s_dns_cache[i].port == port && !strcmp(s_dns_cache[i].host, host)) {
+            return &s_dns_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* get the addresses of host from the cache, or resolve it and keep the result. Addresses resolved before are
+ * kept through failed connects, and still used when resolving fails, so an outage does not add DNS to every retry */
+static int _tcp_lookup(const char *host, uint16_t port, TCPAddrList *list)
+{
+    TCPDnsCacheEntry *entry;
+    TCPAddrList       resolved;
+    bool              found = false, fresh = false;
+    int               i;
+
+    pthread_mutex_lock(&s_dns_cache_lock);
+    entry = _tcp_dns_cache_find(host, port);
+    if (entry) {
+        *list = entry->list;
+        found = true;
+        fresh = entry->expire_ms > _linux_get_time_ms();
+    }
+    pthread_mutex_unlock(&s_dns_cache_lock);
+
+    if (fresh) {
+        return list->addr_num;
+    }
+
+    if (0 == _tcp_resolve(host, port, &resolved)) {
+        if (found) {
+            Log_w("resolve %s failed, use the addresses resolved before", host);
+            return list->addr_num;
+        }
+        return 0;
+    }
+    *list = resolved;
+
+    if (strlen(host) >= HOST_STR_LENGTH) {
+        return list->addr_num;
+    }
+
+    pthread_mutex_lock(&s_dns_cache_lock);
+    entry = _tcp_dns_cache_find(host, port);
+    if (NULL == entry) {
+        /* replace the entry closest to expire */
+        entry = &s_dns_cache[0];
+        for (i = 1; i < TCP_DNS_CACHE_SIZE; i++) {
+            if (s_dns_cache[i].expire_ms < entry->expire_ms) {
+                entry = &s_dns_cache[i];
+            }
+        }
+        strcpy(entry->host, host);
+        entry->port = port;
+    }
+    entry->list      = resolved;
+    entry->expire_ms = _linux_get_time_ms() + TCP_DNS_CACHE_MAX_AGE_MS;
+    pthread_mutex_unlock(&s_dns_cache_lock);
+
+    return list->addr_num;
+}
+
+/* move the address that connected to the front, it is tried first next time */
+static void _tcp_lookup_update(const char *host, uint16_t port, const struct sockaddr_storage *addr)
+{
+    TCPDnsCacheEntry *entry;
+    int               i;
+
+    pthread_mutex_lock(&s_dns_cache_lock);
+    entry = _tcp_dns_cache_find(host, port);
+    for (i = 1; entry && i < entry->list.addr_num; i++) {
+        if (!memcmp(&entry->list.addr[i], addr, entry->list.addr_len[i])) {
+            struct sockaddr_storage tmp_addr = entry->list.addr[0];
+            socklen_t               tmp_len  = entry->list.addr_len[0];
+
+            entry->list.addr[0]     = entry->list.addr[i];
+            entry->list.addr_len[0] = entry->list.addr_len[i];
+            entry->list.addr[i]     = tmp_addr;
+            entry->list.addr_len[i] = tmp_len;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_dns_cache_lock);
+}
+
+/* Happy Eyeballs (RFC 8305): start a non-blocking connect to the next address every TCP_CONNECT_ATTEMPT_DELAY_MS,
+ * or at once when an attempt fails, and keep the first socket that connects. Returns -2 when no socket was created */
+static int _tcp_connect_race(TCPAddrList *list, int *winner)
+{
+    struct pollfd pfd[TCP_DNS_CACHE_ADDR_NUM];
+    int           pfd_addr[TCP_DNS_CACHE_ADDR_NUM];
+    int           pending = 0, next = 0, fd = -1, opened = 0, sock, flags, ret, i;
+    uint64_t      t_now, t_next = 0, t_end;
+
+    t_end = _linux_get_time_ms() + TCP_CONNECT_TIMEOUT_MS;
+
+    while (fd < 0) {
+        t_now = _linux_get_time_ms();
+        if (t_now >= t_end) {
+            break;
+        }
+
+        if (next < list->addr_num && (0 == pending || t_now >= t_next)) {
+            t_next = t_now + TCP_CONNECT_ATTEMPT_DELAY_MS;
+            sock   = socket(list->addr[next].ss_family, SOCK_STREAM, IPPROTO_TCP);
+            if (sock < 0) {
+                next++;
+                continue;
+            }
+            opened++;
+            fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+            if (0 == connect(sock, (struct sockaddr *)&list->addr[next], list->addr_len[next])) {
+                fd      = sock;
+                *winner = next;
+                break;
+            }
+            if (EINPROGRESS == errno) {
+                pfd[pending].fd      = sock;
+                pfd[pending].events  = POLLOUT;
+                pfd[pending].revents = 0;
+                pfd_addr[pending]    = next;
+                pending++;
+            } else {
+                close(sock);
+                t_next = 0;
+            }
+            next++;
             continue;
         }
 
-        if (connect(fd, cur->ai_addr, cur->ai_addrlen) == 0) {
-            ret = fd;
+        if (0 == pending) {
+            break;
+        }
+
+        ret = poll(pfd, pending, (int)((next < list->addr_num ? Min(t_next, t_end) : t_end) - t_now));
+        if (ret < 0 && EINTR != errno) {
             break;
         }
 
-        close(fd);
-        ret = 0;
+        for (i = 0; ret > 0 && i < pending;) {
+            int       err     = 0;
+            socklen_t err_len = sizeof(err);
+
+            if (0 == pfd[i].revents) {
+                i++;
+                continue;
+            }
+            if (getsockopt(pfd[i].fd, SOL_SOCKET, SO_ERROR, &err, &err_len) < 0) {
+                err = errno;
+            }
+            if (0 == err && fd < 0) {
+                fd      = pfd[i].fd;
+                *winner = pfd_addr[i];
+            } else {
+                close(pfd[i].fd);
+                t_next = 0;
+            }
+            pending--;
+            pfd[i]      = pfd[pending];
+            pfd_addr[i] = pfd_addr[pending];
+        }
     }
 
-    if (0 == ret) {
-        Log_e("fail to connect with TCP server: %s:%s", STRING_PTR_PRINT_SANITY_CHECK(host), port_str);
-    } else {
-        /* reduce log print due to frequent log server connect/disconnect */
-        if (0 == strncmp(host, LOG_UPLOAD_SERVER_DOMAIN, HOST_STR_LENGTH))
-            UPLOAD_DBG("connected with TCP server: %s:%s", host, port_str);
-        else
-            Log_i("connected with TCP server: %s:%s", STRING_PTR_PRINT_SANITY_CHECK(host), port_str);
+    for (i = 0; i < pending; i++) {
+        close(pfd[i].fd);
     }
 
-    freeaddrinfo(addr_list);
+    if (fd >= 0) {
+        flags = fcntl(fd, F_GETFL);
+        fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+    }
+
+    return (fd < 0 && 0 == opened) ? -2 : fd;
+}
+
+int HAL_TCP_ConnectSocket(const char *host, uint16_t port, int *fd)
+{
+    TCPAddrList list;
+    int         winner = -1;
+
+    if (_tcp_lookup(host, port, &list) <= 0) {
+        Log_e("fail to resolve TCP server: %s:%d", STRING_PTR_PRINT_SANITY_CHECK(host), port);
+        return QCLOUD_ERR_TCP_UNKNOWN_HOST;
+    }
+
+    *fd = _tcp_connect_race(&list, &winner);
+    if (*fd < 0) {
+        Log_e("fail to connect with TCP server: %s:%d", STRING_PTR_PRINT_SANITY_CHECK(host), port);
+        return (-2 == *fd) ? QCLOUD_ERR_TCP_SOCKET_FAILED : QCLOUD_ERR_TCP_CONNECT;
+    }
+
+    _tcp_lookup_update(host, port, &list.addr[winner]);
+
+    /* reduce log print due to frequent log server connect/disconnect */
+    if (0 == strncmp(host, LOG_UPLOAD_SERVER_DOMAIN, HOST_STR_LENGTH))
+        UPLOAD_DBG("connected with TCP server: %s:%d", host, port);
+    else
+        Log_i("connected with TCP server: %s:%d", STRING_PTR_PRINT_SANITY_CHECK(host), port);
 
-    return (uintptr_t)ret;
+    return QCLOUD_RET_SUCCESS;
+}
+
+uintptr_t HAL_TCP_Connect(const char *host, uint16_t port)
+{
+    int fd = -1;
+
+    if (QCLOUD_RET_SUCCESS != HAL_TCP_ConnectSocket(host, port, &fd)) {
+        return 0;
+    }
+
+    return (uintptr_t)fd;
 }
 
 int HAL_TCP_Disconnect(uintptr_t fd)
@@ -134,8 +386,8 @@ int HAL_TCP_Write(uintptr_t fd, const unsigned char *buf, uint32_t len, uint32_t
 {
     int      ret;
     uint32_t len_sent;
-    uint64_t t_end, t_left;
-    fd_set   sets;
+    uint64_t      t_end, t_left;
+    struct pollfd pfd;
 
     t_end    = _linux_get_time_ms() + timeout_ms;
     len_sent = 0;
@@ -145,17 +397,14 @@ int HAL_TCP_Write(uintptr_t fd, const unsigned char *buf, uint32_t len, uint32_t
         t_left = _linux_time_left(t_end, _linux_get_time_ms());
 
         if (0 != t_left) {
-            struct timeval timeout;
-
-            FD_ZERO(&sets);
-            FD_SET(fd, &sets);
+            /* poll() instead of select(): fd may be above FD_SETSIZE in a process with many connections */
+            pfd.fd      = (int)fd;
+            pfd.events  = POLLOUT;
+            pfd.revents = 0;
 
-            timeout.tv_sec  = t_left / 1000;
-            timeout.tv_usec = (t_left % 1000) * 1000;
-
-            ret = select(fd + 1, NULL, &sets, NULL, &timeout);
+            ret = poll(&pfd, 1, (int)t_left);
             if (ret > 0) {
-                if (0 == FD_ISSET(fd, &sets)) {
+                if (0 == (pfd.revents & (POLLOUT | POLLERR | POLLHUP))) {
                     Log_e("Should NOT arrive");
                     /* If timeout in next loop, it will not sent any data */
                     ret = 0;
@@ -163,7 +412,7 @@ int HAL_TCP_Write(uintptr_t fd, const unsigned char *buf, uint32_t len, uint32_t
                 }
             } else if (0 == ret) {
                 ret = QCLOUD_ERR_TCP_WRITE_TIMEOUT;
-                Log_e("select-write timeout %d", (int)fd);
+                Log_e("poll-write timeout %d", (int)fd);
                 break;
             } else {
                 if (EINTR == errno) {
@@ -172,7 +421,7 @@ int HAL_TCP_Write(uintptr_t fd, const unsigned char *buf, uint32_t len, uint32_t
                 }
 
                 ret = QCLOUD_ERR_TCP_WRITE_FAIL;
-                Log_e("select-write fail: %s", strerror(errno));
+                Log_e("poll-write fail: %s", strerror(errno));
                 break;
             }
         } else {
@@ -205,11 +454,10 @@ int HAL_TCP_Write(uintptr_t fd, const unsigned char *buf, uint32_t len, uint32_t
 
 int HAL_TCP_Read(uintptr_t fd, unsigned char *buf, uint32_t len, uint32_t timeout_ms, size_t *read_len)
 {
-    int            ret, err_code;
-    uint32_t       len_recv;
-    uint64_t       t_end, t_left;
-    fd_set         sets;
-    struct timeval timeout;
+    int           ret, err_code;
+    uint32_t      len_recv;
+    uint64_t      t_end, t_left;
+    struct pollfd pfd;
 
     t_end    = _linux_get_time_ms() + timeout_ms;
     len_recv = 0;
@@ -222,13 +470,11 @@ int HAL_TCP_Read(uintptr_t fd, unsigned char *buf, uint32_t len, uint32_t timeou
             break;
         }
 
-        FD_ZERO(&sets);
-        FD_SET(fd, &sets);
-
-        timeout.tv_sec  = t_left / 1000;
-        timeout.tv_usec = (t_left % 1000) * 1000;
+        pfd.fd      = (int)fd;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
 
-        ret = select(fd + 1, &sets, NULL, NULL, &timeout);
+        ret = poll(&pfd, 1, (int)t_left);
         if (ret > 0) {
             ret = recv(fd, buf + len_recv, len - len_recv, 0);
             if (ret > 0) {
@@ -261,7 +507,10 @@ int HAL_TCP_Read(uintptr_t fd, unsigned char *buf, uint32_t len, uint32_t timeou
             err_code = QCLOUD_ERR_TCP_READ_TIMEOUT;
             break;
         } else {
-            Log_e("select-recv error: %s", strerror(errno));
+            if (EINTR == errno) {
+                continue;
+            }
+            Log_e("poll-recv error: %s", strerror(errno));
             err_code = QCLOUD_ERR_TCP_READ_FAIL;
             break;
         }
@@ -88,3 +88,11 @@ void HAL_MutexUnlock(void *mutex)
 {
     return;
 }
+
+void HAL_Once(int *once, void (*init_routine)(void))
+{
+    if (!*once) {
+        init_routine();
+        *once = 1;
+    }
+}
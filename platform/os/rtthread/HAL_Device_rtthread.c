@@ -163,3 +163,18 @@ int HAL_GetGwDevInfo(void *pgwDeviceInfo)
     return ret;
 }
 #endif
+
+#ifdef REMOTE_CONFIG_MQTT
+size_t HAL_Config_Save(const char *config, size_t len)
+{
+    /* save the config into flash/NVS to have it at the next boot */
+    Log_d("HAL_Config_Save not implement yet");
+    return 0;
+}
+
+size_t HAL_Config_Read(char *buf, size_t len)
+{
+    /* read the config saved by HAL_Config_Save, 0 when nothing saved */
+    return 0;
+}
+#endif
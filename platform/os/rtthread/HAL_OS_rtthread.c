@@ -111,6 +111,31 @@ int HAL_MutexTryLock(_IN_ void *mutex)
     return err_num;
 }
 
+void HAL_Once(_IN_ int *once, _IN_ void (*init_routine)(void))
+{
+    /* 0: not run, 1: running, 2: done. The claim is made with the scheduler locked, the routine runs without */
+    int state;
+
+    for (;;) {
+        rt_enter_critical();
+        state = *once;
+        if (0 == state) {
+            *once = 1;
+        }
+        rt_exit_critical();
+
+        if (2 == state) {
+            return;
+        }
+        if (0 == state) {
+            init_routine();
+            *(volatile int *)once = 2;
+            return;
+        }
+        rt_thread_delay(1);
+    }
+}
+
 void *HAL_Malloc(_IN_ uint32_t size)
 {
     return rt_malloc(size);
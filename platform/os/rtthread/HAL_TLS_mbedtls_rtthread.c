@@ -400,6 +400,30 @@ int HAL_TLS_Read(uintptr_t handle, unsigned char *msg, size_t totalLen, uint32_t
     }
 }
 
+int HAL_TLS_GetFd(uintptr_t handle)
+{
+    if ((uintptr_t)NULL == handle) {
+        return -1;
+    }
+
+    return ((TLSDataParams *)handle)->socket_fd.fd;
+}
+
+int HAL_TLS_GetMemStat(uintptr_t handle, TLSMemStat *stat)
+{
+    /* the package's mbedtls allocates through rt_malloc, no per-connection accounting */
+    return QCLOUD_ERR_FAILURE;
+}
+
+size_t HAL_TLS_Pending(uintptr_t handle)
+{
+    if ((uintptr_t)NULL == handle) {
+        return 0;
+    }
+
+    return mbedtls_ssl_get_bytes_avail(&(((TLSDataParams *)handle)->ssl));
+}
+
 #ifdef __cplusplus
 }
 #endif
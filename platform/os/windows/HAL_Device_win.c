@@ -480,3 +480,47 @@ int HAL_GetGwDevInfo(void *pgwDeviceInfo)
     return ret;
 }
 #endif
+
+#ifdef REMOTE_CONFIG_MQTT
+#ifndef REMOTE_CONFIG_SAVE_FILE_PATH
+#define REMOTE_CONFIG_SAVE_FILE_PATH "remote-config.json"
+#endif
+
+size_t HAL_Config_Save(const char *config, size_t len)
+{
+    FILE * fp;
+    size_t wlen;
+
+    if ((fp = fopen(REMOTE_CONFIG_SAVE_FILE_PATH ".tmp", "wb")) == NULL) {
+        Log_e("fail to open file %s", REMOTE_CONFIG_SAVE_FILE_PATH ".tmp");
+        return 0;
+    }
+
+    wlen = fwrite(config, 1, len, fp);
+    fclose(fp);
+
+    /* rename does not replace an existing file on windows */
+    remove(REMOTE_CONFIG_SAVE_FILE_PATH);
+    if (wlen != len || rename(REMOTE_CONFIG_SAVE_FILE_PATH ".tmp", REMOTE_CONFIG_SAVE_FILE_PATH)) {
+        Log_e("fail to save config to %s", REMOTE_CONFIG_SAVE_FILE_PATH);
+        return 0;
+    }
+
+    return wlen;
+}
+
+size_t HAL_Config_Read(char *buf, size_t len)
+{
+    FILE * fp;
+    size_t rlen;
+
+    if ((fp = fopen(REMOTE_CONFIG_SAVE_FILE_PATH, "rb")) == NULL) {
+        return 0;
+    }
+
+    rlen = fread(buf, 1, len, fp);
+    fclose(fp);
+
+    return rlen;
+}
+#endif
@@ -13,6 +13,7 @@
  *
  */
 
+#include <limits.h>
 #include <memory.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -72,6 +73,22 @@ void HAL_MutexUnlock(_IN_ void *mutex)
 #endif
 }
 
+void HAL_Once(_IN_ int *once, _IN_ void (*init_routine)(void))
+{
+    /* 0: not run, 1: running, 2: done */
+    volatile LONG *state = (volatile LONG *)once;
+    LONG           prev;
+
+    while (2 != (prev = InterlockedCompareExchange(state, 1, 0))) {
+        if (0 == prev) {
+            init_routine();
+            InterlockedExchange(state, 2);
+            return;
+        }
+        Sleep(1);
+    }
+}
+
 void *HAL_Malloc(_IN_ uint32_t size)
 {
     return malloc(size);
@@ -150,25 +167,44 @@ int HAL_ThreadCreate(ThreadParams *params)
 
 #endif
 
-#ifdef AT_TCP_ENABLED
+#if defined(AT_TCP_ENABLED) || defined(MULTITHREAD_ENABLED)
 
 void *HAL_SemaphoreCreate(void)
 {
+#ifdef MULTITHREAD_ENABLED
+    HANDLE sem = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+
+    if (sem == NULL) {
+        HAL_Printf("%s: create semaphore failed\n", __FUNCTION__);
+    }
+
+    return sem;
+#else
     return NULL;
+#endif
 }
 
 void HAL_SemaphoreDestroy(void *sem)
 {
-    return;
+#ifdef MULTITHREAD_ENABLED
+    CloseHandle((HANDLE)sem);
+#endif
 }
 
 void HAL_SemaphorePost(void *sem)
 {
-    return;
+#ifdef MULTITHREAD_ENABLED
+    ReleaseSemaphore((HANDLE)sem, 1, NULL);
+#endif
 }
 
 int HAL_SemaphoreWait(void *sem, uint32_t timeout_ms)
 {
+#ifdef MULTITHREAD_ENABLED
+    if (WaitForSingleObject((HANDLE)sem, timeout_ms) != WAIT_OBJECT_0) {
+        return QCLOUD_ERR_FAILURE;
+    }
+#endif
     return QCLOUD_RET_SUCCESS;
 }
 
@@ -36,6 +36,7 @@ extern "C" {
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/ssl.h"
 #include "mbedtls/ssl_cookie.h"
+#include "mbedtls/ssl_internal.h"
 #include "mbedtls/timing.h"
 #include "utils_param_check.h"
 #include "utils_timer.h"
@@ -61,8 +62,16 @@ typedef struct {
 
     mbedtls_timing_delay_context timer;
     mbedtls_ssl_cookie_ctx       cookie_ctx;
+    TLSMemStat                   mem;
 } DTLSDataParams;
 
+/* heap accounting and max_fragment_length mapping live in HAL_TLS_mbedtls.c */
+extern void _mbedtls_mem_charge_begin(TLSMemStat *owner);
+extern void _mbedtls_mem_charge_end(void);
+extern void _mbedtls_mem_stat_get(TLSMemStat *stat, const TLSMemStat *src);
+extern void _mbedtls_global_init_once(void);
+extern int  _mbedtls_max_frag_len_code(uint16_t max_frag_len);
+
 /**
  * @brief free memory/resources allocated by mbedtls
  */
@@ -198,26 +207,23 @@ int _mbedtls_udp_connect(mbedtls_net_context *socket_fd, const char *host, int p
     return QCLOUD_RET_SUCCESS;
 }
 
-uintptr_t HAL_DTLS_Connect(DTLSConnectParams *pConnectParams, const char *host, int port)
+/**
+ * @brief configure the SSL context of a connection, everything before the handshake
+ */
+static int _mbedtls_client_setup(DTLSDataParams *pDataParams, DTLSConnectParams *pConnectParams, const char *host)
 {
-    IOT_FUNC_ENTRY;
-
     int ret = QCLOUD_RET_SUCCESS;
+    int mfl = _mbedtls_max_frag_len_code(pConnectParams->max_frag_len);
 
-    DTLSDataParams *pDataParams = (DTLSDataParams *)HAL_Malloc(sizeof(DTLSDataParams));
-
-    if ((ret = _mbedtls_client_init(pDataParams, pConnectParams)) != QCLOUD_RET_SUCCESS) {
-        goto error;
-    }
-
-    if ((ret = _mbedtls_udp_connect(&(pDataParams->socket_fd), host, port)) != QCLOUD_RET_SUCCESS) {
-        goto error;
+    if (mfl < 0) {
+        Log_e("invalid max_frag_len %u", pConnectParams->max_frag_len);
+        return QCLOUD_ERR_INVAL;
     }
 
     if ((ret = mbedtls_ssl_config_defaults(&pDataParams->ssl_conf, MBEDTLS_SSL_IS_CLIENT,
                                            MBEDTLS_SSL_TRANSPORT_DATAGRAM, MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
         Log_e("mbedtls_ssl_config_defaults result 0x%04x", ret);
-        goto error;
+        return ret;
     }
 
     mbedtls_ssl_conf_authmode(&(pDataParams->ssl_conf), MBEDTLS_SSL_VERIFY_REQUIRED);
@@ -228,7 +234,7 @@ uintptr_t HAL_DTLS_Connect(DTLSConnectParams *pConnectParams, const char *host,
     if ((ret = mbedtls_ssl_cookie_setup(&pDataParams->cookie_ctx, mbedtls_ctr_drbg_random, &pDataParams->ctr_drbg)) !=
         0) {
         Log_e("mbedtls_ssl_cookie_setup result 0x%04x", ret);
-        goto error;
+        return ret;
     }
 
     mbedtls_ssl_conf_dtls_cookies(&pDataParams->ssl_conf, mbedtls_ssl_cookie_write, mbedtls_ssl_cookie_check,
@@ -249,9 +255,14 @@ uintptr_t HAL_DTLS_Connect(DTLSConnectParams *pConnectParams, const char *host,
     }
 #endif
 
+    if ((ret = mbedtls_ssl_conf_max_frag_len(&(pDataParams->ssl_conf), (unsigned char)mfl)) != 0) {
+        Log_e("mbedtls_ssl_conf_max_frag_len failed returned -0x%x", -ret);
+        return ret;
+    }
+
     if ((ret = mbedtls_ssl_setup(&(pDataParams->ssl), &(pDataParams->ssl_conf))) != 0) {
         Log_e("mbedtls_ssl_setup failed returned -0x%x", -ret);
-        goto error;
+        return ret;
     }
 
     if (pDataParams->ssl_conf.transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM) {
@@ -261,13 +272,56 @@ uintptr_t HAL_DTLS_Connect(DTLSConnectParams *pConnectParams, const char *host,
 
     if ((ret = mbedtls_ssl_set_hostname(&(pDataParams->ssl), host)) != 0) {
         Log_e("mbedtls_ssl_set_hostname failed returned -0x%x", -ret);
-        goto error;
+        return ret;
     }
 
     mbedtls_ssl_set_bio(&(pDataParams->ssl), (void *)&pDataParams->socket_fd, mbedtls_net_send, mbedtls_net_recv,
                         mbedtls_net_recv_timeout);
 
-    while ((ret = mbedtls_ssl_handshake(&(pDataParams->ssl))) != 0) {
+    return QCLOUD_RET_SUCCESS;
+}
+
+uintptr_t HAL_DTLS_Connect(DTLSConnectParams *pConnectParams, const char *host, int port)
+{
+    IOT_FUNC_ENTRY;
+
+    int ret = QCLOUD_RET_SUCCESS;
+
+    _mbedtls_global_init_once();
+    DTLSDataParams *pDataParams = (DTLSDataParams *)HAL_Malloc(sizeof(DTLSDataParams));
+    if (NULL == pDataParams) {
+        Log_e("malloc DTLSDataParams failed");
+        return 0;
+    }
+    memset(&(pDataParams->mem), 0, sizeof(TLSMemStat));
+    pDataParams->mem.heap_cur = pDataParams->mem.heap_peak = sizeof(DTLSDataParams);
+
+    _mbedtls_mem_charge_begin(&(pDataParams->mem));
+    ret = _mbedtls_client_init(pDataParams, pConnectParams);
+    _mbedtls_mem_charge_end();
+    if (ret != QCLOUD_RET_SUCCESS) {
+        goto error;
+    }
+
+    if ((ret = _mbedtls_udp_connect(&(pDataParams->socket_fd), host, port)) != QCLOUD_RET_SUCCESS) {
+        goto error;
+    }
+
+    _mbedtls_mem_charge_begin(&(pDataParams->mem));
+    ret = _mbedtls_client_setup(pDataParams, pConnectParams, host);
+    _mbedtls_mem_charge_end();
+    if (ret != QCLOUD_RET_SUCCESS) {
+        goto error;
+    }
+
+    for (;;) {
+        _mbedtls_mem_charge_begin(&(pDataParams->mem));
+        ret = mbedtls_ssl_handshake(&(pDataParams->ssl));
+        _mbedtls_mem_charge_end();
+        if (ret == 0) {
+            break;
+        }
+
         if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
             Log_e("mbedtls_ssl_handshake failed returned -0x%x", -ret);
             if (ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
@@ -282,6 +336,10 @@ uintptr_t HAL_DTLS_Connect(DTLSConnectParams *pConnectParams, const char *host,
         goto error;
     }
 
+    pDataParams->mem.record_buf_len = MBEDTLS_SSL_BUFFER_LEN;
+    pDataParams->mem.max_frag_len   = mbedtls_ssl_get_max_frag_len(&(pDataParams->ssl));
+    Log_d("DTLS heap: %u bytes, peak %u", (unsigned)pDataParams->mem.heap_cur, (unsigned)pDataParams->mem.heap_peak);
+
     return (uintptr_t)pDataParams;
 
 error:
@@ -315,6 +373,20 @@ void HAL_DTLS_Disconnect(uintptr_t handle)
     HAL_Free((void *)handle);
 }
 
+int HAL_DTLS_GetMemStat(uintptr_t handle, TLSMemStat *stat)
+{
+    DTLSDataParams *data_params = (DTLSDataParams *)handle;
+    POINTER_SANITY_CHECK(data_params, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(stat, QCLOUD_ERR_INVAL);
+
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    _mbedtls_mem_stat_get(stat, &data_params->mem);
+    return QCLOUD_RET_SUCCESS;
+#else
+    return QCLOUD_ERR_FAILURE;
+#endif
+}
+
 int HAL_DTLS_Write(uintptr_t handle, const unsigned char *data, size_t datalen, size_t *written_len)
 {
     DTLSDataParams *data_params = (DTLSDataParams *)handle;
@@ -22,19 +22,34 @@ extern "C" {
 #ifndef AUTH_WITH_NOTLS
 
 #include <errno.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
+#if defined(_WIN32) || defined(_WIN32_WCE)
+#include <winsock2.h>
+#define poll WSAPoll
+#else
+#include <poll.h>
+#endif
+
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/entropy.h"
 #include "mbedtls/error.h"
 #include "mbedtls/net_sockets.h"
+#include "mbedtls/platform.h"
 #include "mbedtls/ssl.h"
+#include "mbedtls/ssl_internal.h"
 #include "qcloud_iot_export_error.h"
 #include "qcloud_iot_export_log.h"
 #include "utils_param_check.h"
 #include "utils_timer.h"
 
+/* upper bound for flushing close_notify on disconnect */
+#ifndef TLS_CLOSE_NOTIFY_TIMEOUT_MS
+#define TLS_CLOSE_NOTIFY_TIMEOUT_MS (500)
+#endif
+
 #ifndef AUTH_MODE_CERT
 static const int ciphersuites[] = {MBEDTLS_TLS_PSK_WITH_AES_128_CBC_SHA, MBEDTLS_TLS_PSK_WITH_AES_256_CBC_SHA, 0};
 #endif
@@ -49,10 +64,267 @@ typedef struct {
     mbedtls_ssl_context      ssl;
     mbedtls_ssl_config       ssl_conf;
     mbedtls_x509_crt         ca_cert;
+    mbedtls_x509_crt *       ca_shared;
     mbedtls_x509_crt         client_cert;
     mbedtls_pk_context       private_key;
+    TLSMemStat               mem;
 } TLSDataParams;
 
+/* number of distinct CA buffers whose parsed chain is shared between connections */
+#ifndef TLS_SHARED_CA_NUM
+#define TLS_SHARED_CA_NUM (2)
+#endif
+
+/**
+ * A parsed CA chain is read-only during the handshake, so every connection
+ * trusting the same PEM buffer (iot_ca_get() for all MQTT clients) verifies
+ * against one copy instead of parsing its own. Entries are keyed by buffer
+ * address and length, and released when the last connection using them goes.
+ */
+typedef struct {
+    const char *     pem;
+    size_t           pem_len;
+    int              refs;
+    mbedtls_x509_crt crt;
+} TLSSharedCA;
+
+static void *      sg_shared_ca_lock = NULL;
+static TLSSharedCA sg_shared_ca[TLS_SHARED_CA_NUM];
+
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+/**
+ * Every mbedtls allocation carries its size and the connection it is charged
+ * to, so a connection's heap can be reported without walking mbedtls internals.
+ * Allocations are charged to whichever connection holds sg_mem_lock; only the
+ * setup and handshake steps allocate, and the lock is never held across a wait.
+ * Frees come from any thread, possibly the one holding sg_mem_lock, so the
+ * counters are updated under sg_mem_stat_lock instead.
+ */
+typedef union {
+    struct {
+        size_t      size;
+        TLSMemStat *owner;
+    } h;
+    uint64_t align;
+} TLSMemHeader;
+
+static void *      sg_mem_lock      = NULL;
+static void *      sg_mem_stat_lock = NULL;
+static TLSMemStat *sg_mem_owner     = NULL;
+
+static void *_mbedtls_mem_calloc(size_t n, size_t size)
+{
+    TLSMemHeader *hdr;
+
+    if (size && n > (SIZE_MAX - sizeof(TLSMemHeader)) / size) {
+        return NULL;
+    }
+
+    size *= n;
+    if (NULL == (hdr = (TLSMemHeader *)HAL_Malloc(sizeof(TLSMemHeader) + size))) {
+        return NULL;
+    }
+    memset(hdr + 1, 0, size);
+
+    hdr->h.size  = size;
+    hdr->h.owner = sg_mem_owner;
+    if (hdr->h.owner) {
+        HAL_MutexLock(sg_mem_stat_lock);
+        hdr->h.owner->heap_cur += size;
+        if (hdr->h.owner->heap_cur > hdr->h.owner->heap_peak) {
+            hdr->h.owner->heap_peak = hdr->h.owner->heap_cur;
+        }
+        HAL_MutexUnlock(sg_mem_stat_lock);
+    }
+
+    return hdr + 1;
+}
+
+static void _mbedtls_mem_free(void *ptr)
+{
+    TLSMemHeader *hdr;
+
+    if (NULL == ptr) {
+        return;
+    }
+
+    hdr = (TLSMemHeader *)ptr - 1;
+    if (hdr->h.owner) {
+        HAL_MutexLock(sg_mem_stat_lock);
+        hdr->h.owner->heap_cur -= hdr->h.size;
+        HAL_MutexUnlock(sg_mem_stat_lock);
+    }
+    HAL_Free(hdr);
+}
+
+/**
+ * @brief charge mbedtls allocations made by this thread to a connection, until _mbedtls_mem_charge_end()
+ *
+ * shared with HAL_DTLS_mbedtls.c
+ */
+void _mbedtls_mem_charge_begin(TLSMemStat *owner)
+{
+    if (NULL == sg_mem_lock) {
+        return;
+    }
+
+    HAL_MutexLock(sg_mem_lock);
+    sg_mem_owner = owner;
+}
+
+void _mbedtls_mem_charge_end(void)
+{
+    if (NULL == sg_mem_lock) {
+        return;
+    }
+
+    sg_mem_owner = NULL;
+    HAL_MutexUnlock(sg_mem_lock);
+}
+
+/**
+ * @brief copy a connection's counters, which other threads' frees may be updating
+ *
+ * shared with HAL_DTLS_mbedtls.c
+ */
+void _mbedtls_mem_stat_get(TLSMemStat *stat, const TLSMemStat *src)
+{
+    if (NULL == sg_mem_stat_lock) {
+        *stat = *src;
+        return;
+    }
+
+    HAL_MutexLock(sg_mem_stat_lock);
+    *stat = *src;
+    HAL_MutexUnlock(sg_mem_stat_lock);
+}
+#else
+void _mbedtls_mem_charge_begin(TLSMemStat *owner)
+{
+}
+
+void _mbedtls_mem_charge_end(void)
+{
+}
+#endif
+
+static int sg_mbedtls_once = 0;
+
+static void _mbedtls_global_init(void)
+{
+    /* without it connections parse their own CA chain, see _shared_ca_get() */
+    sg_shared_ca_lock = HAL_MutexCreate();
+
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    /* hooks go in before the first connection allocates, _mbedtls_mem_free expects a header on every block */
+    sg_mem_stat_lock = HAL_MutexCreate();
+    if (NULL != sg_mem_stat_lock && NULL != (sg_mem_lock = HAL_MutexCreate())) {
+        mbedtls_platform_set_calloc_free(_mbedtls_mem_calloc, _mbedtls_mem_free);
+    }
+#endif
+}
+
+/**
+ * @brief set up the locks and hooks shared by all connections, called before a connection touches mbedtls
+ *
+ * shared with HAL_DTLS_mbedtls.c
+ */
+void _mbedtls_global_init_once(void)
+{
+    HAL_Once(&sg_mbedtls_once, _mbedtls_global_init);
+}
+
+/**
+ * @brief get the shared parsed chain of a CA buffer, parsing it on first use
+ *
+ * @return the chain with a reference taken, or NULL when the cache is full or the parse fails
+ */
+static mbedtls_x509_crt *_shared_ca_get(const char *pem, size_t pem_len)
+{
+    TLSSharedCA *entry = NULL;
+    int          i;
+
+    if (NULL == sg_shared_ca_lock) {
+        return NULL;
+    }
+
+    HAL_MutexLock(sg_shared_ca_lock);
+    for (i = 0; i < TLS_SHARED_CA_NUM; i++) {
+        if (sg_shared_ca[i].refs && sg_shared_ca[i].pem == pem && sg_shared_ca[i].pem_len == pem_len) {
+            entry = &sg_shared_ca[i];
+            break;
+        }
+        if (NULL == entry && 0 == sg_shared_ca[i].refs) {
+            entry = &sg_shared_ca[i];
+        }
+    }
+
+    if (entry && 0 == entry->refs) {
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+        /* the chain outlives the connection that parses it, so it is charged to none */
+        TLSMemStat *owner = sg_mem_owner;
+        sg_mem_owner      = NULL;
+#endif
+        mbedtls_x509_crt_init(&entry->crt);
+        if (mbedtls_x509_crt_parse(&entry->crt, (const unsigned char *)pem, pem_len + 1) != 0) {
+            mbedtls_x509_crt_free(&entry->crt);
+            entry = NULL;
+        } else {
+            entry->pem     = pem;
+            entry->pem_len = pem_len;
+        }
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+        sg_mem_owner = owner;
+#endif
+    }
+
+    if (entry) {
+        entry->refs++;
+    }
+    HAL_MutexUnlock(sg_shared_ca_lock);
+
+    return entry ? &entry->crt : NULL;
+}
+
+static void _shared_ca_put(mbedtls_x509_crt *crt)
+{
+    TLSSharedCA *entry;
+
+    if (NULL == crt) {
+        return;
+    }
+    entry = (TLSSharedCA *)((char *)crt - offsetof(TLSSharedCA, crt));
+
+    HAL_MutexLock(sg_shared_ca_lock);
+    if (0 == --entry->refs) {
+        mbedtls_x509_crt_free(&entry->crt);
+        entry->pem     = NULL;
+        entry->pem_len = 0;
+    }
+    HAL_MutexUnlock(sg_shared_ca_lock);
+}
+
+/**
+ * @brief map a record payload limit in bytes to mbedtls max_fragment_length code
+ */
+int _mbedtls_max_frag_len_code(uint16_t max_frag_len)
+{
+    switch (max_frag_len) {
+        case 0:
+            return MBEDTLS_SSL_MAX_FRAG_LEN_NONE;
+        case 512:
+            return MBEDTLS_SSL_MAX_FRAG_LEN_512;
+        case 1024:
+            return MBEDTLS_SSL_MAX_FRAG_LEN_1024;
+        case 2048:
+            return MBEDTLS_SSL_MAX_FRAG_LEN_2048;
+        case 4096:
+            return MBEDTLS_SSL_MAX_FRAG_LEN_4096;
+        default:
+            return -1;
+    }
+}
+
 /**
  * @brief free memory/resources allocated by mbedtls
  */
@@ -61,6 +333,7 @@ static void _free_mebedtls(TLSDataParams *pParams)
     mbedtls_net_free(&(pParams->socket_fd));
     mbedtls_x509_crt_free(&(pParams->client_cert));
     mbedtls_x509_crt_free(&(pParams->ca_cert));
+    _shared_ca_put(pParams->ca_shared);
     mbedtls_pk_free(&(pParams->private_key));
     mbedtls_ssl_free(&(pParams->ssl));
     mbedtls_ssl_config_free(&(pParams->ssl_conf));
@@ -91,6 +364,7 @@ static int _mbedtls_client_init(TLSDataParams *pDataParams, TLSConnectParams *pC
     mbedtls_x509_crt_init(&(pDataParams->ca_cert));
     mbedtls_x509_crt_init(&(pDataParams->client_cert));
     mbedtls_pk_init(&(pDataParams->private_key));
+    pDataParams->ca_shared = NULL;
 
     mbedtls_entropy_init(&(pDataParams->entropy));
     // custom parameter is NULL for now
@@ -101,6 +375,10 @@ static int _mbedtls_client_init(TLSDataParams *pDataParams, TLSConnectParams *pC
     }
 
     if (pConnectParams->ca_crt != NULL) {
+        pDataParams->ca_shared = _shared_ca_get(pConnectParams->ca_crt, pConnectParams->ca_crt_len);
+    }
+
+    if (pConnectParams->ca_crt != NULL && NULL == pDataParams->ca_shared) {
         if ((ret = mbedtls_x509_crt_parse(&(pDataParams->ca_cert), (const unsigned char *)pConnectParams->ca_crt,
                                           (pConnectParams->ca_crt_len + 1)))) {
             Log_e("parse ca crt failed returned 0x%04x", ret < 0 ? -ret : ret);
@@ -153,7 +431,16 @@ static int _mbedtls_client_init(TLSDataParams *pDataParams, TLSConnectParams *pC
  */
 int _mbedtls_tcp_connect(mbedtls_net_context *socket_fd, const char *host, int port)
 {
-    int  ret = 0;
+    int ret = 0;
+
+#ifdef HAL_TCP_SOCKET_ENABLED
+    /* the TCP HAL socket is a plain fd, eg. the Linux one caching resolved addresses and racing them */
+    if ((ret = HAL_TCP_ConnectSocket(host, (uint16_t)port, &socket_fd->fd)) != QCLOUD_RET_SUCCESS) {
+        Log_e("tcp connect failed returned %d errno: %d", ret, errno);
+        return ret;
+    }
+#else
+    /* other TCP HALs may hand out a handle that is not the socket, eg. lwIP with LWIP_SOCKET_FD_SHIFT */
     char port_str[6];
     HAL_Snprintf(port_str, 6, "%d", port);
     if ((ret = mbedtls_net_connect(socket_fd, host, port_str, MBEDTLS_NET_PROTO_TCP)) != 0) {
@@ -168,15 +455,51 @@ int _mbedtls_tcp_connect(mbedtls_net_context *socket_fd, const char *host, int p
                 return QCLOUD_ERR_TCP_CONNECT;
         }
     }
+#endif
 
-    if ((ret = mbedtls_net_set_block(socket_fd)) != 0) {
-        Log_e("set block faliled returned 0x%04x", ret < 0 ? -ret : ret);
+    /* all waiting is done in _mbedtls_wait(), the socket itself never blocks */
+    if ((ret = mbedtls_net_set_nonblock(socket_fd)) != 0) {
+        Log_e("set nonblock faliled returned 0x%04x", ret < 0 ? -ret : ret);
         return QCLOUD_ERR_TCP_CONNECT;
     }
 
     return QCLOUD_RET_SUCCESS;
 }
 
+/**
+ * @brief Wait until the socket is ready for what mbedtls asked for
+ *
+ * @param socket_fd  socket handle
+ * @param want       MBEDTLS_ERR_SSL_WANT_READ or MBEDTLS_ERR_SSL_WANT_WRITE
+ * @param timer      deadline of the whole operation
+ * @return 1 when ready, 0 when the timer expired, -1 on poll error
+ */
+static int _mbedtls_wait(mbedtls_net_context *socket_fd, int want, Timer *timer)
+{
+    struct pollfd pfd;
+    int           ret;
+
+    pfd.fd     = socket_fd->fd;
+    pfd.events = (want == MBEDTLS_ERR_SSL_WANT_WRITE) ? POLLOUT : POLLIN;
+
+    do {
+        int timeout = left_ms(timer);
+        if (timeout <= 0) {
+            return 0;
+        }
+        pfd.revents = 0;
+        ret         = poll(&pfd, 1, timeout);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        Log_e("poll failed, errno: %d", errno);
+        return -1;
+    }
+
+    /* errors and hangup are reported as ready so the next ssl call picks them up */
+    return ret > 0 ? 1 : 0;
+}
+
 /**
  * @brief verify server certificate
  *
@@ -189,21 +512,28 @@ int _qcloud_server_certificate_verify(void *hostname, mbedtls_x509_crt *crt, int
     return *flags;
 }
 
-uintptr_t HAL_TLS_Connect(TLSConnectParams *pConnectParams, const char *host, int port)
+/**
+ * @brief configure the SSL context of a connection, everything up to the TCP connect
+ */
+static int _mbedtls_client_setup(TLSDataParams *pDataParams, TLSConnectParams *pConnectParams, const char *host)
 {
     int ret = 0;
+    int mfl = _mbedtls_max_frag_len_code(pConnectParams->max_frag_len);
 
-    TLSDataParams *pDataParams = (TLSDataParams *)HAL_Malloc(sizeof(TLSDataParams));
+    if (mfl < 0) {
+        Log_e("invalid max_frag_len %u", pConnectParams->max_frag_len);
+        return QCLOUD_ERR_INVAL;
+    }
 
     if ((ret = _mbedtls_client_init(pDataParams, pConnectParams)) != QCLOUD_RET_SUCCESS) {
-        goto error;
+        return ret;
     }
 
     Log_d("Setting up the SSL/TLS structure...");
     if ((ret = mbedtls_ssl_config_defaults(&(pDataParams->ssl_conf), MBEDTLS_SSL_IS_CLIENT,
                                            MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
         Log_e("mbedtls_ssl_config_defaults failed returned 0x%04x", ret < 0 ? -ret : ret);
-        goto error;
+        return ret;
     }
 
     mbedtls_ssl_conf_verify(&(pDataParams->ssl_conf), _qcloud_server_certificate_verify, (void *)host);
@@ -212,17 +542,22 @@ uintptr_t HAL_TLS_Connect(TLSConnectParams *pConnectParams, const char *host, in
 
     mbedtls_ssl_conf_rng(&(pDataParams->ssl_conf), mbedtls_ctr_drbg_random, &(pDataParams->ctr_drbg));
 
-    mbedtls_ssl_conf_ca_chain(&(pDataParams->ssl_conf), &(pDataParams->ca_cert), NULL);
+    mbedtls_ssl_conf_ca_chain(&(pDataParams->ssl_conf),
+                              pDataParams->ca_shared ? pDataParams->ca_shared : &(pDataParams->ca_cert), NULL);
     if ((ret = mbedtls_ssl_conf_own_cert(&(pDataParams->ssl_conf), &(pDataParams->client_cert),
                                          &(pDataParams->private_key))) != 0) {
         Log_e("mbedtls_ssl_conf_own_cert failed returned 0x%04x", ret < 0 ? -ret : ret);
-        goto error;
+        return ret;
+    }
+
+    if ((ret = mbedtls_ssl_conf_max_frag_len(&(pDataParams->ssl_conf), (unsigned char)mfl)) != 0) {
+        Log_e("mbedtls_ssl_conf_max_frag_len failed returned 0x%04x", ret < 0 ? -ret : ret);
+        return ret;
     }
 
-    mbedtls_ssl_conf_read_timeout(&(pDataParams->ssl_conf), pConnectParams->timeout_ms);
     if ((ret = mbedtls_ssl_setup(&(pDataParams->ssl), &(pDataParams->ssl_conf))) != 0) {
         Log_e("mbedtls_ssl_setup failed returned 0x%04x", ret < 0 ? -ret : ret);
-        goto error;
+        return ret;
     }
 
 #ifndef AUTH_MODE_CERT
@@ -235,11 +570,36 @@ uintptr_t HAL_TLS_Connect(TLSConnectParams *pConnectParams, const char *host, in
     // Set the hostname to check against the received server certificate and sni
     if ((ret = mbedtls_ssl_set_hostname(&(pDataParams->ssl), host)) != 0) {
         Log_e("mbedtls_ssl_set_hostname failed returned 0x%04x", ret < 0 ? -ret : ret);
-        goto error;
+        return ret;
+    }
+
+    mbedtls_ssl_set_bio(&(pDataParams->ssl), &(pDataParams->socket_fd), mbedtls_net_send, mbedtls_net_recv, NULL);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+uintptr_t HAL_TLS_Connect(TLSConnectParams *pConnectParams, const char *host, int port)
+{
+    int   ret = 0;
+    Timer timer;
+
+    InitTimer(&timer);
+    _mbedtls_global_init_once();
+
+    TLSDataParams *pDataParams = (TLSDataParams *)HAL_Malloc(sizeof(TLSDataParams));
+    if (NULL == pDataParams) {
+        Log_e("malloc TLSDataParams failed");
+        return 0;
     }
+    memset(&(pDataParams->mem), 0, sizeof(TLSMemStat));
+    pDataParams->mem.heap_cur = pDataParams->mem.heap_peak = sizeof(TLSDataParams);
 
-    mbedtls_ssl_set_bio(&(pDataParams->ssl), &(pDataParams->socket_fd), mbedtls_net_send, mbedtls_net_recv,
-                        mbedtls_net_recv_timeout);
+    _mbedtls_mem_charge_begin(&(pDataParams->mem));
+    ret = _mbedtls_client_setup(pDataParams, pConnectParams, host);
+    _mbedtls_mem_charge_end();
+    if (ret != QCLOUD_RET_SUCCESS) {
+        goto error;
+    }
 
     Log_d("Performing the SSL/TLS handshake...");
     Log_d("Connecting to /%s/%d...", STRING_PTR_PRINT_SANITY_CHECK(host), port);
@@ -247,7 +607,15 @@ uintptr_t HAL_TLS_Connect(TLSConnectParams *pConnectParams, const char *host, in
         goto error;
     }
 
-    while ((ret = mbedtls_ssl_handshake(&(pDataParams->ssl))) != 0) {
+    countdown_ms(&timer, pConnectParams->timeout_ms);
+    for (;;) {
+        _mbedtls_mem_charge_begin(&(pDataParams->mem));
+        ret = mbedtls_ssl_handshake(&(pDataParams->ssl));
+        _mbedtls_mem_charge_end();
+        if (ret == 0) {
+            break;
+        }
+
         if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
             Log_e("mbedtls_ssl_handshake failed returned 0x%04x", ret < 0 ? -ret : ret);
             if (ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
@@ -255,6 +623,11 @@ uintptr_t HAL_TLS_Connect(TLSConnectParams *pConnectParams, const char *host, in
             }
             goto error;
         }
+
+        if (_mbedtls_wait(&(pDataParams->socket_fd), ret, &timer) <= 0) {
+            Log_e("mbedtls_ssl_handshake timeout after %u ms", pConnectParams->timeout_ms);
+            goto error;
+        }
     }
 
     if ((ret = mbedtls_ssl_get_verify_result(&(pDataParams->ssl))) != 0) {
@@ -262,9 +635,15 @@ uintptr_t HAL_TLS_Connect(TLSConnectParams *pConnectParams, const char *host, in
         goto error;
     }
 
-    mbedtls_ssl_conf_read_timeout(&(pDataParams->ssl_conf), 100);
+    pDataParams->mem.record_buf_len = MBEDTLS_SSL_BUFFER_LEN;
+    pDataParams->mem.max_frag_len   = mbedtls_ssl_get_max_frag_len(&(pDataParams->ssl));
+    if (pConnectParams->max_frag_len && pDataParams->mem.max_frag_len != pConnectParams->max_frag_len) {
+        Log_w("server ignored max_frag_len %u, records stay at %u", pConnectParams->max_frag_len,
+              (unsigned)pDataParams->mem.max_frag_len);
+    }
 
     Log_i("connected with /%s/%d...", STRING_PTR_PRINT_SANITY_CHECK(host), port);
+    Log_d("TLS heap: %u bytes, peak %u", (unsigned)pDataParams->mem.heap_cur, (unsigned)pDataParams->mem.heap_peak);
 
     return (uintptr_t)pDataParams;
 
@@ -281,13 +660,21 @@ void HAL_TLS_Disconnect(uintptr_t handle)
     }
     TLSDataParams *pParams = (TLSDataParams *)handle;
     int            ret     = 0;
-    do {
-        ret = mbedtls_ssl_close_notify(&(pParams->ssl));
-    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    Timer          timer;
+
+    InitTimer(&timer);
+    countdown_ms(&timer, TLS_CLOSE_NOTIFY_TIMEOUT_MS);
+    while ((ret = mbedtls_ssl_close_notify(&(pParams->ssl))) == MBEDTLS_ERR_SSL_WANT_READ ||
+           ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        if (_mbedtls_wait(&(pParams->socket_fd), ret, &timer) <= 0) {
+            break;
+        }
+    }
 
     mbedtls_net_free(&(pParams->socket_fd));
     mbedtls_x509_crt_free(&(pParams->client_cert));
     mbedtls_x509_crt_free(&(pParams->ca_cert));
+    _shared_ca_put(pParams->ca_shared);
     mbedtls_pk_free(&(pParams->private_key));
     mbedtls_ssl_free(&(pParams->ssl));
     mbedtls_ssl_config_free(&(pParams->ssl_conf));
@@ -302,32 +689,37 @@ int HAL_TLS_Write(uintptr_t handle, unsigned char *msg, size_t totalLen, uint32_
     Timer timer;
     InitTimer(&timer);
     countdown_ms(&timer, (unsigned int)timeout_ms);
-    size_t written_so_far;
-    bool   errorFlag = false;
-    int    write_rc  = 0;
+    size_t written_so_far = 0;
+    int    write_rc       = 0;
 
     TLSDataParams *pParams = (TLSDataParams *)handle;
 
-    for (written_so_far = 0; written_so_far < totalLen && !expired(&timer); written_so_far += write_rc) {
-        while (!expired(&timer) &&
-               (write_rc = mbedtls_ssl_write(&(pParams->ssl), msg + written_so_far, totalLen - written_so_far)) <= 0) {
-            if (write_rc != MBEDTLS_ERR_SSL_WANT_READ && write_rc != MBEDTLS_ERR_SSL_WANT_WRITE) {
-                Log_e("HAL_TLS_write failed 0x%04x", write_rc < 0 ? -write_rc : write_rc);
-                errorFlag = true;
-                break;
-            }
+    while (written_so_far < totalLen) {
+        write_rc = mbedtls_ssl_write(&(pParams->ssl), msg + written_so_far, totalLen - written_so_far);
+        if (write_rc > 0) {
+            written_so_far += write_rc;
+            continue;
         }
 
-        if (errorFlag) {
+        if (write_rc != MBEDTLS_ERR_SSL_WANT_READ && write_rc != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            Log_e("HAL_TLS_write failed 0x%04x", write_rc < 0 ? -write_rc : write_rc);
+            *written_len = written_so_far;
+            return QCLOUD_ERR_SSL_WRITE;
+        }
+
+        /* socket buffer full: sleep until it drains instead of spinning */
+        write_rc = _mbedtls_wait(&(pParams->socket_fd), write_rc, &timer);
+        if (write_rc < 0) {
+            *written_len = written_so_far;
+            return QCLOUD_ERR_SSL_WRITE;
+        } else if (write_rc == 0) {
             break;
         }
     }
 
     *written_len = written_so_far;
 
-    if (errorFlag) {
-        return QCLOUD_ERR_SSL_WRITE;
-    } else if (expired(&timer) && written_so_far != totalLen) {
+    if (written_so_far != totalLen) {
         return QCLOUD_ERR_SSL_WRITE_TIMEOUT;
     }
 
@@ -336,9 +728,6 @@ int HAL_TLS_Write(uintptr_t handle, unsigned char *msg, size_t totalLen, uint32_
 
 int HAL_TLS_Read(uintptr_t handle, unsigned char *msg, size_t totalLen, uint32_t timeout_ms, size_t *read_len)
 {
-    // mbedtls_ssl_conf_read_timeout(&(pParams->ssl_conf), timeout_ms); TODO:this cause read blocking and no return even
-    // timeout
-    // use non-blocking read
     Timer timer;
     InitTimer(&timer);
     countdown_ms(&timer, (unsigned int)timeout_ms);
@@ -346,23 +735,26 @@ int HAL_TLS_Read(uintptr_t handle, unsigned char *msg, size_t totalLen, uint32_t
 
     TLSDataParams *pParams = (TLSDataParams *)handle;
 
-    do {
+    while (*read_len < totalLen) {
         int read_rc = 0;
         read_rc     = mbedtls_ssl_read(&(pParams->ssl), msg + *read_len, totalLen - *read_len);
 
         if (read_rc > 0) {
             *read_len += read_rc;
-        } else if (read_rc == 0 || (read_rc != MBEDTLS_ERR_SSL_WANT_WRITE && read_rc != MBEDTLS_ERR_SSL_WANT_READ &&
-                                    read_rc != MBEDTLS_ERR_SSL_TIMEOUT)) {
+            continue;
+        } else if (read_rc == 0 || (read_rc != MBEDTLS_ERR_SSL_WANT_WRITE && read_rc != MBEDTLS_ERR_SSL_WANT_READ)) {
             Log_e("cloud_iot_network_tls_read failed: 0x%04x", read_rc < 0 ? -read_rc : read_rc);
             return QCLOUD_ERR_SSL_READ;
         }
 
-        if (expired(&timer)) {
+        /* no complete record buffered: sleep until the socket has more */
+        read_rc = _mbedtls_wait(&(pParams->socket_fd), read_rc, &timer);
+        if (read_rc < 0) {
+            return QCLOUD_ERR_SSL_READ;
+        } else if (read_rc == 0) {
             break;
         }
-
-    } while (*read_len < totalLen);
+    }
 
     if (totalLen == *read_len) {
         return QCLOUD_RET_SUCCESS;
@@ -375,6 +767,38 @@ int HAL_TLS_Read(uintptr_t handle, unsigned char *msg, size_t totalLen, uint32_t
     }
 }
 
+int HAL_TLS_GetFd(uintptr_t handle)
+{
+    if ((uintptr_t)NULL == handle) {
+        return -1;
+    }
+
+    return ((TLSDataParams *)handle)->socket_fd.fd;
+}
+
+int HAL_TLS_GetMemStat(uintptr_t handle, TLSMemStat *stat)
+{
+    TLSDataParams *pParams = (TLSDataParams *)handle;
+    POINTER_SANITY_CHECK(pParams, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(stat, QCLOUD_ERR_INVAL);
+
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    _mbedtls_mem_stat_get(stat, &pParams->mem);
+    return QCLOUD_RET_SUCCESS;
+#else
+    return QCLOUD_ERR_FAILURE;
+#endif
+}
+
+size_t HAL_TLS_Pending(uintptr_t handle)
+{
+    if ((uintptr_t)NULL == handle) {
+        return 0;
+    }
+
+    return mbedtls_ssl_get_bytes_avail(&(((TLSDataParams *)handle)->ssl));
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,7 @@ typedef struct {
 
 static ConfigData sg_config_data    = {9600, 8, 0, 1, 1000};
 static bool       sg_config_arrived = false;
+static bool       sg_config_changed = false;
 
 static void _on_config_proc_handler(void *client, int config_reply_errcode, char *config_json, int config_json_len)
 {
@@ -91,6 +92,26 @@ static void _on_config_proc_handler(void *client, int config_reply_errcode, char
     return;
 }
 
+#define CONFIG_MAX_LEN 128
+
+static void _apply_cached_config(void *config_cache)
+{
+    char     config_json[CONFIG_MAX_LEN + 1];
+    uint32_t version = 0;
+
+    if (QCLOUD_RET_SUCCESS == IOT_Config_Cache_Get(config_cache, config_json, sizeof(config_json), &version)) {
+        Log_i("config version %u", (unsigned int)version);
+        _on_config_proc_handler(NULL, REMOTE_CONFIG_ERRCODE_SUCCESS, config_json, strlen(config_json));
+    }
+}
+
+static void _on_config_key_changed(void *config_cache, const char *key, const char *value, int value_len,
+                                   void *user_data)
+{
+    Log_i("config key %s changed to %.*s", key, value_len, STRING_PTR_PRINT_SANITY_CHECK(value));
+    sg_config_changed = true;
+}
+
 // MQTT event callback
 static void _mqtt_event_handler(void *pclient, void *handle_context, MQTTEventMsg *msg)
 {
@@ -260,32 +281,21 @@ int main(int argc, char **argv)
         return QCLOUD_ERR_FAILURE;
     }
 
-    // subscribe config topic
+    // the cached config of the last run is usable before any network round trip
     // example: config json data : {"baud rate":115200,"data bits":8,"stop bit":1,"parity":"NONE","thread sleep":1000}
-    static ConfigSubscirbeUserData config_sub_userdata;
-    config_sub_userdata.on_config_proc  = _on_config_proc_handler;
-    config_sub_userdata.json_buffer_len = REMOTE_CONFIG_JSON_BUFFER_MIN_LEN + 88;
-    config_sub_userdata.json_buffer     = HAL_Malloc(config_sub_userdata.json_buffer_len);
-    if (NULL == config_sub_userdata.json_buffer) {
-        Log_e("Malloc Error size:%d", config_sub_userdata.json_buffer_len);
-        return QCLOUD_ERR_MALLOC;
+    void *config_cache = IOT_Config_Cache_Init(CONFIG_MAX_LEN);
+    if (NULL == config_cache) {
+        Log_e("config cache init failed");
+        return QCLOUD_ERR_FAILURE;
     }
+    _apply_cached_config(config_cache);
 
-    for (int count = 0; count < 3; count++) {
-        rc = IOT_Subscribe_Config(client, &config_sub_userdata, 5000);
-        if (QCLOUD_RET_SUCCESS <= rc) {
-            Log_i("config topic subscribe success, packetid:%d", rc);
-            break;
-        } else {
-            Log_i("config topic subscribe failed, ret:%d, retry :%d", rc, count + 1);
-        }
-    }
+    // updates are applied from the yield context, keys without a watcher are not notified
+    IOT_Config_Cache_Watch(config_cache, NULL, _on_config_key_changed, NULL);
 
-    char json_buffer[32];
-    int  time_count = 0;
-    rc              = IOT_Get_Config(client, json_buffer, sizeof(json_buffer), 5000);
+    rc = IOT_Config_Cache_Bind(client, config_cache);
     if (rc != QCLOUD_RET_SUCCESS) {
-        Log_e("get config failed ret: %d", rc);
+        Log_e("config cache bind failed ret: %d", rc);
     }
 
     do {
@@ -298,12 +308,10 @@ int main(int argc, char **argv)
             break;
         }
 
-        time_count++;
-        if ((time_count % 120) == 0) {
-            rc = IOT_Get_Config(client, json_buffer, sizeof(json_buffer), 5000);
-            if (rc != QCLOUD_RET_SUCCESS) {
-                Log_e("get config failed ret: %d", rc);
-            }
+        // apply once after all the keys of an update have been notified
+        if (sg_config_changed) {
+            sg_config_changed = false;
+            _apply_cached_config(config_cache);
         }
 
         if (sg_loop_test)
@@ -311,6 +319,7 @@ int main(int argc, char **argv)
 
     } while (sg_loop_test);
 
+    IOT_Config_Cache_Deinit(config_cache);
     rc = IOT_MQTT_Destroy(&client);
 
     return rc;
@@ -0,0 +1,108 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qcloud_iot_export.h"
+#include "qcloud_iot_import.h"
+#include "utils_getopt.h"
+
+static uint32_t sg_buf_len     = 1024;
+static uint32_t sg_duration_ms = 1000;
+
+static int parse_arguments(int argc, char **argv)
+{
+    int c;
+    while ((c = utils_getopt(argc, argv, "b:t:")) != EOF) switch (c) {
+            case 'b':
+                sg_buf_len = atoi(utils_optarg);
+                if (sg_buf_len == 0 || sg_buf_len % 16)
+                    return -1;
+                break;
+
+            case 't':
+                sg_duration_ms = atoi(utils_optarg);
+                if (sg_duration_ms == 0)
+                    return -1;
+                break;
+
+            default:
+                HAL_Printf(
+                    "usage: %s [options]\n"
+                    "  [-b <bytes per call, multiple of 16>] \n"
+                    "  [-t <ms per algorithm>] \n",
+                    argv[0]);
+                return -1;
+        }
+    return 0;
+}
+
+static int _run_benchmark(uint32_t result[IOT_CRYPTO_ALGO_MAX])
+{
+    int i, rc;
+
+    for (i = 0; i < IOT_CRYPTO_ALGO_MAX; i++) {
+        rc = IOT_Crypto_Benchmark((IotCryptoAlgo)i, sg_buf_len, sg_duration_ms, &result[i]);
+        if (rc != QCLOUD_RET_SUCCESS) {
+            Log_e("benchmark %s failed: %d", IOT_Crypto_Algo_Name((IotCryptoAlgo)i), rc);
+            return rc;
+        }
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    int      rc, i;
+    uint32_t accel;
+    uint32_t accel_kbps[IOT_CRYPTO_ALGO_MAX];
+    uint32_t portable_kbps[IOT_CRYPTO_ALGO_MAX];
+
+    IOT_Log_Set_Level(eLOG_INFO);
+
+    rc = parse_arguments(argc, argv);
+    if (rc != QCLOUD_RET_SUCCESS) {
+        Log_e("parse arguments error, rc = %d", rc);
+        return rc;
+    }
+
+    accel = IOT_Crypto_Get_Accel();
+    Log_i("crypto instructions: SHA %s, AES %s", (accel & IOT_CRYPTO_ACCEL_SHA1) ? "yes" : "no",
+          (accel & IOT_CRYPTO_ACCEL_AES) ? "yes" : "no");
+
+    rc = _run_benchmark(accel_kbps);
+    if (rc != QCLOUD_RET_SUCCESS) {
+        return rc;
+    }
+
+    // same buffers on the portable C code, for comparison
+    IOT_Crypto_Set_Accel(0);
+    rc = _run_benchmark(portable_kbps);
+    IOT_Crypto_Set_Accel(accel);
+    if (rc != QCLOUD_RET_SUCCESS) {
+        return rc;
+    }
+
+    HAL_Printf("%-16s %12s %12s %8s   (%u bytes per call)\n", "algorithm", "accel kB/s", "C kB/s", "speedup",
+               sg_buf_len);
+    for (i = 0; i < IOT_CRYPTO_ALGO_MAX; i++) {
+        HAL_Printf("%-16s %12u %12u %7.2fx\n", IOT_Crypto_Algo_Name((IotCryptoAlgo)i), accel_kbps[i],
+                   portable_kbps[i], portable_kbps[i] ? (double)accel_kbps[i] / portable_kbps[i] : 0.0);
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
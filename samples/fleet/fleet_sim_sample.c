@@ -0,0 +1,960 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Fleet simulator: N devices built from one template device, served by a few
+ * worker threads, each of them polling the sockets of its devices and yielding
+ * only those with data to read. Every device publishes to its own data topic
+ * and subscribes to it, so the broker echo gives the publish round trip time;
+ * shadow updates are timed from request to reply.
+ *
+ * Against the broker stand-in, built with FEATURE_AUTH_WITH_NOTLS:
+ *
+ *     ./tools/mqtt_broker_sim.py --services --quiet --stats 10
+ *     ./output/release/bin/fleet_sim_sample -H 127.0.0.1 -N 2000 -p 1000 -s 5000 -d 60
+ *
+ * Against a real endpoint the devices <pattern % index> have to exist with the
+ * template's secret (or certificate).
+ */
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "qcloud_iot_export.h"
+#include "qcloud_iot_import.h"
+#include "utils_getopt.h"
+
+#define FLEET_MAX_WORKERS       64
+#define FLEET_MAX_EXTRA_SUBS    4
+#define FLEET_MAX_PAYLOAD_LEN   4096
+#define FLEET_SETUP_TIMEOUT_MS  10000
+#define FLEET_SHADOW_TIMEOUT_MS 5000
+
+/* a connected device is yielded at least this often, for keep alive and ack timeouts */
+#define FLEET_IDLE_YIELD_MS 1000
+
+/* a disconnected device is yielded this often, to drive its reconnect */
+#define FLEET_OFFLINE_YIELD_MS 100
+
+/* longest sleep of a worker in poll(), bounds how late a publish is sent */
+#define FLEET_POLL_MAX_MS 50
+
+/* latency histogram: 1 ms buckets up to 1 s, then 100 ms buckets up to 60 s */
+#define FLEET_HIST_FINE_MS 1000
+#define FLEET_HIST_COARSE  100
+#define FLEET_HIST_BUCKETS (FLEET_HIST_FINE_MS + (60000 - FLEET_HIST_FINE_MS) / FLEET_HIST_COARSE + 1)
+
+/* true when time a is at or past time b, on the wrapping HAL_GetTimeMs() clock */
+#define TIME_REACHED(a, b) ((int32_t)((a) - (b)) >= 0)
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_ms;
+    uint32_t bucket[FLEET_HIST_BUCKETS];
+} FleetHist;
+
+typedef struct {
+    uint32_t  connect_ok;
+    uint32_t  connect_fail;
+    uint32_t  sub_ok;
+    uint32_t  sub_fail;
+    uint32_t  published;
+    uint32_t  publish_fail;
+    uint32_t  publish_late;  // publishes sent a whole interval late, the worker can't keep up
+    uint32_t  offline_skip;  // publishes and updates skipped while disconnected
+    uint32_t  acked;
+    uint32_t  echoed;
+    uint32_t  shadow_sent;
+    uint32_t  shadow_ok;
+    uint32_t  shadow_fail;
+    uint32_t  disconnect_events;
+    uint32_t  reconnect_events;
+    FleetHist connect_ms;
+    FleetHist echo_ms;
+    FleetHist shadow_ms;
+} FleetStat;
+
+struct FleetWorker;
+
+typedef struct {
+    int                 index;
+    char                name[MAX_SIZE_OF_DEVICE_NAME + 1];
+    void *              mqtt;    // MQTT client, the one inside the shadow client in shadow mode
+    void *              shadow;  // shadow client, NULL without shadow workload
+    MQTTTopicHandle     data_topic;
+    uint32_t            seq;
+    uint32_t            next_pub;
+    uint32_t            next_shadow;
+    uint32_t            next_yield;
+    uint32_t            shadow_sent_ms;  // send time of the update waiting for reply, 0 for none
+    int32_t             shadow_seq;
+    DeviceProperty      shadow_prop;
+    struct FleetWorker *worker;
+} FleetDevice;
+
+typedef struct FleetWorker {
+    int               id;
+    FleetDevice *     devs;
+    int               dev_num;
+    int               connected;
+    struct pollfd *   pfds;
+    int *             pfd_dev;
+    char *            pub_buf;
+    char              shadow_buf[256];
+    FleetStat         stat;
+    MQTTReconnectStat reconnect;  // summed over the devices when they are destroyed
+    ThreadParams      thread;     // read by the thread once it runs, so it lives here and not on the stack
+    volatile int      state;
+} FleetWorker;
+
+enum { WORKER_SETUP = 0, WORKER_READY, WORKER_DONE };
+
+/* options */
+static int         sg_dev_num       = 100;
+static int         sg_dev_offset    = 0;
+static const char *sg_name_pattern  = "sim%05d";
+static int         sg_worker_num    = 32;
+static int         sg_duration_s    = 60;
+static uint32_t    sg_pub_interval  = 1000;
+static uint32_t    sg_payload_len   = 64;
+static QoS         sg_qos           = QOS0;
+static uint32_t    sg_shadow_period = 0;
+static int         sg_extra_subs    = 0;
+static int         sg_connect_rate  = 0;
+static int         sg_report_s      = 5;
+static uint8_t     sg_mqtt_version  = 4;
+static char *      sg_host          = NULL;
+static const char *sg_backup_hosts[MAX_MQTT_BACKUP_HOSTS];
+static int         sg_backup_num = 0;
+
+static DeviceInfo    sg_template;
+static FleetWorker   sg_workers[FLEET_MAX_WORKERS];
+static volatile bool sg_start = false;
+static volatile bool sg_stop  = false;
+static uint32_t      sg_start_ms;
+
+static void _hist_add(FleetHist *hist, uint32_t ms)
+{
+    uint32_t b = ms < FLEET_HIST_FINE_MS ? ms : FLEET_HIST_FINE_MS + (ms - FLEET_HIST_FINE_MS) / FLEET_HIST_COARSE;
+
+    hist->bucket[b < FLEET_HIST_BUCKETS ? b : FLEET_HIST_BUCKETS - 1]++;
+    hist->count++;
+    if (ms > hist->max_ms) {
+        hist->max_ms = ms;
+    }
+}
+
+static void _hist_merge(FleetHist *to, const FleetHist *from)
+{
+    int i;
+
+    for (i = 0; i < FLEET_HIST_BUCKETS; i++) {
+        to->bucket[i] += from->bucket[i];
+    }
+    to->count += from->count;
+    if (from->max_ms > to->max_ms) {
+        to->max_ms = from->max_ms;
+    }
+}
+
+/* lower bound of the bucket holding the pct-th percentile */
+static uint32_t _hist_percentile(const FleetHist *hist, int pct)
+{
+    uint64_t rank = ((uint64_t)hist->count * pct + 99) / 100;
+    uint64_t seen = 0;
+    int      i;
+
+    for (i = 0; i < FLEET_HIST_BUCKETS; i++) {
+        seen += hist->bucket[i];
+        if (seen >= rank && seen) {
+            return i < FLEET_HIST_FINE_MS ? i : FLEET_HIST_FINE_MS + (i - FLEET_HIST_FINE_MS) * FLEET_HIST_COARSE;
+        }
+    }
+    return hist->max_ms;
+}
+
+static void _hist_print(const char *name, const FleetHist *hist)
+{
+    if (0 == hist->count) {
+        HAL_Printf("  %-18s no samples\n", name);
+        return;
+    }
+    HAL_Printf("  %-18s p50 %u ms, p90 %u ms, p99 %u ms, max %u ms (%u samples)\n", name, _hist_percentile(hist, 50),
+               _hist_percentile(hist, 90), _hist_percentile(hist, 99), hist->max_ms, hist->count);
+}
+
+/* resident memory of the process, 0 when unknown */
+static size_t _get_rss_bytes(void)
+{
+    unsigned long size = 0, resident = 0;
+    FILE *        fp   = fopen("/proc/self/statm", "r");
+
+    if (NULL == fp) {
+        return 0;
+    }
+    if (2 != fscanf(fp, "%lu %lu", &size, &resident)) {
+        resident = 0;
+    }
+    fclose(fp);
+
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static void _mqtt_event_handler(void *pclient, void *handle_context, MQTTEventMsg *msg)
+{
+    FleetDevice *dev = (FleetDevice *)handle_context;
+
+    switch (msg->event_type) {
+        case MQTT_EVENT_DISCONNECT:
+            dev->worker->stat.disconnect_events++;
+            break;
+
+        case MQTT_EVENT_RECONNECT:
+            dev->worker->stat.reconnect_events++;
+            break;
+
+        case MQTT_EVENT_PUBLISH_SUCCESS:
+            dev->worker->stat.acked++;
+            break;
+
+        case MQTT_EVENT_PUBLISH_TIMEOUT:
+        case MQTT_EVENT_PUBLISH_NACK:
+            dev->worker->stat.publish_fail++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void _on_sub_event(void *pClient, MQTTEventType event_type, void *pUserData)
+{
+    FleetDevice *dev = (FleetDevice *)pUserData;
+
+    if (MQTT_EVENT_SUBCRIBE_SUCCESS == event_type) {
+        dev->worker->stat.sub_ok++;
+    } else if (MQTT_EVENT_SUBCRIBE_TIMEOUT == event_type || MQTT_EVENT_SUBCRIBE_NACK == event_type) {
+        dev->worker->stat.sub_fail++;
+    }
+}
+
+/* echo of a publish of this device, the payload starts with {"seq":n,"ts":ms */
+static void _on_data_message(void *pClient, MQTTMessage *message, void *pUserData)
+{
+    FleetDevice *dev = (FleetDevice *)pUserData;
+    char         head[64];
+    size_t       len = message->payload_len < sizeof(head) - 1 ? message->payload_len : sizeof(head) - 1;
+    char *       ts;
+
+    memcpy(head, message->payload, len);
+    head[len] = '\0';
+
+    ts = strstr(head, "\"ts\":");
+    if (ts) {
+        dev->worker->stat.echoed++;
+        _hist_add(&dev->worker->stat.echo_ms, HAL_GetTimeMs() - (uint32_t)strtoul(ts + 5, NULL, 10));
+    }
+}
+
+static void _on_shadow_update(void *pClient, Method method, RequestAck requestAck, const char *pJsonDocument,
+                              void *userContext)
+{
+    FleetDevice *dev = (FleetDevice *)userContext;
+
+    if (ACK_ACCEPTED == requestAck) {
+        dev->worker->stat.shadow_ok++;
+        _hist_add(&dev->worker->stat.shadow_ms, HAL_GetTimeMs() - dev->shadow_sent_ms);
+    } else {
+        dev->worker->stat.shadow_fail++;
+    }
+    dev->shadow_sent_ms = 0;
+}
+
+static int _device_subscribe(FleetDevice *dev)
+{
+    char            topic[MAX_SIZE_OF_MQTT_TOPIC + 1];
+    SubscribeParams sub_params = DEFAULT_SUB_PARAMS;
+    int             rc, i;
+
+    sub_params.qos                  = sg_qos;
+    sub_params.on_message_handler   = _on_data_message;
+    sub_params.on_sub_event_handler = _on_sub_event;
+    sub_params.user_data            = dev;
+
+    HAL_Snprintf(topic, sizeof(topic), "%s/%s/data", sg_template.product_id, dev->name);
+    if ((rc = IOT_MQTT_Topic_Init(&dev->data_topic, topic)) != QCLOUD_RET_SUCCESS) {
+        return rc;
+    }
+    rc = IOT_MQTT_Subscribe(dev->mqtt, topic, &sub_params);
+    if (rc < 0) {
+        return rc;
+    }
+
+    /* extra subscriptions nobody publishes to, for the subscription load of broker and client */
+    sub_params.on_message_handler = NULL;
+    for (i = 0; i < sg_extra_subs; i++) {
+        HAL_Snprintf(topic, sizeof(topic), "%s/%s/sim%d", sg_template.product_id, dev->name, i);
+        rc = IOT_MQTT_Subscribe(dev->mqtt, topic, &sub_params);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+static int _device_connect(FleetDevice *dev)
+{
+    MQTTEventHandler event_handle = {_mqtt_event_handler, dev};
+    uint32_t         t0           = HAL_GetTimeMs();
+
+#ifdef AUTH_MODE_CERT
+    char cert_file[FILE_PATH_MAX_LEN];
+    char key_file[FILE_PATH_MAX_LEN];
+    char current_path[128];
+
+    if (NULL == getcwd(current_path, sizeof(current_path))) {
+        Log_e("getcwd return NULL");
+        return QCLOUD_ERR_FAILURE;
+    }
+    HAL_Snprintf(cert_file, FILE_PATH_MAX_LEN, "%s/certs/%s", current_path, sg_template.dev_cert_file_name);
+    HAL_Snprintf(key_file, FILE_PATH_MAX_LEN, "%s/certs/%s", current_path, sg_template.dev_key_file_name);
+#endif
+
+    if (sg_shadow_period) {
+        ShadowInitParams init_params = DEFAULT_SHAWDOW_INIT_PARAMS;
+
+        init_params.product_id  = sg_template.product_id;
+        init_params.device_name = dev->name;
+#ifdef AUTH_MODE_CERT
+        memcpy(init_params.cert_file, cert_file, FILE_PATH_MAX_LEN);
+        memcpy(init_params.key_file, key_file, FILE_PATH_MAX_LEN);
+#else
+        init_params.device_secret = sg_template.device_secret;
+#endif
+        init_params.mqtt_version = sg_mqtt_version;
+        init_params.event_handle = event_handle;
+        init_params.host         = sg_host;
+        init_params.shadow_type  = eSHADOW;
+
+        dev->shadow = IOT_Shadow_Construct(&init_params);
+        dev->mqtt   = dev->shadow ? IOT_Shadow_Get_Mqtt_Client(dev->shadow) : NULL;
+    } else {
+        MQTTInitParams init_params = DEFAULT_MQTTINIT_PARAMS;
+
+        init_params.product_id  = sg_template.product_id;
+        init_params.device_name = dev->name;
+#ifdef AUTH_MODE_CERT
+        memcpy(init_params.cert_file, cert_file, FILE_PATH_MAX_LEN);
+        memcpy(init_params.key_file, key_file, FILE_PATH_MAX_LEN);
+#else
+        init_params.device_secret = sg_template.device_secret;
+#endif
+        init_params.mqtt_version = sg_mqtt_version;
+        init_params.event_handle = event_handle;
+        init_params.host         = sg_host;
+
+        dev->mqtt = IOT_MQTT_Construct(&init_params);
+    }
+
+    if (NULL == dev->mqtt) {
+        dev->worker->stat.connect_fail++;
+        return QCLOUD_ERR_MQTT_NO_CONN;
+    }
+    dev->worker->stat.connect_ok++;
+    _hist_add(&dev->worker->stat.connect_ms, HAL_GetTimeMs() - t0);
+
+    if (sg_backup_num) {
+        IOT_MQTT_Set_Backup_Hosts(dev->mqtt, sg_backup_hosts, sg_backup_num);
+    }
+
+    dev->shadow_prop.key  = "seq";
+    dev->shadow_prop.data = &dev->shadow_seq;
+    dev->shadow_prop.type = JINT32;
+
+    return _device_subscribe(dev);
+}
+
+static void _device_publish(FleetWorker *worker, FleetDevice *dev, uint32_t now)
+{
+    PublishParams pub_params = DEFAULT_PUB_PARAMS;
+    int           len;
+
+    len = HAL_Snprintf(worker->pub_buf, sg_payload_len + 1, "{\"seq\":%u,\"ts\":%u,\"pad\":\"", dev->seq++, now);
+    if (len < (int)sg_payload_len - 2) {
+        memset(worker->pub_buf + len, 'x', sg_payload_len - 2 - len);
+        memcpy(worker->pub_buf + sg_payload_len - 2, "\"}", 2);
+        len = sg_payload_len;
+    }
+
+    pub_params.qos         = sg_qos;
+    pub_params.payload     = worker->pub_buf;
+    pub_params.payload_len = len;
+    if (IOT_MQTT_Publish_Topic(dev->mqtt, &dev->data_topic, &pub_params) < 0) {
+        worker->stat.publish_fail++;
+    } else {
+        worker->stat.published++;
+    }
+}
+
+static void _device_shadow_update(FleetWorker *worker, FleetDevice *dev, uint32_t now)
+{
+    int rc;
+
+    dev->shadow_seq++;
+    rc = IOT_Shadow_JSON_ConstructReport(dev->shadow, worker->shadow_buf, sizeof(worker->shadow_buf), 1,
+                                         &dev->shadow_prop);
+    if (rc == QCLOUD_RET_SUCCESS) {
+        dev->shadow_sent_ms = now ? now : 1;
+        rc = IOT_Shadow_Update(dev->shadow, worker->shadow_buf, sizeof(worker->shadow_buf), _on_shadow_update, dev,
+                               FLEET_SHADOW_TIMEOUT_MS);
+    }
+    if (rc == QCLOUD_RET_SUCCESS) {
+        worker->stat.shadow_sent++;
+    } else {
+        dev->shadow_sent_ms = 0;
+        worker->stat.shadow_fail++;
+    }
+}
+
+/* send what is due, the next time something is due comes back in *next */
+static void _device_run_workload(FleetWorker *worker, FleetDevice *dev, uint32_t now, uint32_t *next)
+{
+    bool online = IOT_MQTT_IsConnected(dev->mqtt);
+
+    if (sg_pub_interval) {
+        if (TIME_REACHED(now, dev->next_pub)) {
+            if (!online) {
+                worker->stat.offline_skip++;
+            } else {
+                _device_publish(worker, dev, now);
+            }
+            dev->next_pub += sg_pub_interval;
+            if (TIME_REACHED(now, dev->next_pub)) {
+                /* no burst to catch up, the backlog is reported instead */
+                worker->stat.publish_late++;
+                dev->next_pub = now + sg_pub_interval;
+            }
+        }
+        if ((int32_t)(dev->next_pub - *next) < 0) {
+            *next = dev->next_pub;
+        }
+    }
+
+    if (dev->shadow && sg_shadow_period) {
+        if (TIME_REACHED(now, dev->next_shadow)) {
+            if (!online) {
+                worker->stat.offline_skip++;
+            } else if (0 == dev->shadow_sent_ms) {
+                _device_shadow_update(worker, dev, now);
+            }
+            dev->next_shadow = now + sg_shadow_period;
+        }
+        if ((int32_t)(dev->next_shadow - *next) < 0) {
+            *next = dev->next_shadow;
+        }
+    }
+}
+
+/* wait on the sockets of the worker's devices and yield those which are readable or due */
+static void _worker_serve(FleetWorker *worker, bool workload)
+{
+    uint32_t now     = HAL_GetTimeMs();
+    uint32_t next    = now + FLEET_POLL_MAX_MS;
+    int      pending = 0, connected = 0;
+    int      n       = 0, i, fd, timeout;
+
+    for (i = 0; i < worker->dev_num; i++) {
+        FleetDevice *dev = &worker->devs[i];
+
+        if (NULL == dev->mqtt) {
+            continue;
+        }
+        if (workload) {
+            _device_run_workload(worker, dev, now, &next);
+        }
+
+        fd = IOT_MQTT_GetFd(dev->mqtt);
+        if (fd >= 0) {
+            connected++;
+            if (IOT_MQTT_ReadPending(dev->mqtt)) {
+                pending++;
+            }
+            worker->pfds[n].fd      = fd;
+            worker->pfds[n].events  = POLLIN;
+            worker->pfds[n].revents = 0;
+            worker->pfd_dev[n++]    = i;
+        }
+        if ((int32_t)(dev->next_yield - next) < 0) {
+            next = dev->next_yield;
+        }
+    }
+    worker->connected = connected;
+
+    timeout = pending ? 0 : (TIME_REACHED(now, next) ? 0 : (int)(next - now));
+    if (poll(worker->pfds, n, timeout) < 0) {
+        HAL_SleepMs(1);
+    }
+
+    now = HAL_GetTimeMs();
+    for (i = 0; i < n; i++) {
+        if (worker->pfds[i].revents) {
+            /* force the yield below */
+            worker->devs[worker->pfd_dev[i]].next_yield = now;
+        }
+    }
+
+    for (i = 0; i < worker->dev_num; i++) {
+        FleetDevice *dev = &worker->devs[i];
+
+        if (NULL == dev->mqtt || !(TIME_REACHED(now, dev->next_yield) || IOT_MQTT_ReadPending(dev->mqtt))) {
+            continue;
+        }
+        if (dev->shadow) {
+            IOT_Shadow_Yield(dev->shadow, 1);
+        } else {
+            IOT_MQTT_Yield(dev->mqtt, 1);
+        }
+        dev->next_yield = now + (IOT_MQTT_IsConnected(dev->mqtt) ? FLEET_IDLE_YIELD_MS : FLEET_OFFLINE_YIELD_MS);
+    }
+}
+
+static bool _worker_subscribed(FleetWorker *worker)
+{
+    return worker->stat.sub_ok + worker->stat.sub_fail >= worker->stat.connect_ok * (1 + sg_extra_subs);
+}
+
+static void _worker_thread(void *arg)
+{
+    FleetWorker *worker = (FleetWorker *)arg;
+    uint32_t     pace   = sg_connect_rate ? (uint32_t)(1000 * sg_worker_num / sg_connect_rate) : 0;
+    uint32_t     deadline;
+    int          i;
+
+    for (i = 0; i < worker->dev_num && !sg_stop; i++) {
+        FleetDevice *dev = &worker->devs[i];
+
+        if (_device_connect(dev) != QCLOUD_RET_SUCCESS) {
+            Log_e("device %s setup failed", dev->name);
+        }
+        dev->next_yield = HAL_GetTimeMs();
+        if (pace) {
+            HAL_SleepMs(pace);
+        }
+    }
+
+    /* subscriptions are acked before the workload starts, or the first echoes are lost */
+    deadline = HAL_GetTimeMs() + FLEET_SETUP_TIMEOUT_MS;
+    while (!sg_stop && !_worker_subscribed(worker) && !TIME_REACHED(HAL_GetTimeMs(), deadline)) {
+        _worker_serve(worker, false);
+    }
+    worker->state = WORKER_READY;
+
+    while (!sg_start && !sg_stop) {
+        _worker_serve(worker, false);
+    }
+
+    /* spread the first publish and update of every device evenly over one interval */
+    for (i = 0; i < worker->dev_num; i++) {
+        FleetDevice *dev  = &worker->devs[i];
+        uint64_t     slot = (uint64_t)(dev->index - sg_dev_offset);
+
+        dev->next_pub    = sg_start_ms + (uint32_t)(slot * sg_pub_interval / sg_dev_num);
+        dev->next_shadow = sg_start_ms + (uint32_t)(slot * sg_shadow_period / sg_dev_num);
+    }
+
+    while (!sg_stop) {
+        _worker_serve(worker, true);
+    }
+
+    for (i = 0; i < worker->dev_num; i++) {
+        FleetDevice *     dev = &worker->devs[i];
+        MQTTReconnectStat rs;
+
+        if (NULL == dev->mqtt) {
+            continue;
+        }
+        if (QCLOUD_RET_SUCCESS == IOT_MQTT_Get_Reconnect_Stat(dev->mqtt, &rs)) {
+            worker->reconnect.disconnects += rs.disconnects;
+            worker->reconnect.reconnects += rs.reconnects;
+            worker->reconnect.attempts += rs.attempts;
+            worker->reconnect.failovers += rs.failovers;
+            worker->reconnect.total_ms += rs.total_ms;
+            if (rs.max_ms > worker->reconnect.max_ms) {
+                worker->reconnect.max_ms = rs.max_ms;
+            }
+        }
+        if (dev->shadow) {
+            IOT_Shadow_Destroy(dev->shadow);
+        } else {
+            IOT_MQTT_Destroy(&dev->mqtt);
+        }
+        dev->mqtt = dev->shadow = NULL;
+    }
+
+    worker->state = WORKER_DONE;
+}
+
+static void _sum_stat(FleetStat *sum, bool with_hist)
+{
+    int i;
+
+    memset(sum, 0, sizeof(FleetStat));
+    for (i = 0; i < sg_worker_num; i++) {
+        FleetStat *s = &sg_workers[i].stat;
+
+        sum->connect_ok += s->connect_ok;
+        sum->connect_fail += s->connect_fail;
+        sum->sub_ok += s->sub_ok;
+        sum->sub_fail += s->sub_fail;
+        sum->published += s->published;
+        sum->publish_fail += s->publish_fail;
+        sum->publish_late += s->publish_late;
+        sum->offline_skip += s->offline_skip;
+        sum->acked += s->acked;
+        sum->echoed += s->echoed;
+        sum->shadow_sent += s->shadow_sent;
+        sum->shadow_ok += s->shadow_ok;
+        sum->shadow_fail += s->shadow_fail;
+        sum->disconnect_events += s->disconnect_events;
+        sum->reconnect_events += s->reconnect_events;
+        if (with_hist) {
+            _hist_merge(&sum->connect_ms, &s->connect_ms);
+            _hist_merge(&sum->echo_ms, &s->echo_ms);
+            _hist_merge(&sum->shadow_ms, &s->shadow_ms);
+        }
+    }
+}
+
+static int _connected_num(void)
+{
+    int i, n = 0;
+
+    for (i = 0; i < sg_worker_num; i++) {
+        n += sg_workers[i].connected;
+    }
+    return n;
+}
+
+static bool _workers_in_state(int state)
+{
+    int i;
+
+    for (i = 0; i < sg_worker_num; i++) {
+        if (sg_workers[i].state < state) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool _name_pattern_valid(const char *pattern)
+{
+    const char *p = strchr(pattern, '%');
+
+    /* exactly one conversion, and it is an integer one */
+    if (NULL == p || strchr(p + 1, '%')) {
+        return false;
+    }
+    for (p++; *p >= '0' && *p <= '9'; p++) {
+    }
+    return 'd' == *p;
+}
+
+static int parse_arguments(int argc, char **argv)
+{
+    int c;
+    while ((c = utils_getopt(argc, argv, "c:N:o:n:w:d:p:l:q:s:u:R:r:v:H:b:")) != EOF) switch (c) {
+            case 'c':
+                if (HAL_SetDevInfoFile(utils_optarg))
+                    return -1;
+                break;
+
+            case 'N':
+                sg_dev_num = atoi(utils_optarg);
+                if (sg_dev_num <= 0)
+                    return -1;
+                break;
+
+            case 'o':
+                sg_dev_offset = atoi(utils_optarg);
+                break;
+
+            case 'n':
+                sg_name_pattern = utils_optarg;
+                if (!_name_pattern_valid(sg_name_pattern))
+                    return -1;
+                break;
+
+            case 'w':
+                sg_worker_num = atoi(utils_optarg);
+                if (sg_worker_num <= 0 || sg_worker_num > FLEET_MAX_WORKERS)
+                    return -1;
+                break;
+
+            case 'd':
+                sg_duration_s = atoi(utils_optarg);
+                if (sg_duration_s <= 0)
+                    return -1;
+                break;
+
+            case 'p':
+                if (atoi(utils_optarg) < 0)
+                    return -1;
+                sg_pub_interval = atoi(utils_optarg);
+                break;
+
+            case 'l':
+                sg_payload_len = atoi(utils_optarg);
+                if (sg_payload_len < 32 || sg_payload_len > FLEET_MAX_PAYLOAD_LEN)
+                    return -1;
+                break;
+
+            case 'q':
+                sg_qos = (QoS)atoi(utils_optarg);
+                if (sg_qos != QOS0 && sg_qos != QOS1)
+                    return -1;
+                break;
+
+            case 's':
+                if (atoi(utils_optarg) < 0)
+                    return -1;
+                sg_shadow_period = atoi(utils_optarg);
+                break;
+
+            case 'u':
+                sg_extra_subs = atoi(utils_optarg);
+                if (sg_extra_subs < 0 || sg_extra_subs > FLEET_MAX_EXTRA_SUBS)
+                    return -1;
+                break;
+
+            case 'R':
+                sg_connect_rate = atoi(utils_optarg);
+                if (sg_connect_rate < 0)
+                    return -1;
+                break;
+
+            case 'r':
+                sg_report_s = atoi(utils_optarg);
+                if (sg_report_s <= 0)
+                    return -1;
+                break;
+
+            case 'v':
+                sg_mqtt_version = (uint8_t)atoi(utils_optarg);
+                break;
+
+            case 'H':
+                sg_host = utils_optarg;
+                break;
+
+            case 'b':
+                if (sg_backup_num >= MAX_MQTT_BACKUP_HOSTS)
+                    return -1;
+                sg_backup_hosts[sg_backup_num++] = utils_optarg;
+                break;
+
+            default:
+                HAL_Printf(
+                    "usage: %s [options]\n"
+                    "  [-c <template device info file>] \n"
+                    "  [-N <devices>] [-o <first device index>] [-n <device name pattern, eg. sim%%05d>] \n"
+                    "  [-w <worker threads>] [-d <seconds to run>] [-r <seconds between reports>] \n"
+                    "  [-p <ms between publishes of a device, 0 none>] [-l <payload bytes>] [-q <qos 0|1>] \n"
+                    "  [-s <ms between shadow updates of a device, 0 none>] [-u <extra subscriptions, max %d>] \n"
+                    "  [-R <connects per second, 0 unlimited>] [-v <mqtt version 4|5>] \n"
+                    "  [-H <host>] [-b <backup host>]... \n",
+                    argv[0], FLEET_MAX_EXTRA_SUBS);
+                return -1;
+        }
+    return 0;
+}
+
+static void _print_report(uint32_t elapsed_ms, FleetStat *last)
+{
+    FleetStat now;
+    uint32_t  ms = elapsed_ms ? elapsed_ms : 1;
+
+    _sum_stat(&now, false);
+    HAL_Printf("[%5us] online %d, publish %u/s, echo %u/s, shadow %u/s, disconnects %u, reconnects %u\n",
+               (HAL_GetTimeMs() - sg_start_ms) / 1000, _connected_num(),
+               (uint32_t)((uint64_t)(now.published - last->published) * 1000 / ms),
+               (uint32_t)((uint64_t)(now.echoed - last->echoed) * 1000 / ms),
+               (uint32_t)((uint64_t)(now.shadow_ok - last->shadow_ok) * 1000 / ms),
+               now.disconnect_events - last->disconnect_events, now.reconnect_events - last->reconnect_events);
+    *last = now;
+}
+
+static void _print_summary(uint32_t run_ms, size_t rss_per_dev)
+{
+    static FleetStat  sum;
+    MQTTReconnectStat rs;
+    uint32_t          s = run_ms / 1000 ? run_ms / 1000 : 1;
+    int               i;
+
+    _sum_stat(&sum, true);
+    memset(&rs, 0, sizeof(rs));
+    for (i = 0; i < sg_worker_num; i++) {
+        rs.disconnects += sg_workers[i].reconnect.disconnects;
+        rs.reconnects += sg_workers[i].reconnect.reconnects;
+        rs.attempts += sg_workers[i].reconnect.attempts;
+        rs.failovers += sg_workers[i].reconnect.failovers;
+        rs.total_ms += sg_workers[i].reconnect.total_ms;
+        if (sg_workers[i].reconnect.max_ms > rs.max_ms) {
+            rs.max_ms = sg_workers[i].reconnect.max_ms;
+        }
+    }
+
+    HAL_Printf("\n%d devices on %d workers, %u s of workload\n", sg_dev_num, sg_worker_num, run_ms / 1000);
+    HAL_Printf("connect: %u ok, %u failed; subscribe: %u ok, %u failed\n", sum.connect_ok, sum.connect_fail,
+               sum.sub_ok, sum.sub_fail);
+    _hist_print("connect", &sum.connect_ms);
+    HAL_Printf("publish: %u sent (%u/s), %u failed, %u late, %u acked, %u echoed (%.2f%% lost)\n", sum.published,
+               sum.published / s, sum.publish_fail, sum.publish_late, sum.acked, sum.echoed,
+               sum.published ? 100.0 * (sum.published - (sum.echoed < sum.published ? sum.echoed : sum.published)) /
+                                   sum.published
+                             : 0.0);
+    _hist_print("publish -> echo", &sum.echo_ms);
+    if (sg_shadow_period) {
+        HAL_Printf("shadow: %u updates (%u/s), %u accepted, %u failed\n", sum.shadow_sent, sum.shadow_sent / s,
+                   sum.shadow_ok, sum.shadow_fail);
+        _hist_print("update -> reply", &sum.shadow_ms);
+    }
+    HAL_Printf("skipped while offline: %u\n", sum.offline_skip);
+    HAL_Printf("reconnect: %u disconnects, %u reconnects in %u attempts, %u failovers, avg %u ms, max %u ms\n",
+               rs.disconnects, rs.reconnects, rs.attempts, rs.failovers,
+               rs.reconnects ? (uint32_t)(rs.total_ms / rs.reconnects) : 0, rs.max_ms);
+    HAL_Printf("memory per device: %u bytes resident\n", (unsigned)rss_per_dev);
+}
+
+int main(int argc, char **argv)
+{
+    FleetDevice *devs;
+    FleetStat    last;
+    size_t       rss_before, rss_after;
+    uint32_t     now, next_report, last_report, wake, end;
+    int          rc, i, connected;
+
+    IOT_Log_Set_Level(eLOG_WARN);
+
+    rc = parse_arguments(argc, argv);
+    if (rc != QCLOUD_RET_SUCCESS) {
+        Log_e("parse arguments error, rc = %d", rc);
+        return rc;
+    }
+
+    rc = HAL_GetDevInfo(&sg_template);
+    if (QCLOUD_RET_SUCCESS != rc) {
+        Log_e("get template device info failed: %d", rc);
+        return rc;
+    }
+
+    if (sg_worker_num > sg_dev_num) {
+        sg_worker_num = sg_dev_num;
+    }
+
+    devs = (FleetDevice *)HAL_Malloc(sizeof(FleetDevice) * sg_dev_num);
+    if (NULL == devs) {
+        Log_e("malloc %d devices failed", sg_dev_num);
+        return QCLOUD_ERR_MALLOC;
+    }
+    memset(devs, 0, sizeof(FleetDevice) * sg_dev_num);
+
+    rss_before = _get_rss_bytes();
+
+    for (i = 0; i < sg_worker_num; i++) {
+        FleetWorker *worker   = &sg_workers[i];
+        int          first    = (int)((int64_t)sg_dev_num * i / sg_worker_num);
+        int          last_dev = (int)((int64_t)sg_dev_num * (i + 1) / sg_worker_num);
+        int          j;
+
+        worker->id      = i;
+        worker->devs    = devs + first;
+        worker->dev_num = last_dev - first;
+        worker->pfds    = (struct pollfd *)HAL_Malloc(sizeof(struct pollfd) * worker->dev_num);
+        worker->pfd_dev = (int *)HAL_Malloc(sizeof(int) * worker->dev_num);
+        worker->pub_buf = (char *)HAL_Malloc(sg_payload_len + 1);
+        if (NULL == worker->pfds || NULL == worker->pfd_dev || NULL == worker->pub_buf) {
+            Log_e("malloc worker %d failed", i);
+            return QCLOUD_ERR_MALLOC;
+        }
+        for (j = 0; j < worker->dev_num; j++) {
+            FleetDevice *dev = &worker->devs[j];
+
+            dev->index  = sg_dev_offset + first + j;
+            dev->worker = worker;
+            HAL_Snprintf(dev->name, sizeof(dev->name), sg_name_pattern, dev->index);
+        }
+
+        worker->thread.thread_func = _worker_thread;
+        worker->thread.user_arg    = worker;
+        rc                         = HAL_ThreadCreate(&worker->thread);
+        if (rc) {
+            Log_e("create worker thread fail: %d", rc);
+            return rc;
+        }
+    }
+
+    HAL_Printf("connecting %d devices %s..%d of product %s\n", sg_dev_num, devs[0].name,
+               sg_dev_offset + sg_dev_num - 1, sg_template.product_id);
+    while (!_workers_in_state(WORKER_READY)) {
+        HAL_SleepMs(100);
+    }
+
+    rss_after = _get_rss_bytes();
+    _sum_stat(&last, false);
+    connected = last.connect_ok ? (int)last.connect_ok : 1;
+    HAL_Printf("%u devices connected, %u failed, %u subscriptions acked\n", last.connect_ok, last.connect_fail,
+               last.sub_ok);
+
+    sg_start_ms = HAL_GetTimeMs();
+    sg_start    = true;
+    next_report = sg_start_ms + sg_report_s * 1000;
+    last_report = sg_start_ms;
+    end         = sg_start_ms + sg_duration_s * 1000;
+    now         = sg_start_ms;
+    while (!TIME_REACHED(now, end)) {
+        wake = TIME_REACHED(next_report, end) ? end : next_report;
+        HAL_SleepMs(TIME_REACHED(now, wake) ? 0 : wake - now);
+        now = HAL_GetTimeMs();
+        if (TIME_REACHED(now, next_report)) {
+            _print_report(now - last_report, &last);
+            last_report = now;
+            /* woken late, skip the reports that are due already */
+            while (TIME_REACHED(now, next_report)) {
+                next_report += sg_report_s * 1000;
+            }
+        }
+    }
+    sg_stop = true;
+
+    while (!_workers_in_state(WORKER_DONE)) {
+        HAL_SleepMs(100);
+    }
+
+    _print_summary(now - sg_start_ms, rss_after > rss_before ? (rss_after - rss_before) / connected : 0);
+
+    for (i = 0; i < sg_worker_num; i++) {
+        HAL_Free(sg_workers[i].pfds);
+        HAL_Free(sg_workers[i].pfd_dev);
+        HAL_Free(sg_workers[i].pub_buf);
+    }
+    HAL_Free(devs);
+
+    return QCLOUD_RET_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lite-utils.h"
+#include "qcloud_iot_export.h"
+#include "qcloud_iot_import.h"
+#include "utils_getopt.h"
+
+#define VALUE_NUM (256)
+
+static uint32_t sg_duration_ms = 500;
+
+static int32_t sg_ints[VALUE_NUM];
+static double  sg_doubles[VALUE_NUM];
+static char    sg_int_strs[VALUE_NUM][LITE_NUMBER_STR_MAX_LEN];
+static char    sg_double_strs[VALUE_NUM][LITE_NUMBER_STR_MAX_LEN];
+
+/* keeps the compiler from dropping the work */
+static volatile uint32_t sg_sink;
+
+typedef void (*BenchFunc)(int index);
+
+static int parse_arguments(int argc, char **argv)
+{
+    int c;
+    while ((c = utils_getopt(argc, argv, "t:")) != EOF) switch (c) {
+            case 't':
+                sg_duration_ms = atoi(utils_optarg);
+                if (sg_duration_ms == 0)
+                    return -1;
+                break;
+
+            default:
+                HAL_Printf(
+                    "usage: %s [options]\n"
+                    "  [-t <ms per routine>] \n",
+                    argv[0]);
+                return -1;
+        }
+    return 0;
+}
+
+/* what a device reports: counters, sensor readings with a few decimals, the odd large value */
+static void _gen_values(void)
+{
+    int i;
+
+    srand(1);
+    for (i = 0; i < VALUE_NUM; i++) {
+        sg_ints[i]    = (i % 4) ? rand() % 10000 : rand() - RAND_MAX / 2;
+        sg_doubles[i] = (i % 4) ? (rand() % 100000) / 100.0 : (double)rand() / rand() * 1e6;
+        HAL_Snprintf(sg_int_strs[i], LITE_NUMBER_STR_MAX_LEN, "%d", sg_ints[i]);
+        LITE_double_to_str(sg_doubles[i], sg_double_strs[i], LITE_NUMBER_STR_MAX_LEN);
+    }
+}
+
+static void _sscanf_int(int i)
+{
+    int32_t v;
+    sscanf(sg_int_strs[i], "%d", &v);
+    sg_sink += v;
+}
+
+static void _lite_int(int i)
+{
+    int32_t v;
+    LITE_get_int32(&v, sg_int_strs[i]);
+    sg_sink += v;
+}
+
+static void _sscanf_double(int i)
+{
+    double v;
+    sscanf(sg_double_strs[i], "%lf", &v);
+    sg_sink += (uint32_t)v;
+}
+
+static void _lite_double(int i)
+{
+    double v;
+    LITE_get_double(&v, sg_double_strs[i]);
+    sg_sink += (uint32_t)v;
+}
+
+static void _snprintf_int(int i)
+{
+    char buf[LITE_NUMBER_STR_MAX_LEN];
+    sg_sink += HAL_Snprintf(buf, sizeof(buf), "%d", sg_ints[i]);
+}
+
+static void _lite_int_str(int i)
+{
+    char buf[LITE_NUMBER_STR_MAX_LEN];
+    sg_sink += LITE_int64_to_str(sg_ints[i], buf, sizeof(buf));
+}
+
+/* %.17g is what it takes for snprintf to read back the same double */
+static void _snprintf_double(int i)
+{
+    char buf[LITE_NUMBER_STR_MAX_LEN];
+    sg_sink += HAL_Snprintf(buf, sizeof(buf), "%.17g", sg_doubles[i]);
+}
+
+static void _lite_double_str(int i)
+{
+    char buf[LITE_NUMBER_STR_MAX_LEN];
+    sg_sink += LITE_double_to_str(sg_doubles[i], buf, sizeof(buf));
+}
+
+/* calls per second */
+static uint32_t _run(BenchFunc func)
+{
+    uint32_t calls = 0;
+    uint32_t start = HAL_GetTimeMs();
+    uint32_t elapsed;
+    int      i;
+
+    do {
+        for (i = 0; i < VALUE_NUM; i++) {
+            func(i);
+        }
+        calls += VALUE_NUM;
+        elapsed = HAL_GetTimeMs() - start;
+    } while (elapsed < sg_duration_ms);
+
+    return (uint32_t)((uint64_t)calls * 1000 / elapsed);
+}
+
+int main(int argc, char **argv)
+{
+    int rc, i;
+
+    static const struct {
+        const char *name;
+        BenchFunc   stdio;
+        BenchFunc   lite;
+    } benches[] = {
+        {"parse int32", _sscanf_int, _lite_int},
+        {"parse double", _sscanf_double, _lite_double},
+        {"format int32", _snprintf_int, _lite_int_str},
+        {"format double", _snprintf_double, _lite_double_str},
+    };
+
+    IOT_Log_Set_Level(eLOG_INFO);
+
+    rc = parse_arguments(argc, argv);
+    if (rc != QCLOUD_RET_SUCCESS) {
+        Log_e("parse arguments error, rc = %d", rc);
+        return rc;
+    }
+
+    _gen_values();
+
+    HAL_Printf("%-16s %14s %14s %8s\n", "routine", "stdio calls/s", "LITE calls/s", "speedup");
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        uint32_t stdio_rate = _run(benches[i].stdio);
+        uint32_t lite_rate  = _run(benches[i].lite);
+
+        HAL_Printf("%-16s %14u %14u %7.2fx\n", benches[i].name, stdio_rate, lite_rate,
+                   stdio_rate ? (double)lite_rate / stdio_rate : 0.0);
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
@@ -87,6 +87,9 @@ static void _mqtt_event_handler(void *pclient, void *handle_context, MQTTEventMs
     }
 }
 
+static uint8_t sg_mqtt_version = 4;
+static char *  sg_host         = NULL;
+
 // Setup MQTT construct parameters
 static int _setup_connect_init_params(MQTTInitParams *initParams, DeviceInfo *device_info)
 {
@@ -123,6 +126,8 @@ static int _setup_connect_init_params(MQTTInitParams *initParams, DeviceInfo *de
     initParams->keep_alive_interval_ms = QCLOUD_IOT_MQTT_KEEP_ALIVE_INTERNAL;
 
     initParams->auto_connect_enable  = 1;
+    initParams->mqtt_version         = sg_mqtt_version;
+    initParams->host                 = sg_host;
     initParams->event_handle.h_fp    = _mqtt_event_handler;
     initParams->event_handle.context = NULL;
 
@@ -247,7 +252,7 @@ static bool sg_loop_test = false;
 static int  parse_arguments(int argc, char **argv)
 {
     int c;
-    while ((c = utils_getopt(argc, argv, "c:l")) != EOF) switch (c) {
+    while ((c = utils_getopt(argc, argv, "c:lv:H:")) != EOF) switch (c) {
             case 'c':
                 if (HAL_SetDevInfoFile(utils_optarg))
                     return -1;
@@ -257,11 +262,21 @@ static int  parse_arguments(int argc, char **argv)
                 sg_loop_test = true;
                 break;
 
+            case 'v':
+                sg_mqtt_version = atoi(utils_optarg);
+                break;
+
+            case 'H':
+                sg_host = utils_optarg;
+                break;
+
             default:
                 HAL_Printf(
                     "usage: %s [options]\n"
                     "  [-c <config file for DeviceInfo>] \n"
-                    "  [-l ] loop test or not\n",
+                    "  [-l ] loop test or not\n"
+                    "  [-v <4|5>] MQTT protocol version, 5 needs FEATURE_MQTT5_ENABLED\n"
+                    "  [-H <host>] server to connect to instead of the default one\n",
                     argv[0]);
                 return -1;
         }
@@ -323,12 +338,12 @@ int main(int argc, char **argv)
         Log_e("get system time failed!");
     }
 
-    // Sync time by NTP timestamp from server
-    rc = IOT_Sync_NTPTime(client);
+    // Sync the SDK clock with server, IOT_Get_Clock_Ms() is then served locally
+    rc = IOT_Sync_Clock(client, DEFAULT_CLOCK_SYNC_SAMPLES);
     if (QCLOUD_RET_SUCCESS == rc) {
-        Log_i("sync ntp time success!");
+        Log_i("sync clock success, cloud time %llu ms", (unsigned long long)IOT_Get_Clock_Ms());
     } else {
-        Log_e("sync ntp time failed!");
+        Log_e("sync clock failed!");
     }
 #endif
 
@@ -468,6 +468,16 @@ int main(int argc, char **argv)
         return QCLOUD_ERR_FAILURE;
     }
 
+    // Run message callbacks on worker threads so they never hold up the loop thread
+    MQTTDispatchParams dispatch_params = DEFAULT_MQTT_DISPATCH_PARAMS;
+    dispatch_params.policy             = eMQTT_DISPATCH_BLOCK;
+    rc                                 = IOT_MQTT_Dispatch_Start(client, &dispatch_params);
+    if (rc) {
+        Log_e("MQTT dispatch start failed: %d", rc);
+        rc = IOT_MQTT_Destroy(&client);
+        return rc;
+    }
+
     // Start the default loop thread to read and handle MQTT packet
     rc = IOT_MQTT_StartLoop(client);
     if (rc) {
@@ -484,6 +494,12 @@ int main(int argc, char **argv)
         Log_i("MQTT multi-thread test SUCCESS");
     }
 
+    MQTTDispatchStat dispatch_stat;
+    if (IOT_MQTT_Dispatch_Get_Stat(client, &dispatch_stat) == QCLOUD_RET_SUCCESS) {
+        Log_i("dispatch enqueued: %u delivered: %u dropped: %u blocked: %u peak depth: %u", dispatch_stat.enqueued,
+              dispatch_stat.delivered, dispatch_stat.dropped, dispatch_stat.blocked, dispatch_stat.peak_depth);
+    }
+
     // Finish and destroy
     IOT_MQTT_StopLoop(client);
     rc = IOT_MQTT_Destroy(&client);
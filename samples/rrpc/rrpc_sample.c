@@ -129,8 +129,9 @@ static int _setup_connect_init_params(MQTTInitParams *initParams, DeviceInfo *de
     return QCLOUD_RET_SUCCESS;
 }
 
-// User callback
-static void _rrpc_message_handler(void *pClient, const char *msg, uint32_t msgLen)
+// User callback, ctx identifies the request and may be copied to reply later or from another thread
+static void _rrpc_message_handler(void *pClient, const sRRPCContext *ctx, const char *msg, uint32_t msgLen,
+                                  void *userContext)
 {
     char   sg_rrpc_reply_buffer[128] = {0};
     size_t sg_rrpc_reply_buffersize  = sizeof(sg_rrpc_reply_buffer) / sizeof(sg_rrpc_reply_buffer[0]);
@@ -141,7 +142,7 @@ static void _rrpc_message_handler(void *pClient, const char *msg, uint32_t msgLe
     sg_rrpc_reply_buffer[0] = 'o';
     sg_rrpc_reply_buffer[1] = 'k';
 
-    IOT_RRPC_Reply(pClient, sg_rrpc_reply_buffer, sg_rrpc_reply_buffersize, NULL);
+    IOT_RRPC_Reply_Request(pClient, ctx, sg_rrpc_reply_buffer, sg_rrpc_reply_buffersize, NULL);
 }
 
 static int sg_loop_count = 5;
@@ -212,7 +213,12 @@ int main(int argc, char **argv)
     }
 
     // subscribe rrpc topics
-    rc = IOT_RRPC_Init(client, _rrpc_message_handler);
+    RRPCInitParams rrpc_params = DEFAULT_RRPC_INIT_PARAMS;
+    rrpc_params.callback       = _rrpc_message_handler;
+#ifdef MULTITHREAD_ENABLED
+    rrpc_params.worker_num = 2;
+#endif
+    rc = IOT_RRPC_Init_Dispatcher(client, &rrpc_params);
     if (rc != QCLOUD_RET_SUCCESS) {
         return rc;
     }
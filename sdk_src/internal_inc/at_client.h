@@ -93,6 +93,7 @@ typedef struct _at_client_ {
 
     const at_urc *urc_table;
     uint16_t      urc_table_size;
+    uint8_t       urc_end_map[32];  // bitmap of chars a URC can end with, to skip useless table scans
 
 #ifdef AT_OS_USED
     void *     resp_sem;  // resp received, send sem to notic ack wait
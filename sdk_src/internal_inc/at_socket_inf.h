@@ -19,25 +19,34 @@
 #include <stdint.h>
 #include <stdio.h>
 
-#include "utils_list.h"
-
 #define UNUSED_SOCKET             (-1)
 #define MAX_AT_SOCKET_NUM         (5)
 #define AT_SOCKET_SEND_TIMEOUT_MS (1000)
 #define AT_SOCKET_RECV_TIMEOUT_MS (1000)
 #define IPV4_STR_MAX_LEN          (16)
 
+/* downlink data is landed in fixed blocks from a static pool, no malloc per packet */
+#ifndef AT_RECV_BLOCK_SIZE
+#define AT_RECV_BLOCK_SIZE (256)
+#endif
+#ifndef AT_RECV_BLOCK_NUM
+#define AT_RECV_BLOCK_NUM (16)
+#endif
+
 typedef enum { eNET_TCP = 6, eNET_UDP = 17, eNET_DEFAULT = 0xff } eNetProto;
 
 typedef enum { eSOCKET_ALLOCED = 0, eSOCKET_CONNECTED, eSOCKET_CLOSED } eSocketState;
 
-/* AT receive package list structure */
-typedef struct at_recv_pkt {
-    List   list;
-    size_t bfsz_totle;
-    size_t bfsz_index;
-    char * buff;
-} at_recv_pkt;
+/* AT receive block, socket data is queued as a chain of blocks */
+typedef struct at_recv_block {
+    struct at_recv_block *next;
+    uint16_t              len;     // valid data length
+    uint16_t              offset;  // read offset
+    char                  data[AT_RECV_BLOCK_SIZE];
+} at_recv_block;
+
+/* read data from AT server, such as at_client_obj_recv */
+typedef int (*at_recv_read_fn)(char *buf, int size, int timeout);
 
 typedef enum {
     AT_SOCKET_EVT_RECV = 0,
@@ -63,7 +72,9 @@ typedef struct {
 /*at socket context*/
 typedef struct {
     int             fd; /** socket fd */
-    List *          recvpkt_list;
+    at_recv_block * recv_head;
+    at_recv_block * recv_tail;
+    size_t          recv_len;
     char            remote_ip[IPV4_STR_MAX_LEN];
     uint16_t        remote_port;
     uint32_t        send_timeout_ms;
@@ -84,4 +95,7 @@ int at_socket_connect(const char *host, uint16_t port, eNetProto eProto);
 int at_socket_close(int fd);
 int at_socket_send(int fd, const void *buf, size_t len);
 int at_socket_recv(int fd, void *buf, size_t len);
+
+// at device driver api, called in URC context
+int at_socket_recv_data(int dev_fd, size_t bfsz, at_recv_read_fn read_fn, uint32_t timeout);
 #endif
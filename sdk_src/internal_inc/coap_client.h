@@ -63,6 +63,11 @@ extern "C" {
 /* Max size of token */
 #define COAP_MSG_MAX_TOKEN_LEN (8)
 
+/* Max options in one msg, option nodes live in the msg itself */
+#ifndef COAP_MSG_MAX_OPTION_NUM
+#define COAP_MSG_MAX_OPTION_NUM (8)
+#endif
+
 /* COAP Max code class */
 #define COAP_MSG_MAX_CODE_CLASS (7)
 
@@ -183,7 +188,7 @@ typedef struct Client {
 
     uint32_t command_timeout_ms;  // CoAP command timeout, unit:ms
 
-    List *message_list;  // msg list
+    List message_list;  // list of CoAPMsgSendInfo waiting for ack or response
 
     unsigned char max_retry_count;  // Max retry count
 
@@ -208,7 +213,7 @@ typedef struct Client {
 typedef struct coap_msg_op {
     unsigned short      option_num;  // Option number
     unsigned            val_len;     // Option length
-    char *              val;         // Pointer to a buffer containing the option value
+    const char *        val;         // Option value, points to caller data or into the recv buffer, not owned
     struct coap_msg_op *next;        // Pointer to the next option structure in the list
 } CoAPMsgOption;
 
@@ -229,6 +234,7 @@ typedef enum {
 } CoAPNodeState;
 
 typedef struct {
+    list_head_t    list;  // link in message_list
     CoAPNodeState  node_state;
     void *         user_context;
     unsigned short msg_id;
@@ -264,7 +270,7 @@ typedef struct {
 
     unsigned short msg_id;  // msg id
 
-    char * pay_load;      // msg payload
+    char * pay_load;      // msg payload, points to caller data or into the recv buffer, not owned
     size_t pay_load_len;  // length of payload
 
     char     token[COAP_MSG_MAX_TOKEN_LEN];  // msg token
@@ -274,6 +280,9 @@ typedef struct {
 
     OnRespCallback handler;       // CoAP Response msg callback
     void *         user_context;  // user context
+
+    CoAPMsgOption op_pool[COAP_MSG_MAX_OPTION_NUM];  // storage of op_list nodes
+    unsigned      op_count;                          // used nodes of op_pool
 } CoAPMessage;
 
 #define DEFAULT_COAP_MESSAGE                                                                         \
@@ -346,7 +355,7 @@ int coap_message_id_set(CoAPMessage *message, unsigned msg_id);
 int coap_message_token_set(CoAPMessage *message, char *buf, size_t len);
 
 /**
- * @brief set msg payload
+ * @brief set msg payload, buf is referenced and must stay valid until the msg is sent
  *
  * @param message CoAP msg
  * @param buf msg payload buffer
@@ -356,7 +365,7 @@ int coap_message_token_set(CoAPMessage *message, char *buf, size_t len);
 int coap_message_payload_set(CoAPMessage *message, char *buf, size_t len);
 
 /**
- * @brief add msg option
+ * @brief add msg option, val is referenced and must stay valid until the msg is sent
  *
  * @param message CoAP msg
  * @param num option number
@@ -385,17 +394,18 @@ int coap_message_callback_set(CoAPMessage *message, OnRespCallback callback);
 int coap_message_context_set(CoAPMessage *message, void *userContext);
 
 /**
- * @brief create CoAPMsgOption from option number/len/val
+ * @brief take a CoAPMsgOption from the msg option pool
  *
+ * @param message CoAP msg
  * @param num CoAP option number
  * @param len CoAP option string len
- * @param val CoAP option string value
- * @return QCLOUD_RET_SUCCESS for success, or err code for failure
+ * @param val CoAP option string value, referenced not copied
+ * @return option node, NULL if the pool is used up
  */
-CoAPMsgOption *qcloud_iot_coap_option_init(unsigned num, unsigned len, const char *val);
+CoAPMsgOption *qcloud_iot_coap_option_init(CoAPMessage *message, unsigned num, unsigned len, const char *val);
 
 /**
- *  @brief destroy CoAPMessage
+ *  @brief reset CoAPMessage, nothing is allocated so nothing is freed
  *
  *  @param[in,out] message
  */
@@ -437,7 +447,7 @@ ssize_t coap_message_recv(CoAPClient *client, uint32_t timeout_ms);
 int coap_client_auth(CoAPClient *client);
 
 /**
- *  @brief Parse a message
+ *  @brief Parse a message, token is copied while options and payload point into buf
  *
  *  @param[in,out] message Pointer to a message structure
  *  @param[in] buf Pointer to a buffer containing the message
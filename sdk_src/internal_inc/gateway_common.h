@@ -16,11 +16,12 @@
 #ifndef IOT_GATEWAY_COMMON_H_
 #define IOT_GATEWAY_COMMON_H_
 
+#include "mqtt_client.h"
 #include "qcloud_iot_export.h"
 
 #define GATEWAY_PAYLOAD_BUFFER_LEN        1024
 #define GATEWAY_RECEIVE_BUFFER_LEN        1024
-#define GATEWAY_LOOP_MAX_COUNT            100
+#define GATEWAY_WAIT_TIMEOUT_MS           (20 * 1000)
 #define SUBDEV_BIND_SIGN_LEN              64
 #define BIND_SIGN_KEY_SIZE                MAX_SIZE_OF_DEVICE_SECRET
 #define GATEWAY_ONLINE_OP_STR             "online"
@@ -29,6 +30,12 @@
 #define GATEWAY_UNBIND_OP_STR             "unbind"
 #define GATEWAY_DESCRIBE_SUBDEVIES_OP_STR "describe_sub_devices"
 
+/* Number of hash buckets of the virtual client topic routes */
+#define GATEWAY_ROUTE_BUCKETS 256
+
+/* Max number of virtual client SUBSCRIBEs waiting for SUBACK, the MQTT ack list holds MAX_MESSAGE_HANDLERS */
+#define GATEWAY_ROUTE_INFLIGHT 4
+
 /* The format of operation of gateway topic */
 #define GATEWAY_TOPIC_OPERATION_FMT "$gateway/operation/%s/%s"
 
@@ -80,14 +87,54 @@ typedef struct _ReplyData {
 
 /* The structure of gateway data */
 typedef struct _GatewayData {
-    int32_t   sync_status;
-    ReplyData online;
-    ReplyData offline;
-    ReplyData bind;
-    ReplyData unbind;
-    ReplyData get_bindlist;
+    int32_t             sync_status;
+    ReplyData           online;
+    ReplyData           offline;
+    ReplyData           bind;
+    ReplyData           unbind;
+    ReplyData           get_bindlist;
+    QcloudIotCompletion sync_done;  // signaled on sub/unsub ack and on a reply to the pending operation
 } GatewayData;
 
+/* Subscription state of a virtual client topic route */
+typedef enum _VirtualRouteState {
+    /* Waiting for a free SUBSCRIBE slot */
+    VIRTUAL_ROUTE_PENDING,
+
+    /* SUBSCRIBE sent, waiting for SUBACK */
+    VIRTUAL_ROUTE_INFLIGHT,
+
+    /* Subscribed */
+    VIRTUAL_ROUTE_READY,
+
+    /* Rejected by the server */
+    VIRTUAL_ROUTE_FAILED
+} VirtualRouteState;
+
+/* The structure of virtual client, a sub-device using the MQTT connection of the gateway */
+typedef struct _VirtualClient {
+    struct _Gateway *gateway;  // NULL once the gateway is destroyed before this client
+    char             product_id[MAX_SIZE_OF_PRODUCT_ID + 1];
+    char             device_name[MAX_SIZE_OF_DEVICE_NAME + 1];
+    List             routes;        // topic routes of this client
+    list_head_t      gateway_link;  // in vclients of the gateway
+} VirtualClient;
+
+/* The structure of topic route, one subscription of a virtual client */
+typedef struct _VirtualRoute {
+    char *                topic_filter;  // stored right behind the route
+    VirtualClient *       owner;
+    OnMessageHandler      message_handler;
+    OnSubEventHandler     sub_event_handler;
+    void *                user_data;
+    QoS                   qos;
+    VirtualRouteState     state;
+    uint32_t              sub_id;        // tells the SUBACK of this route from a stale one
+    list_head_t           owner_link;    // in routes of the owner
+    list_head_t           pending_link;  // in route_pending of the gateway while PENDING
+    struct _VirtualRoute *next;          // next in the hash bucket or in the wildcard list
+} VirtualRoute;
+
 /* The structure of gateway context */
 typedef struct _Gateway {
     void *           mqtt;
@@ -97,6 +144,13 @@ typedef struct _Gateway {
     MQTTEventHandler event_handle;
     int              is_construct;
     char             recv_buf[GATEWAY_RECEIVE_BUFFER_LEN];
+    void *           route_lock;
+    VirtualRoute **  route_table;      // routes without wildcard by topic hash, allocated with the first route
+    VirtualRoute *   route_wildcards;  // routes with '+' or '#'
+    List             route_pending;    // routes to subscribe, in order
+    VirtualRoute *   route_inflight[GATEWAY_ROUTE_INFLIGHT];
+    uint32_t         route_next_id;
+    List             vclients;  // live virtual clients, detached by gateway_route_release
 } Gateway;
 
 SubdevSession *subdev_add_session(Gateway *gateway, char *product_id, char *device_name);
@@ -114,4 +168,14 @@ int gateway_publish_sync(Gateway *gateway, char *topic, PublishParams *params, i
 
 int subdev_bind_hmac_sha1_cal(DeviceInfo *pDevInfo, char *signout, int max_signlen, int nonce, long timestamp);
 
+int gateway_route_init(Gateway *gateway);
+
+void gateway_route_release(Gateway *gateway);
+
+void gateway_route_pump(Gateway *gateway);
+
+void gateway_route_reset(Gateway *gateway);
+
+bool gateway_route_message(Gateway *gateway, MQTTMessage *message);
+
 #endif /* IOT_GATEWAY_COMMON_H_ */
@@ -47,6 +47,9 @@ extern "C" {
 /* Minimal wait interval when reconnect */
 #define MIN_RECONNECT_WAIT_INTERVAL (1000)
 
+/* Give up reconnecting when the connection has been lost for this long (unit: ms) */
+#define MAX_RECONNECT_DOWN_TIME (2 * MAX_RECONNECT_WAIT_INTERVAL)
+
 /* Minimal MQTT timeout value */
 #define MIN_COMMAND_TIMEOUT (500)
 
@@ -54,7 +57,7 @@ extern "C" {
 #define MAX_COMMAND_TIMEOUT (20000)
 
 /* Max size of a topic name */
-#define MAX_SIZE_OF_CLOUD_TOPIC ((MAX_SIZE_OF_DEVICE_NAME) + (MAX_SIZE_OF_PRODUCT_ID) + 64 + 6)
+#define MAX_SIZE_OF_CLOUD_TOPIC MAX_SIZE_OF_MQTT_TOPIC
 
 /* minimal TLS handshaking timeout value (unit: ms) */
 #define QCLOUD_IOT_TLS_HANDSHAKE_TIMEOUT (5 * 1000)
@@ -130,7 +133,7 @@ typedef struct {
 
     char    struct_id[4];    // The eyecatcher for this structure.  must be MQTC.
     uint8_t struct_version;  // struct version = 0
-    uint8_t mqtt_version;    // MQTT protocol version: 4 = 3.1.1
+    uint8_t mqtt_version;    // MQTT protocol version: 4 = 3.1.1, 5 = 5.0
 
     uint16_t keep_alive_interval;  // keep alive interval, unit: second
     uint8_t  clean_session;        // flag of clean session, refer to MQTT spec 3.1.2.4
@@ -168,30 +171,72 @@ typedef struct SubTopicHandle {
     OnSubEventHandler sub_event_handler;  // callback when event of this subscription happens
     void *            handler_user_data;  // user context for callback
     QoS               qos;                // QoS
+    bool              routed;             // kept out of sub_handles, messages go to the event handler
 } SubTopicHandle;
 
+/**
+ * @brief completion of a sync request, signaled from MQTT callbacks once the reply is stored
+ *
+ * Sync APIs reset it before sending the request and block in qcloud_iot_mqtt_wait_completion until the reply
+ * arrives or the deadline passes, instead of polling a flag in fixed yield slices. It has to live as long as
+ * the callbacks that signal it, so it is kept in the client or service state, never on the stack.
+ */
+typedef struct {
+    volatile bool done;  // set by signal, cleared by reset
+#ifdef MULTITHREAD_ENABLED
+    void *sem;  // posted by signal, waited on while the yield thread reads the network
+#endif
+} QcloudIotCompletion;
+
 /**
  * @brief data structure for system time service
  */
 typedef struct _sys_mqtt_state {
-    bool   topic_sub_ok;
-    bool   result_recv_ok;
-    long   time;
-    size_t ntptime1;
-    size_t ntptime2;
+    bool                topic_sub_ok;
+    bool                result_recv_ok;
+    QcloudIotCompletion sync_done;  // signaled on sub ack and time reply
+    long                time;
+    uint64_t            ntptime1;       // cloud time in ms when the request was received
+    uint64_t            ntptime2;       // cloud time in ms when the reply was sent
+    uint32_t            recv_local_ms;  // HAL_GetTimeMs() when the reply was received
 } SysMQTTState;
 
 /**
  * @brief data structure for config service
  */
 typedef struct _config_mqtt_state {
-    bool topic_sub_ok;
-    bool get_reply_ok;
+    bool                topic_sub_ok;
+    bool                get_reply_ok;
+    QcloudIotCompletion sync_done;  // signaled along with get_reply_ok
+    void *              cache;      // config cache bound by IOT_Config_Cache_Bind
 } ConfigMQTTState;
 
 /**
  * @brief MQTT QCloud IoT Client structure
  */
+#ifdef MQTT5_ENABLED
+/* Max number of topic alias the client assigns for outbound PUBLISH */
+#ifndef MQTT5_TOPIC_ALIAS_NUM
+#define MQTT5_TOPIC_ALIAS_NUM (8)
+#endif
+
+typedef struct {
+    uint32_t last_used;                           // LRU stamp, 0 means the alias is not mapped on server
+    uint16_t len;                                 // length of topic
+    char     topic[MAX_SIZE_OF_CLOUD_TOPIC + 1];  // topic name the alias stands for
+} MQTT5TopicAlias;
+
+/* limits announced by server in CONNACK, valid for one connection */
+typedef struct {
+    uint16_t        receive_max;  // Receive Maximum: QoS1 publish waiting for PUBACK at most
+    uint16_t        alias_max;    // Topic Alias Maximum, 0 = topic alias not accepted
+    uint32_t        packet_max;   // Maximum Packet Size, 0 = no limit
+    uint8_t         qos_max;      // Maximum QoS
+    uint32_t        alias_clock;  // LRU clock of alias slots
+    MQTT5TopicAlias alias[MQTT5_TOPIC_ALIAS_NUM];
+} MQTT5SessionState;
+#endif
+
 typedef struct Client {
     uint8_t is_connected;
     uint8_t was_manually_disconnected;
@@ -200,9 +245,13 @@ typedef struct Client {
     uint16_t next_packet_id;      // MQTT random packet id
     uint32_t command_timeout_ms;  // MQTT command timeout, unit:ms
 
-    uint32_t current_reconnect_wait_interval;  // unit:ms
+    uint32_t current_reconnect_wait_interval;  // unit:ms, ceiling of the random reconnect delay
     uint32_t counter_network_disconnected;     // number of disconnection
 
+    uint32_t          reconnect_rand;      // xorshift state of the reconnect delay
+    uint32_t          disconnect_time_ms;  // when the connection was lost
+    MQTTReconnectStat reconnect_stat;      // counters of reconnection
+
     size_t        write_buf_size;                         // size of MQTT write buffer
     size_t        read_buf_size;                          // size of MQTT read buffer
     unsigned char write_buf[QCLOUD_IOT_MQTT_TX_BUF_LEN];  // MQTT write buffer
@@ -214,8 +263,8 @@ typedef struct Client {
     void *lock_list_pub;  // mutex/lock for puback waiting list
     void *lock_list_sub;  // mutex/lock for suback waiting list
 
-    List *list_pub_wait_ack;  // puback waiting list
-    List *list_sub_wait_ack;  // suback waiting list
+    List list_pub_wait_ack;  // puback waiting list of QcloudIotPubInfo
+    List list_sub_wait_ack;  // suback waiting list of QcloudIotSubInfo
 
     MQTTEventHandler event_handle;  // callback for MQTT event
 
@@ -230,7 +279,10 @@ typedef struct Client {
 
     DeviceInfo device_info;
 
-    char host_addr[HOST_STR_LENGTH];
+    char    host_addr[HOST_STR_LENGTH];
+    char    backup_hosts[MAX_MQTT_BACKUP_HOSTS][HOST_STR_LENGTH];  // tried in turn when reconnecting fails
+    uint8_t backup_host_num;
+    uint8_t host_index;  // server in use, 0 for host_addr, i for backup_hosts[i - 1]
 
 #ifdef AUTH_MODE_CERT
     char cert_file_path[FILE_PATH_MAX_LEN];  // full path of device cert file
@@ -254,16 +306,24 @@ typedef struct Client {
 #endif
 
 #ifdef BROADCAST_ENABLED
-    bool broadcast_state;  // using in broadcast
+    bool                broadcast_state;     // using in broadcast
+    QcloudIotCompletion broadcast_sub_done;  // signaled on broadcast topic sub ack
 #endif
 
 #ifdef RRPC_ENABLED
-    bool rrpc_state;
+    bool                rrpc_state;
+    QcloudIotCompletion rrpc_sub_done;  // signaled on rrpc topic sub ack
+    void *              rrpc_dispatcher;
 #endif
 
 #ifdef MULTITHREAD_ENABLED
-    bool thread_running;
-    int  thread_exit_code;
+    bool  thread_running;
+    int   thread_exit_code;
+    void *dispatcher;  // message callback workers, set by IOT_MQTT_Dispatch_Start
+#endif
+
+#ifdef MQTT5_ENABLED
+    MQTT5SessionState v5_state;  // server limits and topic alias of MQTT 5 connection
 #endif
 
 } Qcloud_IoT_Client;
@@ -271,7 +331,7 @@ typedef struct Client {
 /**
  * @brief MQTT protocol version
  */
-typedef enum { MQTT_3_1_1 = 4 } MQTT_VERSION;
+typedef enum { MQTT_3_1_1 = 4, MQTT_5_0 = 5 } MQTT_VERSION;
 
 typedef enum MQTT_NODE_STATE {
     MQTT_NODE_STATE_NORMANL = 0,
@@ -280,6 +340,7 @@ typedef enum MQTT_NODE_STATE {
 
 /* topic publish info */
 typedef struct REPUBLISH_INFO {
+    list_head_t    list;           /* link in puback waiting list */
     Timer          pub_start_time; /* timer for puback waiting */
     MQTTNodeState  node_state;     /* node state in wait list */
     uint16_t       msg_id;         /* packet id */
@@ -289,6 +350,7 @@ typedef struct REPUBLISH_INFO {
 
 /* topic subscribe/unsubscribe info */
 typedef struct SUBSCRIBE_INFO {
+    list_head_t    list;           /* link in suback waiting list */
     enum msgTypes  type;           /* type: sub or unsub */
     uint16_t       msg_id;         /* packet id */
     Timer          sub_start_time; /* timer for suback waiting */
@@ -356,6 +418,27 @@ int qcloud_iot_mqtt_disconnect(Qcloud_IoT_Client *pClient);
  */
 int qcloud_iot_mqtt_publish(Qcloud_IoT_Client *pClient, char *topicName, PublishParams *pParams);
 
+/**
+ * @brief Publish MQTT message to a pre-encoded topic
+ *
+ * @param pClient       handle to MQTT client
+ * @param pTopic        topic handle filled by qcloud_iot_mqtt_topic_init
+ * @param pParams       publish parameters
+ *
+ * @return packet id (>=0) when success, or err code (<0) for failure
+ */
+int qcloud_iot_mqtt_publish_topic(Qcloud_IoT_Client *pClient, const MQTTTopicHandle *pTopic, PublishParams *pParams);
+
+/**
+ * @brief Check a publish topic and encode it in MQTT wire form
+ *
+ * @param pTopic        topic handle to fill
+ * @param topicName     MQTT topic name
+ *
+ * @return QCLOUD_RET_SUCCESS for success, or err code for failure
+ */
+int qcloud_iot_mqtt_topic_init(MQTTTopicHandle *pTopic, const char *topicName);
+
 /**
  * @brief Subscribe MQTT topic
  *
@@ -367,6 +450,19 @@ int qcloud_iot_mqtt_publish(Qcloud_IoT_Client *pClient, char *topicName, Publish
  */
 int qcloud_iot_mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, SubscribeParams *pParams);
 
+/**
+ * @brief Subscribe MQTT topic for a caller that routes the messages itself. The subscription takes no
+ * sub_handles slot and is not re-subscribed on reconnect, its messages reach the event handler as
+ * MQTT_EVENT_PUBLISH_RECVEIVED. on_message_handler of pParams is ignored.
+ *
+ * @param pClient       handle to MQTT client
+ * @param topicFilter   MQTT topic filter
+ * @param pParams       subscribe parameters
+ *
+ * @return packet id (>=0) when success, or err code (<0) for failure
+ */
+int qcloud_iot_mqtt_subscribe_routed(Qcloud_IoT_Client *pClient, char *topicFilter, SubscribeParams *pParams);
+
 /**
  * @brief Re-subscribe MQTT topics
  *
@@ -386,6 +482,16 @@ int qcloud_iot_mqtt_resubscribe(Qcloud_IoT_Client *pClient);
  */
 int qcloud_iot_mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter);
 
+/**
+ * @brief Unsubscribe MQTT topic subscribed by qcloud_iot_mqtt_subscribe_routed
+ *
+ * @param pClient       handle to MQTT client
+ * @param topicFilter   MQTT topic filter
+ *
+ * @return packet id (>=0) when success, or err code (<0) for failure
+ */
+int qcloud_iot_mqtt_unsubscribe_routed(Qcloud_IoT_Client *pClient, char *topicFilter);
+
 /**
  * @brief check if MQTT topic has been subscribed or not
  *
@@ -410,6 +516,47 @@ int qcloud_iot_mqtt_yield(Qcloud_IoT_Client *pClient, uint32_t timeout_ms);
 // workaround wrapper for qcloud_iot_mqtt_yield for multi-thread mode
 int qcloud_iot_mqtt_yield_mt(Qcloud_IoT_Client *mqtt_client, uint32_t timeout_ms);
 
+/**
+ * @brief Init a completion, it still works by yield when no semaphore is available
+ *
+ * @param completion completion to init
+ */
+void qcloud_iot_completion_init(QcloudIotCompletion *completion);
+
+/**
+ * @brief Release the resource of a completion
+ *
+ * @param completion completion to deinit
+ */
+void qcloud_iot_completion_deinit(QcloudIotCompletion *completion);
+
+/**
+ * @brief Clear a completion and drop any stale signal, call it before the request is sent
+ *
+ * @param completion completion to reset
+ */
+void qcloud_iot_completion_reset(QcloudIotCompletion *completion);
+
+/**
+ * @brief Complete a completion and wake up its waiter, call it after the result is stored
+ *
+ * @param completion completion to signal
+ */
+void qcloud_iot_completion_signal(QcloudIotCompletion *completion);
+
+/**
+ * @brief Wait until the completion is signaled or timeout. It blocks on the semaphore when the yield thread is
+ * running, or reads the network itself and returns right after the callback signaled it.
+ *
+ * @param pClient    handle to MQTT client
+ * @param completion completion to wait for
+ * @param timeout_ms timeout value (unit: ms)
+ *
+ * @return QCLOUD_RET_SUCCESS when signaled, QCLOUD_ERR_MQTT_REQUEST_TIMEOUT when timeout, or err code of yield
+ */
+int qcloud_iot_mqtt_wait_completion(Qcloud_IoT_Client *pClient, QcloudIotCompletion *completion,
+                                    uint32_t timeout_ms);
+
 /**
  * @brief Check if auto reconnect is enabled or not
  *
@@ -537,7 +684,7 @@ int qcloud_iot_mqtt_pub_info_proc(Qcloud_IoT_Client *pClient);
 int qcloud_iot_mqtt_sub_info_proc(Qcloud_IoT_Client *pClient);
 
 int push_sub_info_to(Qcloud_IoT_Client *c, int len, unsigned short msgId, MessageTypes type, SubTopicHandle *handler,
-                     ListNode **node);
+                     QcloudIotSubInfo **info);
 
 int serialize_pub_ack_packet(unsigned char *buf, size_t buf_len, MessageTypes packet_type, uint8_t dup,
                              uint16_t packet_id, uint32_t *serialized_len);
@@ -547,14 +694,15 @@ int serialize_packet_with_zero_payload(unsigned char *buf, size_t buf_len, Messa
 
 int deserialize_publish_packet(unsigned char *dup, QoS *qos, uint8_t *retained, uint16_t *packet_id, char **topicName,
                                uint16_t *topicNameLen, unsigned char **payload, size_t *payload_len, unsigned char *buf,
-                               size_t buf_len);
+                               size_t buf_len, uint8_t mqtt_version);
 
 int deserialize_suback_packet(uint16_t *packet_id, uint32_t max_count, uint32_t *count, QoS *grantedQoSs,
-                              unsigned char *buf, size_t buf_len);
+                              unsigned char *buf, size_t buf_len, uint8_t mqtt_version);
 
-int deserialize_unsuback_packet(uint16_t *packet_id, unsigned char *buf, size_t buf_len);
+int deserialize_unsuback_packet(uint16_t *packet_id, unsigned char *buf, size_t buf_len, uint8_t mqtt_version);
 
-int deserialize_ack_packet(uint8_t *packet_type, uint8_t *dup, uint16_t *packet_id, unsigned char *buf, size_t buf_len);
+int deserialize_ack_packet(uint8_t *packet_type, uint8_t *dup, uint16_t *packet_id, unsigned char *buf, size_t buf_len,
+                           uint8_t mqtt_version);
 
 #ifdef MQTT_RMDUP_MSG_ENABLED
 
@@ -562,6 +710,117 @@ void reset_repeat_packet_id_buffer(Qcloud_IoT_Client *pClient);
 
 #endif
 
+/**
+ * @brief Find the callback of the subscription matching a topic
+ *
+ * @param pClient       MQTT Client
+ * @param topicName     topic of the message, null terminated
+ * @param topicNameLen  length of topicName
+ * @param handler       output callback
+ * @param user_data     output user context of the callback
+ * @return true if a subscription with a callback matches
+ */
+bool qcloud_iot_mqtt_find_handler(Qcloud_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+                                  OnMessageHandler *handler, void **user_data);
+
+/**
+ * @brief Check if a topic matches a topic filter with '+' or '#' wildcards
+ *
+ * @param topicFilter   topic filter, null terminated
+ * @param topicName     topic of the message, need not be null terminated
+ * @param topicNameLen  length of topicName
+ * @return true if the topic matches
+ */
+bool qcloud_iot_mqtt_is_topic_matched(const char *topicFilter, const char *topicName, uint16_t topicNameLen);
+
+#ifdef MULTITHREAD_ENABLED
+/**
+ * @brief Copy a message to the queue of its dispatch worker
+ *
+ * @param pClient       MQTT Client
+ * @param message       message with ptopic/topic_len set
+ * @return QCLOUD_RET_SUCCESS if the message is queued or dropped by the dispatch policy,
+ *         err code if there is no dispatcher and it should be delivered inline
+ */
+int qcloud_iot_mqtt_dispatch(Qcloud_IoT_Client *pClient, MQTTMessage *message);
+
+/**
+ * @brief Stop the dispatch workers and drop the messages still queued
+ *
+ * @param pClient       MQTT Client
+ */
+void qcloud_iot_mqtt_dispatch_fini(Qcloud_IoT_Client *pClient);
+#endif
+
+#ifdef MQTT5_ENABLED
+/* reason code at and above this value means failure, MQTT v5.0 Specification 2.4 */
+#define MQTT5_REASON_FAILURE 0x80
+
+/* MQTT 5 property identifiers used by the client, MQTT v5.0 Specification 2.2.2.2 */
+#define MQTT5_PROP_SESSION_EXPIRY    0x11
+#define MQTT5_PROP_SERVER_KEEP_ALIVE 0x13
+#define MQTT5_PROP_RECEIVE_MAXIMUM   0x21
+#define MQTT5_PROP_TOPIC_ALIAS_MAX   0x22
+#define MQTT5_PROP_TOPIC_ALIAS       0x23
+#define MQTT5_PROP_MAXIMUM_QOS       0x24
+#define MQTT5_PROP_MAX_PACKET_SIZE   0x27
+
+/**
+ * @brief Get the size of a variable byte integer
+ *
+ * @param value     value to encode
+ * @return bytes needed, 1 to 4
+ */
+size_t mqtt5_vbi_len(uint32_t value);
+
+/**
+ * @brief Skip the properties of a received packet
+ *
+ * @param pptr      points to the property length, moved past the properties
+ * @param enddata   end of the packet
+ * @return QCLOUD_RET_SUCCESS for success, or err code for malformed properties
+ */
+int mqtt5_skip_properties(unsigned char **pptr, unsigned char *enddata);
+
+/**
+ * @brief Reset the session state to protocol defaults before CONNECT
+ *
+ * @param pClient   MQTT Client
+ */
+void mqtt5_session_reset(Qcloud_IoT_Client *pClient);
+
+/**
+ * @brief Read CONNACK properties into the session state
+ *
+ * @param pClient   MQTT Client
+ * @param pptr      points to the property length, moved past the properties
+ * @param enddata   end of the packet
+ * @return QCLOUD_RET_SUCCESS for success, or err code for malformed properties
+ */
+int mqtt5_read_connack_properties(Qcloud_IoT_Client *pClient, unsigned char **pptr, unsigned char *enddata);
+
+/**
+ * @brief Get the topic alias for a publish, assigning the least recently used one on a miss
+ *
+ * Must be called with lock_write_buf held, the mapping is made on server by the packet sent under the same lock.
+ *
+ * @param pClient   MQTT Client
+ * @param topicName topic name
+ * @param topicLen  length of topicName
+ * @param mapped    output, true if server knows the alias and the topic name can be left out
+ * @return alias, or 0 if server does not accept topic alias
+ */
+uint16_t mqtt5_topic_alias_get(Qcloud_IoT_Client *pClient, const char *topicName, uint16_t topicLen, bool *mapped);
+
+/**
+ * @brief Forget an alias whose mapping packet was not sent
+ *
+ * @param pClient   MQTT Client
+ * @param alias     alias returned by mqtt5_topic_alias_get
+ */
+void mqtt5_topic_alias_drop(Qcloud_IoT_Client *pClient, uint16_t alias);
+#endif
+
 size_t get_mqtt_packet_len(size_t rem_len);
 
 size_t mqtt_write_packet_rem_len(unsigned char *buf, uint32_t length);
@@ -27,6 +27,7 @@ extern "C" {
 
 #define TYPE_FIELD     "type"
 #define MD5_FIELD      "md5sum"
+#define SHA256_FIELD   "sha256sum"
 #define VERSION_FIELD  "version"
 #define URL_FIELD      "url"
 #define FILESIZE_FIELD "file_size"
@@ -25,13 +25,39 @@ extern "C" {
 
 #include "qcloud_iot_export_ota.h"
 
-void *qcloud_otalib_md5_init(void);
+/* firmware is hashed in slices of this size, every digest in turn while the slice is in cache */
+#ifndef OTA_DIGEST_SLICE_LEN
+#define OTA_DIGEST_SLICE_LEN (1024)
+#endif
+
+/**
+ * @brief Create the digest pipeline run over the firmware while it is downloaded
+ *
+ * @param types     mask of IOT_OTA_DigestType, MD5 is always added
+ * @return          digest handle, NULL for failure
+ */
+void *qcloud_otalib_digest_init(uint32_t types);
+
+/* feed one downloaded chunk to every digest of the pipeline in a single pass */
+void qcloud_otalib_digest_update(void *digest, const char *buf, size_t buf_len);
+
+/**
+ * @brief Get one digest of the data fed so far as hex string, the pipeline can still be updated after it
+ *
+ * @param digest        digest handle
+ * @param type          digest to get, must be enabled in the pipeline
+ * @param output_str    output buffer, 33 bytes for MD5 and 65 for SHA256
+ * @param output_len    size of output buffer
+ * @return              QCLOUD_RET_SUCCESS for success, or err code for failure
+ */
+int qcloud_otalib_digest_finalize(void *digest, IOT_OTA_DigestType type, char *output_str, size_t output_len);
 
-void qcloud_otalib_md5_update(void *md5, const char *buf, size_t buf_len);
+/* enabled digests, bytes hashed and ms spent hashing them */
+void qcloud_otalib_digest_stat(void *digest, uint32_t *types, uint32_t *hashed_bytes, uint32_t *hash_ms);
 
-void qcloud_otalib_md5_finalize(void *md5, char *output_str);
+const char *qcloud_otalib_digest_name(IOT_OTA_DigestType type);
 
-void qcloud_otalib_md5_deinit(void *md5);
+void qcloud_otalib_digest_deinit(void *digest);
 
 int qcloud_otalib_get_firmware_type(const char *json, char **type);
 
@@ -50,6 +76,15 @@ int qcloud_otalib_get_report_version_result(const char *json);
  */
 int qcloud_otalib_get_params(const char *json, char **type, char **url, char **version, char *md5, uint32_t *fileSize);
 
+/**
+ * @brief Parse the optional SHA-256 of firmware from JSON string
+ *
+ * @param json          source JSON string
+ * @param sha256        output hex string, 65 bytes
+ * @return              QCLOUD_RET_SUCCESS when present, or err code otherwise
+ */
+int qcloud_otalib_get_sha256(const char *json, char *sha256);
+
 /**
  * @brief Generate firmware info from id and version
  *
@@ -0,0 +1,85 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef QCLOUD_IOT_CLOCK_H_
+#define QCLOUD_IOT_CLOCK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* a sync moving the clock by more than this is applied as a step, smaller corrections never go backwards */
+#ifndef QCLOUD_CLOCK_STEP_THRESHOLD_MS
+#define QCLOUD_CLOCK_STEP_THRESHOLD_MS (1000)
+#endif
+
+/* drift is only re-estimated when two syncs are at least this far apart, so RTT noise does not dominate */
+#ifndef QCLOUD_CLOCK_DRIFT_MIN_INTERVAL_MS
+#define QCLOUD_CLOCK_DRIFT_MIN_INTERVAL_MS (10 * 60 * 1000)
+#endif
+
+/* bound of the local oscillator error, larger estimates mean the cloud clock itself moved */
+#ifndef QCLOUD_CLOCK_DRIFT_MAX_PPM
+#define QCLOUD_CLOCK_DRIFT_MAX_PPM (500)
+#endif
+
+/**
+ * @brief one time exchange with the cloud, NTP style
+ */
+typedef struct {
+    uint32_t local_send_ms;  // HAL_GetTimeMs() when the request was sent
+    uint64_t cloud_recv_ms;  // cloud time when the request was received
+    uint64_t cloud_send_ms;  // cloud time when the reply was sent
+    uint32_t local_recv_ms;  // HAL_GetTimeMs() when the reply was received
+} ClockSample;
+
+/**
+ * @brief Discipline the SDK clock with the samples of one sync round
+ *
+ * The sample with the smallest round trip is used as the new anchor, and the
+ * rate error of HAL_GetTimeMs() is re-estimated against the previous anchor.
+ *
+ * @param samples       samples of this round
+ * @param num           sample count
+ * @return              QCLOUD_RET_SUCCESS for success, otherwise failure
+ */
+int qcloud_iot_clock_update(const ClockSample *samples, int num);
+
+/**
+ * @brief Check if the clock has been synced with the cloud
+ */
+bool qcloud_iot_clock_is_synced(void);
+
+/**
+ * @brief Get current cloud time in millisecond, without any network access
+ *
+ * Falls back to HAL_Timer_current_sec() until the first sync.
+ * The values returned never go backwards except on a step.
+ */
+uint64_t qcloud_iot_clock_now_ms(void);
+
+/**
+ * @brief Get current cloud time in second, see qcloud_iot_clock_now_ms()
+ */
+long qcloud_iot_clock_now_sec(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // QCLOUD_IOT_CLOCK_H_
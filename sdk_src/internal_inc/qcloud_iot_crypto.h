@@ -0,0 +1,58 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef QCLOUD_IOT_CRYPTO_H_
+#define QCLOUD_IOT_CRYPTO_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "qcloud_iot_export_crypto.h"
+
+/**
+ * @brief mask of IOT_CRYPTO_ACCEL_* the utils may dispatch to, CPU is probed on first call
+ */
+uint32_t qcloud_iot_crypto_accel(void);
+
+/**
+ * @brief run SHA-1 compression over whole 64 bytes blocks, only valid with IOT_CRYPTO_ACCEL_SHA1
+ */
+void qcloud_iot_crypto_sha1_blocks(uint32_t state[5], const unsigned char *data, size_t blocks);
+
+/**
+ * @brief run SHA-256 compression over whole 64 bytes blocks, only valid with IOT_CRYPTO_ACCEL_SHA256
+ */
+void qcloud_iot_crypto_sha256_blocks(uint32_t state[8], const unsigned char *data, size_t blocks);
+
+/**
+ * @brief AES on round keys laid out by utils_aes_setkey_enc/dec, only valid with IOT_CRYPTO_ACCEL_AES
+ *
+ * mode is UTILS_AES_ENCRYPT or UTILS_AES_DECRYPT, length of cbc is a multiple of 16
+ */
+void qcloud_iot_crypto_aes_ecb(int nr, const uint32_t *rk, int mode, const unsigned char input[16],
+                               unsigned char output[16]);
+void qcloud_iot_crypto_aes_cbc(int nr, const uint32_t *rk, int mode, size_t length, unsigned char iv[16],
+                               const unsigned char *input, unsigned char *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QCLOUD_IOT_CRYPTO_H_ */
@@ -61,6 +61,8 @@ typedef struct _RequestParam {
  * @brief for property and it's callback
  */
 typedef struct {
+    list_head_t list;  // link in property_handle_list
+
     void *property;
 
     OnPropRegCallback callback;
@@ -70,9 +72,15 @@ typedef struct {
 typedef struct _ShadowInnerData {
     uint32_t token_num;
     int32_t  sync_status;
-    List *   request_list;
-    List *   property_handle_list;
+    List     request_list;          // list of Request waiting for reply
+    List     property_handle_list;  // list of PropertyHandler
     char *   result_topic;
+
+    MQTTTopicHandle     operation_topic;  // encoded in qcloud_iot_shadow_init
+    QcloudIotCompletion sync_done;        // signaled on sub ack and on the ack of a sync request
+
+    OnShadowDeltaCallback delta_callback;  // gets the whole delta before property callbacks
+    void *                delta_context;
 } ShadowInnerData;
 
 typedef struct _Shadow {
@@ -82,6 +90,10 @@ typedef struct _Shadow {
     MQTTEventHandler event_handle;
     ShadowInnerData  inner_data;
     char             shadow_recv_buf[CLOUD_IOT_JSON_RX_BUF_LEN];
+#ifdef CBOR_PAYLOAD_ENABLED
+    eShadowPayloadFormat payload_format;
+    size_t               shadow_recv_len;  // a CBOR document in shadow_recv_buf may hold '\0'
+#endif
 } Qcloud_IoT_Shadow;
 
 int qcloud_iot_shadow_init(Qcloud_IoT_Shadow *pShadow);
@@ -106,6 +118,20 @@ void handle_expired_request(Qcloud_IoT_Shadow *pShadow);
  */
 int do_shadow_request(Qcloud_IoT_Shadow *pShadow, RequestParams *pParams, char *pJsonDoc, size_t sizeOfBuffer);
 
+#ifdef CBOR_PAYLOAD_ENABLED
+/**
+ * @brief Entry of all shadow CBOR request, the document already carries type and clientToken
+ *
+ * @param pShadow       shadow client
+ * @param pParams       request param
+ * @param pCborDoc      CBOR document
+ * @param docLength     length of document
+ * @return              QCLOUD_RET_SUCCESS for success, or err code for failure
+ */
+int do_shadow_cbor_request(Qcloud_IoT_Shadow *pShadow, RequestParams *pParams, const uint8_t *pCborDoc,
+                           size_t docLength);
+#endif
+
 /**
  * @brief subscribe shadow topic $shadow/operation/result
  *
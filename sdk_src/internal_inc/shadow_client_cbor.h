@@ -0,0 +1,92 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef IOT_SHADOW_CLIENT_CBOR_H_
+#define IOT_SHADOW_CLIENT_CBOR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lite-cbor.h"
+#include "qcloud_iot_export.h"
+
+#ifdef CBOR_PAYLOAD_ENABLED
+
+/**
+ * add a CBOR map member of a device property, key and value
+ *
+ * @param w             CBOR writer
+ * @param pKey          key of property
+ * @param pData         value of property
+ * @param type          value type of property
+ */
+void put_cbor_node(LITE_cbor_writer *w, const char *pKey, void *pData, JsonDataType type);
+
+/**
+ * build a CBOR request with only type and clientToken, such as a get request
+ *
+ * @param tokenNumber   shadow token number, increment every time
+ * @param buf           CBOR buffer
+ * @param size          size of buffer
+ * @param type          operation type
+ * @param product_id    product ID
+ * @return              length of request, or err code for failure
+ */
+int build_empty_cbor(uint32_t *tokenNumber, uint8_t *buf, size_t size, const char *type, char *product_id);
+
+/**
+ * copy a text member of CBOR document, such as type or clientToken
+ *
+ * @param pDoc          CBOR document
+ * @param len           document length
+ * @param key           key of the member, path as "payload.state" is supported
+ * @param buf           buffer for the text with '\0'
+ * @param size          size of buffer
+ * @return              true for success
+ */
+bool parse_cbor_text(const uint8_t *pDoc, size_t len, const char *key, char *buf, size_t size);
+
+/**
+ * parse field of "result" from CBOR shadow reply
+ *
+ * @param pDoc          CBOR document
+ * @param len           document length
+ * @param pResultCode   result code
+ * @return              true for success
+ */
+bool parse_cbor_result_code(const uint8_t *pDoc, size_t len, int16_t *pResultCode);
+
+/**
+ * update value in property if the key matches a member of the CBOR delta map
+ *
+ * @param pDelta        CBOR delta map
+ * @param len           delta length
+ * @param pProperty     device property
+ * @return              true for key matched and value updated
+ */
+bool cbor_update_value_if_key_match(const uint8_t *pDelta, size_t len, DeviceProperty *pProperty);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // IOT_SHADOW_CLIENT_CBOR_H_
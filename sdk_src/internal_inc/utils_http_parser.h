@@ -0,0 +1,120 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef QCLOUD_IOT_UTILS_HTTP_PARSER_H_
+#define QCLOUD_IOT_UTILS_HTTP_PARSER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Incremental HTTP/1.x response parser.
+ *
+ * The parser is fed with arbitrary slices of the byte stream received from the
+ * server and never copies or NUL-terminates the input. Status line and headers
+ * are consumed byte by byte, body data (Content-Length, chunked or
+ * read-until-close) is handed back as spans pointing into the caller's buffer.
+ * It keeps no reference to the input between calls, so the caller is free to
+ * reuse its receive buffer once a slice has been consumed.
+ */
+typedef enum {
+    HTTP_PARSER_STATE_STATUS_LINE = 0,
+    HTTP_PARSER_STATE_HEADER_NAME,
+    HTTP_PARSER_STATE_HEADER_VALUE,
+    HTTP_PARSER_STATE_BODY,
+    HTTP_PARSER_STATE_BODY_UNTIL_CLOSE,
+    HTTP_PARSER_STATE_CHUNK_SIZE,
+    HTTP_PARSER_STATE_CHUNK_EXT,
+    HTTP_PARSER_STATE_CHUNK_DATA,
+    HTTP_PARSER_STATE_CHUNK_DATA_END,
+    HTTP_PARSER_STATE_TRAILER,
+    HTTP_PARSER_STATE_DONE,
+    HTTP_PARSER_STATE_ERROR,
+} HTTPParserState;
+
+typedef struct {
+    HTTPParserState state;
+    uint8_t         sub_state;      // position inside the current token
+    uint8_t         header_id;      // candidate mask while matching a header name, then header being parsed
+    bool            line_empty;     // current header/trailer line has no content yet
+    bool            is_chunked;     // Transfer-Encoding: chunked
+    bool            has_content_len;  // Content-Length header present
+    bool            value_started;  // a digit of the numeric value has been seen
+    int             status_code;    // HTTP status code, valid once headers are complete
+    uint32_t        content_len;    // Content-Length, or sum of chunk sizes seen so far
+    uint32_t        body_left;      // bytes left in the body or in the current chunk
+    uint32_t        body_recv;      // body bytes handed out so far
+} HTTPParser;
+
+/**
+ * @brief Reset parser to expect a new response
+ *
+ * @param parser    parser handle
+ */
+void qcloud_http_parser_init(HTTPParser *parser);
+
+/**
+ * @brief Feed a slice of the response stream into the parser
+ *
+ * The call stops after the first body span found in the slice, so the caller
+ * should loop until the whole slice is consumed. Bytes after the end of the
+ * response are not consumed.
+ *
+ * @param parser    parser handle
+ * @param data      input slice, need not be NUL-terminated
+ * @param len       length of input slice
+ * @param body      [out] start of body span inside data, NULL if none
+ * @param body_len  [out] length of body span, 0 if none
+ * @return          number of bytes consumed (>= 0), or QCLOUD_ERR_HTTP_PRTCL on malformed input
+ */
+int qcloud_http_parser_execute(HTTPParser *parser, const char *data, size_t len, const char **body,
+                               size_t *body_len);
+
+/**
+ * @brief Tell the parser the peer closed the connection
+ *
+ * Completes a response whose body is delimited by connection close.
+ *
+ * @param parser    parser handle
+ * @return          QCLOUD_RET_SUCCESS if response is complete, or QCLOUD_ERR_HTTP_CLOSED if truncated
+ */
+int qcloud_http_parser_finish(HTTPParser *parser);
+
+/**
+ * @brief Check if status line and all headers have been parsed
+ */
+bool qcloud_http_parser_headers_complete(const HTTPParser *parser);
+
+/**
+ * @brief Check if the whole response has been parsed
+ */
+bool qcloud_http_parser_is_done(const HTTPParser *parser);
+
+/**
+ * @brief Number of body bytes the parser knows are still pending
+ *
+ * @return  bytes left in the body or current chunk, 0 if unknown (headers, chunk framing, read-until-close)
+ */
+uint32_t qcloud_http_parser_body_left(const HTTPParser *parser);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* QCLOUD_IOT_UTILS_HTTP_PARSER_H_ */
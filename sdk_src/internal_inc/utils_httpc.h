@@ -23,6 +23,7 @@ extern "C" {
 #include <stdbool.h>
 
 #include "network_interface.h"
+#include "utils_http_parser.h"
 
 #define HTTP_PORT  80
 #define HTTPS_PORT 443
@@ -36,18 +37,21 @@ typedef struct {
     char *  auth_user;
     char *  auth_password;
     Network network_stack;
+    char *  pending;      // bytes read past the end of last response, start of the next pipelined one
+    int     pending_len;  // length of pending
 } HTTPClient;
 
 typedef struct {
-    bool  is_more;               // if more data to check
-    bool  is_chunked;            // if response in chunked data
-    int   retrieve_len;          // length of retrieve
-    int   response_content_len;  // length of resposne content
-    int   post_buf_len;          // post data length
-    int   response_buf_len;      // length of response data buffer
-    char *post_content_type;     // type of post content
-    char *post_buf;              // post data buffer
-    char *response_buf;          // response data buffer
+    bool       is_more;               // if more data to check
+    bool       is_chunked;            // if response in chunked data
+    int        retrieve_len;          // length of retrieve
+    int        response_content_len;  // length of resposne content
+    int        post_buf_len;          // post data length
+    int        response_buf_len;      // length of response data buffer
+    char *     post_content_type;     // type of post content
+    char *     post_buf;              // post data buffer
+    char *     response_buf;          // response data buffer
+    HTTPParser parser;                // response parser state, kept across recv calls
 } HTTPClientData;
 
 /**
@@ -20,71 +20,40 @@
 extern "C" {
 #endif
 
-#include <stdlib.h>
+#include "lite-utils.h"
 
 /*
- * ListNode iterator direction
- */
-typedef enum { LIST_HEAD, LIST_TAIL } ListDirection;
-
-/*
- * define list node
- */
-typedef struct ListNode {
-    struct ListNode *prev;
-    struct ListNode *next;
-    void *           val;
-} ListNode;
-
-/*
- * Double Linked List
+ * Intrusive double linked list with an element counter.
+ *
+ * Elements embed a list_head_t link and are owned by the caller: the list never
+ * allocates or frees anything, so pushing, removing and iterating don't touch the heap.
+ * Iterate with the list_for_each_entry*() macros of lite-list.h on &list->head, and use
+ * list_for_each_entry_safe() when the loop body may remove the current element.
  */
 typedef struct {
-    ListNode *   head;
-    ListNode *   tail;
+    list_head_t  head;
     unsigned int len;
-    void (*free)(void *val);
-    int (*match)(void *a, void *b);
 } List;
 
-/*
- * list iterator
- */
-typedef struct {
-    ListNode *    next;
-    ListDirection direction;
-} ListIterator;
-
-/* create node */
-ListNode *list_node_new(void *val);
-
-/* create list */
-List *list_new(void);
-
-ListNode *list_rpush(List *self, ListNode *node);
-
-ListNode *list_lpush(List *self, ListNode *node);
-
-ListNode *list_find(List *self, void *val);
-
-ListNode *list_at(List *self, int index);
-
-ListNode *list_rpop(List *self);
-
-ListNode *list_lpop(List *self);
-
-void list_remove(List *self, ListNode *node);
-
-void list_destroy(List *self);
-
-/* create iterator */
-ListIterator *list_iterator_new(List *list, ListDirection direction);
-
-ListIterator *list_iterator_new_from_node(ListNode *node, ListDirection direction);
+static inline void list_init(List *self)
+{
+    INIT_LIST_HEAD(&self->head);
+    self->len = 0;
+}
 
-ListNode *list_iterator_next(ListIterator *self);
+/* append an element at the tail */
+static inline void list_push(List *self, list_head_t *link)
+{
+    list_add_tail(link, &self->head);
+    self->len++;
+}
 
-void list_iterator_destroy(ListIterator *self);
+/* unlink an element, the element itself is left to the caller to release */
+static inline void list_unlink(List *self, list_head_t *link)
+{
+    list_del_init(link);
+    self->len--;
+}
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,67 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef QCLOUD_IOT_UTILS_MEM_H_
+#define QCLOUD_IOT_UTILS_MEM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "qcloud_iot_export_mem.h"
+
+/* blocks per pool, a pool of 0 blocks is skipped; requests above the largest
+ * block size, or finding every fitting pool empty, go to HAL_Malloc */
+#ifndef MEM_POOL_32_NUM
+#define MEM_POOL_32_NUM 16
+#endif
+
+#ifndef MEM_POOL_64_NUM
+#define MEM_POOL_64_NUM 16
+#endif
+
+#ifndef MEM_POOL_128_NUM
+#define MEM_POOL_128_NUM 8
+#endif
+
+#ifndef MEM_POOL_256_NUM
+#define MEM_POOL_256_NUM 8
+#endif
+
+#ifndef MEM_POOL_512_NUM
+#define MEM_POOL_512_NUM 4
+#endif
+
+/**
+ * @brief Allocate memory for an SDK object, from the pools when MEM_POOL_ENABLED
+ *
+ * @param tag       owner of the memory, for accounting
+ * @param size      size in bytes
+ * @return          the memory, or NULL on failure
+ */
+void *utils_mem_alloc(MemTag tag, size_t size);
+
+/**
+ * @brief Release memory allocated by utils_mem_alloc, NULL is ignored
+ */
+void utils_mem_free(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // QCLOUD_IOT_UTILS_MEM_H_
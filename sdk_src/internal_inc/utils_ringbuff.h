@@ -25,18 +25,48 @@
 #define RINGBUFF_FULL      -4 /* Routing problem.          */
 #define RINGBUFF_TOO_SHORT -5
 
+/*
+ * Single producer/single consumer ring buffer.
+ *
+ * The size is a power of two and readpoint/writepoint are free running
+ * counters, so used space is (writepoint - readpoint) and the whole buffer
+ * can be filled. Only the producer (eg. uart isr) writes writepoint and only
+ * the consumer (at parser) writes readpoint, which makes push and pop safe
+ * against each other without locking.
+ */
 typedef struct _ring_buff_ {
-    uint32_t size;
-    uint32_t readpoint;
-    uint32_t writepoint;
+    uint32_t size;        // buffer size, power of two
+    uint32_t mask;        // size - 1
+    uint32_t readpoint;   // total bytes consumed, written by consumer only
+    uint32_t writepoint;  // total bytes produced, written by producer only
+    uint32_t dropped;     // bytes dropped because ring was full, written by producer only
     char*    buffer;
-    bool     full;
 } sRingbuff;
 
 typedef sRingbuff* ring_buff_t;
 
+/* size is rounded down to a power of two */
 int ring_buff_init(sRingbuff* ring_buff, char* buff, uint32_t size);
+
+/* drop all pending data, consumer side */
 int ring_buff_flush(sRingbuff* ring_buff);
+
+/* bulk copy, return RINGBUFF_FULL if only part of data fits */
 int ring_buff_push_data(sRingbuff* ring_buff, uint8_t* pData, int len);
+
+/* bulk copy, return bytes popped */
 int ring_buff_pop_data(sRingbuff* ring_buff, uint8_t* pData, int len);
+
+/* bytes readable/writable now */
+uint32_t ring_buff_used(sRingbuff* ring_buff);
+uint32_t ring_buff_free(sRingbuff* ring_buff);
+
+/* consumer: get the contiguous readable span, then release bytes handled in place */
+uint32_t ring_buff_read_span(sRingbuff* ring_buff, const char** span);
+void     ring_buff_consume(sRingbuff* ring_buff, uint32_t len);
+
+/* producer: get the contiguous writable span, then publish bytes written in place */
+uint32_t ring_buff_write_span(sRingbuff* ring_buff, char** span);
+void     ring_buff_commit(sRingbuff* ring_buff, uint32_t len);
+
 #endif  // __ringbuff_h__
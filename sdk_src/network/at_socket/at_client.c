@@ -362,33 +362,42 @@ int at_client_send(at_client_t client, const char *buf, int size, uint32_t timeo
     return HAL_AT_Uart_Send((void *)buf, size);
 }
 
-static int at_client_getchar(at_client_t client, char *pch, uint32_t timeout)
+/**
+ * Wait until the ring buffer holds data. Without rx irq the uart is read here,
+ * straight into the free span of the ring buffer.
+ *
+ * @return bytes available in ring buffer, 0 for timeout
+ */
+static uint32_t at_client_wait_data(at_client_t client, uint32_t timeout)
 {
-    int   ret = QCLOUD_RET_SUCCESS;
-    Timer timer;
+    uint32_t avail = ring_buff_used(client->pRingBuff);
+    Timer    timer;
+
+    if (avail) {
+        return avail;
+    }
 
     countdown_ms(&timer, timeout);
     do {
 #ifndef AT_UART_RECV_IRQ
-        if (0 == HAL_AT_Uart_Recv((void *)pch, 1, NULL, timeout)) {
-            continue;
-        }
-#else
-        if (0 ==
-            ring_buff_pop_data(client->pRingBuff, (uint8_t *)pch, 1)) {  // push data to ringbuff @ AT_UART_IRQHandler
-            continue;
+        char *   span;
+        uint32_t recv_size = 0;
+        uint32_t span_len  = ring_buff_write_span(client->pRingBuff, &span);
+
+        if (span_len && QCLOUD_RET_SUCCESS == HAL_AT_Uart_Recv(span, span_len, &recv_size, left_ms(&timer))) {
+            ring_buff_commit(client->pRingBuff, recv_size);
         }
 #endif
-        else {
+        avail = ring_buff_used(client->pRingBuff);
+        if (avail) {
             break;
         }
+#ifdef AT_UART_RECV_IRQ
+        at_delayms(1);  // data pushed to ringbuff @ AT_UART_IRQHandler
+#endif
     } while (!expired(&timer));
 
-    if (expired(&timer)) {
-        ret = QCLOUD_ERR_FAILURE;
-    }
-
-    return ret;
+    return avail;
 }
 
 /**
@@ -406,9 +415,7 @@ static int at_client_getchar(at_client_t client, char *pch, uint32_t timeout)
  */
 int at_client_obj_recv(char *buf, int size, int timeout)
 {
-    int  read_idx = 0;
-    int  result   = QCLOUD_RET_SUCCESS;
-    char ch;
+    int read_idx = 0;
 
     POINTER_SANITY_CHECK(buf, 0);
     at_client_t client = at_client_get();
@@ -418,18 +425,13 @@ int at_client_obj_recv(char *buf, int size, int timeout)
         return 0;
     }
 
-    while (1) {
-        if (read_idx < size) {
-            result = at_client_getchar(client, &ch, timeout);
-            if (result != QCLOUD_RET_SUCCESS) {
-                Log_e("AT Client receive failed, uart device get data error(%d)", result);
-                return 0;
-            }
-
-            buf[read_idx++] = ch;
-        } else {
-            break;
+    while (read_idx < size) {
+        if (0 == at_client_wait_data(client, timeout)) {
+            Log_e("AT Client receive failed, uart device get data timeout");
+            return 0;
         }
+
+        read_idx += ring_buff_pop_data(client->pRingBuff, (uint8_t *)buf + read_idx, size - read_idx);
     }
 
 #ifdef AT_DEBUG
@@ -473,9 +475,19 @@ void at_set_urc_table(at_client_t client, const at_urc_t urc_table, uint32_t tab
         return;
     }
 
+    memset(client->urc_end_map, 0, sizeof(client->urc_end_map));
     for (idx = 0; idx < table_sz; idx++) {
         POINTER_SANITY_CHECK_RTN(urc_table[idx].cmd_prefix);
         POINTER_SANITY_CHECK_RTN(urc_table[idx].cmd_suffix);
+
+        int suffix_len = strlen(urc_table[idx].cmd_suffix);
+        if (suffix_len) {
+            uint8_t last = (uint8_t)urc_table[idx].cmd_suffix[suffix_len - 1];
+            client->urc_end_map[last >> 3] |= 1 << (last & 0x07);
+        } else {
+            /* prefix only URC may end with any char */
+            memset(client->urc_end_map, 0xff, sizeof(client->urc_end_map));
+        }
     }
 
     client->urc_table      = urc_table;
@@ -518,43 +530,53 @@ static const at_urc *get_urc_obj(at_client_t client)
 
 static int at_recv_readline(at_client_t client)
 {
-    int  read_len = 0;
-    char ch = 0, last_ch = 0;
-    bool is_full = false;
-    int  ret;
+    int         read_len = 0;
+    char        ch = 0, last_ch = 0;
+    bool        is_full = false;
+    const char *span;
+    uint32_t    span_len, i;
 
-    memset(client->recv_buffer, 0x00, client->recv_bufsz);
-    client->cur_recv_len = 0;
+    client->cur_recv_len   = 0;
+    client->recv_buffer[0] = '\0';
 
     while (1) {
-        ret = at_client_getchar(client, &ch, GET_CHAR_TIMEOUT_MS);
-
-        if (QCLOUD_RET_SUCCESS != ret) {
+        if (0 == at_client_wait_data(client, GET_CHAR_TIMEOUT_MS)) {
             return -1;
         }
 
-        if (read_len < client->recv_bufsz) {
-            client->recv_buffer[read_len++] = ch;
-            client->cur_recv_len            = read_len;
-        } else {
-            is_full = true;
-        }
+        /* scan the whole readable span, only consume up to the end of line so that
+         * URC handlers can read their payload (eg. +IPD) right behind it */
+        span_len = ring_buff_read_span(client->pRingBuff, &span);
+        for (i = 0; i < span_len; i++) {
+            ch = span[i];
 
-        /* is newline or URC data */
-        if ((ch == '\n' && last_ch == '\r') || (client->end_sign != 0 && ch == client->end_sign) ||
-            get_urc_obj(client)) {
-            if (is_full) {
-                Log_e("read line failed. The line data length is out of buffer size(%d)!", client->recv_bufsz);
-                memset(client->recv_buffer, 0x00, client->recv_bufsz);
-                client->cur_recv_len = 0;
-                ring_buff_flush(client->pRingBuff);
-                return -1;
+            if (read_len < client->recv_bufsz - 1) {
+                client->recv_buffer[read_len++] = ch;
+                client->recv_buffer[read_len]   = '\0';
+                client->cur_recv_len            = read_len;
+            } else {
+                is_full = true;
             }
-            break;
+
+            /* is newline or URC data */
+            if ((ch == '\n' && last_ch == '\r') || (client->end_sign != 0 && ch == client->end_sign) ||
+                ((client->urc_end_map[(uint8_t)ch >> 3] & (1 << ((uint8_t)ch & 0x07))) && get_urc_obj(client))) {
+                ring_buff_consume(client->pRingBuff, i + 1);
+                if (is_full) {
+                    Log_e("read line failed. The line data length is out of buffer size(%d)!", client->recv_bufsz);
+                    client->recv_buffer[0] = '\0';
+                    client->cur_recv_len   = 0;
+                    ring_buff_flush(client->pRingBuff);
+                    return -1;
+                }
+                goto exit;
+            }
+            last_ch = ch;
         }
-        last_ch = ch;
+        ring_buff_consume(client->pRingBuff, span_len);
     }
 
+exit:
 #ifdef AT_DEBUG
     at_print_raw_cmd("recvline", client->recv_buffer, read_len);
 #endif
@@ -32,13 +32,65 @@ static void *sg_at_socket_mutex;
 /**at device driver ops*/
 static at_device_op_t *sg_at_device_ops = NULL;
 
-#define MAX_RECV_PKT_PER_CHAIN (10)
+/**receive block pool, protected by sg_at_socket_mutex */
+static at_recv_block  sg_recv_blocks[AT_RECV_BLOCK_NUM];
+static at_recv_block *sg_recv_free_list = NULL;
 
 static at_device_op_t *_at_device_op_get(void)
 {
     return sg_at_device_ops;
 }
 
+static void _at_recv_pool_init(void)
+{
+    int i;
+
+    sg_recv_free_list = NULL;
+    for (i = AT_RECV_BLOCK_NUM - 1; i >= 0; i--) {
+        sg_recv_blocks[i].next = sg_recv_free_list;
+        sg_recv_free_list      = &sg_recv_blocks[i];
+    }
+}
+
+/* take a chain of blocks able to hold len bytes, all or nothing. called with sg_at_socket_mutex */
+static at_recv_block *_at_recv_block_take(size_t len)
+{
+    at_recv_block *head  = sg_recv_free_list;
+    at_recv_block *tail  = NULL;
+    size_t         count = (len + AT_RECV_BLOCK_SIZE - 1) / AT_RECV_BLOCK_SIZE;
+
+    while (count && sg_recv_free_list) {
+        tail              = sg_recv_free_list;
+        sg_recv_free_list = tail->next;
+        count--;
+    }
+
+    if (count || NULL == tail) {
+        /* not enough blocks, give back what we took */
+        if (tail) {
+            tail->next = sg_recv_free_list;
+        }
+        sg_recv_free_list = head;
+        return NULL;
+    }
+
+    tail->next = NULL;
+    return head;
+}
+
+/* give a chain of blocks back to the pool. called with sg_at_socket_mutex */
+static void _at_recv_block_release(at_recv_block *chain)
+{
+    at_recv_block *next;
+
+    while (chain) {
+        next              = chain->next;
+        chain->next       = sg_recv_free_list;
+        sg_recv_free_list = chain;
+        chain             = next;
+    }
+}
+
 static int _at_socket_ctx_free(at_socket_ctx_t *pCtx)
 {
     POINTER_SANITY_CHECK(pCtx, QCLOUD_ERR_INVAL);
@@ -46,10 +98,10 @@ static int _at_socket_ctx_free(at_socket_ctx_t *pCtx)
     pCtx->fd       = UNUSED_SOCKET;
     pCtx->net_type = eNET_DEFAULT;
 
-    if (pCtx->recvpkt_list) {
-        list_destroy(pCtx->recvpkt_list);
-        pCtx->recvpkt_list = NULL;
-    }
+    _at_recv_block_release(pCtx->recv_head);
+    pCtx->recv_head = NULL;
+    pCtx->recv_tail = NULL;
+    pCtx->recv_len  = 0;
 
     if (pCtx->recv_lock) {
         HAL_MutexDestroy(pCtx->recv_lock);
@@ -70,18 +122,15 @@ static at_socket_ctx_t *_at_socket_ctx_alloc(void)
             at_socket_ctxs[i].recv_timeout_ms = AT_SOCKET_RECV_TIMEOUT_MS;
             at_socket_ctxs[i].dev_op          = _at_device_op_get();
 
+            at_socket_ctxs[i].recv_head       = NULL;
+            at_socket_ctxs[i].recv_tail       = NULL;
+            at_socket_ctxs[i].recv_len        = 0;
+
             at_socket_ctxs[i].recv_lock = HAL_MutexCreate();
             if (NULL == at_socket_ctxs[i].recv_lock) {
                 Log_e("create recv lock fail");
                 goto exit;
             }
-            at_socket_ctxs[i].recvpkt_list = list_new();
-            if (NULL != at_socket_ctxs[i].recvpkt_list) {
-                at_socket_ctxs[i].recvpkt_list->free = HAL_Free;
-            } else {
-                Log_e("no memory to allocate recvpkt_list");
-                goto exit;
-            }
 
             at_socket_ctxs[i].state = eSOCKET_ALLOCED;
             return &at_socket_ctxs[i];
@@ -110,105 +159,159 @@ static at_socket_ctx_t *_at_socket_find(int fd)
     return NULL;
 }
 
-/* get a block to the AT socket receive list*/
-static int _at_recvpkt_put(List *rlist, const char *ptr, size_t length)
+/* fill a chain of blocks with len bytes, either by read_fn or from src */
+static int _at_recv_block_fill(at_recv_block *chain, size_t len, const char *src, at_recv_read_fn read_fn,
+                               uint32_t timeout)
 {
-    at_recv_pkt *pkt = NULL;
-
-    if (rlist->len > MAX_RECV_PKT_PER_CHAIN) {
-        Log_e("Too many recv packets wait for read");
-        HAL_Free(pkt);
-        return QCLOUD_ERR_FAILURE;
+    size_t         fill;
+    at_recv_block *blk;
+
+    for (blk = chain; blk && len; blk = blk->next) {
+        fill = (len > AT_RECV_BLOCK_SIZE) ? AT_RECV_BLOCK_SIZE : len;
+        if (read_fn) {
+            if (read_fn(blk->data, (int)fill, (int)timeout) != (int)fill) {
+                return QCLOUD_ERR_FAILURE;
+            }
+        } else {
+            memcpy(blk->data, src, fill);
+            src += fill;
+        }
+        blk->len    = fill;
+        blk->offset = 0;
+        len -= fill;
     }
 
-    pkt = (at_recv_pkt *)HAL_Malloc(sizeof(struct at_recv_pkt));
-    if (pkt == NULL) {
-        Log_e("No memory for receive packet table!");
-        return QCLOUD_ERR_FAILURE;
-    }
+    return QCLOUD_RET_SUCCESS;
+}
 
-    pkt->bfsz_totle = length;
-    pkt->bfsz_index = 0;
-    pkt->buff       = (char *)ptr;
+/* append a filled chain to the socket receive queue */
+static int _at_recvpkt_put(int dev_fd, at_recv_block *chain, size_t length)
+{
+    at_socket_ctx_t *pAtSocket;
+    at_recv_block *  tail = chain;
+    int              rc   = QCLOUD_RET_SUCCESS;
 
-    ListNode *node = list_node_new(pkt);
-    if (NULL == node) {
-        Log_e("run list_node_new is error!");
-        HAL_Free(pkt);
-        return QCLOUD_ERR_FAILURE;
+    while (tail->next) {
+        tail = tail->next;
     }
 
-    list_rpush(rlist, node);
+    HAL_MutexLock(sg_at_socket_mutex);
+    pAtSocket = _at_socket_find(dev_fd + MAX_AT_SOCKET_NUM);
+    if (NULL == pAtSocket || pAtSocket->state != eSOCKET_CONNECTED) {
+        Log_e("socket %d not connected, drop %u bytes", dev_fd, (unsigned)length);
+        _at_recv_block_release(chain);
+        rc = QCLOUD_ERR_FAILURE;
+    } else {
+        if (pAtSocket->recv_tail) {
+            pAtSocket->recv_tail->next = chain;
+        } else {
+            pAtSocket->recv_head = chain;
+        }
+        pAtSocket->recv_tail = tail;
+        pAtSocket->recv_len += length;
+    }
+    HAL_MutexUnlock(sg_at_socket_mutex);
 
-    return length;
+    return rc;
 }
 
-/* get a block from AT socket receive list */
-static int _at_recvpkt_get(List *pkt_list, char *buff, size_t len)
+/* copy data out of the socket receive queue, fully read blocks go back to the pool.
+ * This is the second copy of a payload, after the one from the AT client into the blocks: the MQTT reader asks for
+ * the fixed header byte by byte, so by the time it wants the body the whole +IPD has already been queued */
+static int _at_recvpkt_get(at_socket_ctx_t *pAtSocket, char *buff, size_t len)
 {
-    ListIterator *iter;
-    ListNode *    node = NULL;
-    at_recv_pkt * pkt;
-    size_t        readlen = 0, page_len = 0;
+    at_recv_block *blk, *done = NULL;
+    size_t         readlen = 0, page_len;
     POINTER_SANITY_CHECK(buff, QCLOUD_ERR_INVAL);
 
-    if (pkt_list->len) {
-        iter = list_iterator_new(pkt_list, LIST_HEAD);
-        if (NULL == iter) {
-            Log_e("new listiterator fail");
-            return QCLOUD_ERR_TCP_READ_FAIL;
+    HAL_MutexLock(sg_at_socket_mutex);
+    while ((blk = pAtSocket->recv_head) != NULL && readlen < len) {
+        page_len = blk->len - blk->offset;
+        if (page_len > len - readlen) {
+            page_len = len - readlen;
         }
 
-        /*traverse recv pktlist*/
-        do {
-            node = list_iterator_next(iter);
-            if (!node) {
-                break;
-            }
+        memcpy(buff + readlen, blk->data + blk->offset, page_len);
+        blk->offset += page_len;
+        readlen += page_len;
 
-            /*get recv packet*/
-            pkt = (at_recv_pkt *)(node->val);
-            if (!pkt) {
-                Log_e("pkt is invalid!");
-                list_remove(pkt_list, node);
-                continue;
-            }
+        if (blk->offset == blk->len) {
+            pAtSocket->recv_head = blk->next;
+            blk->next            = done;
+            done                 = blk;
+        }
+    }
+    if (NULL == pAtSocket->recv_head) {
+        pAtSocket->recv_tail = NULL;
+    }
+    pAtSocket->recv_len -= readlen;
+    _at_recv_block_release(done);
+    HAL_MutexUnlock(sg_at_socket_mutex);
 
-            page_len = pkt->bfsz_totle - pkt->bfsz_index;
-            if (page_len >= (len - readlen)) {
-                memcpy(buff + readlen, pkt->buff + pkt->bfsz_index, (len - readlen));
-                pkt->bfsz_index += len - readlen;
-                readlen = len;
-                break;
-            } else {
-                memcpy(buff + readlen, pkt->buff + pkt->bfsz_index, page_len);
-                readlen += page_len;
+    return readlen;
+}
+
+/**
+ * Land bfsz bytes of socket data straight into pooled receive blocks.
+ *
+ * @param dev_fd    socket id of at device
+ * @param bfsz      data length
+ * @param read_fn   function to read data from AT server
+ * @param timeout   timeout of read_fn
+ * @return          QCLOUD_RET_SUCCESS for success, or err code for failure. Data is always consumed from AT server
+ */
+int at_socket_recv_data(int dev_fd, size_t bfsz, at_recv_read_fn read_fn, uint32_t timeout)
+{
+    POINTER_SANITY_CHECK(read_fn, QCLOUD_ERR_INVAL);
+    at_recv_block *chain;
+    char           drop[16];
+    size_t         left;
 
-                /*delete pkt after read*/
-                HAL_Free(pkt->buff);
-                list_remove(pkt_list, node);
+    HAL_MutexLock(sg_at_socket_mutex);
+    chain = _at_recv_block_take(bfsz);
+    HAL_MutexUnlock(sg_at_socket_mutex);
+
+    if (NULL == chain) {
+        Log_e("no free receive block for %u bytes, drop it", (unsigned)bfsz);
+        for (left = bfsz; left > 0;) {
+            size_t n = (left > sizeof(drop)) ? sizeof(drop) : left;
+            if (read_fn(drop, (int)n, (int)timeout) != (int)n) {
+                break;
             }
-        } while (1);
+            left -= n;
+        }
+        return QCLOUD_ERR_FAILURE;
+    }
 
-        list_iterator_destroy(iter);
+    if (QCLOUD_RET_SUCCESS != _at_recv_block_fill(chain, bfsz, NULL, read_fn, timeout)) {
+        Log_e("receive size(%u) data failed!", (unsigned)bfsz);
+        HAL_MutexLock(sg_at_socket_mutex);
+        _at_recv_block_release(chain);
+        HAL_MutexUnlock(sg_at_socket_mutex);
+        return QCLOUD_ERR_FAILURE;
     }
 
-    return readlen;
+    return _at_recvpkt_put(dev_fd, chain, bfsz);
 }
 
+/* legacy path for drivers delivering data in their own heap buffer */
 static void _at_socket_recv_cb(int fd, at_socket_evt_t event, char *buff, size_t bfsz)
 {
     POINTER_SANITY_CHECK_RTN(buff);
-    at_socket_ctx_t *pAtSocket;
+    at_recv_block *chain;
 
     if (event == AT_SOCKET_EVT_RECV) {
         HAL_MutexLock(sg_at_socket_mutex);
-        pAtSocket = _at_socket_find(fd + MAX_AT_SOCKET_NUM);
-        if (_at_recvpkt_put(pAtSocket->recvpkt_list, buff, bfsz) < 0) {
+        chain = _at_recv_block_take(bfsz);
+        HAL_MutexUnlock(sg_at_socket_mutex);
+
+        if (NULL == chain) {
             Log_e("put recv package to list fail");
-            HAL_Free(buff);
+        } else {
+            _at_recv_block_fill(chain, bfsz, buff, NULL, 0);
+            _at_recvpkt_put(fd, chain, bfsz);
         }
-        HAL_MutexUnlock(sg_at_socket_mutex);
+        HAL_Free(buff);
     }
 }
 
@@ -246,11 +349,14 @@ int at_socket_init(void)
     int rc = QCLOUD_RET_SUCCESS;
 
     for (i = 0; i < MAX_AT_SOCKET_NUM; i++) {
-        at_socket_ctxs[i].fd           = UNUSED_SOCKET;
-        at_socket_ctxs[i].state        = eSOCKET_CLOSED;
-        at_socket_ctxs[i].dev_op       = NULL;
-        at_socket_ctxs[i].recvpkt_list = NULL;
+        at_socket_ctxs[i].fd        = UNUSED_SOCKET;
+        at_socket_ctxs[i].state     = eSOCKET_CLOSED;
+        at_socket_ctxs[i].dev_op    = NULL;
+        at_socket_ctxs[i].recv_head = NULL;
+        at_socket_ctxs[i].recv_tail = NULL;
+        at_socket_ctxs[i].recv_len  = 0;
     }
+    _at_recv_pool_init();
 
     sg_at_socket_mutex = HAL_MutexCreate();
     if (sg_at_socket_mutex == NULL) {
@@ -365,7 +471,7 @@ int at_socket_send(int fd, const void *buf, size_t len)
 int at_socket_recv(int fd, void *buf, size_t len)
 {
     at_socket_ctx_t *pAtSocket;
-    size_t           recv_len;
+    size_t           recv_len, queued;
 
     pAtSocket = _at_socket_find(fd);
     POINTER_SANITY_CHECK(pAtSocket, QCLOUD_ERR_INVAL);
@@ -378,8 +484,13 @@ int at_socket_recv(int fd, void *buf, size_t len)
     } else {
         HAL_MutexLock(pAtSocket->recv_lock);
 
+        // the +IPD path updates recv_len under sg_at_socket_mutex
+        HAL_MutexLock(sg_at_socket_mutex);
+        queued = pAtSocket->recv_len;
+        HAL_MutexUnlock(sg_at_socket_mutex);
+
         // call at device recv driver for os and nonos
-        if (pAtSocket->recvpkt_list->len == 0) {
+        if (queued == 0) {
             if (pAtSocket->dev_op->recv_timeout(fd - MAX_AT_SOCKET_NUM, buf, len, pAtSocket->recv_timeout_ms) !=
                 QCLOUD_RET_SUCCESS) {
                 Log_e("at device recv err");  // do not return yet
@@ -387,7 +498,7 @@ int at_socket_recv(int fd, void *buf, size_t len)
         }
 
         /* receive packet list last transmission of remaining data */
-        recv_len = _at_recvpkt_get(pAtSocket->recvpkt_list, (char *)buf, len);
+        recv_len = _at_recvpkt_get(pAtSocket, (char *)buf, len);
         HAL_MutexUnlock(pAtSocket->recv_lock);
     }
 
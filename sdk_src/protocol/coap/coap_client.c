@@ -31,6 +31,7 @@ extern "C" {
 #include "qcloud_iot_export.h"
 #include "qcloud_iot_import.h"
 #include "utils_base64.h"
+#include "utils_mem.h"
 #include "utils_param_check.h"
 
 static uint16_t _get_random_start_packet_id(void)
@@ -100,7 +101,12 @@ void IOT_COAP_Destroy(void **pClient)
         (coap_client)->network_stack.disconnect(&(coap_client)->network_stack);
     }
 
-    list_destroy(coap_client->message_list);
+    CoAPMsgSendInfo *send_info, *next;
+    list_for_each_entry_safe(send_info, next, &coap_client->message_list.head, list, CoAPMsgSendInfo)
+    {
+        list_unlink(&coap_client->message_list, &send_info->list);
+        utils_mem_free(send_info);
+    }
 
     HAL_MutexDestroy(coap_client->lock_send_buf);
     HAL_MutexDestroy(coap_client->lock_list_wait_ack);
@@ -156,11 +162,11 @@ int IOT_COAP_SendMessage(void *pClient, char *topicName, SendMsgParams *sendPara
     int  len              = get_coap_message_token(pClient, message_token);
     coap_message_token_set(&send_message, message_token, len);
 
-    send_message.pay_load = (char *)HAL_Malloc(sendParams->pay_load_len);
-    if (NULL == send_message.pay_load)
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_INVAL);
-
-    coap_message_payload_set(&send_message, sendParams->pay_load, sendParams->pay_load_len);
+    /* payload and options are referenced in place until serialized into send_buf */
+    ret = coap_message_payload_set(&send_message, sendParams->pay_load, sendParams->pay_load_len);
+    if (ret != QCLOUD_RET_SUCCESS) {
+        IOT_FUNC_EXIT_RC(ret);
+    }
 
     coap_message_option_add(&send_message, COAP_MSG_URI_PATH, strlen(topicName), topicName);
     coap_message_option_add(&send_message, COAP_MSG_AUTH_TOKEN, coap_client->auth_token_len, coap_client->auth_token);
@@ -175,8 +181,6 @@ int IOT_COAP_SendMessage(void *pClient, char *topicName, SendMsgParams *sendPara
 
     ret = coap_message_send(coap_client, &send_message);
 
-    HAL_Free(send_message.pay_load);
-
     if (ret != QCLOUD_RET_SUCCESS) {
         IOT_FUNC_EXIT_RC(ret)
     }
@@ -332,7 +336,7 @@ int qcloud_iot_coap_init(CoAPClient *pClient, CoAPInitParams *pParams)
         goto error;
     }
 
-    pClient->message_list    = list_new();
+    list_init(&pClient->message_list);
     pClient->max_retry_count = pParams->max_retry_count;
     pClient->event_handle    = pParams->event_handle;
 
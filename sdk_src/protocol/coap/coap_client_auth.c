@@ -105,12 +105,12 @@ int coap_client_auth(CoAPClient *pclient)
     int  len              = get_coap_message_token(pclient, message_token);
     coap_message_token_set(&send_message, message_token, len);
 
-    len             = MAX_SIZE_OF_PRODUCT_ID + strlen(pclient->device_info.device_name) + strlen(COAP_AUTH_URI) + 4;
-    char *auth_path = (char *)HAL_Malloc(len);
-    HAL_Snprintf(auth_path, len, "%s/%s/%s", STRING_PTR_PRINT_SANITY_CHECK(pclient->device_info.product_id),
+    /* option and payload are referenced by the msg, keep them on stack until sent */
+    char auth_path[MAX_SIZE_OF_PRODUCT_ID + MAX_SIZE_OF_DEVICE_NAME + sizeof(COAP_AUTH_URI) + 4];
+    HAL_Snprintf(auth_path, sizeof(auth_path), "%s/%s/%s",
+                 STRING_PTR_PRINT_SANITY_CHECK(pclient->device_info.product_id),
                  STRING_PTR_PRINT_SANITY_CHECK(pclient->device_info.device_name), COAP_AUTH_URI);
     coap_message_option_add(&send_message, COAP_MSG_URI_PATH, strlen(auth_path), auth_path);
-    HAL_Free(auth_path);
 
     coap_message_option_add(&send_message, COAP_MSG_NEED_RESP, 1, "0");
 
@@ -119,27 +119,14 @@ int coap_client_auth(CoAPClient *pclient)
 
     get_coap_next_conn_id(coap_client);
 
-    send_message.pay_load_len = strlen(QCLOUD_IOT_DEVICE_SDK_APPID) + COAP_MAX_CONN_ID_LEN + 2;
-    send_message.pay_load     = (char *)HAL_Malloc(send_message.pay_load_len);
-    if (NULL == send_message.pay_load)
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_INVAL);
-
-    char *temp_pay_load = (char *)HAL_Malloc(send_message.pay_load_len);
-    if (NULL == temp_pay_load) {
-        HAL_Free(send_message.pay_load);
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_INVAL);
-    }
-
-    HAL_Snprintf(temp_pay_load, send_message.pay_load_len, "%s;%s", QCLOUD_IOT_DEVICE_SDK_APPID,
+    char pay_load[sizeof(QCLOUD_IOT_DEVICE_SDK_APPID) + COAP_MAX_CONN_ID_LEN + 1] = {0};
+    HAL_Snprintf(pay_load, sizeof(pay_load), "%s;%s", QCLOUD_IOT_DEVICE_SDK_APPID,
                  STRING_PTR_PRINT_SANITY_CHECK(coap_client->conn_id));
 
-    coap_message_payload_set(&send_message, temp_pay_load, send_message.pay_load_len);
+    coap_message_payload_set(&send_message, pay_load, sizeof(pay_load));
 
     ret = coap_message_send(coap_client, &send_message);
 
-    HAL_Free(temp_pay_load);
-    HAL_Free(send_message.pay_load);
-
     IOT_FUNC_EXIT_RC(ret)
 }
 
@@ -32,37 +32,6 @@ extern "C" {
  *
  *  @param[in,out] op Pointer to the option structure
  */
-static void _coap_msg_op_delete(CoAPMsgOption *option)
-{
-    IOT_FUNC_ENTRY
-    HAL_Free(option->val);
-    HAL_Free(option);
-    IOT_FUNC_EXIT
-}
-
-/**
- *  @brief Deinitialise an option linked-list structure
- *
- *  @param[in,out] list Pointer to an option linked-list structure
- */
-static void _coap_msg_op_list_destroy(CoAPMsgOptionList *list)
-{
-    IOT_FUNC_ENTRY
-
-    CoAPMsgOption *prev   = NULL;
-    CoAPMsgOption *option = NULL;
-
-    option = list->first;
-    while (option != NULL) {
-        prev   = option;
-        option = option->next;
-        _coap_msg_op_delete(prev);
-    }
-    memset(list, 0, sizeof(CoAPMsgOptionList));
-
-    IOT_FUNC_EXIT
-}
-
 uint16_t get_next_coap_msg_id(CoAPClient *pClient)
 {
     IOT_FUNC_ENTRY
@@ -144,17 +113,13 @@ int coap_message_payload_set(CoAPMessage *message, char *buf, size_t len)
 {
     IOT_FUNC_ENTRY
 
-    message->pay_load_len = 0;
-
-    if (len > 0) {
-        if (message->pay_load == NULL) {
-            IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE)
-        }
-
-        memcpy(message->pay_load, buf, len);
-        message->pay_load_len = len;
+    if (len > 0 && buf == NULL) {
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_INVAL)
     }
 
+    message->pay_load     = buf;
+    message->pay_load_len = len;
+
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS)
 }
 
@@ -166,8 +131,8 @@ int coap_message_option_add(CoAPMessage *message, unsigned num, unsigned len, co
     CoAPMsgOption *    option = NULL;
     CoAPMsgOptionList *list   = &message->op_list;
 
-    if ((option = qcloud_iot_coap_option_init(num, len, val)) == NULL) {
-        Log_e("allocate new option failed.");
+    if ((option = qcloud_iot_coap_option_init(message, num, len, val)) == NULL) {
+        Log_e("too many options, max %d", COAP_MSG_MAX_OPTION_NUM);
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE)
     }
 
@@ -221,30 +186,19 @@ int coap_message_context_set(CoAPMessage *message, void *userContext)
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS)
 }
 
-CoAPMsgOption *qcloud_iot_coap_option_init(unsigned num, unsigned len, const char *val)
+CoAPMsgOption *qcloud_iot_coap_option_init(CoAPMessage *message, unsigned num, unsigned len, const char *val)
 {
-    IOT_FUNC_ENTRY
-
     CoAPMsgOption *option = NULL;
 
-    option = (CoAPMsgOption *)HAL_Malloc(sizeof(CoAPMsgOption));
-    if (option == NULL) {
-        Log_e("no space to malloc option");
+    if (message->op_count >= COAP_MSG_MAX_OPTION_NUM) {
         return NULL;
     }
 
+    option             = &message->op_pool[message->op_count++];
     option->option_num = num;
     option->val_len    = len;
-    option->val        = (char *)HAL_Malloc(len);
-    if (option->val == NULL) {
-        HAL_Free(option);
-        option = NULL;
-        Log_e("no space to malloc option");
-        return NULL;
-    }
-
-    memcpy(option->val, val, len);
-    option->next = NULL;
+    option->val        = val;
+    option->next       = NULL;
 
     return option;
 }
@@ -253,12 +207,6 @@ void coap_message_destroy(CoAPMessage *message)
 {
     IOT_FUNC_ENTRY
 
-    _coap_msg_op_list_destroy(&message->op_list);
-
-    if (message->pay_load != NULL) {
-        HAL_Free(message->pay_load);
-    }
-
     memset(message, 0, sizeof(CoAPMessage));
 
     IOT_FUNC_EXIT
@@ -272,7 +220,7 @@ void coap_msg_dump(CoAPMessage *msg)
     Log_i("msg->code_detail  = %u", msg->code_detail);
     Log_i("msg->msg_id       = %d", msg->msg_id);
     Log_i("msg->pay_load_len = %d", msg->pay_load_len);
-    Log_i("msg->pay_load: %s", STRING_PTR_PRINT_SANITY_CHECK(msg->pay_load));
+    Log_i("msg->pay_load: %.*s", (int)msg->pay_load_len, STRING_PTR_PRINT_SANITY_CHECK(msg->pay_load));
 
     Log_i("msg->token_len = %u", msg->token_len);
     Log_i("msg->token: %s", STRING_PTR_PRINT_SANITY_CHECK(msg->token));
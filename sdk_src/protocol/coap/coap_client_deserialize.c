@@ -77,26 +77,27 @@ static int _coap_msg_check(CoAPMessage *msg)
 }
 
 /**
- *  @brief Allocate an option structure and add it to the end of an option linked-list structure
+ *  @brief Take an option structure from the msg pool and add it to the end of the option linked-list
  *
- *  @param[in,out] list Pointer to an option linked-list structure
+ *  @param[in,out] msg Pointer to a message structure
  *  @param[in] num Option number
  *  @param[in] len Option length
- *  @param[in] val Pointer to a buffer containing the option value
+ *  @param[in] val Pointer to the option value inside the receive buffer
  *
  *  @returns Operation status
  *  @retval 0 Success
  *  @retval <0 Error
  */
-static int _coap_msg_op_list_add_last(CoAPMsgOptionList *list, unsigned num, unsigned len, const char *val)
+static int _coap_msg_op_list_add_last(CoAPMessage *msg, unsigned num, unsigned len, const char *val)
 {
     IOT_FUNC_ENTRY
 
-    CoAPMsgOption *option = NULL;
+    CoAPMsgOptionList *list   = &msg->op_list;
+    CoAPMsgOption *    option = NULL;
 
-    if ((option = qcloud_iot_coap_option_init(num, len, val)) == NULL) {
-        Log_e("allocate new option failed.");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE)
+    if ((option = qcloud_iot_coap_option_init(msg, num, len, val)) == NULL) {
+        Log_e("too many options, max %d", COAP_MSG_MAX_OPTION_NUM);
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_COAP_DATA_SIZE)
     }
 
     if (list->first == NULL) {
@@ -216,7 +217,7 @@ static ssize_t _coap_message_deserialize_option(CoAPMessage *msg, char *buf, siz
         if (len < 1) {
             IOT_FUNC_EXIT_RC(QCLOUD_ERR_COAP_DATA_SIZE)
         }
-        op_delta += p[0];
+        op_delta += (unsigned char)p[0];
         p++;
         len--;
     } else if (op_delta == 14) {
@@ -231,7 +232,7 @@ static ssize_t _coap_message_deserialize_option(CoAPMessage *msg, char *buf, siz
         if (len < 1) {
             IOT_FUNC_EXIT_RC(QCLOUD_ERR_COAP_DATA_SIZE)
         }
-        op_len += p[0];
+        op_len += (unsigned char)p[0];
         p++;
         len--;
     } else if (op_len == 14) {
@@ -251,7 +252,7 @@ static ssize_t _coap_message_deserialize_option(CoAPMessage *msg, char *buf, siz
     } else {
         op_num = COAP_MSG_OPTION_NUM(prev) + op_delta;
     }
-    ret = _coap_msg_op_list_add_last(&msg->op_list, op_num, op_len, p);
+    ret = _coap_msg_op_list_add_last(msg, op_num, op_len, p);
     if (ret < 0) {
         IOT_FUNC_EXIT_RC(ret)
     }
@@ -322,13 +323,8 @@ static ssize_t _coap_message_deserialize_payload(CoAPMessage *msg, char *buf, si
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_COAP_DATA_SIZE)
     }
 
-    msg->pay_load = (char *)HAL_Malloc(len);
-
-    if (msg->pay_load == NULL) {
-        return -ENOMEM;
-    }
-
-    memcpy(msg->pay_load, p, len);
+    /* payload is the tail of the datagram, refer to it in place */
+    msg->pay_load     = p;
     msg->pay_load_len = len;
     p += len;
 
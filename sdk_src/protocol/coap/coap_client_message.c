@@ -23,6 +23,7 @@ extern "C" {
 #include "coap_client_net.h"
 #include "qcloud_iot_export.h"
 #include "qcloud_iot_import.h"
+#include "utils_mem.h"
 #include "utils_param_check.h"
 #include "utils_timer.h"
 
@@ -50,6 +51,13 @@ static void _event_message_type_set(CoAPEventMessage *eventMsg, CoAPMessage *mes
     }
 }
 
+static void _coap_message_list_remove(CoAPClient *client, CoAPMsgSendInfo *send_info)
+{
+    list_unlink(&client->message_list, &send_info->list);
+    utils_mem_free(send_info);
+    Log_i("remove node");
+}
+
 static int _coap_message_list_proc(CoAPClient *client, CoAPMessage *message, uint16_t processCmd)
 {
     IOT_FUNC_ENTRY;
@@ -57,40 +65,14 @@ static int _coap_message_list_proc(CoAPClient *client, CoAPMessage *message, uin
 
     HAL_MutexLock(client->lock_list_wait_ack);
 
-    if (client->message_list->len <= 0) {
+    if (client->message_list.len <= 0) {
         HAL_MutexUnlock(client->lock_list_wait_ack);
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
     }
 
-    ListIterator *   iter;
-    ListNode *       node      = NULL;
-    ListNode *       temp_node = NULL;
-    CoAPMsgSendInfo *send_info = NULL;
-
-    if ((iter = list_iterator_new(client->message_list, LIST_TAIL)) == NULL) {
-        HAL_MutexUnlock(client->lock_list_wait_ack);
-        IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
-    }
-
-    for (;;) {
-        node = list_iterator_next(iter);
-
-        if (NULL != temp_node) {
-            list_remove(client->message_list, temp_node);
-            Log_i("remove node");
-            temp_node = NULL;
-        }
-
-        if (NULL == node) {
-            break;
-        }
-
-        send_info = (CoAPMsgSendInfo *)node->val;
-        if (NULL == send_info) {
-            Log_e("node's value is invalid!");
-            continue;
-        }
-
+    CoAPMsgSendInfo *send_info, *next;
+    list_for_each_entry_safe(send_info, next, &client->message_list.head, list, CoAPMsgSendInfo)
+    {
         if (processCmd == PROCESS_ACK_CMD) {
             if (send_info->msg_id == message->msg_id) {
                 send_info->acked = 1; /* ACK is received */
@@ -139,7 +121,7 @@ static int _coap_message_list_proc(CoAPClient *client, CoAPMessage *message, uin
             }
         } else if (processCmd == PROCESS_WAIT_CMD) {
             if (COAP_NODE_STATE_INVALID == send_info->node_state) {
-                temp_node = node;
+                _coap_message_list_remove(client, send_info);
                 continue;
             }
 
@@ -161,7 +143,6 @@ static int _coap_message_list_proc(CoAPClient *client, CoAPMessage *message, uin
                 }
             } else {
                 send_info->node_state = COAP_NODE_STATE_INVALID;
-                temp_node             = node;
 
                 if (send_info->handler != NULL) {
                     message->type         = COAP_MSG_ACK;
@@ -183,12 +164,12 @@ static int _coap_message_list_proc(CoAPClient *client, CoAPMessage *message, uin
                     Log_e("nether response callback nor event callback is set");
                 }
 
+                _coap_message_list_remove(client, send_info);
                 continue;
             }
         }
     }
 
-    list_iterator_destroy(iter);
     HAL_MutexUnlock(client->lock_list_wait_ack);
 
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
@@ -289,10 +270,6 @@ static void _coap_message_handle(CoAPClient *client, unsigned char *buf, unsigne
         Log_e("not recgonized recv message type");
     }
 
-    if (recv_message.pay_load != NULL) {
-        HAL_Free(recv_message.pay_load);
-        recv_message.pay_load_len = 0;
-    }
 
     IOT_FUNC_EXIT
 }
@@ -301,7 +278,9 @@ static int _coap_message_list_add(CoAPClient *client, CoAPMessage *message, int
 {
     IOT_FUNC_ENTRY
 
-    CoAPMsgSendInfo *send_info = (CoAPMsgSendInfo *)HAL_Malloc(sizeof(CoAPMsgSendInfo));
+    /* one block holds the send info followed by the serialized msg kept for retransmission,
+     * it is released as a whole once removed from message_list */
+    CoAPMsgSendInfo *send_info = (CoAPMsgSendInfo *)utils_mem_alloc(MEM_TAG_COAP, sizeof(CoAPMsgSendInfo) + len);
     if (send_info == NULL) {
         Log_e("no memory to malloc SendInfo");
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE)
@@ -323,20 +302,11 @@ static int _coap_message_list_add(CoAPClient *client, CoAPMessage *message, int
 
     send_info->token_len = message->token_len;
     memcpy(send_info->token, message->token, message->token_len);
-    send_info->message = (unsigned char *)HAL_Malloc(len);
-
-    if (NULL != send_info->message) {
-        memcpy(send_info->message, client->send_buf, len);
-    }
-
-    ListNode *node = list_node_new(send_info);
-    if (NULL == node) {
-        Log_e("run list_node_new is error!");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE)
-    }
+    send_info->message = (unsigned char *)(send_info + 1);
+    memcpy(send_info->message, client->send_buf, len);
 
     HAL_MutexLock(client->lock_list_wait_ack);
-    list_rpush(client->message_list, node);
+    list_push(&client->message_list, &send_info->list);
     HAL_MutexUnlock(client->lock_list_wait_ack);
 
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS)
@@ -398,10 +368,12 @@ ssize_t coap_message_recv(CoAPClient *client, uint32_t timeout_ms)
     size_t read_lean = 0;
     int    rc        = 0;
 
-    rc = client->network_stack.read(&client->network_stack, client->recv_buf, client->read_buf_size, timeout_ms,
+    /* keep one byte to NUL terminate the datagram, the payload view then reads as a string */
+    rc = client->network_stack.read(&client->network_stack, client->recv_buf, client->read_buf_size - 1, timeout_ms,
                                     &read_lean);
     switch (rc) {
         case QCLOUD_RET_SUCCESS:
+            client->recv_buf[read_lean] = '\0';
             _coap_message_handle(client, client->recv_buf, read_lean);
             break;
         case QCLOUD_ERR_SSL_READ_TIMEOUT:
@@ -0,0 +1,389 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "utils_http_parser.h"
+
+#include <string.h>
+
+#include "qcloud_iot_export_error.h"
+
+/* sub states of status line */
+#define HTTP_STATUS_SUB_VERSION    5 /* 0~4: matching "HTTP/" */
+#define HTTP_STATUS_SUB_CODE_SPACE 6
+#define HTTP_STATUS_SUB_CODE       7
+#define HTTP_STATUS_SUB_REASON     8
+
+/* header names we care about, bit index is the header id */
+#define HTTP_HEADER_NONE              0
+#define HTTP_HEADER_CONTENT_LENGTH    1
+#define HTTP_HEADER_TRANSFER_ENCODING 2
+#define HTTP_HEADER_ALL               ((1 << HTTP_HEADER_CONTENT_LENGTH) | (1 << HTTP_HEADER_TRANSFER_ENCODING))
+
+#define HTTP_CHUNKED_TOKEN     "chunked"
+#define HTTP_CHUNKED_TOKEN_LEN (sizeof(HTTP_CHUNKED_TOKEN) - 1)
+
+static const char *sg_header_names[] = {NULL, "content-length", "transfer-encoding"};
+
+static char _http_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static int _http_hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c = _http_lower(c);
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+static int _http_parser_fail(HTTPParser *parser)
+{
+    parser->state = HTTP_PARSER_STATE_ERROR;
+    return QCLOUD_ERR_HTTP_PRTCL;
+}
+
+static void _http_parser_next_header(HTTPParser *parser)
+{
+    parser->state         = HTTP_PARSER_STATE_HEADER_NAME;
+    parser->sub_state     = 0;
+    parser->header_id     = HTTP_HEADER_ALL;
+    parser->line_empty    = true;
+    parser->value_started = false;
+}
+
+static void _http_parser_next_chunk(HTTPParser *parser)
+{
+    parser->state         = HTTP_PARSER_STATE_CHUNK_SIZE;
+    parser->body_left     = 0;
+    parser->value_started = false;
+}
+
+static void _http_parser_headers_done(HTTPParser *parser)
+{
+    int code = parser->status_code;
+
+    /* these responses never carry a body */
+    if ((code >= 100 && code < 200) || code == 204 || code == 304) {
+        parser->state = HTTP_PARSER_STATE_DONE;
+    } else if (parser->is_chunked) {
+        parser->content_len = 0;
+        _http_parser_next_chunk(parser);
+    } else if (parser->has_content_len) {
+        parser->body_left = parser->content_len;
+        parser->state     = parser->content_len ? HTTP_PARSER_STATE_BODY : HTTP_PARSER_STATE_DONE;
+    } else {
+        parser->state = HTTP_PARSER_STATE_BODY_UNTIL_CLOSE;
+    }
+}
+
+static int _http_parser_status_line(HTTPParser *parser, char c)
+{
+    if (parser->sub_state < HTTP_STATUS_SUB_VERSION) {
+        if (c != "HTTP/"[parser->sub_state])
+            return _http_parser_fail(parser);
+        parser->sub_state++;
+    } else if (parser->sub_state == HTTP_STATUS_SUB_VERSION) {
+        if (c == ' ')
+            parser->sub_state = HTTP_STATUS_SUB_CODE_SPACE;
+        else if ((c < '0' || c > '9') && c != '.')
+            return _http_parser_fail(parser);
+    } else if (parser->sub_state == HTTP_STATUS_SUB_CODE_SPACE || parser->sub_state == HTTP_STATUS_SUB_CODE) {
+        if (c >= '0' && c <= '9') {
+            if (parser->status_code >= 100)
+                return _http_parser_fail(parser);
+            parser->status_code = parser->status_code * 10 + (c - '0');
+            parser->sub_state   = HTTP_STATUS_SUB_CODE;
+        } else if (c == ' ' && parser->sub_state == HTTP_STATUS_SUB_CODE_SPACE) {
+            /* tolerate extra spaces before status code */
+        } else if (parser->sub_state == HTTP_STATUS_SUB_CODE && (c == ' ' || c == '\r' || c == '\n')) {
+            if (parser->status_code < 100)
+                return _http_parser_fail(parser);
+            parser->sub_state = HTTP_STATUS_SUB_REASON;
+            if (c == '\n')
+                _http_parser_next_header(parser);
+        } else {
+            return _http_parser_fail(parser);
+        }
+    } else if (c == '\n') {
+        _http_parser_next_header(parser);
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+static int _http_parser_header_name(HTTPParser *parser, char c)
+{
+    int id;
+
+    if (c == '\r')
+        return QCLOUD_RET_SUCCESS;
+
+    if (c == '\n') {
+        if (!parser->line_empty)
+            return _http_parser_fail(parser);
+        _http_parser_headers_done(parser);
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    parser->line_empty = false;
+
+    if (c == ':') {
+        uint8_t mask      = parser->header_id;
+        parser->header_id = HTTP_HEADER_NONE;
+        for (id = HTTP_HEADER_CONTENT_LENGTH; id <= HTTP_HEADER_TRANSFER_ENCODING; id++) {
+            if ((mask & (1 << id)) && sg_header_names[id][parser->sub_state] == '\0') {
+                parser->header_id = id;
+            }
+        }
+        parser->state         = HTTP_PARSER_STATE_HEADER_VALUE;
+        parser->sub_state     = 0;
+        parser->value_started = false;
+        if (parser->header_id == HTTP_HEADER_CONTENT_LENGTH) {
+            parser->has_content_len = true;
+            parser->content_len     = 0;
+        }
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    for (id = HTTP_HEADER_CONTENT_LENGTH; id <= HTTP_HEADER_TRANSFER_ENCODING; id++) {
+        if ((parser->header_id & (1 << id)) && sg_header_names[id][parser->sub_state] != _http_lower(c)) {
+            parser->header_id &= ~(1 << id);
+        }
+    }
+    if (parser->header_id)
+        parser->sub_state++;
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+static int _http_parser_header_value(HTTPParser *parser, char c)
+{
+    if (c == '\r')
+        return QCLOUD_RET_SUCCESS;
+
+    if (c == '\n') {
+        if (parser->header_id == HTTP_HEADER_CONTENT_LENGTH && !parser->value_started)
+            return _http_parser_fail(parser);
+        if (parser->header_id == HTTP_HEADER_TRANSFER_ENCODING)
+            parser->is_chunked = (parser->sub_state == HTTP_CHUNKED_TOKEN_LEN);
+        _http_parser_next_header(parser);
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    if (parser->header_id == HTTP_HEADER_CONTENT_LENGTH) {
+        if (c >= '0' && c <= '9') {
+            if (parser->content_len > (UINT32_MAX - (uint32_t)(c - '0')) / 10)
+                return _http_parser_fail(parser);
+            parser->content_len   = parser->content_len * 10 + (c - '0');
+            parser->value_started = true;
+        } else if (c != ' ' && c != '\t') {
+            return _http_parser_fail(parser);
+        }
+    } else if (parser->header_id == HTTP_HEADER_TRANSFER_ENCODING) {
+        /* "chunked" has to be the last coding in the list */
+        if (parser->sub_state == HTTP_CHUNKED_TOKEN_LEN && (c == ' ' || c == '\t')) {
+            return QCLOUD_RET_SUCCESS;
+        }
+        if (parser->sub_state < HTTP_CHUNKED_TOKEN_LEN && _http_lower(c) == HTTP_CHUNKED_TOKEN[parser->sub_state]) {
+            parser->sub_state++;
+        } else {
+            parser->sub_state = (_http_lower(c) == HTTP_CHUNKED_TOKEN[0]) ? 1 : 0;
+        }
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+static int _http_parser_chunk_size(HTTPParser *parser, char c)
+{
+    int v;
+
+    if (c == '\r')
+        return QCLOUD_RET_SUCCESS;
+
+    if (c == '\n') {
+        if (!parser->value_started)
+            return _http_parser_fail(parser);
+        if (parser->body_left == 0) {
+            parser->state      = HTTP_PARSER_STATE_TRAILER;
+            parser->line_empty = true;
+            return QCLOUD_RET_SUCCESS;
+        }
+        if (parser->content_len > UINT32_MAX - parser->body_left)
+            return _http_parser_fail(parser);
+        parser->content_len += parser->body_left;
+        parser->state = HTTP_PARSER_STATE_CHUNK_DATA;
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    if (parser->state == HTTP_PARSER_STATE_CHUNK_EXT)
+        return QCLOUD_RET_SUCCESS;
+
+    if (c == ';') {
+        parser->state = HTTP_PARSER_STATE_CHUNK_EXT;
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    if (c == ' ' || c == '\t')
+        return QCLOUD_RET_SUCCESS;
+
+    v = _http_hex_value(c);
+    if (v < 0 || parser->body_left > (UINT32_MAX >> 4))
+        return _http_parser_fail(parser);
+
+    parser->body_left     = (parser->body_left << 4) | (uint32_t)v;
+    parser->value_started = true;
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+void qcloud_http_parser_init(HTTPParser *parser)
+{
+    memset(parser, 0, sizeof(HTTPParser));
+    parser->state = HTTP_PARSER_STATE_STATUS_LINE;
+}
+
+int qcloud_http_parser_execute(HTTPParser *parser, const char *data, size_t len, const char **body,
+                               size_t *body_len)
+{
+    size_t pos = 0;
+    size_t span;
+    int    rc;
+
+    *body     = NULL;
+    *body_len = 0;
+
+    while (pos < len) {
+        char c = data[pos];
+
+        switch (parser->state) {
+            case HTTP_PARSER_STATE_STATUS_LINE:
+                rc = _http_parser_status_line(parser, c);
+                break;
+
+            case HTTP_PARSER_STATE_HEADER_NAME:
+                rc = _http_parser_header_name(parser, c);
+                if (rc == QCLOUD_RET_SUCCESS && qcloud_http_parser_headers_complete(parser)) {
+                    /* give the caller a chance to look at status and headers before any body */
+                    return (int)(pos + 1);
+                }
+                break;
+
+            case HTTP_PARSER_STATE_HEADER_VALUE:
+                rc = _http_parser_header_value(parser, c);
+                break;
+
+            case HTTP_PARSER_STATE_CHUNK_SIZE:
+            case HTTP_PARSER_STATE_CHUNK_EXT:
+                rc = _http_parser_chunk_size(parser, c);
+                break;
+
+            case HTTP_PARSER_STATE_CHUNK_DATA_END:
+                if (c == '\n') {
+                    _http_parser_next_chunk(parser);
+                } else if (c != '\r') {
+                    return _http_parser_fail(parser);
+                }
+                rc = QCLOUD_RET_SUCCESS;
+                break;
+
+            case HTTP_PARSER_STATE_TRAILER:
+                if (c == '\n') {
+                    if (parser->line_empty) {
+                        parser->state = HTTP_PARSER_STATE_DONE;
+                        return (int)(pos + 1);
+                    }
+                    parser->line_empty = true;
+                } else if (c != '\r') {
+                    parser->line_empty = false;
+                }
+                rc = QCLOUD_RET_SUCCESS;
+                break;
+
+            case HTTP_PARSER_STATE_BODY:
+            case HTTP_PARSER_STATE_CHUNK_DATA:
+                span = len - pos;
+                if (span > parser->body_left)
+                    span = parser->body_left;
+                parser->body_left -= span;
+                parser->body_recv += span;
+                *body     = data + pos;
+                *body_len = span;
+                if (parser->body_left == 0) {
+                    parser->state = (parser->state == HTTP_PARSER_STATE_BODY) ? HTTP_PARSER_STATE_DONE
+                                                                              : HTTP_PARSER_STATE_CHUNK_DATA_END;
+                }
+                return (int)(pos + span);
+
+            case HTTP_PARSER_STATE_BODY_UNTIL_CLOSE:
+                span = len - pos;
+                parser->body_recv += span;
+                *body     = data + pos;
+                *body_len = span;
+                return (int)len;
+
+            case HTTP_PARSER_STATE_DONE:
+                return (int)pos;
+
+            default:
+                return QCLOUD_ERR_HTTP_PRTCL;
+        }
+
+        if (rc != QCLOUD_RET_SUCCESS)
+            return rc;
+
+        pos++;
+    }
+
+    return (int)pos;
+}
+
+int qcloud_http_parser_finish(HTTPParser *parser)
+{
+    if (parser->state == HTTP_PARSER_STATE_BODY_UNTIL_CLOSE) {
+        parser->state = HTTP_PARSER_STATE_DONE;
+    }
+
+    return (parser->state == HTTP_PARSER_STATE_DONE) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_HTTP_CLOSED;
+}
+
+bool qcloud_http_parser_headers_complete(const HTTPParser *parser)
+{
+    return parser->state >= HTTP_PARSER_STATE_BODY && parser->state != HTTP_PARSER_STATE_ERROR;
+}
+
+bool qcloud_http_parser_is_done(const HTTPParser *parser)
+{
+    return parser->state == HTTP_PARSER_STATE_DONE;
+}
+
+uint32_t qcloud_http_parser_body_left(const HTTPParser *parser)
+{
+    if (parser->state == HTTP_PARSER_STATE_BODY || parser->state == HTTP_PARSER_STATE_CHUNK_DATA)
+        return parser->body_left;
+
+    return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -33,7 +33,6 @@ extern "C" {
 
 #define HTTP_CLIENT_AUTHB_SIZE 128
 
-#define HTTP_CLIENT_CHUNK_SIZE    1025
 #define HTTP_CLIENT_SEND_BUF_SIZE 1024
 
 #define HTTP_CLIENT_MAX_HOST_LEN 64
@@ -319,31 +318,23 @@ static int _http_client_send_userdata(HTTPClient *client, HTTPClientData *client
     return QCLOUD_RET_SUCCESS;
 }
 
-static int _http_client_recv(HTTPClient *client, char *buf, int min_len, int max_len, int *p_read_len,
-                             uint32_t timeout_ms, HTTPClientData *client_data)
+static int _http_client_recv(HTTPClient *client, char *buf, int max_len, int *p_read_len, uint32_t timeout_ms)
 {
     IOT_FUNC_ENTRY;
 
-    int    rc = 0;
-    Timer  timer;
+    int    rc        = 0;
     size_t recv_size = 0;
 
-    InitTimer(&timer);
-    countdown_ms(&timer, (unsigned int)timeout_ms);
-
     *p_read_len = 0;
 
-    rc = client->network_stack.read(&client->network_stack, (unsigned char *)buf, max_len, (uint32_t)left_ms(&timer),
-                                    &recv_size);
+    rc = client->network_stack.read(&client->network_stack, (unsigned char *)buf, max_len, timeout_ms, &recv_size);
     *p_read_len = (int)recv_size;
     if (rc == QCLOUD_ERR_SSL_NOTHING_TO_READ || rc == QCLOUD_ERR_TCP_NOTHING_TO_READ) {
         Log_d("HTTP read nothing and timeout");
         rc = QCLOUD_RET_SUCCESS;
     } else if (rc == QCLOUD_ERR_SSL_READ_TIMEOUT || rc == QCLOUD_ERR_TCP_READ_TIMEOUT) {
-        if (*p_read_len == client_data->retrieve_len || client_data->retrieve_len == 0)
-            rc = QCLOUD_RET_SUCCESS;
-        else
-            Log_e("network_stack read timeout");
+        /* partial data is fine, the parser knows whether more is needed */
+        rc = QCLOUD_RET_SUCCESS;
     } else if (rc == QCLOUD_ERR_TCP_PEER_SHUTDOWN && *p_read_len > 0) {
         /* HTTP server give response and close this connection */
         client->network_stack.disconnect(&client->network_stack);
@@ -356,271 +347,184 @@ static int _http_client_recv(HTTPClient *client, char *buf, int min_len, int max
     IOT_FUNC_EXIT_RC(rc);
 }
 
-static int _http_client_retrieve_content(HTTPClient *client, char *data, int len, uint32_t timeout_ms,
-                                         HTTPClientData *client_data)
+/* keep what was read past the end of a response, it is the start of the next one when requests are pipelined */
+static int _http_client_pending_save(HTTPClient *client, const char *data, int len)
 {
-    IOT_FUNC_ENTRY;
-
-    int   count   = 0;
-    int   templen = 0;
-    int   crlf_pos;
-    Timer timer;
+    char *pending = HAL_Malloc(len + client->pending_len);
 
-    InitTimer(&timer);
-    countdown_ms(&timer, (unsigned int)timeout_ms);
-
-    client_data->is_more = IOT_TRUE;
-
-    if (client_data->response_content_len == -1 && client_data->is_chunked == IOT_FALSE) {
-        while (1) {
-            int rc, max_len;
-            if (count + len < client_data->response_buf_len - 1) {
-                memcpy(client_data->response_buf + count, data, len);
-                count += len;
-                client_data->response_buf[count] = '\0';
-            } else {
-                memcpy(client_data->response_buf + count, data, client_data->response_buf_len - 1 - count);
-                client_data->response_buf[client_data->response_buf_len - 1] = '\0';
-                return HTTP_RETRIEVE_MORE_DATA;
-            }
+    if (NULL == pending) {
+        Log_e("malloc pending response data failed");
+        return QCLOUD_ERR_MALLOC;
+    }
 
-            max_len = HTTP_CLIENT_MIN(HTTP_CLIENT_CHUNK_SIZE - 1, client_data->response_buf_len - 1 - count);
-            rc      = _http_client_recv(client, data, 1, max_len, &len, (uint32_t)left_ms(&timer), client_data);
+    /* bytes still pending come after the ones just read from them */
+    memcpy(pending, data, len);
+    if (client->pending_len) {
+        memcpy(pending + len, client->pending, client->pending_len);
+        HAL_Free(client->pending);
+    }
+    client->pending = pending;
+    client->pending_len += len;
 
-            /* Receive data */
-            // Log_d("data len: %d %d", len, count);
+    return QCLOUD_RET_SUCCESS;
+}
 
-            if (rc != QCLOUD_RET_SUCCESS) {
-                IOT_FUNC_EXIT_RC(rc);
-            }
-            if (0 >= left_ms(&timer)) {
-                Log_e("HTTP read timeout!");
-                IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP_TIMEOUT);
-            }
+static int _http_client_pending_take(HTTPClient *client, char *buf, int max_len)
+{
+    int len = HTTP_CLIENT_MIN(max_len, client->pending_len);
 
-            if (len == 0) {
-                /* read no more data */
-                Log_d("no more data, len == 0");
-                client_data->is_more = IOT_FALSE;
-                IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
-            }
-        }
+    memcpy(buf, client->pending, len);
+    client->pending_len -= len;
+    if (client->pending_len) {
+        memmove(client->pending, client->pending + len, client->pending_len);
+    } else {
+        HAL_Free(client->pending);
+        client->pending = NULL;
     }
 
-    while (1) {
-        uint32_t readLen = 0;
-        if (client_data->is_chunked && client_data->retrieve_len <= 0) {
-            /* Read chunk header */
-            bool foundCrlf;
-            int  n;
-            do {
-                foundCrlf = IOT_FALSE;
-                crlf_pos  = 0;
-                data[len] = 0;
-                if (len >= 2) {
-                    for (; crlf_pos < len - 2; crlf_pos++) {
-                        if (data[crlf_pos] == '\r' && data[crlf_pos + 1] == '\n') {
-                            foundCrlf = IOT_TRUE;
-                            break;
-                        }
-                    }
-                }
-                if (!foundCrlf) {
-                    /* Try to read more */
-                    if (len < HTTP_CLIENT_CHUNK_SIZE) {
-                        int new_trf_len, rc;
-                        rc = _http_client_recv(client, data + len, 0, HTTP_CLIENT_CHUNK_SIZE - len - 1, &new_trf_len,
-                                               left_ms(&timer), client_data);
-                        len += new_trf_len;
-                        if ((rc != QCLOUD_RET_SUCCESS) || (0 >= left_ms(&timer))) {
-                            Log_w("_http_client_recv ret: %d, left_time: %d", rc, left_ms(&timer));
-                            IOT_FUNC_EXIT_RC(rc);
-                        } else {
-                            continue;
-                        }
-                    } else {
-                        IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP);
-                    }
-                }
-            } while (!foundCrlf);
-            data[crlf_pos] = '\0';
-
-            // n = sscanf(data, "%x", &readLen);/* chunk length */
-            readLen                   = strtoul(data, NULL, 16);
-            n                         = (0 == readLen) ? 0 : 1;
-            client_data->retrieve_len = readLen;
-            client_data->response_content_len += client_data->retrieve_len;
-            if (readLen == 0) {
-                client_data->is_more = IOT_FALSE;
-                Log_d("no more (last chunk)");
-            }
-
-            if (n != 1) {
-                Log_e("Could not read chunk length");
-                return QCLOUD_ERR_HTTP_UNRESOLVED_DNS;
-            }
+    return len;
+}
 
-            memmove(data, &data[crlf_pos + 2], len - (crlf_pos + 2));
-            len -= (crlf_pos + 2);
+static int _http_client_check_response_code(HTTPClient *client)
+{
+    if ((client->response_code < 200) || (client->response_code >= 400)) {
+        Log_w("Response code %d", client->response_code);
 
-        } else {
-            readLen = client_data->retrieve_len;
-        }
+        if (client->response_code == 403)
+            return QCLOUD_ERR_HTTP_AUTH;
 
-        do {
-            templen = HTTP_CLIENT_MIN(len, readLen);
-            if (count + templen < client_data->response_buf_len - 1) {
-                memcpy(client_data->response_buf + count, data, templen);
-                count += templen;
-                client_data->response_buf[count] = '\0';
-                client_data->retrieve_len -= templen;
-            } else {
-                memcpy(client_data->response_buf + count, data, client_data->response_buf_len - 1 - count);
-                client_data->response_buf[client_data->response_buf_len - 1] = '\0';
-                client_data->retrieve_len -= (client_data->response_buf_len - 1 - count);
-                IOT_FUNC_EXIT_RC(HTTP_RETRIEVE_MORE_DATA);
-            }
+        if (client->response_code == 404)
+            return QCLOUD_ERR_HTTP_NOT_FOUND;
+    }
 
-            if (len > readLen) {
-                Log_d("memmove %d %d %d\n", readLen, len, client_data->retrieve_len);
-                memmove(data, &data[readLen], len - readLen); /* chunk case, read between two chunks */
-                len -= readLen;
-                readLen                   = 0;
-                client_data->retrieve_len = 0;
-            } else {
-                readLen -= len;
-            }
+    return QCLOUD_RET_SUCCESS;
+}
 
-            if (readLen) {
-                int rc;
-                int max_len = HTTP_CLIENT_MIN(HTTP_CLIENT_CHUNK_SIZE - 1, client_data->response_buf_len - 1 - count);
-                max_len     = HTTP_CLIENT_MIN(max_len, readLen);
-                rc          = _http_client_recv(client, data, 1, max_len, &len, left_ms(&timer), client_data);
-                if (rc != QCLOUD_RET_SUCCESS) {
-                    Log_w("_http_client_recv ret: %d, left_time: %d", rc, left_ms(&timer));
-                    IOT_FUNC_EXIT_RC(rc);
-                }
-                if (left_ms(&timer) <= 0) {
-                    Log_e("HTTP read timeout!");
-                    IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP_TIMEOUT);
-                }
-            }
-        } while (readLen);
-
-        if (client_data->is_chunked) {
-            if (len < 2) {
-                int new_trf_len, rc;
-                /* Read missing chars to find end of chunk */
-                rc = _http_client_recv(client, data + len, 2 - len, HTTP_CLIENT_CHUNK_SIZE - len - 1, &new_trf_len,
-                                       left_ms(&timer), client_data);
-                if ((rc != QCLOUD_RET_SUCCESS) || (0 >= left_ms(&timer))) {
-                    Log_w("_http_client_recv ret: %d, left_time: %d", rc, left_ms(&timer));
-                    IOT_FUNC_EXIT_RC(rc);
-                }
-                len += new_trf_len;
-            }
+static void _http_client_update_data(HTTPClientData *client_data)
+{
+    HTTPParser *parser = &client_data->parser;
 
-            if ((data[0] != '\r') || (data[1] != '\n')) {
-                Log_e("Format error, %s", data); /* after memmove, the beginning of next chunk */
-                IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP_UNRESOLVED_DNS);
-            }
-            memmove(data, &data[2], len - 2); /* remove the \r\n */
-            len -= 2;
-        } else {
-            // Log_d("no more (content-length)");
-            client_data->is_more = IOT_FALSE;
-            break;
-        }
+    client_data->is_chunked = parser->is_chunked;
+    if (parser->is_chunked || parser->has_content_len) {
+        client_data->response_content_len = parser->content_len;
+        client_data->retrieve_len         = parser->content_len - parser->body_recv;
+    } else {
+        /* body ends with connection close, length is only known up to now */
+        client_data->response_content_len = parser->body_recv;
+        client_data->retrieve_len         = 0;
     }
-
-    IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
-static int _http_client_response_parse(HTTPClient *client, char *data, int len, uint32_t timeout_ms,
-                                       HTTPClientData *client_data)
+/**
+ * Read from network straight into the free tail of response_buf and let the
+ * parser pick the body out of it in place. Content-Length bodies are never
+ * moved after being read; for chunked bodies only the chunk payload is shifted
+ * down over the consumed framing bytes.
+ */
+static int _http_client_retrieve_content(HTTPClient *client, uint32_t timeout_ms, HTTPClientData *client_data)
 {
     IOT_FUNC_ENTRY;
 
-    int   crlf_pos;
-    Timer timer;
-    char *tmp_ptr, *ptr_body_end;
+    HTTPParser *parser = &client_data->parser;
+    char *      buf    = client_data->response_buf;
+    int         cap    = client_data->response_buf_len - 1;
+    int         count  = 0;
+    int         rc     = QCLOUD_RET_SUCCESS;
+    Timer       timer;
 
     InitTimer(&timer);
-    countdown_ms(&timer, timeout_ms);
-
-    client_data->response_content_len = -1;
+    countdown_ms(&timer, (unsigned int)timeout_ms);
 
-    char *crlf_ptr = strstr(data, "\r\n");
-    if (crlf_ptr == NULL) {
-        Log_e("\\r\\n not found");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP_UNRESOLVED_DNS);
-    }
+    buf[0] = '\0';
 
-    crlf_pos       = crlf_ptr - data;
-    data[crlf_pos] = '\0';
+    while (!qcloud_http_parser_is_done(parser)) {
+        int      len, want;
+        uint32_t body_left;
+        char *   pos;
 
-#if 0
-    if (sscanf(data, "HTTP/%*d.%*d %d %*[^\r\n]", &(client->response_code)) != 1) {
-        Log_e("Not a correct HTTP answer : %s\n", data);
-        return QCLOUD_ERR_HTTP_UNRESOLVED_DNS;
-    }
-#endif
+        if (count >= cap) {
+            _http_client_update_data(client_data);
+            IOT_FUNC_EXIT_RC(HTTP_RETRIEVE_MORE_DATA);
+        }
 
-    client->response_code = atoi(data + 9);
+        if (0 == client->pending_len && 0 == client->network_stack.handle) {
+            /* connection closed by server after last read */
+            rc = qcloud_http_parser_finish(parser);
+            break;
+        }
 
-    if ((client->response_code < 200) || (client->response_code >= 400)) {
-        Log_w("Response code %d", client->response_code);
+        want      = cap - count;
+        body_left = qcloud_http_parser_body_left(parser);
+        if (body_left && body_left < (uint32_t)want) {
+            want = (int)body_left;
+        }
 
-        if (client->response_code == 403)
-            IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP_AUTH);
+        if (client->pending_len) {
+            len = _http_client_pending_take(client, buf + count, want);
+        } else {
+            rc = _http_client_recv(client, buf + count, want, &len, (uint32_t)left_ms(&timer));
+            if (rc == QCLOUD_ERR_TCP_PEER_SHUTDOWN) {
+                rc = qcloud_http_parser_finish(parser);
+                break;
+            }
+            if (rc != QCLOUD_RET_SUCCESS) {
+                IOT_FUNC_EXIT_RC(rc);
+            }
+        }
 
-        if (client->response_code == 404)
-            IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP_NOT_FOUND);
-    }
+        pos = buf + count;
+        while (len > 0) {
+            const char *body;
+            size_t      body_len;
+            bool        had_headers = qcloud_http_parser_headers_complete(parser);
 
-    // Log_d("Reading headers : %s", data);
+            int used = qcloud_http_parser_execute(parser, pos, len, &body, &body_len);
+            if (used < 0) {
+                Log_e("HTTP response parse error");
+                IOT_FUNC_EXIT_RC(used);
+            }
 
-    // remove null character
-    memmove(data, &data[crlf_pos + 2], len - (crlf_pos + 2) + 1);
-    len -= (crlf_pos + 2);
+            if (body_len) {
+                if (body != buf + count) {
+                    memmove(buf + count, body, body_len);
+                }
+                count += body_len;
+            }
+            pos += used;
+            len -= used;
 
-    client_data->is_chunked = IOT_FALSE;
+            if (!had_headers && qcloud_http_parser_headers_complete(parser)) {
+                client->response_code = parser->status_code;
+                rc                    = _http_client_check_response_code(client);
+                if (rc != QCLOUD_RET_SUCCESS) {
+                    IOT_FUNC_EXIT_RC(rc);
+                }
+            }
 
-    if (NULL == (ptr_body_end = strstr(data, "\r\n\r\n"))) {
-        int new_trf_len, rc;
-        rc = _http_client_recv(client, data + len, 1, HTTP_CLIENT_CHUNK_SIZE - len - 1, &new_trf_len, left_ms(&timer),
-                               client_data);
-        if (rc != QCLOUD_RET_SUCCESS) {
-            IOT_FUNC_EXIT_RC(rc);
+            if (used == 0) {
+                /* response complete, anything left belongs to the next pipelined request */
+                rc = _http_client_pending_save(client, pos, len);
+                if (rc != QCLOUD_RET_SUCCESS) {
+                    IOT_FUNC_EXIT_RC(rc);
+                }
+                break;
+            }
         }
-        len += new_trf_len;
-        data[len] = '\0';
-        if (NULL == (ptr_body_end = strstr(data, "\r\n\r\n"))) {
-            Log_e("parse error: no end of the request body");
-            IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
+        buf[count] = '\0';
+
+        if (!qcloud_http_parser_is_done(parser) && left_ms(&timer) <= 0) {
+            Log_e("HTTP read timeout!");
+            _http_client_update_data(client_data);
+            IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP_TIMEOUT);
         }
     }
 
-    if (NULL != (tmp_ptr = strstr(data, "Content-Length"))) {
-        client_data->response_content_len = atoi(tmp_ptr + strlen("Content-Length: "));
-        client_data->retrieve_len         = client_data->response_content_len;
-    } else if (NULL != (tmp_ptr = strstr(data, "Transfer-Encoding"))) {
-        int   len_chunk   = strlen("Chunked");
-        char *chunk_value = data + strlen("Transfer-Encoding: ");
-
-        if ((!memcmp(chunk_value, "Chunked", len_chunk)) || (!memcmp(chunk_value, "chunked", len_chunk))) {
-            client_data->is_chunked           = IOT_TRUE;
-            client_data->response_content_len = 0;
-            client_data->retrieve_len         = 0;
-        }
-    } else {
-        Log_e("Could not parse header");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP);
+    buf[count] = '\0';
+    _http_client_update_data(client_data);
+    if (rc == QCLOUD_RET_SUCCESS) {
+        client_data->is_more = IOT_FALSE;
     }
 
-    len = len - (ptr_body_end + 4 - data);
-    memmove(data, ptr_body_end + 4, len + 1);
-    int rc = _http_client_retrieve_content(client, data, len, left_ms(&timer), client_data);
     IOT_FUNC_EXIT_RC(rc);
 }
 
@@ -655,40 +559,25 @@ static int _http_client_recv_response(HTTPClient *client, uint32_t timeout_ms, H
 {
     IOT_FUNC_ENTRY;
 
-    int   reclen = 0, rc = QCLOUD_ERR_HTTP_CONN;
-    char  buf[HTTP_CLIENT_CHUNK_SIZE] = {0};
-    Timer timer;
-
-    InitTimer(&timer);
-    countdown_ms(&timer, timeout_ms);
+    int rc = QCLOUD_ERR_HTTP_CONN;
 
-    if (0 == client->network_stack.handle) {
+    /* a response read ahead before the server closed can still be served */
+    if (0 == client->network_stack.handle && 0 == client->pending_len) {
         Log_e("Connection has not been established");
         IOT_FUNC_EXIT_RC(rc);
     }
 
-    if (client_data->is_more) {
-        client_data->response_buf[0] = '\0';
-        rc                           = _http_client_retrieve_content(client, buf, reclen, left_ms(&timer), client_data);
-    } else {
-        client_data->is_more = IOT_TRUE;
-        rc = _http_client_recv(client, buf, 1, HTTP_CLIENT_CHUNK_SIZE - 1, &reclen, left_ms(&timer), client_data);
-
-        if (rc != QCLOUD_RET_SUCCESS) {
-            IOT_FUNC_EXIT_RC(rc);
-        }
-        // else if(0 == left_ms(&timer)){
-        //  IOT_FUNC_EXIT_RC(QCLOUD_ERR_HTTP_TIMEOUT);
-        //}
-
-        buf[reclen] = '\0';
-
-        if (reclen) {
-            // HAL_Printf("RESPONSE:\n%s", buf);
-            rc = _http_client_response_parse(client, buf, reclen, left_ms(&timer), client_data);
-        }
+    if (!client_data->is_more) {
+        /* start of a new response */
+        qcloud_http_parser_init(&client_data->parser);
+        client_data->is_more              = IOT_TRUE;
+        client_data->is_chunked           = IOT_FALSE;
+        client_data->response_content_len = -1;
+        client_data->retrieve_len         = 0;
     }
 
+    rc = _http_client_retrieve_content(client, timeout_ms, client_data);
+
     IOT_FUNC_EXIT_RC(rc);
 }
 
@@ -751,6 +640,13 @@ void qcloud_http_client_close(HTTPClient *client)
     if (client->network_stack.handle != 0) {
         client->network_stack.disconnect(&client->network_stack);
     }
+
+    /* pipelined responses are lost with the connection */
+    if (client->pending) {
+        HAL_Free(client->pending);
+        client->pending = NULL;
+    }
+    client->pending_len = 0;
 }
 
 int qcloud_http_client_common(HTTPClient *client, const char *url, int port, const char *ca_crt, HttpMethod method,
@@ -34,6 +34,7 @@ extern "C" {
 #include "qcloud_iot_import.h"
 #include "utils_base64.h"
 #include "utils_list.h"
+#include "utils_mem.h"
 
 static uint16_t _get_random_start_packet_id(void)
 {
@@ -83,6 +84,18 @@ void *IOT_MQTT_Construct(MQTTInitParams *pParams)
     connect_params.keep_alive_interval = Min(pParams->keep_alive_interval_ms / 1000, 690);
     connect_params.clean_session       = pParams->clean_session;
     connect_params.auto_connect_enable = pParams->auto_connect_enable;
+#ifdef MQTT5_ENABLED
+    if (MQTT_5_0 == pParams->mqtt_version) {
+        connect_params.mqtt_version = MQTT_5_0;
+    }
+#endif
+    if (pParams->mqtt_version && pParams->mqtt_version != connect_params.mqtt_version) {
+        Log_e("MQTT version %d is not supported", pParams->mqtt_version);
+        qcloud_iot_mqtt_fini(mqtt_client);
+        HAL_Free(mqtt_client);
+        pParams->err_code = QCLOUD_ERR_INVAL;
+        return NULL;
+    }
 #if defined(AUTH_WITH_NOTLS) && defined(AUTH_MODE_KEY)
     if (pParams->device_secret == NULL) {
         Log_e("Device secret is null!");
@@ -135,6 +148,45 @@ void *IOT_MQTT_Construct(MQTTInitParams *pParams)
     return mqtt_client;
 }
 
+/* free the pub/sub info still waiting for ack */
+static void _mqtt_wait_list_release(Qcloud_IoT_Client *pClient)
+{
+    QcloudIotPubInfo *pub_info, *pub_next;
+    QcloudIotSubInfo *sub_info, *sub_next;
+
+    list_for_each_entry_safe(pub_info, pub_next, &pClient->list_pub_wait_ack.head, list, QcloudIotPubInfo)
+    {
+        list_unlink(&pClient->list_pub_wait_ack, &pub_info->list);
+        utils_mem_free(pub_info);
+    }
+
+    list_for_each_entry_safe(sub_info, sub_next, &pClient->list_sub_wait_ack.head, list, QcloudIotSubInfo)
+    {
+        list_unlink(&pClient->list_sub_wait_ack, &sub_info->list);
+        utils_mem_free(sub_info);
+    }
+}
+
+/* release the completions of sync service requests */
+static void _mqtt_completion_deinit(Qcloud_IoT_Client *pClient)
+{
+#ifdef SYSTEM_COMM
+    qcloud_iot_completion_deinit(&pClient->sys_state.sync_done);
+#endif
+
+#ifdef REMOTE_CONFIG_MQTT
+    qcloud_iot_completion_deinit(&pClient->config_state.sync_done);
+#endif
+
+#ifdef BROADCAST_ENABLED
+    qcloud_iot_completion_deinit(&pClient->broadcast_sub_done);
+#endif
+
+#ifdef RRPC_ENABLED
+    qcloud_iot_completion_deinit(&pClient->rrpc_sub_done);
+#endif
+}
+
 int IOT_MQTT_Destroy(void **pClient)
 {
     POINTER_SANITY_CHECK(*pClient, QCLOUD_ERR_INVAL);
@@ -148,6 +200,11 @@ int IOT_MQTT_Destroy(void **pClient)
         set_client_conn_state(mqtt_client, NOTCONNECTED);
     }
 
+#ifdef MULTITHREAD_ENABLED
+    /* callbacks still running use the subscriptions and their user data released below */
+    qcloud_iot_mqtt_dispatch_fini(mqtt_client);
+#endif
+
     int i = 0;
     for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
         /* notify this event to topic subscriber */
@@ -171,8 +228,8 @@ int IOT_MQTT_Destroy(void **pClient)
     HAL_MutexDestroy(mqtt_client->lock_list_sub);
     HAL_MutexDestroy(mqtt_client->lock_list_pub);
 
-    list_destroy(mqtt_client->list_pub_wait_ack);
-    list_destroy(mqtt_client->list_sub_wait_ack);
+    _mqtt_wait_list_release(mqtt_client);
+    _mqtt_completion_deinit(mqtt_client);
 
     HAL_Free(*pClient);
     *pClient = NULL;
@@ -216,6 +273,18 @@ int IOT_MQTT_Publish(void *pClient, char *topicName, PublishParams *pParams)
     return qcloud_iot_mqtt_publish(mqtt_client, topicName, pParams);
 }
 
+int IOT_MQTT_Topic_Init(MQTTTopicHandle *pTopic, const char *topicName)
+{
+    return qcloud_iot_mqtt_topic_init(pTopic, topicName);
+}
+
+int IOT_MQTT_Publish_Topic(void *pClient, const MQTTTopicHandle *pTopic, PublishParams *pParams)
+{
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+
+    return qcloud_iot_mqtt_publish_topic(mqtt_client, pTopic, pParams);
+}
+
 int IOT_MQTT_Subscribe(void *pClient, char *topicFilter, SubscribeParams *pParams)
 {
     Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
@@ -248,6 +317,89 @@ bool IOT_MQTT_IsConnected(void *pClient)
     IOT_FUNC_EXIT_RC(get_client_conn_state(mqtt_client) == 1)
 }
 
+int IOT_MQTT_GetFd(void *pClient)
+{
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+    Network *          pNetwork    = &(mqtt_client->network_stack);
+
+    if (!get_client_conn_state(mqtt_client) || 0 == pNetwork->handle) {
+        return QCLOUD_ERR_MQTT_NO_CONN;
+    }
+
+#ifdef AT_TCP_ENABLED
+    /* the handle is a module link id, there is no descriptor to wait on */
+    return QCLOUD_ERR_FAILURE;
+#else
+#ifndef AUTH_WITH_NOTLS
+    if (NETWORK_TLS == pNetwork->type) {
+        return HAL_TLS_GetFd(pNetwork->handle);
+    }
+#endif
+    return (int)pNetwork->handle;
+#endif
+}
+
+bool IOT_MQTT_ReadPending(void *pClient)
+{
+    POINTER_SANITY_CHECK(pClient, false);
+
+    Network *pNetwork = &(((Qcloud_IoT_Client *)pClient)->network_stack);
+
+#if !defined(AUTH_WITH_NOTLS) && !defined(AT_TCP_ENABLED)
+    if (NETWORK_TLS == pNetwork->type && pNetwork->handle) {
+        return HAL_TLS_Pending(pNetwork->handle) > 0;
+    }
+#endif
+    (void)pNetwork;
+    return false;
+}
+
+int IOT_MQTT_Set_Backup_Hosts(void *pClient, const char *hosts[], int num)
+{
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+    int                i;
+
+    if (num < 0 || num > MAX_MQTT_BACKUP_HOSTS || (num > 0 && NULL == hosts)) {
+        Log_e("invalid backup host number: %d", num);
+        return QCLOUD_ERR_INVAL;
+    }
+    for (i = 0; i < num; i++) {
+        if (NULL == hosts[i] || 0 == strlen(hosts[i]) || strlen(hosts[i]) >= HOST_STR_LENGTH) {
+            Log_e("invalid backup host %d", i);
+            return QCLOUD_ERR_INVAL;
+        }
+    }
+
+    HAL_MutexLock(mqtt_client->lock_generic);
+    for (i = 0; i < num; i++) {
+        HAL_Snprintf(mqtt_client->backup_hosts[i], HOST_STR_LENGTH, "%s", hosts[i]);
+    }
+    mqtt_client->backup_host_num    = num;
+    mqtt_client->host_index         = 0;
+    mqtt_client->network_stack.host = mqtt_client->host_addr;
+    HAL_MutexUnlock(mqtt_client->lock_generic);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int IOT_MQTT_Get_Reconnect_Stat(void *pClient, MQTTReconnectStat *pStat)
+{
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pStat, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+
+    HAL_MutexLock(mqtt_client->lock_generic);
+    *pStat = mqtt_client->reconnect_stat;
+    HAL_MutexUnlock(mqtt_client->lock_generic);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
 #ifdef MULTITHREAD_ENABLED
 
 static void _mqtt_yield_thread(void *ptr)
@@ -268,16 +420,17 @@ static void _mqtt_yield_thread(void *ptr)
 #endif
 
         if (rc == QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT) {
-            HAL_SleepMs(500);
+            /* yield sleeps until the next reconnect attempt by itself */
             continue;
         } else if (rc == QCLOUD_RET_MQTT_MANUALLY_DISCONNECTED || rc == QCLOUD_ERR_MQTT_RECONNECT_TIMEOUT) {
             Log_e("MQTT Yield thread exit with error: %d", rc);
             break;
         } else if (rc != QCLOUD_RET_SUCCESS && rc != QCLOUD_RET_MQTT_RECONNECTED) {
             Log_e("MQTT Yield thread error: %d", rc);
+            HAL_SleepMs(200);
         }
 
-        HAL_SleepMs(200);
+        /* yield blocks on the network read by itself, an extra sleep only delays the replies sync APIs wait for */
     }
 
     mqtt_client->thread_running   = false;
@@ -365,8 +518,13 @@ int qcloud_iot_mqtt_init(Qcloud_IoT_Client *pClient, MQTTInitParams *pParams)
         return rc;
     }
 
-    int size =
-        HAL_Snprintf(pClient->host_addr, HOST_STR_LENGTH, "%s.%s", pParams->product_id, QCLOUD_IOT_MQTT_DIRECT_DOMAIN);
+    int size;
+    if (NULL != pParams->host && '\0' != pParams->host[0]) {
+        size = HAL_Snprintf(pClient->host_addr, HOST_STR_LENGTH, "%s", pParams->host);
+    } else {
+        size = HAL_Snprintf(pClient->host_addr, HOST_STR_LENGTH, "%s.%s", pParams->product_id,
+                            QCLOUD_IOT_MQTT_DIRECT_DOMAIN);
+    }
     if (size < 0 || size > HOST_STR_LENGTH - 1) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
     }
@@ -419,17 +577,8 @@ int qcloud_iot_mqtt_init(Qcloud_IoT_Client *pClient, MQTTInitParams *pParams)
         goto error;
     }
 
-    if ((pClient->list_pub_wait_ack = list_new()) == NULL) {
-        Log_e("create pub wait list failed.");
-        goto error;
-    }
-    pClient->list_pub_wait_ack->free = HAL_Free;
-
-    if ((pClient->list_sub_wait_ack = list_new()) == NULL) {
-        Log_e("create sub wait list failed.");
-        goto error;
-    }
-    pClient->list_sub_wait_ack->free = HAL_Free;
+    list_init(&pClient->list_pub_wait_ack);
+    list_init(&pClient->list_sub_wait_ack);
 
 #ifndef AUTH_WITH_NOTLS
     // device param for TLS connection
@@ -471,6 +620,7 @@ int qcloud_iot_mqtt_init(Qcloud_IoT_Client *pClient, MQTTInitParams *pParams)
     pClient->network_stack.ssl_connect_params.timeout_ms =
         pClient->command_timeout_ms > QCLOUD_IOT_TLS_HANDSHAKE_TIMEOUT ? pClient->command_timeout_ms
                                                                        : QCLOUD_IOT_TLS_HANDSHAKE_TIMEOUT;
+    pClient->network_stack.ssl_connect_params.max_frag_len = QCLOUD_IOT_MQTT_TLS_MAX_FRAG_LEN;
 
 #else
     pClient->network_stack.host = pClient->host_addr;
@@ -488,6 +638,19 @@ int qcloud_iot_mqtt_init(Qcloud_IoT_Client *pClient, MQTTInitParams *pParams)
     pClient->sys_state.result_recv_ok = false;
     pClient->sys_state.topic_sub_ok   = false;
     pClient->sys_state.time           = 0;
+    qcloud_iot_completion_init(&pClient->sys_state.sync_done);
+#endif
+
+#ifdef REMOTE_CONFIG_MQTT
+    qcloud_iot_completion_init(&pClient->config_state.sync_done);
+#endif
+
+#ifdef BROADCAST_ENABLED
+    qcloud_iot_completion_init(&pClient->broadcast_sub_done);
+#endif
+
+#ifdef RRPC_ENABLED
+    qcloud_iot_completion_init(&pClient->rrpc_sub_done);
 #endif
 
 #ifdef MULTITHREAD_ENABLED
@@ -497,14 +660,6 @@ int qcloud_iot_mqtt_init(Qcloud_IoT_Client *pClient, MQTTInitParams *pParams)
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 
 error:
-    if (pClient->list_pub_wait_ack) {
-        pClient->list_pub_wait_ack->free(pClient->list_pub_wait_ack);
-        pClient->list_pub_wait_ack = NULL;
-    }
-    if (pClient->list_sub_wait_ack) {
-        pClient->list_sub_wait_ack->free(pClient->list_sub_wait_ack);
-        pClient->list_sub_wait_ack = NULL;
-    }
     if (pClient->lock_generic) {
         HAL_MutexDestroy(pClient->lock_generic);
         pClient->lock_generic = NULL;
@@ -537,8 +692,9 @@ int qcloud_iot_mqtt_fini(Qcloud_IoT_Client *mqtt_client)
     HAL_MutexDestroy(mqtt_client->lock_list_sub);
     HAL_MutexDestroy(mqtt_client->lock_list_pub);
 
-    list_destroy(mqtt_client->list_pub_wait_ack);
-    list_destroy(mqtt_client->list_sub_wait_ack);
+    _mqtt_wait_list_release(mqtt_client);
+
+    _mqtt_completion_deinit(mqtt_client);
 
     Log_i("release mqtt client resources");
 
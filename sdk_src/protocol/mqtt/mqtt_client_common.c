@@ -24,6 +24,7 @@ extern "C" {
 
 #include "mqtt_client.h"
 #include "utils_list.h"
+#include "utils_mem.h"
 
 /* remain waiting time after MQTT header is received (unit: ms) */
 #define QCLOUD_IOT_MQTT_MAX_REMAIN_WAIT_MS (2000)
@@ -326,9 +327,11 @@ int mqtt_init_packet_header(unsigned char *header, MessageTypes message_type, Qo
  * @param packet_id returned integer - the MQTT packet identifier
  * @param buf the raw buffer data, of the correct length determined by the remaining length field
  * @param buf_len the length in bytes of the data in the supplied buffer
+ * @param mqtt_version the MQTT protocol version, MQTT 5 acks have reason codes and properties
  * @return error code.  1 is success, 0 is failure
  */
-int deserialize_ack_packet(uint8_t *packet_type, uint8_t *dup, uint16_t *packet_id, unsigned char *buf, size_t buf_len)
+int deserialize_ack_packet(uint8_t *packet_type, uint8_t *dup, uint16_t *packet_id, unsigned char *buf, size_t buf_len,
+                           uint8_t mqtt_version)
 {
     IOT_FUNC_ENTRY;
 
@@ -366,6 +369,24 @@ int deserialize_ack_packet(uint8_t *packet_type, uint8_t *dup, uint16_t *packet_
 
     *packet_id = mqtt_read_uint16_t(&curdata);
 
+#ifdef MQTT5_ENABLED
+    /* PUBACK/PUBREC: reason code then properties, UNSUBACK: properties then reason codes, both optional when empty.
+     * MQTT v5.0 Specification 3.4.2 and 3.11.2 */
+    if (MQTT_5_0 == mqtt_version) {
+        if (UNSUBACK == *packet_type && QCLOUD_RET_SUCCESS != mqtt5_skip_properties(&curdata, enddata)) {
+            IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
+        }
+        if (enddata - curdata >= 1) {
+            unsigned char reason_code = mqtt_read_char(&curdata);
+            if (reason_code >= MQTT5_REASON_FAILURE) {
+                Log_e("deserialize_ack_packet failure! reason_code = 0x%02x", reason_code);
+                IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
+            }
+        }
+        IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
+    }
+#endif
+
     if (enddata - curdata >= 1) {
         unsigned char ack_code = mqtt_read_char(&curdata);
         if (ack_code != 0) {
@@ -385,10 +406,11 @@ int deserialize_ack_packet(uint8_t *packet_type, uint8_t *dup, uint16_t *packet_
  * @param grantedQoSs returned array of integers - the granted qualities of service
  * @param buf the raw buffer data, of the correct length determined by the remaining length field
  * @param buf_len the length in bytes of the data in the supplied buffer
+ * @param mqtt_version the MQTT protocol version, MQTT 5 suback has properties and reason codes
  * @return error code.  1 is success, 0 is failure
  */
 int deserialize_suback_packet(uint16_t *packet_id, uint32_t max_count, uint32_t *count, QoS *grantedQoSs,
-                              unsigned char *buf, size_t buf_len)
+                              unsigned char *buf, size_t buf_len, uint8_t mqtt_version)
 {
     IOT_FUNC_ENTRY;
 
@@ -429,13 +451,24 @@ int deserialize_suback_packet(uint16_t *packet_id, uint32_t max_count, uint32_t
     // read packet id from variable header
     *packet_id = mqtt_read_uint16_t(&curdata);
 
+#ifdef MQTT5_ENABLED
+    if (MQTT_5_0 == mqtt_version && QCLOUD_RET_SUCCESS != mqtt5_skip_properties(&curdata, enddata)) {
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
+    }
+#endif
+
     // read payload
     *count = 0;
     while (curdata < enddata) {
         if (*count > max_count) {
             IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
         }
-        grantedQoSs[(*count)++] = (QoS)mqtt_read_char(&curdata);
+        grantedQoSs[*count] = (QoS)mqtt_read_char(&curdata);
+        // MQTT 5 has failure reason codes from 0x80, report them as the 0x80 of MQTT 3.1.1
+        if (MQTT_5_0 == mqtt_version && grantedQoSs[*count] >= 0x80) {
+            grantedQoSs[*count] = (QoS)0x80;
+        }
+        (*count)++;
     }
 
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
@@ -446,9 +479,10 @@ int deserialize_suback_packet(uint16_t *packet_id, uint32_t max_count, uint32_t
  * @param packet_id returned integer - the MQTT packet identifier
  * @param buf the raw buffer data, of the correct length determined by the remaining length field
  * @param buf_len the length in bytes of the data in the supplied buffer
+ * @param mqtt_version the MQTT protocol version
  * @return int indicating function execution status
  */
-int deserialize_unsuback_packet(uint16_t *packet_id, unsigned char *buf, size_t buf_len)
+int deserialize_unsuback_packet(uint16_t *packet_id, unsigned char *buf, size_t buf_len, uint8_t mqtt_version)
 {
     IOT_FUNC_ENTRY;
 
@@ -459,7 +493,7 @@ int deserialize_unsuback_packet(uint16_t *packet_id, unsigned char *buf, size_t
     unsigned char dup  = 0;
     int           rc;
 
-    rc = deserialize_ack_packet(&type, &dup, packet_id, buf, buf_len);
+    rc = deserialize_ack_packet(&type, &dup, packet_id, buf, buf_len, mqtt_version);
     if (QCLOUD_RET_SUCCESS == rc && UNSUBACK != type) {
         rc = QCLOUD_ERR_FAILURE;
     }
@@ -770,6 +804,34 @@ static uint8_t _is_topic_matched(char *topic_filter, char *topicName, uint16_t t
     }
 }
 
+bool qcloud_iot_mqtt_is_topic_matched(const char *topicFilter, const char *topicName, uint16_t topicNameLen)
+{
+    return _is_topic_matched((char *)topicFilter, (char *)topicName, topicNameLen) != 0;
+}
+
+bool qcloud_iot_mqtt_find_handler(Qcloud_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+                                  OnMessageHandler *handler, void **user_data)
+{
+    uint32_t i;
+    bool     found = false;
+
+    HAL_MutexLock(pClient->lock_generic);
+    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
+        if ((pClient->sub_handles[i].topic_filter != NULL) &&
+            (_is_topic_equals(topicName, (char *)pClient->sub_handles[i].topic_filter) ||
+             _is_topic_matched((char *)pClient->sub_handles[i].topic_filter, topicName, topicNameLen)) &&
+            pClient->sub_handles[i].message_handler != NULL) {
+            *handler   = pClient->sub_handles[i].message_handler;
+            *user_data = pClient->sub_handles[i].handler_user_data;
+            found      = true;
+            break;
+        }
+    }
+    HAL_MutexUnlock(pClient->lock_generic);
+
+    return found;
+}
+
 /**
  * @brief deliver the message to user callback
  *
@@ -789,25 +851,21 @@ static int _deliver_message(Qcloud_IoT_Client *pClient, char *topicName, uint16_
     message->ptopic    = topicName;
     message->topic_len = (size_t)topicNameLen;
 
-    uint32_t i;
-    HAL_MutexLock(pClient->lock_generic);
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
-        if ((pClient->sub_handles[i].topic_filter != NULL) &&
-            (_is_topic_equals(topicName, (char *)pClient->sub_handles[i].topic_filter) ||
-             _is_topic_matched((char *)pClient->sub_handles[i].topic_filter, topicName, topicNameLen))) {
-            HAL_MutexUnlock(pClient->lock_generic);
-            if (pClient->sub_handles[i].message_handler != NULL) {
-                pClient->sub_handles[i].message_handler(pClient, message, pClient->sub_handles[i].handler_user_data);
-                IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
-            }
-            HAL_MutexLock(pClient->lock_generic);
+    OnMessageHandler handler;
+    void *           user_data;
+    if (qcloud_iot_mqtt_find_handler(pClient, topicName, topicNameLen, &handler, &user_data)) {
+#ifdef MULTITHREAD_ENABLED
+        /* with dispatch workers the callback runs off this thread, the worker looks the handler up again */
+        if (qcloud_iot_mqtt_dispatch(pClient, message) == QCLOUD_RET_SUCCESS) {
+            IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
         }
+#endif
+        handler(pClient, message, user_data);
+        IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
     }
 
     /* Message handler not found for topic */
     /* May be we do not care  change FAILURE  use SUCCESS*/
-    HAL_MutexUnlock(pClient->lock_generic);
-
     Log_d("no matching any topic, call default handle function");
 
     if (NULL != pClient->event_handle.h_fp) {
@@ -834,35 +892,12 @@ static int _mask_pubInfo_from(Qcloud_IoT_Client *c, uint16_t msgId)
     }
 
     HAL_MutexLock(c->lock_list_pub);
-    if (c->list_pub_wait_ack->len) {
-        ListIterator *    iter;
-        ListNode *        node      = NULL;
-        QcloudIotPubInfo *repubInfo = NULL;
-
-        if (NULL == (iter = list_iterator_new(c->list_pub_wait_ack, LIST_TAIL))) {
-            HAL_MutexUnlock(c->lock_list_pub);
-            return QCLOUD_RET_SUCCESS;
-        }
-
-        for (;;) {
-            node = list_iterator_next(iter);
-
-            if (NULL == node) {
-                break;
-            }
-
-            repubInfo = (QcloudIotPubInfo *)node->val;
-            if (NULL == repubInfo) {
-                Log_e("node's value is invalid!");
-                continue;
-            }
-
-            if (repubInfo->msg_id == msgId) {
-                repubInfo->node_state = MQTT_NODE_STATE_INVALID; /* set as invalid node */
-            }
+    QcloudIotPubInfo *repubInfo;
+    list_for_each_entry(repubInfo, &c->list_pub_wait_ack.head, list, QcloudIotPubInfo)
+    {
+        if (repubInfo->msg_id == msgId) {
+            repubInfo->node_state = MQTT_NODE_STATE_INVALID; /* set as invalid node */
         }
-
-        list_iterator_destroy(iter);
     }
     HAL_MutexUnlock(c->lock_list_pub);
 
@@ -883,35 +918,13 @@ static int _mask_sub_info_from(Qcloud_IoT_Client *c, unsigned int msgId, SubTopi
     }
 
     HAL_MutexLock(c->lock_list_sub);
-    if (c->list_sub_wait_ack->len) {
-        ListIterator *    iter;
-        ListNode *        node     = NULL;
-        QcloudIotSubInfo *sub_info = NULL;
-
-        if (NULL == (iter = list_iterator_new(c->list_sub_wait_ack, LIST_TAIL))) {
-            HAL_MutexUnlock(c->lock_list_sub);
-            IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
-        }
-
-        for (;;) {
-            node = list_iterator_next(iter);
-            if (NULL == node) {
-                break;
-            }
-
-            sub_info = (QcloudIotSubInfo *)node->val;
-            if (NULL == sub_info) {
-                Log_e("node's value is invalid!");
-                continue;
-            }
-
-            if (sub_info->msg_id == msgId) {
-                *messageHandler      = sub_info->handler;       /* return handle */
-                sub_info->node_state = MQTT_NODE_STATE_INVALID; /* mark as invalid node */
-            }
+    QcloudIotSubInfo *sub_info;
+    list_for_each_entry(sub_info, &c->list_sub_wait_ack.head, list, QcloudIotSubInfo)
+    {
+        if (sub_info->msg_id == msgId) {
+            *messageHandler      = sub_info->handler;       /* return handle */
+            sub_info->node_state = MQTT_NODE_STATE_INVALID; /* mark as invalid node */
         }
-
-        list_iterator_destroy(iter);
     }
     HAL_MutexUnlock(c->lock_list_sub);
 
@@ -928,7 +941,8 @@ static int _handle_puback_packet(Qcloud_IoT_Client *pClient, Timer *timer)
     uint8_t  dup, type;
     int      rc;
 
-    rc = deserialize_ack_packet(&type, &dup, &packet_id, pClient->read_buf, pClient->read_buf_size);
+    rc = deserialize_ack_packet(&type, &dup, &packet_id, pClient->read_buf, pClient->read_buf_size,
+                                pClient->options.mqtt_version);
     if (QCLOUD_RET_SUCCESS != rc) {
         IOT_FUNC_EXIT_RC(rc);
     }
@@ -959,7 +973,8 @@ static int _handle_suback_packet(Qcloud_IoT_Client *pClient, Timer *timer, QoS q
     int      rc;
     bool     sub_nack = false;
 
-    rc = deserialize_suback_packet(&packet_id, 1, &count, grantedQoS, pClient->read_buf, pClient->read_buf_size);
+    rc = deserialize_suback_packet(&packet_id, 1, &count, grantedQoS, pClient->read_buf, pClient->read_buf_size,
+                                   pClient->options.mqtt_version);
     if (QCLOUD_RET_SUCCESS != rc) {
         IOT_FUNC_EXIT_RC(rc);
     }
@@ -1000,8 +1015,15 @@ static int _handle_suback_packet(Qcloud_IoT_Client *pClient, Timer *timer, QoS q
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_MQTT_SUB);
     }
 
+    /* the subscriber routes the messages itself, there is no handle to keep */
+    if (sub_handle.routed) {
+        HAL_Free((void *)sub_handle.topic_filter);
+        sub_handle.topic_filter = NULL;
+        flag_dup                = 1;
+    }
+
     int i;
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
+    for (i = 0; i < MAX_MESSAGE_HANDLERS && !flag_dup; ++i) {
         if ((NULL != pClient->sub_handles[i].topic_filter)) {
             if (0 == _check_handle_is_identical(&pClient->sub_handles[i], &sub_handle)) {
                 flag_dup = 1;
@@ -1063,12 +1085,14 @@ static int _handle_unsuback_packet(Qcloud_IoT_Client *pClient, Timer *timer)
 
     uint16_t packet_id = 0;
 
-    int rc = deserialize_unsuback_packet(&packet_id, pClient->read_buf, pClient->read_buf_size);
+    int rc = deserialize_unsuback_packet(&packet_id, pClient->read_buf, pClient->read_buf_size,
+                                         pClient->options.mqtt_version);
     if (rc != QCLOUD_RET_SUCCESS) {
         IOT_FUNC_EXIT_RC(rc);
     }
 
     SubTopicHandle messageHandler;
+    memset(&messageHandler, 0, sizeof(SubTopicHandle));
     (void)_mask_sub_info_from(pClient, packet_id, &messageHandler);
 
     /* Remove from message handler array */
@@ -1134,12 +1158,13 @@ static int _handle_publish_packet(Qcloud_IoT_Client *pClient, Timer *timer)
     char *      topic_name;
     uint16_t    topic_len;
     MQTTMessage msg;
+    Timer       ack_timer;
     int         rc;
     uint32_t    len = 0;
 
     rc = deserialize_publish_packet(&msg.dup, &msg.qos, &msg.retained, &msg.id, &topic_name, &topic_len,
                                     (unsigned char **)&msg.payload, &msg.payload_len, pClient->read_buf,
-                                    pClient->read_buf_size);
+                                    pClient->read_buf_size, pClient->options.mqtt_version);
     if (QCLOUD_RET_SUCCESS != rc) {
         IOT_FUNC_EXIT_RC(rc);
     }
@@ -1190,13 +1215,14 @@ static int _handle_publish_packet(Qcloud_IoT_Client *pClient, Timer *timer)
         IOT_FUNC_EXIT_RC(rc);
     }
 
-    if (expired(timer)) {
-        /* send timeout */
-        Log_w("puback timer expired! left:%d, increase a bit", left_ms(timer));
-        countdown_ms(timer, 100);
+    /* the ack gets its own budget, a short yield may have spent the caller's timer and must not be stretched */
+    ack_timer = *timer;
+    if (expired(&ack_timer)) {
+        Log_d("puback timer expired! left:%d, increase a bit", left_ms(timer));
+        countdown_ms(&ack_timer, 100);
     }
 
-    rc = send_mqtt_packet(pClient, len, timer);
+    rc = send_mqtt_packet(pClient, len, &ack_timer);
     if (QCLOUD_RET_SUCCESS != rc) {
         HAL_MutexUnlock(pClient->lock_write_buf);
         IOT_FUNC_EXIT_RC(rc);
@@ -1211,10 +1237,12 @@ static int _handle_pubrec_packet(Qcloud_IoT_Client *pClient, Timer *timer)
     IOT_FUNC_ENTRY;
     uint16_t      packet_id;
     unsigned char dup, type;
+    Timer         ack_timer;
     int           rc;
     uint32_t      len;
 
-    rc = deserialize_ack_packet(&type, &dup, &packet_id, pClient->read_buf, pClient->read_buf_size);
+    rc = deserialize_ack_packet(&type, &dup, &packet_id, pClient->read_buf, pClient->read_buf_size,
+                                pClient->options.mqtt_version);
     if (QCLOUD_RET_SUCCESS != rc) {
         IOT_FUNC_EXIT_RC(rc);
     }
@@ -1226,14 +1254,15 @@ static int _handle_pubrec_packet(Qcloud_IoT_Client *pClient, Timer *timer)
         IOT_FUNC_EXIT_RC(rc);
     }
 
-    if (expired(timer)) {
-        /* send timeout */
-        Log_w("pubrec timer expired! left:%d, increase a bit", left_ms(timer));
-        countdown_ms(timer, 100);
+    /* same as the PUBACK of a received publish, don't stretch the caller's timer */
+    ack_timer = *timer;
+    if (expired(&ack_timer)) {
+        Log_d("pubrec timer expired! left:%d, increase a bit", left_ms(timer));
+        countdown_ms(&ack_timer, 100);
     }
 
     /* send the PUBREL packet */
-    rc = send_mqtt_packet(pClient, len, timer);
+    rc = send_mqtt_packet(pClient, len, &ack_timer);
     if (QCLOUD_RET_SUCCESS != rc) {
         HAL_MutexUnlock(pClient->lock_write_buf);
         /* there was a problem */
@@ -1303,6 +1332,20 @@ int cycle_for_read(Qcloud_IoT_Client *pClient, Timer *timer, uint8_t *packet_typ
             break;
         case PINGRESP:
             break;
+#ifdef MQTT5_ENABLED
+        case DISCONNECT: {
+            /* MQTT 5 server tells the reason before closing the connection, MQTT v5.0 Specification 3.14 */
+            uint32_t rem_len = 0, rem_len_bytes = 0;
+            uint8_t  reason_code = 0;
+
+            rc = mqtt_read_packet_rem_len_form_buf(pClient->read_buf + 1, &rem_len, &rem_len_bytes);
+            if (QCLOUD_RET_SUCCESS == rc && rem_len > 0) {
+                reason_code = pClient->read_buf[1 + rem_len_bytes];
+            }
+            Log_e("disconnected by server, reason code 0x%02x", reason_code);
+            IOT_FUNC_EXIT_RC(QCLOUD_ERR_TCP_PEER_SHUTDOWN);
+        }
+#endif
         default: {
             /* Either unknown packet type or Failure occurred
              * Should not happen */
@@ -1376,22 +1419,22 @@ uint8_t get_client_conn_state(Qcloud_IoT_Client *pClient)
  * return: 0, success; NOT 0, fail;
  */
 int push_sub_info_to(Qcloud_IoT_Client *c, int len, unsigned short msgId, MessageTypes type, SubTopicHandle *handler,
-                     ListNode **node)
+                     QcloudIotSubInfo **info)
 {
     IOT_FUNC_ENTRY;
-    if (!c || !handler || !node) {
+    if (!c || !handler || !info) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_INVAL);
     }
 
     HAL_MutexLock(c->lock_list_sub);
 
-    if (c->list_sub_wait_ack->len >= MAX_MESSAGE_HANDLERS) {
+    if (c->list_sub_wait_ack.len >= MAX_MESSAGE_HANDLERS) {
         HAL_MutexUnlock(c->lock_list_sub);
-        Log_e("number of sub_info more than max! size = %d", c->list_sub_wait_ack->len);
+        Log_e("number of sub_info more than max! size = %d", c->list_sub_wait_ack.len);
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_MQTT_MAX_SUBSCRIPTIONS);
     }
 
-    QcloudIotSubInfo *sub_info = (QcloudIotSubInfo *)HAL_Malloc(sizeof(QcloudIotSubInfo) + len);
+    QcloudIotSubInfo *sub_info = (QcloudIotSubInfo *)utils_mem_alloc(MEM_TAG_MQTT, sizeof(QcloudIotSubInfo) + len);
     if (NULL == sub_info) {
         HAL_MutexUnlock(c->lock_list_sub);
         Log_e("malloc failed!");
@@ -1411,15 +1454,8 @@ int push_sub_info_to(Qcloud_IoT_Client *c, int len, unsigned short msgId, Messag
 
     memcpy(sub_info->buf, c->write_buf, len);
 
-    *node = list_node_new(sub_info);
-    if (NULL == *node) {
-        HAL_MutexUnlock(c->lock_list_sub);
-        HAL_Free(sub_info);
-        Log_e("list_node_new failed!");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
-    }
-
-    list_rpush(c->list_sub_wait_ack, *node);
+    list_push(&c->list_sub_wait_ack, &sub_info->list);
+    *info = sub_info;
 
     HAL_MutexUnlock(c->lock_list_sub);
 
@@ -22,6 +22,7 @@ extern "C" {
 #include <string.h>
 
 #include "mqtt_client.h"
+#include "qcloud_iot_clock.h"
 #include "qcloud_iot_common.h"
 #include "utils_hmac.h"
 
@@ -48,6 +49,55 @@ typedef enum {
     CONNACK_NOT_AUTHORIZED_ERROR                = 5   // connection refused: not authorized
 } MQTTConnackReturnCodes;
 
+#ifdef MQTT5_ENABLED
+/**
+ * Connect reason code of MQTT 5 mapped to the return codes above, MQTT v5.0 Specification 3.2.2.2
+ */
+#define CONNACK5_UNSUPPORTED_PROTOCOL_VERSION 0x84
+#define CONNACK5_CLIENT_IDENTIFIER_NOT_VALID  0x85
+#define CONNACK5_BAD_USER_NAME_OR_PASSWORD    0x86
+#define CONNACK5_NOT_AUTHORIZED               0x87
+#define CONNACK5_SERVER_UNAVAILABLE           0x88
+#define CONNACK5_SERVER_BUSY                  0x89
+
+/* QoS1 publish server may send before PUBACK, not more than the packet id window of duplicate removal */
+#define MQTT5_CLIENT_RECEIVE_MAX MQTT_MAX_REPEAT_BUF_LEN
+
+static void _write_uint_32(unsigned char **pptr, uint32_t value)
+{
+    mqtt_write_char(pptr, (unsigned char)(value >> 24));
+    mqtt_write_char(pptr, (unsigned char)(value >> 16));
+    mqtt_write_char(pptr, (unsigned char)(value >> 8));
+    mqtt_write_char(pptr, (unsigned char)value);
+}
+
+/**
+ * Length of CONNECT properties: Session Expiry Interval when the session is kept, Receive Maximum and
+ * Maximum Packet Size. Topic Alias Maximum is left out so server never sends topic alias to client.
+ */
+static uint32_t _get_connect_properties_len(MQTTConnectParams *options)
+{
+    return (options->clean_session ? 0 : 5) + 3 + 5;
+}
+
+static void _write_connect_properties(unsigned char **pptr, MQTTConnectParams *options)
+{
+    uint32_t props_len = _get_connect_properties_len(options);
+
+    *pptr += mqtt_write_packet_rem_len(*pptr, props_len);
+
+    /* MQTT 3.1.1 keeps a not clean session until it is cleaned, MQTT 5 needs the expiry to keep it */
+    if (!options->clean_session) {
+        mqtt_write_char(pptr, MQTT5_PROP_SESSION_EXPIRY);
+        _write_uint_32(pptr, 0xFFFFFFFF);
+    }
+    mqtt_write_char(pptr, MQTT5_PROP_RECEIVE_MAXIMUM);
+    mqtt_write_uint_16(pptr, MQTT5_CLIENT_RECEIVE_MAX);
+    mqtt_write_char(pptr, MQTT5_PROP_MAX_PACKET_SIZE);
+    _write_uint_32(pptr, QCLOUD_IOT_MQTT_RX_BUF_LEN);
+}
+#endif
+
 /**
  * Determines the length of the MQTT connect packet that would be produced using the supplied connect options.
  * @param options the options to be used to build the connect packet
@@ -63,6 +113,12 @@ static uint32_t _get_packet_connect_rem_len(MQTTConnectParams *options)
     } else if (4 == options->mqtt_version) {
         len = 10;
     }
+#ifdef MQTT5_ENABLED
+    else if (MQTT_5_0 == options->mqtt_version) {
+        uint32_t props_len = _get_connect_properties_len(options);
+        len                = 10 + mqtt5_vbi_len(props_len) + props_len;
+    }
+#endif
 
     len += strlen(options->client_id) + 2;
 
@@ -123,7 +179,7 @@ static int _serialize_connect_packet(unsigned char *buf, size_t buf_len, MQTTCon
     uint32_t       rem_len = 0;
     int            rc;
 
-    long cur_timesec = HAL_Timer_current_sec() + MAX_ACCESS_EXPIRE_TIMEOUT / 1000;
+    long cur_timesec = qcloud_iot_clock_now_sec() + MAX_ACCESS_EXPIRE_TIMEOUT / 1000;
     if (cur_timesec <= 0 || MAX_ACCESS_EXPIRE_TIMEOUT <= 0) {
         cur_timesec = LONG_MAX;
     }
@@ -185,6 +241,11 @@ static int _serialize_connect_packet(unsigned char *buf, size_t buf_len, MQTTCon
     if (4 == options->mqtt_version) {
         mqtt_write_utf8_string(&ptr, "MQTT");
         mqtt_write_char(&ptr, (unsigned char)4);
+#ifdef MQTT5_ENABLED
+    } else if (MQTT_5_0 == options->mqtt_version) {
+        mqtt_write_utf8_string(&ptr, "MQTT");
+        mqtt_write_char(&ptr, (unsigned char)MQTT_5_0);
+#endif
     } else {
         mqtt_write_utf8_string(&ptr, "MQIsdp");
         mqtt_write_char(&ptr, (unsigned char)3);
@@ -203,6 +264,12 @@ static int _serialize_connect_packet(unsigned char *buf, size_t buf_len, MQTTCon
     // keep alive interval (unit:ms) in variable header
     mqtt_write_uint_16(&ptr, options->keep_alive_interval);
 
+#ifdef MQTT5_ENABLED
+    if (MQTT_5_0 == options->mqtt_version) {
+        _write_connect_properties(&ptr, options);
+    }
+#endif
+
     // client id
     mqtt_write_utf8_string(&ptr, options->client_id);
 
@@ -234,16 +301,19 @@ err_exit:
 
 /**
  * Deserializes the supplied (wire) buffer into connack data - return code
- * @param sessionPresent the session present flag returned (only for MQTT 3.1.1)
+ * @param pClient the client whose MQTT 5 session state is set from the connack properties
+ * @param sessionPresent the session present flag returned (only for MQTT 3.1.1 and 5.0)
  * @param connack_rc returned integer value of the connack return code
  * @param buf the raw buffer data, of the correct length determined by the remaining length field
  * @param buflen the length in bytes of the data in the supplied buffer
  * @return int indicating function execution status
  */
-static int _deserialize_connack_packet(uint8_t *sessionPresent, int *connack_rc, unsigned char *buf, size_t buflen)
+static int _deserialize_connack_packet(Qcloud_IoT_Client *pClient, uint8_t *sessionPresent, int *connack_rc,
+                                       unsigned char *buf, size_t buflen)
 {
     IOT_FUNC_ENTRY;
 
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
     POINTER_SANITY_CHECK(sessionPresent, QCLOUD_ERR_INVAL);
     POINTER_SANITY_CHECK(connack_rc, QCLOUD_ERR_INVAL);
     POINTER_SANITY_CHECK(buf, QCLOUD_ERR_INVAL);
@@ -273,7 +343,8 @@ static int _deserialize_connack_packet(uint8_t *sessionPresent, int *connack_rc,
     }
     curdata += (readBytesLen);
     enddata = curdata + decodedLen;
-    if (enddata - curdata != 2) {
+    /* MQTT 5 CONNACK has properties after the return code */
+    if (enddata - curdata < 2 || (MQTT_5_0 != pClient->options.mqtt_version && enddata - curdata != 2)) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
     }
 
@@ -283,6 +354,37 @@ static int _deserialize_connack_packet(uint8_t *sessionPresent, int *connack_rc,
 
     // variable header - return code, refer to MQTT spec 3.2.2.3
     connack_rc_char = mqtt_read_char(&curdata);
+#ifdef MQTT5_ENABLED
+    if (MQTT_5_0 == pClient->options.mqtt_version) {
+        switch (connack_rc_char) {
+            case CONNACK_CONNECTION_ACCEPTED:
+                *connack_rc = QCLOUD_RET_MQTT_CONNACK_CONNECTION_ACCEPTED;
+                rc          = mqtt5_read_connack_properties(pClient, &curdata, enddata);
+                IOT_FUNC_EXIT_RC(rc);
+            case CONNACK5_UNSUPPORTED_PROTOCOL_VERSION:
+                *connack_rc = QCLOUD_ERR_MQTT_CONNACK_UNACCEPTABLE_PROTOCOL_VERSION;
+                break;
+            case CONNACK5_CLIENT_IDENTIFIER_NOT_VALID:
+                *connack_rc = QCLOUD_ERR_MQTT_CONNACK_IDENTIFIER_REJECTED;
+                break;
+            case CONNACK5_SERVER_UNAVAILABLE:
+            case CONNACK5_SERVER_BUSY:
+                *connack_rc = QCLOUD_ERR_MQTT_CONNACK_SERVER_UNAVAILABLE;
+                break;
+            case CONNACK5_BAD_USER_NAME_OR_PASSWORD:
+                *connack_rc = QCLOUD_ERR_MQTT_CONNACK_BAD_USERDATA;
+                break;
+            case CONNACK5_NOT_AUTHORIZED:
+                *connack_rc = QCLOUD_ERR_MQTT_CONNACK_NOT_AUTHORIZED;
+                break;
+            default:
+                Log_e("connect refused, reason code 0x%02x", connack_rc_char);
+                *connack_rc = QCLOUD_ERR_MQTT_CONNACK_UNKNOWN;
+                break;
+        }
+        IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
+    }
+#endif
     switch (connack_rc_char) {
         case CONNACK_CONNECTION_ACCEPTED:
             *connack_rc = QCLOUD_RET_MQTT_CONNACK_CONNECTION_ACCEPTED;
@@ -340,6 +442,12 @@ static int _mqtt_connect(Qcloud_IoT_Client *pClient, MQTTConnectParams *options)
     }
 
     HAL_MutexLock(pClient->lock_write_buf);
+#ifdef MQTT5_ENABLED
+    /* server limits and topic alias only last for one connection */
+    if (MQTT_5_0 == pClient->options.mqtt_version) {
+        mqtt5_session_reset(pClient);
+    }
+#endif
     // serialize CONNECT packet
     rc = _serialize_connect_packet(pClient->write_buf, pClient->write_buf_size, &(pClient->options), &len);
     if (QCLOUD_RET_SUCCESS != rc || 0 == len) {
@@ -362,7 +470,8 @@ static int _mqtt_connect(Qcloud_IoT_Client *pClient, MQTTConnectParams *options)
     }
 
     // deserialize CONNACK and check reture code
-    rc = _deserialize_connack_packet(&sessionPresent, &connack_rc, pClient->read_buf, pClient->read_buf_size);
+    rc = _deserialize_connack_packet(pClient, &sessionPresent, &connack_rc, pClient->read_buf,
+                                     pClient->read_buf_size);
     if (QCLOUD_RET_SUCCESS != rc) {
         IOT_FUNC_EXIT_RC(rc);
     }
@@ -371,6 +480,13 @@ static int _mqtt_connect(Qcloud_IoT_Client *pClient, MQTTConnectParams *options)
         IOT_FUNC_EXIT_RC(connack_rc);
     }
 
+#ifdef MQTT_RMDUP_MSG_ENABLED
+    /* a new session numbers its publishes from scratch, ids seen in the old one are no duplicates */
+    if (!sessionPresent) {
+        reset_repeat_packet_id_buffer(pClient);
+    }
+#endif
+
     set_client_conn_state(pClient, CONNECTED);
     HAL_MutexLock(pClient->lock_generic);
     pClient->was_manually_disconnected = 0;
@@ -0,0 +1,369 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+#include "mqtt_client.h"
+#include "qcloud_iot_import.h"
+#include "utils_mem.h"
+
+#ifdef MULTITHREAD_ENABLED
+
+#ifndef MQTT_DISPATCH_STACK_SIZE
+#define MQTT_DISPATCH_STACK_SIZE 4096
+#endif
+
+/* how often an idle worker checks for shutdown */
+#define MQTT_DISPATCH_IDLE_MS 1000
+
+/* how often a blocked yield thread checks for room */
+#define MQTT_DISPATCH_BLOCK_POLL_MS 5
+
+/* how long destroy waits for running callbacks to return */
+#define MQTT_DISPATCH_STOP_MS 5000
+
+struct MQTTDispatcher;
+
+/**
+ * Each worker owns a ring of messages and is the only one taking from it. A
+ * topic always hashes to the same worker, so its messages are handled one at
+ * a time and in arrival order; different topics run in parallel.
+ */
+typedef struct {
+    struct MQTTDispatcher *d;
+    ThreadParams           thread;  // read by the new thread after HAL_ThreadCreate returns
+    void *                 sem;
+    MQTTMessage **         ring;
+    uint16_t               head;
+    uint16_t               count;
+} DispatchWorker;
+
+typedef struct MQTTDispatcher {
+    Qcloud_IoT_Client *client;
+    MQTTDispatchParams params;
+    void *             lock;  // guards the rings and stat
+    DispatchWorker *   workers;
+    MQTTDispatchStat   stat;
+    volatile bool      stop;
+    volatile uint16_t  worker_alive;
+} MQTTDispatcher;
+
+static uint32_t _dispatch_topic_hash(const char *topic, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    size_t   i;
+
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)topic[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+/* a copy of the message, topic and payload in the same block, both null terminated */
+static MQTTMessage *_dispatch_msg_copy(MQTTMessage *message)
+{
+    size_t       size = sizeof(MQTTMessage) + message->topic_len + message->payload_len + 2;
+    MQTTMessage *copy = (MQTTMessage *)utils_mem_alloc(MEM_TAG_MQTT, size);
+    char *       topic;
+    char *       payload;
+
+    if (!copy) {
+        return NULL;
+    }
+
+    topic   = (char *)(copy + 1);
+    payload = topic + message->topic_len + 1;
+    memcpy(topic, message->ptopic, message->topic_len);
+    topic[message->topic_len] = '\0';
+    memcpy(payload, message->payload, message->payload_len);
+    payload[message->payload_len] = '\0';
+
+    *copy         = *message;
+    copy->ptopic  = topic;
+    copy->payload = payload;
+
+    return copy;
+}
+
+static void _dispatch_worker(void *arg)
+{
+    DispatchWorker *w = (DispatchWorker *)arg;
+    MQTTDispatcher *d = w->d;
+
+    while (!d->stop) {
+        HAL_SemaphoreWait(w->sem, MQTT_DISPATCH_IDLE_MS);
+
+        for (;;) {
+            MQTTMessage *    msg;
+            OnMessageHandler handler;
+            void *           user_data;
+
+            HAL_MutexLock(d->lock);
+            if (d->stop || w->count == 0) {
+                HAL_MutexUnlock(d->lock);
+                break;
+            }
+            msg     = w->ring[w->head];
+            w->head = (w->head + 1) % d->params.queue_len;
+            w->count--;
+            d->stat.depth--;
+            HAL_MutexUnlock(d->lock);
+
+            /* the subscription may be gone since the message was queued */
+            if (qcloud_iot_mqtt_find_handler(d->client, (char *)msg->ptopic, (uint16_t)msg->topic_len, &handler,
+                                             &user_data)) {
+                handler(d->client, msg, user_data);
+
+                HAL_MutexLock(d->lock);
+                d->stat.delivered++;
+                HAL_MutexUnlock(d->lock);
+            }
+            utils_mem_free(msg);
+        }
+    }
+
+    HAL_MutexLock(d->lock);
+    d->worker_alive--;
+    HAL_MutexUnlock(d->lock);
+}
+
+static void _dispatcher_destroy(MQTTDispatcher *d)
+{
+    int i;
+
+    if (d->worker_alive) {
+        Timer timer;
+        InitTimer(&timer);
+        countdown_ms(&timer, MQTT_DISPATCH_STOP_MS);
+
+        d->stop = true;
+        for (i = 0; i < d->params.worker_num; i++) {
+            HAL_SemaphorePost(d->workers[i].sem);
+        }
+        while (d->worker_alive && !expired(&timer)) {
+            HAL_SleepMs(10);
+        }
+        if (d->worker_alive) {
+            /* a callback is stuck, freeing under it would be worse than leaking */
+            Log_e("%u mqtt dispatch workers still busy, dispatcher leaked", d->worker_alive);
+            return;
+        }
+    }
+
+    for (i = 0; d->workers && i < d->params.worker_num; i++) {
+        DispatchWorker *w = &d->workers[i];
+        while (w->count) {
+            utils_mem_free(w->ring[w->head]);
+            w->head = (w->head + 1) % d->params.queue_len;
+            w->count--;
+        }
+        if (w->ring) {
+            HAL_Free(w->ring);
+        }
+        if (w->sem) {
+            HAL_SemaphoreDestroy(w->sem);
+        }
+    }
+    if (d->workers) {
+        HAL_Free(d->workers);
+    }
+    if (d->lock) {
+        HAL_MutexDestroy(d->lock);
+    }
+    HAL_Free(d);
+}
+
+static int _dispatcher_start_workers(MQTTDispatcher *d)
+{
+    int i;
+
+    for (i = 0; i < d->params.worker_num; i++) {
+        ThreadParams *thread_params = &d->workers[i].thread;
+
+        thread_params->thread_func = _dispatch_worker;
+        thread_params->thread_name = "mqtt_dispatch";
+        thread_params->user_arg    = &d->workers[i];
+        thread_params->stack_size  = d->params.stack_size ? d->params.stack_size : MQTT_DISPATCH_STACK_SIZE;
+        thread_params->priority    = 1;
+
+        HAL_MutexLock(d->lock);
+        d->worker_alive++;
+        HAL_MutexUnlock(d->lock);
+
+        if (HAL_ThreadCreate(thread_params)) {
+            Log_e("create mqtt dispatch worker %d fail", i);
+            HAL_MutexLock(d->lock);
+            d->worker_alive--;
+            HAL_MutexUnlock(d->lock);
+            return QCLOUD_ERR_FAILURE;
+        }
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int qcloud_iot_mqtt_dispatch(Qcloud_IoT_Client *pClient, MQTTMessage *message)
+{
+    MQTTDispatcher *d = (MQTTDispatcher *)pClient->dispatcher;
+    DispatchWorker *w;
+    MQTTMessage *   copy;
+
+    if (!d || d->stop) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    w = &d->workers[_dispatch_topic_hash(message->ptopic, message->topic_len) % d->params.worker_num];
+
+    HAL_MutexLock(d->lock);
+    if (w->count == d->params.queue_len && d->params.policy == eMQTT_DISPATCH_BLOCK) {
+        Timer timer;
+        InitTimer(&timer);
+        countdown_ms(&timer, d->params.block_ms);
+
+        d->stat.blocked++;
+        while (w->count == d->params.queue_len && !d->stop && !expired(&timer)) {
+            HAL_MutexUnlock(d->lock);
+            HAL_SleepMs(MQTT_DISPATCH_BLOCK_POLL_MS);
+            HAL_MutexLock(d->lock);
+        }
+    }
+    if (w->count == d->params.queue_len || d->stop) {
+        d->stat.dropped++;
+        HAL_MutexUnlock(d->lock);
+        Log_w("dispatch queue full, msg of %s dropped", message->ptopic);
+        return QCLOUD_RET_SUCCESS;
+    }
+    HAL_MutexUnlock(d->lock);
+
+    /* the message lives in the MQTT read buffer, which the next packet overwrites */
+    copy = _dispatch_msg_copy(message);
+
+    HAL_MutexLock(d->lock);
+    /* only the yield thread adds to the rings, the room checked above is still there */
+    if (!copy) {
+        d->stat.dropped++;
+        HAL_MutexUnlock(d->lock);
+        Log_e("dispatch msg of %s dropped, malloc fail", message->ptopic);
+        return QCLOUD_RET_SUCCESS;
+    }
+    w->ring[(w->head + w->count) % d->params.queue_len] = copy;
+    w->count++;
+    d->stat.enqueued++;
+    if (++d->stat.depth > d->stat.peak_depth) {
+        d->stat.peak_depth = d->stat.depth;
+    }
+    HAL_MutexUnlock(d->lock);
+
+    HAL_SemaphorePost(w->sem);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+void qcloud_iot_mqtt_dispatch_fini(Qcloud_IoT_Client *pClient)
+{
+    MQTTDispatcher *d = (MQTTDispatcher *)pClient->dispatcher;
+
+    if (d) {
+        pClient->dispatcher = NULL;
+        _dispatcher_destroy(d);
+    }
+}
+
+int IOT_MQTT_Dispatch_Start(void *pClient, MQTTDispatchParams *pParams)
+{
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pParams, QCLOUD_ERR_INVAL);
+    NUMBERIC_SANITY_CHECK(pParams->worker_num, QCLOUD_ERR_INVAL);
+    NUMBERIC_SANITY_CHECK(pParams->queue_len, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+    MQTTDispatcher *   d;
+    int                i;
+
+    if (mqtt_client->dispatcher) {
+        Log_e("mqtt dispatch already started");
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    d = (MQTTDispatcher *)HAL_Malloc(sizeof(MQTTDispatcher));
+    if (!d) {
+        Log_e("malloc mqtt dispatcher fail");
+        return QCLOUD_ERR_MALLOC;
+    }
+    memset(d, 0, sizeof(MQTTDispatcher));
+    d->client = mqtt_client;
+    d->params = *pParams;
+
+    d->lock    = HAL_MutexCreate();
+    d->workers = (DispatchWorker *)HAL_Malloc(d->params.worker_num * sizeof(DispatchWorker));
+    if (!d->lock || !d->workers) {
+        goto error;
+    }
+    memset(d->workers, 0, d->params.worker_num * sizeof(DispatchWorker));
+
+    for (i = 0; i < d->params.worker_num; i++) {
+        DispatchWorker *w = &d->workers[i];
+        w->d              = d;
+        w->sem            = HAL_SemaphoreCreate();
+        w->ring           = (MQTTMessage **)HAL_Malloc(d->params.queue_len * sizeof(MQTTMessage *));
+        if (!w->sem || !w->ring) {
+            goto error;
+        }
+    }
+
+    if (_dispatcher_start_workers(d) != QCLOUD_RET_SUCCESS) {
+        goto error;
+    }
+
+    mqtt_client->dispatcher = d;
+    Log_i("mqtt dispatch started, %u workers, queue %u", d->params.worker_num, d->params.queue_len);
+
+    return QCLOUD_RET_SUCCESS;
+
+error:
+    Log_e("mqtt dispatch init fail");
+    _dispatcher_destroy(d);
+    return QCLOUD_ERR_FAILURE;
+}
+
+int IOT_MQTT_Dispatch_Get_Stat(void *pClient, MQTTDispatchStat *pStat)
+{
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pStat, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+    MQTTDispatcher *   d           = (MQTTDispatcher *)mqtt_client->dispatcher;
+
+    if (!d) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    HAL_MutexLock(d->lock);
+    *pStat = d->stat;
+    HAL_MutexUnlock(d->lock);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
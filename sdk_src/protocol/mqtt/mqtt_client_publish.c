@@ -23,6 +23,7 @@ extern "C" {
 
 #include "mqtt_client.h"
 #include "utils_list.h"
+#include "utils_mem.h"
 
 /**
  * @param mqttstring the MQTTString structure into which the data is to be read
@@ -57,26 +58,32 @@ static int _read_string_with_len(char **string, uint16_t *stringLen, unsigned ch
 /**
  * Determines the length of the MQTT publish packet that would be produced using the supplied parameters
  * @param qos the MQTT QoS of the publish (packetid is omitted for QoS 0)
- * @param topicName the topic name to be used in the publish
+ * @param topicLen the length of the topic name to be used in the publish
  * @param payload_len the length of the payload to be sent
+ * @param mqtt_version the MQTT protocol version, properties are only in MQTT 5
+ * @param topicAlias the MQTT 5 topic alias, 0 for none
  * @return the length of buffer needed to contain the serialized version of the packet
  */
-static uint32_t _get_publish_packet_len(uint8_t qos, char *topicName, size_t payload_len)
+static uint32_t _get_publish_packet_len(uint8_t qos, size_t topicLen, size_t payload_len, uint8_t mqtt_version,
+                                        uint16_t topicAlias)
 {
     size_t len = 0;
 
-    len += 2 + strlen(topicName) + payload_len;
+    len += 2 + topicLen + payload_len;
     if (qos > 0) {
         len += 2; /* packetid */
     }
+    if (MQTT_5_0 == mqtt_version) {
+        len += 1 + (topicAlias ? 3 : 0); /* property length + topic alias */
+    }
     return (uint32_t)len;
 }
 
-static int _mask_push_pubInfo_to(Qcloud_IoT_Client *c, int len, unsigned short msgId, ListNode **node)
+static int _mask_push_pubInfo_to(Qcloud_IoT_Client *c, int len, unsigned short msgId, QcloudIotPubInfo **pub_info)
 {
     IOT_FUNC_ENTRY;
 
-    if (!c || !node) {
+    if (!c || !pub_info) {
         Log_e("invalid parameters!");
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_MQTT_PUSH_TO_LIST_FAILED);
     }
@@ -88,13 +95,13 @@ static int _mask_push_pubInfo_to(Qcloud_IoT_Client *c, int len, unsigned short m
 
     HAL_MutexLock(c->lock_list_pub);
 
-    if (c->list_pub_wait_ack->len >= MAX_REPUB_NUM) {
+    if (c->list_pub_wait_ack.len >= MAX_REPUB_NUM) {
         HAL_MutexUnlock(c->lock_list_pub);
-        Log_e("more than %u elements in republish list. List overflow!", c->list_pub_wait_ack->len);
+        Log_e("more than %u elements in republish list. List overflow!", c->list_pub_wait_ack.len);
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
     }
 
-    QcloudIotPubInfo *repubInfo = (QcloudIotPubInfo *)HAL_Malloc(sizeof(QcloudIotPubInfo) + len);
+    QcloudIotPubInfo *repubInfo = (QcloudIotPubInfo *)utils_mem_alloc(MEM_TAG_MQTT, sizeof(QcloudIotPubInfo) + len);
     if (NULL == repubInfo) {
         HAL_MutexUnlock(c->lock_list_pub);
         Log_e("memory malloc failed!");
@@ -111,15 +118,8 @@ static int _mask_push_pubInfo_to(Qcloud_IoT_Client *c, int len, unsigned short m
 
     memcpy(repubInfo->buf, c->write_buf, len);
 
-    *node = list_node_new(repubInfo);
-    if (NULL == *node) {
-        HAL_MutexUnlock(c->lock_list_pub);
-        HAL_Free(repubInfo);
-        Log_e("list_node_new failed!");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
-    }
-
-    list_rpush(c->list_pub_wait_ack, *node);
+    list_push(&c->list_pub_wait_ack, &repubInfo->list);
+    *pub_info = repubInfo;
 
     HAL_MutexUnlock(c->lock_list_pub);
 
@@ -137,11 +137,12 @@ static int _mask_push_pubInfo_to(Qcloud_IoT_Client *c, int len, unsigned short m
  * @param payload_len returned integer - the length of the MQTT payload
  * @param buf the raw buffer data, of the correct length determined by the remaining length field
  * @param buf_len the length in bytes of the data in the supplied buffer
+ * @param mqtt_version the MQTT protocol version, properties are skipped for MQTT 5
  * @return error code.  1 is success
  */
 int deserialize_publish_packet(uint8_t *dup, QoS *qos, uint8_t *retained, uint16_t *packet_id, char **topicName,
                                uint16_t *topicNameLen, unsigned char **payload, size_t *payload_len, unsigned char *buf,
-                               size_t buf_len)
+                               size_t buf_len, uint8_t mqtt_version)
 {
     IOT_FUNC_ENTRY;
 
@@ -195,6 +196,13 @@ int deserialize_publish_packet(uint8_t *dup, QoS *qos, uint8_t *retained, uint16
         *packet_id = mqtt_read_uint16_t(&curdata);
     }
 
+#ifdef MQTT5_ENABLED
+    /* no topic alias is expected as client announces Topic Alias Maximum 0 */
+    if (MQTT_5_0 == mqtt_version && QCLOUD_RET_SUCCESS != mqtt5_skip_properties(&curdata, enddata)) {
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
+    }
+#endif
+
     *payload_len = (size_t)(enddata - curdata);
     *payload     = curdata;
 
@@ -249,13 +257,18 @@ int serialize_pub_ack_packet(unsigned char *buf, size_t buf_len, MessageTypes pa
  * @param retained integer - the MQTT retained flag
  * @param packet_id integer - the MQTT packet identifier
  * @param topicName MQTTString - the MQTT topic in the publish
+ * @param topicLen integer - the length of topicName
+ * @param topicWire byte buffer - topicName already encoded with its length, or NULL
+ * @param mqtt_version integer - the MQTT protocol version, properties are only in MQTT 5
+ * @param topicAlias integer - the MQTT 5 topic alias, 0 for none. topicLen is 0 if server knows the alias
  * @param payload byte buffer - the MQTT publish payload
  * @param payload_len integer - the length of the MQTT payload
  * @return the length of the serialized data.  <= 0 indicates error
  */
 static int _serialize_publish_packet(unsigned char *buf, size_t buf_len, uint8_t dup, QoS qos, uint8_t retained,
-                                     uint16_t packet_id, char *topicName, unsigned char *payload, size_t payload_len,
-                                     uint32_t *serialized_len)
+                                     uint16_t packet_id, const char *topicName, uint16_t topicLen,
+                                     const unsigned char *topicWire, uint8_t mqtt_version, uint16_t topicAlias,
+                                     unsigned char *payload, size_t payload_len, uint32_t *serialized_len)
 {
     IOT_FUNC_ENTRY;
     POINTER_SANITY_CHECK(buf, QCLOUD_ERR_INVAL);
@@ -267,7 +280,7 @@ static int _serialize_publish_packet(unsigned char *buf, size_t buf_len, uint8_t
     uint32_t       rem_len = 0;
     int            rc;
 
-    rem_len = _get_publish_packet_len(qos, topicName, payload_len);
+    rem_len = _get_publish_packet_len(qos, topicLen, payload_len, mqtt_version, topicAlias);
     if (get_mqtt_packet_len(rem_len) > buf_len) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_BUF_TOO_SHORT);
     }
@@ -282,12 +295,35 @@ static int _serialize_publish_packet(unsigned char *buf, size_t buf_len, uint8_t
     ptr += mqtt_write_packet_rem_len(ptr, rem_len); /* write remaining length */
     ;
 
-    mqtt_write_utf8_string(&ptr, topicName); /* Variable Header: Topic Name */
+    /* Variable Header: Topic Name */
+    if (topicWire) {
+        memcpy(ptr, topicWire, topicLen + 2);
+        ptr += topicLen + 2;
+    } else {
+        mqtt_write_uint_16(&ptr, topicLen);
+        if (topicLen) {
+            memcpy(ptr, topicName, topicLen);
+            ptr += topicLen;
+        }
+    }
 
     if (qos > 0) {
         mqtt_write_uint_16(&ptr, packet_id); /* Variable Header: Topic Name */
     }
 
+#ifdef MQTT5_ENABLED
+    /* Variable Header: Properties */
+    if (MQTT_5_0 == mqtt_version) {
+        if (topicAlias) {
+            mqtt_write_char(&ptr, 3);
+            mqtt_write_char(&ptr, MQTT5_PROP_TOPIC_ALIAS);
+            mqtt_write_uint_16(&ptr, topicAlias);
+        } else {
+            mqtt_write_char(&ptr, 0);
+        }
+    }
+#endif
+
     memcpy(ptr, payload, payload_len);
     ptr += payload_len;
 
@@ -296,25 +332,62 @@ static int _serialize_publish_packet(unsigned char *buf, size_t buf_len, uint8_t
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
-int qcloud_iot_mqtt_publish(Qcloud_IoT_Client *pClient, char *topicName, PublishParams *pParams)
+#ifdef MQTT5_ENABLED
+/**
+ * Check a publish against the limits server announced in CONNACK
+ * @param pClient the MQTT client
+ * @param qos the MQTT QoS of the publish
+ * @return QCLOUD_RET_SUCCESS if it can be sent now
+ */
+static int _mqtt5_check_publish(Qcloud_IoT_Client *pClient, QoS qos)
 {
-    IOT_FUNC_ENTRY;
+    QcloudIotPubInfo *pub_info;
+    uint16_t          inflight = 0;
 
-    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
-    POINTER_SANITY_CHECK(pParams, QCLOUD_ERR_INVAL);
-    STRING_PTR_SANITY_CHECK(topicName, QCLOUD_ERR_INVAL);
+    if (qos > pClient->v5_state.qos_max) {
+        Log_e("QoS%d is over the maximum QoS of server", qos);
+        return QCLOUD_ERR_MQTT_QOS_NOT_SUPPORT;
+    }
 
-    Timer    timer;
-    uint32_t len = 0;
-    int      rc;
+    if (QOS0 == qos) {
+        return QCLOUD_RET_SUCCESS;
+    }
 
-    ListNode *node = NULL;
+    /* acked nodes stay in the list until qcloud_iot_mqtt_pub_info_proc, only count the ones waiting */
+    HAL_MutexLock(pClient->lock_list_pub);
+    list_for_each_entry(pub_info, &pClient->list_pub_wait_ack.head, list, QcloudIotPubInfo)
+    {
+        if (MQTT_NODE_STATE_NORMANL == pub_info->node_state) {
+            inflight++;
+        }
+    }
+    HAL_MutexUnlock(pClient->lock_list_pub);
 
-    size_t topicLen = strlen(topicName);
-    if (topicLen > MAX_SIZE_OF_CLOUD_TOPIC) {
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_MAX_TOPIC_LENGTH);
+    if (inflight >= pClient->v5_state.receive_max) {
+        Log_w("%u publish waiting for PUBACK, receive maximum of server reached", inflight);
+        return QCLOUD_ERR_MQTT_FLOW_CONTROL;
     }
 
+    return QCLOUD_RET_SUCCESS;
+}
+#endif
+
+static int _mqtt_publish(Qcloud_IoT_Client *pClient, const char *topicName, uint16_t topicLen,
+                         const unsigned char *topicWire, PublishParams *pParams)
+{
+    IOT_FUNC_ENTRY;
+
+    Timer    timer;
+    uint32_t len          = 0;
+    uint16_t topicAlias   = 0;
+    uint8_t  mqtt_version = pClient->options.mqtt_version;
+    int      rc;
+#ifdef MQTT5_ENABLED
+    bool aliasMapped = false;
+#endif
+
+    QcloudIotPubInfo *pub_info = NULL;
+
     if (pParams->qos == QOS2) {
         Log_e("QoS2 is not supported currently");
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_MQTT_QOS_NOT_SUPPORT);
@@ -328,6 +401,16 @@ int qcloud_iot_mqtt_publish(Qcloud_IoT_Client *pClient, char *topicName, Publish
     countdown_ms(&timer, pClient->command_timeout_ms);
 
     HAL_MutexLock(pClient->lock_write_buf);
+#ifdef MQTT5_ENABLED
+    if (MQTT_5_0 == mqtt_version) {
+        rc = _mqtt5_check_publish(pClient, pParams->qos);
+        if (QCLOUD_RET_SUCCESS != rc) {
+            HAL_MutexUnlock(pClient->lock_write_buf);
+            IOT_FUNC_EXIT_RC(rc);
+        }
+    }
+#endif
+
     if (pParams->qos == QOS1) {
         pParams->id = get_next_packet_id(pClient);
         if (IOT_Log_Get_Level() <= eLOG_DEBUG) {
@@ -345,20 +428,37 @@ int qcloud_iot_mqtt_publish(Qcloud_IoT_Client *pClient, char *topicName, Publish
         }
     }
 
+#ifdef MQTT5_ENABLED
+    /* once server knows the alias the topic name is left out */
+    if (MQTT_5_0 == mqtt_version) {
+        topicAlias = mqtt5_topic_alias_get(pClient, topicName, topicLen, &aliasMapped);
+        if (aliasMapped) {
+            topicLen  = 0;
+            topicWire = NULL;
+        }
+    }
+#endif
+
     rc = _serialize_publish_packet(pClient->write_buf, pClient->write_buf_size, 0, pParams->qos, pParams->retained,
-                                   pParams->id, topicName, (unsigned char *)pParams->payload, pParams->payload_len,
-                                   &len);
+                                   pParams->id, topicName, topicLen, topicWire, mqtt_version, topicAlias,
+                                   (unsigned char *)pParams->payload, pParams->payload_len, &len);
+#ifdef MQTT5_ENABLED
+    if (QCLOUD_RET_SUCCESS == rc && MQTT_5_0 == mqtt_version && pClient->v5_state.packet_max &&
+        len > pClient->v5_state.packet_max) {
+        Log_e("publish packet of %u bytes is over the maximum packet size %u of server", len,
+              pClient->v5_state.packet_max);
+        rc = QCLOUD_ERR_MQTT_PACKET_TOO_LARGE;
+    }
+#endif
     if (QCLOUD_RET_SUCCESS != rc) {
-        HAL_MutexUnlock(pClient->lock_write_buf);
-        IOT_FUNC_EXIT_RC(rc);
+        goto exit_unlock;
     }
 
     if (pParams->qos > QOS0) {
-        rc = _mask_push_pubInfo_to(pClient, len, pParams->id, &node);
+        rc = _mask_push_pubInfo_to(pClient, len, pParams->id, &pub_info);
         if (QCLOUD_RET_SUCCESS != rc) {
             Log_e("push publish into to pubInfolist failed!");
-            HAL_MutexUnlock(pClient->lock_write_buf);
-            IOT_FUNC_EXIT_RC(rc);
+            goto exit_unlock;
         }
     }
 
@@ -367,17 +467,76 @@ int qcloud_iot_mqtt_publish(Qcloud_IoT_Client *pClient, char *topicName, Publish
     if (QCLOUD_RET_SUCCESS != rc) {
         if (pParams->qos > QOS0) {
             HAL_MutexLock(pClient->lock_list_pub);
-            list_remove(pClient->list_pub_wait_ack, node);
+            list_unlink(&pClient->list_pub_wait_ack, &pub_info->list);
+            utils_mem_free(pub_info);
             HAL_MutexUnlock(pClient->lock_list_pub);
         }
-
-        HAL_MutexUnlock(pClient->lock_write_buf);
-        IOT_FUNC_EXIT_RC(rc);
+        goto exit_unlock;
     }
 
     HAL_MutexUnlock(pClient->lock_write_buf);
 
     IOT_FUNC_EXIT_RC(pParams->id);
+
+exit_unlock:
+#ifdef MQTT5_ENABLED
+    /* server did not get the packet mapping a new alias */
+    if (topicAlias && !aliasMapped) {
+        mqtt5_topic_alias_drop(pClient, topicAlias);
+    }
+#endif
+    HAL_MutexUnlock(pClient->lock_write_buf);
+    IOT_FUNC_EXIT_RC(rc);
+}
+
+int qcloud_iot_mqtt_publish(Qcloud_IoT_Client *pClient, char *topicName, PublishParams *pParams)
+{
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pParams, QCLOUD_ERR_INVAL);
+    STRING_PTR_SANITY_CHECK(topicName, QCLOUD_ERR_INVAL);
+
+    size_t topicLen = strlen(topicName);
+    if (topicLen > MAX_SIZE_OF_CLOUD_TOPIC) {
+        return QCLOUD_ERR_MAX_TOPIC_LENGTH;
+    }
+
+    return _mqtt_publish(pClient, topicName, (uint16_t)topicLen, NULL, pParams);
+}
+
+int qcloud_iot_mqtt_publish_topic(Qcloud_IoT_Client *pClient, const MQTTTopicHandle *pTopic, PublishParams *pParams)
+{
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pTopic, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pParams, QCLOUD_ERR_INVAL);
+    NUMBERIC_SANITY_CHECK(pTopic->len, QCLOUD_ERR_INVAL);
+
+    /* checked and encoded by qcloud_iot_mqtt_topic_init, the name follows the length and is null terminated */
+    return _mqtt_publish(pClient, (const char *)pTopic->wire + 2, pTopic->len, pTopic->wire, pParams);
+}
+
+int qcloud_iot_mqtt_topic_init(MQTTTopicHandle *pTopic, const char *topicName)
+{
+    POINTER_SANITY_CHECK(pTopic, QCLOUD_ERR_INVAL);
+    STRING_PTR_SANITY_CHECK(topicName, QCLOUD_ERR_INVAL);
+
+    unsigned char *ptr      = pTopic->wire;
+    size_t         topicLen = strlen(topicName);
+
+    pTopic->len = 0;
+    if (topicLen > MAX_SIZE_OF_CLOUD_TOPIC) {
+        return QCLOUD_ERR_MAX_TOPIC_LENGTH;
+    }
+    /* wildcards are for topic filters only, MQTT spec 3.3.2.1 */
+    if (strpbrk(topicName, "+#")) {
+        Log_e("wildcard in publish topic %s", topicName);
+        return QCLOUD_ERR_INVAL;
+    }
+
+    mqtt_write_uint_16(&ptr, (uint16_t)topicLen);
+    memcpy(ptr, topicName, topicLen + 1);
+    pTopic->len = (uint16_t)topicLen;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
 #ifdef __cplusplus
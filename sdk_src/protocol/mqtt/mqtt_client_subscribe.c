@@ -21,18 +21,24 @@ extern "C" {
 #include <string.h>
 
 #include "mqtt_client.h"
+#include "utils_mem.h"
 
 /**
  * Determines the length of the MQTT subscribe packet that would be produced using the supplied parameters
  * @param count the number of topic filter strings in topicFilters
  * @param topicFilters the array of topic filter strings to be used in the publish
+ * @param mqtt_version the MQTT protocol version, properties are only in MQTT 5
  * @return the length of buffer needed to contain the serialized version of the packet
  */
-static uint32_t _get_subscribe_packet_rem_len(uint32_t count, char **topicFilters)
+static uint32_t _get_subscribe_packet_rem_len(uint32_t count, char **topicFilters, uint8_t mqtt_version)
 {
     size_t i;
     size_t len = 2; /* packetid */
 
+    if (MQTT_5_0 == mqtt_version) {
+        len += 1; /* empty properties */
+    }
+
     for (i = 0; i < count; ++i) {
         len += 2 + strlen(*topicFilters + i) + 1; /* length + topic + req_qos */
     }
@@ -49,10 +55,11 @@ static uint32_t _get_subscribe_packet_rem_len(uint32_t count, char **topicFilter
  * @param count - number of members in the topicFilters and reqQos arrays
  * @param topicFilters - array of topic filter names
  * @param requestedQoSs - array of requested QoS
+ * @param mqtt_version - the MQTT protocol version
  * @return the length of the serialized data.  <= 0 indicates error
  */
 static int _serialize_subscribe_packet(unsigned char *buf, size_t buf_len, uint8_t dup, uint16_t packet_id,
-                                       uint32_t count, char **topicFilters, QoS *requestedQoSs,
+                                       uint32_t count, char **topicFilters, QoS *requestedQoSs, uint8_t mqtt_version,
                                        uint32_t *serialized_len)
 {
     IOT_FUNC_ENTRY;
@@ -68,7 +75,7 @@ static int _serialize_subscribe_packet(unsigned char *buf, size_t buf_len, uint8
 
     // remaining length of SUBSCRIBE packet = packet type(2 byte) + count * (remaining length(2 byte) + topicLen + qos(1
     // byte))
-    rem_len = _get_subscribe_packet_rem_len(count, topicFilters);
+    rem_len = _get_subscribe_packet_rem_len(count, topicFilters, mqtt_version);
     if (get_mqtt_packet_len(rem_len) > buf_len) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_BUF_TOO_SHORT);
     }
@@ -83,7 +90,10 @@ static int _serialize_subscribe_packet(unsigned char *buf, size_t buf_len, uint8
     ptr += mqtt_write_packet_rem_len(ptr, rem_len);
     // variable header
     mqtt_write_uint_16(&ptr, packet_id);
-    // payload
+    if (MQTT_5_0 == mqtt_version) {
+        mqtt_write_char(&ptr, 0);
+    }
+    // payload, the QoS byte is also the subscription options of MQTT 5 with the other options cleared
     for (i = 0; i < count; ++i) {
         mqtt_write_utf8_string(&ptr, *topicFilters + i);
         mqtt_write_char(&ptr, (unsigned char)requestedQoSs[i]);
@@ -94,7 +104,7 @@ static int _serialize_subscribe_packet(unsigned char *buf, size_t buf_len, uint8
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
-int qcloud_iot_mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, SubscribeParams *pParams)
+static int _mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, SubscribeParams *pParams, bool routed)
 {
     IOT_FUNC_ENTRY;
     int rc;
@@ -108,7 +118,7 @@ int qcloud_iot_mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, Sub
     uint32_t len       = 0;
     uint16_t packet_id = 0;
 
-    ListNode *node = NULL;
+    QcloudIotSubInfo *sub_info = NULL;
 
     size_t topicLen = strlen(topicFilter);
     if (topicLen > MAX_SIZE_OF_CLOUD_TOPIC) {
@@ -142,7 +152,7 @@ int qcloud_iot_mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, Sub
     Log_d("topicName=%s|packet_id=%d", topic_filter_stored, packet_id);
 
     rc = _serialize_subscribe_packet(pClient->write_buf, pClient->write_buf_size, 0, packet_id, 1, &topic_filter_stored,
-                                     &pParams->qos, &len);
+                                     &pParams->qos, pClient->options.mqtt_version, &len);
     if (QCLOUD_RET_SUCCESS != rc) {
         HAL_MutexUnlock(pClient->lock_write_buf);
         HAL_Free(topic_filter_stored);
@@ -156,8 +166,9 @@ int qcloud_iot_mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, Sub
     sub_handle.sub_event_handler = pParams->on_sub_event_handler;
     sub_handle.qos               = pParams->qos;
     sub_handle.handler_user_data = pParams->user_data;
+    sub_handle.routed            = routed;
 
-    rc = push_sub_info_to(pClient, len, (unsigned int)packet_id, SUBSCRIBE, &sub_handle, &node);
+    rc = push_sub_info_to(pClient, len, (unsigned int)packet_id, SUBSCRIBE, &sub_handle, &sub_info);
     if (QCLOUD_RET_SUCCESS != rc) {
         Log_e("push publish into to pubInfolist failed!");
         HAL_MutexUnlock(pClient->lock_write_buf);
@@ -169,7 +180,8 @@ int qcloud_iot_mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, Sub
     rc = send_mqtt_packet(pClient, len, &timer);
     if (QCLOUD_RET_SUCCESS != rc) {
         HAL_MutexLock(pClient->lock_list_sub);
-        list_remove(pClient->list_sub_wait_ack, node);
+        list_unlink(&pClient->list_sub_wait_ack, &sub_info->list);
+        utils_mem_free(sub_info);
         HAL_MutexUnlock(pClient->lock_list_sub);
 
         HAL_MutexUnlock(pClient->lock_write_buf);
@@ -182,6 +194,16 @@ int qcloud_iot_mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, Sub
     IOT_FUNC_EXIT_RC(packet_id);
 }
 
+int qcloud_iot_mqtt_subscribe(Qcloud_IoT_Client *pClient, char *topicFilter, SubscribeParams *pParams)
+{
+    return _mqtt_subscribe(pClient, topicFilter, pParams, false);
+}
+
+int qcloud_iot_mqtt_subscribe_routed(Qcloud_IoT_Client *pClient, char *topicFilter, SubscribeParams *pParams)
+{
+    return _mqtt_subscribe(pClient, topicFilter, pParams, true);
+}
+
 int qcloud_iot_mqtt_resubscribe(Qcloud_IoT_Client *pClient)
 {
     IOT_FUNC_ENTRY;
@@ -21,18 +21,24 @@ extern "C" {
 #include <string.h>
 
 #include "mqtt_client.h"
+#include "utils_mem.h"
 
 /**
  * Determines the length of the MQTT unsubscribe packet that would be produced using the supplied parameters
  * @param count the number of topic filter strings in topicFilters
  * @param topicFilters the array of topic filter strings to be used in the publish
+ * @param mqtt_version the MQTT protocol version, properties are only in MQTT 5
  * @return the length of buffer needed to contain the serialized version of the packet
  */
-static uint32_t _get_unsubscribe_packet_rem_len(uint32_t count, char **topicFilters)
+static uint32_t _get_unsubscribe_packet_rem_len(uint32_t count, char **topicFilters, uint8_t mqtt_version)
 {
     size_t i;
     size_t len = 2; /* packetid */
 
+    if (MQTT_5_0 == mqtt_version) {
+        len += 1; /* empty properties */
+    }
+
     for (i = 0; i < count; ++i) {
         len += 2 + strlen(*topicFilters + i); /* length + topic*/
     }
@@ -48,11 +54,13 @@ static uint32_t _get_unsubscribe_packet_rem_len(uint32_t count, char **topicFilt
  * @param packet_id integer - the MQTT packet identifier
  * @param count - number of members in the topicFilters array
  * @param topicFilters - array of topic filter names
+ * @param mqtt_version - the MQTT protocol version
  * @param serialized_len - the length of the serialized data
  * @return int indicating function execution status
  */
 static int _serialize_unsubscribe_packet(unsigned char *buf, size_t buf_len, uint8_t dup, uint16_t packet_id,
-                                         uint32_t count, char **topicFilters, uint32_t *serialized_len)
+                                         uint32_t count, char **topicFilters, uint8_t mqtt_version,
+                                         uint32_t *serialized_len)
 {
     IOT_FUNC_ENTRY;
 
@@ -65,7 +73,7 @@ static int _serialize_unsubscribe_packet(unsigned char *buf, size_t buf_len, uin
     uint32_t       i       = 0;
     int            rc;
 
-    rem_len = _get_unsubscribe_packet_rem_len(count, topicFilters);
+    rem_len = _get_unsubscribe_packet_rem_len(count, topicFilters, mqtt_version);
     if (get_mqtt_packet_len(rem_len) > buf_len) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_BUF_TOO_SHORT);
     }
@@ -79,6 +87,9 @@ static int _serialize_unsubscribe_packet(unsigned char *buf, size_t buf_len, uin
     ptr += mqtt_write_packet_rem_len(ptr, rem_len); /* write remaining length */
 
     mqtt_write_uint_16(&ptr, packet_id);
+    if (MQTT_5_0 == mqtt_version) {
+        mqtt_write_char(&ptr, 0);
+    }
 
     for (i = 0; i < count; ++i) {
         mqtt_write_utf8_string(&ptr, *topicFilters + i);
@@ -89,7 +100,7 @@ static int _serialize_unsubscribe_packet(unsigned char *buf, size_t buf_len, uin
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
-int qcloud_iot_mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter)
+static int _mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter, bool routed)
 {
     IOT_FUNC_ENTRY;
     int rc;
@@ -101,18 +112,18 @@ int qcloud_iot_mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter)
     Timer    timer;
     uint32_t len          = 0;
     uint16_t packet_id    = 0;
-    bool     suber_exists = false;
+    bool     suber_exists = routed;
 
-    ListNode *node = NULL;
+    QcloudIotSubInfo *sub_info = NULL;
 
     size_t topicLen = strlen(topicFilter);
     if (topicLen > MAX_SIZE_OF_CLOUD_TOPIC) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_MAX_TOPIC_LENGTH);
     }
 
-    /* Remove from message handler array */
+    /* Remove from message handler array, a routed subscription has no entry there */
     HAL_MutexLock(pClient->lock_generic);
-    for (i = 0; i < MAX_MESSAGE_HANDLERS; ++i) {
+    for (i = 0; i < MAX_MESSAGE_HANDLERS && !routed; ++i) {
         if ((pClient->sub_handles[i].topic_filter != NULL &&
              !strcmp(pClient->sub_handles[i].topic_filter, topicFilter)) ||
             strstr(topicFilter, "/#") != NULL || strstr(topicFilter, "/+") != NULL) {
@@ -156,7 +167,7 @@ int qcloud_iot_mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter)
     HAL_MutexLock(pClient->lock_write_buf);
     packet_id = get_next_packet_id(pClient);
     rc        = _serialize_unsubscribe_packet(pClient->write_buf, pClient->write_buf_size, 0, packet_id, 1,
-                                       &topic_filter_stored, &len);
+                                       &topic_filter_stored, pClient->options.mqtt_version, &len);
     if (QCLOUD_RET_SUCCESS != rc) {
         HAL_MutexUnlock(pClient->lock_write_buf);
         HAL_Free(topic_filter_stored);
@@ -168,8 +179,9 @@ int qcloud_iot_mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter)
     sub_handle.sub_event_handler = NULL;
     sub_handle.message_handler   = NULL;
     sub_handle.handler_user_data = NULL;
+    sub_handle.routed            = routed;
 
-    rc = push_sub_info_to(pClient, len, (unsigned int)packet_id, UNSUBSCRIBE, &sub_handle, &node);
+    rc = push_sub_info_to(pClient, len, (unsigned int)packet_id, UNSUBSCRIBE, &sub_handle, &sub_info);
     if (QCLOUD_RET_SUCCESS != rc) {
         Log_e("push publish into to pubInfolist failed: %d", rc);
         HAL_MutexUnlock(pClient->lock_write_buf);
@@ -181,7 +193,8 @@ int qcloud_iot_mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter)
     rc = send_mqtt_packet(pClient, len, &timer);
     if (QCLOUD_RET_SUCCESS != rc) {
         HAL_MutexLock(pClient->lock_list_sub);
-        list_remove(pClient->list_sub_wait_ack, node);
+        list_unlink(&pClient->list_sub_wait_ack, &sub_info->list);
+        utils_mem_free(sub_info);
         HAL_MutexUnlock(pClient->lock_list_sub);
 
         HAL_MutexUnlock(pClient->lock_write_buf);
@@ -194,6 +207,16 @@ int qcloud_iot_mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter)
     IOT_FUNC_EXIT_RC(packet_id);
 }
 
+int qcloud_iot_mqtt_unsubscribe(Qcloud_IoT_Client *pClient, char *topicFilter)
+{
+    return _mqtt_unsubscribe(pClient, topicFilter, false);
+}
+
+int qcloud_iot_mqtt_unsubscribe_routed(Qcloud_IoT_Client *pClient, char *topicFilter)
+{
+    return _mqtt_unsubscribe(pClient, topicFilter, true);
+}
+
 #ifdef __cplusplus
 }
 #endif
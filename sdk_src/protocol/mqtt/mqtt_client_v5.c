@@ -0,0 +1,306 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <string.h>
+
+#include "mqtt_client.h"
+
+#ifdef MQTT5_ENABLED
+
+/* a variable byte integer takes 4 bytes at most, MQTT v5.0 Specification 1.5.5 */
+#define MQTT5_MAX_VBI_BYTES 4
+
+/* data type of a property value, MQTT v5.0 Specification 2.2.2.2 */
+typedef enum {
+    eMQTT5_PROP_BYTE = 0,
+    eMQTT5_PROP_UINT16,
+    eMQTT5_PROP_UINT32,
+    eMQTT5_PROP_VBI,
+    eMQTT5_PROP_BINARY,  // UTF-8 string has the same layout
+    eMQTT5_PROP_PAIR,    // UTF-8 string pair
+    eMQTT5_PROP_INVALID,
+} MQTT5PropType;
+
+static MQTT5PropType _property_type(uint8_t id)
+{
+    switch (id) {
+        case 0x01: /* Payload Format Indicator */
+        case 0x17: /* Request Problem Information */
+        case 0x19: /* Request Response Information */
+        case 0x24: /* Maximum QoS */
+        case 0x25: /* Retain Available */
+        case 0x28: /* Wildcard Subscription Available */
+        case 0x29: /* Subscription Identifier Available */
+        case 0x2A: /* Shared Subscription Available */
+            return eMQTT5_PROP_BYTE;
+        case 0x13: /* Server Keep Alive */
+        case 0x21: /* Receive Maximum */
+        case 0x22: /* Topic Alias Maximum */
+        case 0x23: /* Topic Alias */
+            return eMQTT5_PROP_UINT16;
+        case 0x02: /* Message Expiry Interval */
+        case 0x11: /* Session Expiry Interval */
+        case 0x18: /* Will Delay Interval */
+        case 0x27: /* Maximum Packet Size */
+            return eMQTT5_PROP_UINT32;
+        case 0x0B: /* Subscription Identifier */
+            return eMQTT5_PROP_VBI;
+        case 0x03: /* Content Type */
+        case 0x08: /* Response Topic */
+        case 0x09: /* Correlation Data */
+        case 0x12: /* Assigned Client Identifier */
+        case 0x15: /* Authentication Method */
+        case 0x16: /* Authentication Data */
+        case 0x1A: /* Response Information */
+        case 0x1C: /* Server Reference */
+        case 0x1F: /* Reason String */
+            return eMQTT5_PROP_BINARY;
+        case 0x26: /* User Property */
+            return eMQTT5_PROP_PAIR;
+        default:
+            return eMQTT5_PROP_INVALID;
+    }
+}
+
+static int _read_vbi(unsigned char **pptr, unsigned char *enddata, uint32_t *value)
+{
+    uint32_t multiplier = 1;
+    int      i;
+
+    *value = 0;
+    for (i = 0; i < MQTT5_MAX_VBI_BYTES; i++) {
+        if (*pptr >= enddata) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        unsigned char c = mqtt_read_char(pptr);
+        *value += (c & 127) * multiplier;
+        if (!(c & 128)) {
+            return QCLOUD_RET_SUCCESS;
+        }
+        multiplier *= 128;
+    }
+
+    return QCLOUD_ERR_FAILURE;
+}
+
+/**
+ * Read one property, the value of numeric types is returned and the others are skipped
+ * @param pptr pointer to the property identifier - incremented past the property
+ * @param enddata end of the property list
+ * @param id returned property identifier
+ * @param value returned value of byte/integer properties
+ * @return QCLOUD_RET_SUCCESS if successful
+ */
+static int _read_property(unsigned char **pptr, unsigned char *enddata, uint8_t *id, uint32_t *value)
+{
+    unsigned char *ptr = *pptr;
+    uint16_t       len;
+    int            i;
+
+    *id    = mqtt_read_char(&ptr);
+    *value = 0;
+
+    switch (_property_type(*id)) {
+        case eMQTT5_PROP_BYTE:
+            if (enddata - ptr < 1) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            *value = mqtt_read_char(&ptr);
+            break;
+        case eMQTT5_PROP_UINT16:
+            if (enddata - ptr < 2) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            *value = mqtt_read_uint16_t(&ptr);
+            break;
+        case eMQTT5_PROP_UINT32:
+            if (enddata - ptr < 4) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            *value = ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) | ((uint32_t)ptr[2] << 8) | ptr[3];
+            ptr += 4;
+            break;
+        case eMQTT5_PROP_VBI:
+            if (QCLOUD_RET_SUCCESS != _read_vbi(&ptr, enddata, value)) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            break;
+        case eMQTT5_PROP_BINARY:
+        case eMQTT5_PROP_PAIR:
+            for (i = (eMQTT5_PROP_PAIR == _property_type(*id)) ? 2 : 1; i > 0; i--) {
+                if (enddata - ptr < 2) {
+                    return QCLOUD_ERR_FAILURE;
+                }
+                len = mqtt_read_uint16_t(&ptr);
+                if (enddata - ptr < len) {
+                    return QCLOUD_ERR_FAILURE;
+                }
+                ptr += len;
+            }
+            break;
+        default:
+            Log_e("unknown MQTT5 property 0x%02x", *id);
+            return QCLOUD_ERR_FAILURE;
+    }
+
+    *pptr = ptr;
+    return QCLOUD_RET_SUCCESS;
+}
+
+/* read the property length and return the end of the property list */
+static int _read_properties_end(unsigned char **pptr, unsigned char *enddata, unsigned char **props_end)
+{
+    uint32_t props_len = 0;
+
+    if (QCLOUD_RET_SUCCESS != _read_vbi(pptr, enddata, &props_len) || props_len > (uint32_t)(enddata - *pptr)) {
+        Log_e("malformed MQTT5 property length");
+        return QCLOUD_ERR_FAILURE;
+    }
+    *props_end = *pptr + props_len;
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+size_t mqtt5_vbi_len(uint32_t value)
+{
+    return get_mqtt_packet_len(value) - value - 1;
+}
+
+int mqtt5_skip_properties(unsigned char **pptr, unsigned char *enddata)
+{
+    unsigned char *props_end = NULL;
+    int            rc;
+
+    /* the property length is left out when there is nothing after it */
+    if (*pptr == enddata) {
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    rc = _read_properties_end(pptr, enddata, &props_end);
+    if (QCLOUD_RET_SUCCESS == rc) {
+        *pptr = props_end;
+    }
+
+    return rc;
+}
+
+void mqtt5_session_reset(Qcloud_IoT_Client *pClient)
+{
+    MQTT5SessionState *state = &pClient->v5_state;
+
+    /* defaults when the property is absent from CONNACK, MQTT v5.0 Specification 3.2.2.3 */
+    memset(state, 0, sizeof(MQTT5SessionState));
+    state->receive_max = 65535;
+    state->qos_max     = QOS2;
+}
+
+int mqtt5_read_connack_properties(Qcloud_IoT_Client *pClient, unsigned char **pptr, unsigned char *enddata)
+{
+    MQTT5SessionState *state     = &pClient->v5_state;
+    unsigned char *    props_end = NULL;
+    uint8_t            id;
+    uint32_t           value;
+
+    if (*pptr == enddata) {
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    if (QCLOUD_RET_SUCCESS != _read_properties_end(pptr, enddata, &props_end)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    while (*pptr < props_end) {
+        if (QCLOUD_RET_SUCCESS != _read_property(pptr, props_end, &id, &value)) {
+            return QCLOUD_ERR_FAILURE;
+        }
+
+        switch (id) {
+            case MQTT5_PROP_RECEIVE_MAXIMUM:
+                state->receive_max = value ? (uint16_t)value : 65535;
+                break;
+            case MQTT5_PROP_TOPIC_ALIAS_MAX:
+                state->alias_max = (uint16_t)value;
+                break;
+            case MQTT5_PROP_MAX_PACKET_SIZE:
+                state->packet_max = value;
+                break;
+            case MQTT5_PROP_MAXIMUM_QOS:
+                state->qos_max = (uint8_t)value;
+                break;
+            case MQTT5_PROP_SERVER_KEEP_ALIVE:
+                /* server keep alive replaces the one client asked for, MQTT v5.0 Specification 3.2.2.3.14 */
+                Log_i("server keep alive %u s", value);
+                pClient->options.keep_alive_interval = (uint16_t)value;
+                break;
+            default:
+                break;
+        }
+    }
+
+    Log_d("MQTT5 receive max %u, topic alias max %u, max packet size %u, max qos %u", state->receive_max,
+          state->alias_max, state->packet_max, state->qos_max);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+uint16_t mqtt5_topic_alias_get(Qcloud_IoT_Client *pClient, const char *topicName, uint16_t topicLen, bool *mapped)
+{
+    MQTT5SessionState *state = &pClient->v5_state;
+    uint16_t           num   = Min(state->alias_max, MQTT5_TOPIC_ALIAS_NUM);
+    uint16_t           i, lru = 0;
+
+    *mapped = false;
+    if (0 == num || 0 == topicLen) {
+        return 0;
+    }
+
+    for (i = 0; i < num; i++) {
+        MQTT5TopicAlias *slot = &state->alias[i];
+        if (slot->last_used && slot->len == topicLen && !memcmp(slot->topic, topicName, topicLen)) {
+            slot->last_used = ++state->alias_clock;
+            *mapped         = true;
+            return i + 1;
+        }
+        if (slot->last_used < state->alias[lru].last_used) {
+            lru = i;
+        }
+    }
+
+    /* remap the least recently used alias, the PUBLISH carrying topic name and alias updates server side */
+    MQTT5TopicAlias *slot = &state->alias[lru];
+    memcpy(slot->topic, topicName, topicLen);
+    slot->topic[topicLen] = '\0';
+    slot->len             = topicLen;
+    slot->last_used       = ++state->alias_clock;
+
+    return lru + 1;
+}
+
+void mqtt5_topic_alias_drop(Qcloud_IoT_Client *pClient, uint16_t alias)
+{
+    if (alias > 0 && alias <= MQTT5_TOPIC_ALIAS_NUM) {
+        pClient->v5_state.alias[alias - 1].last_used = 0;
+    }
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
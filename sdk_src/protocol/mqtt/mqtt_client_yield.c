@@ -21,12 +21,75 @@ extern "C" {
 #include "log_upload.h"
 #include "mqtt_client.h"
 #include "qcloud_iot_import.h"
+#include "utils_mem.h"
 
-static uint32_t _get_random_interval(void)
+/* xorshift32, seeded with the client id so that devices cut off together do not retry together */
+static uint32_t _get_random(Qcloud_IoT_Client *pClient)
 {
-    srand((unsigned)HAL_GetTimeMs());
-    /* range: 1000 - 2000 ms, in 10ms unit */
-    return (rand() % 100 + 100) * 10;
+    uint32_t    x = pClient->reconnect_rand;
+    const char *c;
+
+    if (0 == x) {
+        x = HAL_GetTimeMs() ^ (uint32_t)(uintptr_t)pClient;
+        for (c = pClient->device_info.client_id; *c != '\0'; c++) {
+            x = x * 31 + (uint8_t)*c;
+        }
+        if (0 == x) {
+            x = 1;
+        }
+    }
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    pClient->reconnect_rand = x;
+    return x;
+}
+
+/* full jitter: wait a random time between 0 and the current ceiling */
+static void _start_reconnect_delay(Qcloud_IoT_Client *pClient)
+{
+    countdown_ms(&(pClient->reconnect_delay_timer),
+                 _get_random(pClient) % (pClient->current_reconnect_wait_interval + 1));
+}
+
+static bool _is_reconnect_timeout(Qcloud_IoT_Client *pClient)
+{
+    return (uint32_t)(HAL_GetTimeMs() - pClient->disconnect_time_ms) > MAX_RECONNECT_DOWN_TIME;
+}
+
+/* try the next server after a failed attempt */
+static void _switch_host(Qcloud_IoT_Client *pClient)
+{
+    if (0 == pClient->backup_host_num) {
+        return;
+    }
+
+    HAL_MutexLock(pClient->lock_generic);
+    pClient->host_index         = (pClient->host_index + 1) % (pClient->backup_host_num + 1);
+    pClient->network_stack.host = pClient->host_index ? pClient->backup_hosts[pClient->host_index - 1]
+                                                      : pClient->host_addr;
+    pClient->reconnect_stat.failovers++;
+    HAL_MutexUnlock(pClient->lock_generic);
+
+    Log_i("switch to MQTT server %s", pClient->network_stack.host);
+}
+
+static void _update_reconnect_stat(Qcloud_IoT_Client *pClient)
+{
+    uint32_t down_ms = HAL_GetTimeMs() - pClient->disconnect_time_ms;
+
+    HAL_MutexLock(pClient->lock_generic);
+    pClient->reconnect_stat.reconnects++;
+    pClient->reconnect_stat.last_ms = down_ms;
+    pClient->reconnect_stat.total_ms += down_ms;
+    if (down_ms > pClient->reconnect_stat.max_ms) {
+        pClient->reconnect_stat.max_ms = down_ms;
+    }
+    HAL_MutexUnlock(pClient->lock_generic);
+
+    Log_i("reconnected to %s after %u ms", pClient->network_stack.host, down_ms);
 }
 
 static void _iot_disconnect_callback(Qcloud_IoT_Client *pClient)
@@ -92,10 +155,11 @@ static int _handle_reconnect(Qcloud_IoT_Client *pClient)
 {
     IOT_FUNC_ENTRY;
 
-    int8_t isPhysicalLayerConnected = 1;
-    int    rc                       = QCLOUD_RET_MQTT_RECONNECTED;
+    int8_t  isPhysicalLayerConnected = 1;
+    int     rc                       = QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT;
+    uint8_t i;
 
-    // reconnect control by delay timer (increase interval exponentially )
+    // reconnect control by delay timer (random delay, the ceiling increases exponentially)
     if (!expired(&(pClient->reconnect_delay_timer))) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT);
     }
@@ -105,10 +169,16 @@ static int _handle_reconnect(Qcloud_IoT_Client *pClient)
             (int8_t)pClient->network_stack.is_connected(&(pClient->network_stack));  // always return 1
     }
 
-    if (isPhysicalLayerConnected) {
+    // each server is tried once, starting with the one connected last
+    for (i = 0; isPhysicalLayerConnected && i <= pClient->backup_host_num; i++) {
+        HAL_MutexLock(pClient->lock_generic);
+        pClient->reconnect_stat.attempts++;
+        HAL_MutexUnlock(pClient->lock_generic);
+
         rc = qcloud_iot_mqtt_attempt_reconnect(pClient);
         if (rc == QCLOUD_RET_MQTT_RECONNECTED) {
             Log_e("attempt to reconnect success.");
+            _update_reconnect_stat(pClient);
             _reconnect_callback(pClient);
 #ifdef LOG_UPLOAD
             if (is_log_uploader_init()) {
@@ -119,18 +189,23 @@ static int _handle_reconnect(Qcloud_IoT_Client *pClient)
             }
 #endif
             IOT_FUNC_EXIT_RC(rc);
-        } else {
-            Log_e("attempt to reconnect failed, errCode: %d", rc);
-            rc = QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT;
         }
-    }
 
-    pClient->current_reconnect_wait_interval *= 2;
+        Log_e("attempt to reconnect failed, errCode: %d", rc);
+        rc = QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT;
+        if (get_client_conn_state(pClient)) {
+            break;
+        }
+        _switch_host(pClient);
+    }
 
-    if (MAX_RECONNECT_WAIT_INTERVAL < pClient->current_reconnect_wait_interval) {
+    if (_is_reconnect_timeout(pClient)) {
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_MQTT_RECONNECT_TIMEOUT);
     }
-    countdown_ms(&(pClient->reconnect_delay_timer), pClient->current_reconnect_wait_interval);
+
+    pClient->current_reconnect_wait_interval =
+        Min(2 * pClient->current_reconnect_wait_interval, MAX_RECONNECT_WAIT_INTERVAL);
+    _start_reconnect_delay(pClient);
 
     IOT_FUNC_EXIT_RC(rc);
 }
@@ -207,11 +282,12 @@ static int _mqtt_keep_alive(Qcloud_IoT_Client *pClient)
  *
  * @param pClient    handle to MQTT client
  * @param timeout_ms timeout value (unit: ms) for this operation
+ * @param done       return as soon as it becomes true after a packet is handled, NULL to run until timeout
  *
  * @return QCLOUD_RET_SUCCESS when success, QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT when try reconnecing, or err code for
  * failure
  */
-int qcloud_iot_mqtt_yield(Qcloud_IoT_Client *pClient, uint32_t timeout_ms)
+static int _mqtt_yield(Qcloud_IoT_Client *pClient, uint32_t timeout_ms, volatile bool *done)
 {
     IOT_FUNC_ENTRY;
 
@@ -236,13 +312,18 @@ int qcloud_iot_mqtt_yield(Qcloud_IoT_Client *pClient, uint32_t timeout_ms)
     countdown_ms(&timer, timeout_ms);
 
     // 3. main loop for packet reading/handling and keep alive maintainance
-    while (!expired(&timer)) {
+    while (!expired(&timer) && !(done && *done)) {
         if (!get_client_conn_state(pClient)) {
-            if (pClient->current_reconnect_wait_interval > MAX_RECONNECT_WAIT_INTERVAL) {
+            if (_is_reconnect_timeout(pClient)) {
                 rc = QCLOUD_ERR_MQTT_RECONNECT_TIMEOUT;
                 break;
             }
             rc = _handle_reconnect(pClient);
+            if (rc == QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT) {
+                /* nothing to read until reconnected, sleep till the next attempt instead of spinning.
+                 * A failed attempt can outlast the yield timeout and left_ms() goes negative on the RTOS HALs */
+                HAL_SleepMs(Max(Min(left_ms(&(pClient->reconnect_delay_timer)), left_ms(&timer)), 0));
+            }
 
             continue;
         }
@@ -265,10 +346,14 @@ int qcloud_iot_mqtt_yield(Qcloud_IoT_Client *pClient, uint32_t timeout_ms)
 
         if (rc == QCLOUD_ERR_MQTT_NO_CONN) {
             pClient->counter_network_disconnected++;
+            pClient->disconnect_time_ms = HAL_GetTimeMs();
+            HAL_MutexLock(pClient->lock_generic);
+            pClient->reconnect_stat.disconnects++;
+            HAL_MutexUnlock(pClient->lock_generic);
 
             if (pClient->options.auto_connect_enable == 1) {
-                pClient->current_reconnect_wait_interval = _get_random_interval();
-                countdown_ms(&(pClient->reconnect_delay_timer), pClient->current_reconnect_wait_interval);
+                pClient->current_reconnect_wait_interval = MIN_RECONNECT_WAIT_INTERVAL;
+                _start_reconnect_delay(pClient);
 
                 // reconnect timeout
                 rc = QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT;
@@ -283,6 +368,11 @@ int qcloud_iot_mqtt_yield(Qcloud_IoT_Client *pClient, uint32_t timeout_ms)
     IOT_FUNC_EXIT_RC(rc);
 }
 
+int qcloud_iot_mqtt_yield(Qcloud_IoT_Client *pClient, uint32_t timeout_ms)
+{
+    return _mqtt_yield(pClient, timeout_ms, NULL);
+}
+
 // workaround wrapper for qcloud_iot_mqtt_yield for multi-thread mode
 int qcloud_iot_mqtt_yield_mt(Qcloud_IoT_Client *mqtt_client, uint32_t timeout_ms)
 {
@@ -300,87 +390,144 @@ int qcloud_iot_mqtt_yield_mt(Qcloud_IoT_Client *mqtt_client, uint32_t timeout_ms
     return qcloud_iot_mqtt_yield(mqtt_client, timeout_ms);
 }
 
-/**
- * @brief puback waiting timeout process
- *
- * @param pClient reference to MQTTClient
- *
- */
-int qcloud_iot_mqtt_pub_info_proc(Qcloud_IoT_Client *pClient)
+#ifdef MULTITHREAD_ENABLED
+/* yield slice of a waiter when callbacks run on dispatch workers and signal after the packet is handled */
+#define MQTT_SYNC_DISPATCH_SLICE_MS 10
+
+/* sleep slice of a waiter when the completion has no semaphore */
+#define MQTT_SYNC_POLL_MS 10
+#endif
+
+void qcloud_iot_completion_init(QcloudIotCompletion *completion)
 {
-    IOT_FUNC_ENTRY;
+    completion->done = false;
+#ifdef MULTITHREAD_ENABLED
+    completion->sem = HAL_SemaphoreCreate();
+    if (NULL == completion->sem) {
+        Log_w("create completion semaphore fail, fall back to polling");
+    }
+#endif
+}
+
+void qcloud_iot_completion_deinit(QcloudIotCompletion *completion)
+{
+#ifdef MULTITHREAD_ENABLED
+    if (NULL != completion->sem) {
+        HAL_SemaphoreDestroy(completion->sem);
+        completion->sem = NULL;
+    }
+#endif
+    completion->done = false;
+}
 
+void qcloud_iot_completion_reset(QcloudIotCompletion *completion)
+{
+    /* a stale post left by a late reply only wakes the next waiter once, it checks done and waits again */
+    completion->done = false;
+}
+
+void qcloud_iot_completion_signal(QcloudIotCompletion *completion)
+{
+    completion->done = true;
+#ifdef MULTITHREAD_ENABLED
+    if (NULL != completion->sem) {
+        HAL_SemaphorePost(completion->sem);
+    }
+#endif
+}
+
+int qcloud_iot_mqtt_wait_completion(Qcloud_IoT_Client *pClient, QcloudIotCompletion *completion, uint32_t timeout_ms)
+{
     POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(completion, QCLOUD_ERR_INVAL);
 
-    HAL_MutexLock(pClient->lock_list_pub);
-    do {
-        if (0 == pClient->list_pub_wait_ack->len) {
-            break;
-        }
+    int   rc = QCLOUD_RET_SUCCESS;
+    int   left;
+    Timer timer;
 
-        ListIterator *iter;
-        ListNode *    node      = NULL;
-        ListNode *    temp_node = NULL;
+    InitTimer(&timer);
+    countdown_ms(&timer, timeout_ms);
 
-        if (NULL == (iter = list_iterator_new(pClient->list_pub_wait_ack, LIST_TAIL))) {
-            Log_e("new list failed");
-            break;
+    while (!completion->done) {
+        /* goes below zero once expired on the RTOS timer HALs */
+        left = left_ms(&timer);
+        if (left <= 0) {
+            return QCLOUD_ERR_MQTT_REQUEST_TIMEOUT;
         }
 
-        for (;;) {
-            node = list_iterator_next(iter);
-
-            if (NULL != temp_node) {
-                list_remove(pClient->list_pub_wait_ack, temp_node);
-                temp_node = NULL;
+#ifdef MULTITHREAD_ENABLED
+        /* the yield thread reads the network, just sleep until the callback signals */
+        if (pClient->thread_running) {
+            if (NULL != completion->sem) {
+                HAL_SemaphoreWait(completion->sem, left);
+            } else {
+                HAL_SleepMs(Min(left, MQTT_SYNC_POLL_MS));
             }
+            continue;
+        }
 
-            if (NULL == node) {
-                break; /* end of list */
-            }
+        /* the callback runs later on a worker, the packet alone does not end the yield */
+        if (NULL != pClient->dispatcher) {
+            left = Min(left, MQTT_SYNC_DISPATCH_SLICE_MS);
+        }
+#endif
 
-            QcloudIotPubInfo *repubInfo = (QcloudIotPubInfo *)node->val;
-            if (NULL == repubInfo) {
-                Log_e("node's value is invalid!");
-                temp_node = node;
-                continue;
-            }
+        rc = _mqtt_yield(pClient, left, &completion->done);
+        if (QCLOUD_RET_SUCCESS != rc && QCLOUD_ERR_MQTT_ATTEMPTING_RECONNECT != rc &&
+            QCLOUD_RET_MQTT_RECONNECTED != rc) {
+            return completion->done ? QCLOUD_RET_SUCCESS : rc;
+        }
+    }
 
-            /* remove invalid node */
-            if (MQTT_NODE_STATE_INVALID == repubInfo->node_state) {
-                temp_node = node;
-                continue;
-            }
+    return QCLOUD_RET_SUCCESS;
+}
 
-            if (!pClient->is_connected) {
-                continue;
-            }
+/**
+ * @brief puback waiting timeout process
+ *
+ * @param pClient reference to MQTTClient
+ *
+ */
+int qcloud_iot_mqtt_pub_info_proc(Qcloud_IoT_Client *pClient)
+{
+    IOT_FUNC_ENTRY;
 
-            /* check the request if timeout or not */
-            if (left_ms(&repubInfo->pub_start_time) > 0) {
-                continue;
-            }
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
 
-            HAL_MutexUnlock(pClient->lock_list_pub);
-            /* If wait ACK timeout, remove the node from list */
-            /* It is up to user to do republishing or not */
-            temp_node = node;
+    QcloudIotPubInfo *repubInfo, *next;
 
-            countdown_ms(&repubInfo->pub_start_time, pClient->command_timeout_ms);
-            HAL_MutexLock(pClient->lock_list_pub);
+    HAL_MutexLock(pClient->lock_list_pub);
+    list_for_each_entry_safe(repubInfo, next, &pClient->list_pub_wait_ack.head, list, QcloudIotPubInfo)
+    {
+        /* remove invalid node */
+        if (MQTT_NODE_STATE_INVALID == repubInfo->node_state) {
+            list_unlink(&pClient->list_pub_wait_ack, &repubInfo->list);
+            utils_mem_free(repubInfo);
+            continue;
+        }
 
-            /* notify timeout event */
-            if (NULL != pClient->event_handle.h_fp) {
-                MQTTEventMsg msg;
-                msg.event_type = MQTT_EVENT_PUBLISH_TIMEOUT;
-                msg.msg        = (void *)(uintptr_t)repubInfo->msg_id;
-                pClient->event_handle.h_fp(pClient, pClient->event_handle.context, &msg);
-            }
+        if (!pClient->is_connected) {
+            continue;
         }
 
-        list_iterator_destroy(iter);
+        /* check the request if timeout or not */
+        if (left_ms(&repubInfo->pub_start_time) > 0) {
+            continue;
+        }
+
+        /* notify timeout event */
+        if (NULL != pClient->event_handle.h_fp) {
+            MQTTEventMsg msg;
+            msg.event_type = MQTT_EVENT_PUBLISH_TIMEOUT;
+            msg.msg        = (void *)(uintptr_t)repubInfo->msg_id;
+            pClient->event_handle.h_fp(pClient, pClient->event_handle.context, &msg);
+        }
 
-    } while (0);
+        /* If wait ACK timeout, remove the node from list */
+        /* It is up to user to do republishing or not */
+        list_unlink(&pClient->list_pub_wait_ack, &repubInfo->list);
+        utils_mem_free(repubInfo);
+    }
 
     HAL_MutexUnlock(pClient->lock_list_pub);
 
@@ -402,94 +549,62 @@ int qcloud_iot_mqtt_sub_info_proc(Qcloud_IoT_Client *pClient)
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_INVAL);
     }
 
+    QcloudIotSubInfo *sub_info, *next;
+    uint16_t          packet_id = 0;
+    MessageTypes      msg_type;
+
     HAL_MutexLock(pClient->lock_list_sub);
-    do {
-        if (0 == pClient->list_sub_wait_ack->len) {
-            break;
+    list_for_each_entry_safe(sub_info, next, &pClient->list_sub_wait_ack.head, list, QcloudIotSubInfo)
+    {
+        /* remove invalid node */
+        if (MQTT_NODE_STATE_INVALID == sub_info->node_state) {
+            list_unlink(&pClient->list_sub_wait_ack, &sub_info->list);
+            utils_mem_free(sub_info);
+            continue;
         }
 
-        ListIterator *iter;
-        ListNode *    node      = NULL;
-        ListNode *    temp_node = NULL;
-        uint16_t      packet_id = 0;
-        MessageTypes  msg_type;
-
-        if (NULL == (iter = list_iterator_new(pClient->list_sub_wait_ack, LIST_TAIL))) {
-            Log_e("new list failed");
-            HAL_MutexUnlock(pClient->lock_list_sub);
-            IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
+        if (pClient->is_connected <= 0) {
+            continue;
         }
 
-        for (;;) {
-            node = list_iterator_next(iter);
-
-            if (NULL != temp_node) {
-                list_remove(pClient->list_sub_wait_ack, temp_node);
-                temp_node = NULL;
-            }
-
-            if (NULL == node) {
-                break; /* end of list */
-            }
-
-            QcloudIotSubInfo *sub_info = (QcloudIotSubInfo *)node->val;
-            if (NULL == sub_info) {
-                Log_e("node's value is invalid!");
-                temp_node = node;
-                continue;
-            }
-
-            /* remove invalid node */
-            if (MQTT_NODE_STATE_INVALID == sub_info->node_state) {
-                temp_node = node;
-                continue;
-            }
-
-            if (pClient->is_connected <= 0) {
-                continue;
-            }
-
-            /* check the request if timeout or not */
-            if (left_ms(&sub_info->sub_start_time) > 0) {
-                continue;
-            }
-
-            /* When arrive here, it means timeout to wait ACK */
-            packet_id = sub_info->msg_id;
-            msg_type  = sub_info->type;
+        /* check the request if timeout or not */
+        if (left_ms(&sub_info->sub_start_time) > 0) {
+            continue;
+        }
 
-            /* Wait MQTT SUBSCRIBE ACK timeout */
-            if (NULL != pClient->event_handle.h_fp) {
-                MQTTEventMsg msg;
+        /* When arrive here, it means timeout to wait ACK */
+        packet_id = sub_info->msg_id;
+        msg_type  = sub_info->type;
 
-                if (SUBSCRIBE == msg_type) {
-                    /* subscribe timeout */
-                    msg.event_type = MQTT_EVENT_SUBCRIBE_TIMEOUT;
-                    msg.msg        = (void *)(uintptr_t)packet_id;
+        /* Wait MQTT SUBSCRIBE ACK timeout */
+        if (NULL != pClient->event_handle.h_fp) {
+            MQTTEventMsg msg;
 
-                    /* notify this event to topic subscriber */
-                    if (NULL != sub_info->handler.sub_event_handler)
-                        sub_info->handler.sub_event_handler(pClient, MQTT_EVENT_SUBCRIBE_TIMEOUT,
-                                                            sub_info->handler.handler_user_data);
+            if (SUBSCRIBE == msg_type) {
+                /* subscribe timeout */
+                msg.event_type = MQTT_EVENT_SUBCRIBE_TIMEOUT;
+                msg.msg        = (void *)(uintptr_t)packet_id;
 
-                } else {
-                    /* unsubscribe timeout */
-                    msg.event_type = MQTT_EVENT_UNSUBCRIBE_TIMEOUT;
-                    msg.msg        = (void *)(uintptr_t)packet_id;
-                }
+                /* notify this event to topic subscriber */
+                if (NULL != sub_info->handler.sub_event_handler)
+                    sub_info->handler.sub_event_handler(pClient, MQTT_EVENT_SUBCRIBE_TIMEOUT,
+                                                        sub_info->handler.handler_user_data);
 
-                pClient->event_handle.h_fp(pClient, pClient->event_handle.context, &msg);
+            } else {
+                /* unsubscribe timeout */
+                msg.event_type = MQTT_EVENT_UNSUBCRIBE_TIMEOUT;
+                msg.msg        = (void *)(uintptr_t)packet_id;
             }
 
-            if (NULL != sub_info->handler.topic_filter)
-                HAL_Free((void *)(sub_info->handler.topic_filter));
-
-            temp_node = node;
+            pClient->event_handle.h_fp(pClient, pClient->event_handle.context, &msg);
         }
 
-        list_iterator_destroy(iter);
+        if (NULL != sub_info->handler.topic_filter)
+            HAL_Free((void *)(sub_info->handler.topic_filter));
 
-    } while (0);
+        list_unlink(&pClient->list_sub_wait_ack, &sub_info->list);
+        utils_mem_free(sub_info);
+    }
 
     HAL_MutexUnlock(pClient->lock_list_sub);
 
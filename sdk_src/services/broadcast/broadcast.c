@@ -57,6 +57,8 @@ static void _broadcast_event_callback(void *pClient, MQTTEventType event_type, v
         default:
             return;
     }
+
+    qcloud_iot_completion_signal(&mqtt_client->broadcast_sub_done);
 }
 
 int IOT_Broadcast_Subscribe(void *pClient, OnBroadcastMessageCallback callback)
@@ -79,17 +81,17 @@ int IOT_Broadcast_Subscribe(void *pClient, OnBroadcastMessageCallback callback)
 
     if (!mqtt_client->broadcast_state) {
         for (int cntSub = 0; cntSub < 3; cntSub++) {
+            qcloud_iot_completion_reset(&mqtt_client->broadcast_sub_done);
             ret = IOT_MQTT_Subscribe(mqtt_client, broadcast_topic, &sub_params);
             if (ret < 0) {
                 Log_e("broadcast topic subscribe failed: %d, cnt: %d", ret, cntSub);
                 continue;
             }
 
-            /* wait for sub ack */
-            ret = qcloud_iot_mqtt_yield_mt(mqtt_client, 500);
-            if (ret || mqtt_client->broadcast_state) {
-                break;
-            }
+            /* wait for sub ack, nack or its timeout */
+            qcloud_iot_mqtt_wait_completion(mqtt_client, &mqtt_client->broadcast_sub_done,
+                                            mqtt_client->command_timeout_ms);
+            break;
         }
     }
 
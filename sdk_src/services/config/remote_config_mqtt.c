@@ -22,6 +22,7 @@ extern "C" {
 
 #ifdef REMOTE_CONFIG_MQTT
 #include <string.h>
+#include "json_parser.h"
 #include "lite-utils.h"
 #include "mqtt_client.h"
 #include "qcloud_iot_device.h"
@@ -34,6 +35,28 @@ extern "C" {
 #define CONFIG_PUBLISH_TOPIC_FORMAT   "$config/operation/%s/%s"
 #define CONFIG_SUBSCRIBE_TOPIC_FORMAT "$config/operation/result/%s/%s"
 
+typedef struct {
+    char                      key[MAX_CONFIG_KEY_LEN + 1];
+    bool                      any_key;
+    OnConfigKeyChangedHandler handler;
+    void *                    user_data;
+} ConfigKeyWatcher;
+
+typedef struct {
+    void *   client;
+    void *   lock;
+    uint32_t version;
+    int      doc_size;
+    char *   doc;  // cached config document, swapped with sub_userdata.json_buffer on update
+
+    ConfigSubscirbeUserData sub_userdata;
+
+    ConfigKeyWatcher watchers[MAX_CONFIG_KEY_WATCHERS];
+    int              watcher_num;
+} ConfigCache;
+
+static int _iot_config_cache_request(void *client);
+
 static int _check_snprintf_return(int32_t return_code, size_t max_size_of_write)
 {
     if (return_code >= max_size_of_write) {
@@ -74,6 +97,7 @@ static void _config_mqtt_message_callback(void *client, MQTTMessage *message, vo
     char *             type           = NULL;
     char *             result         = NULL;
     char *             config_payload = NULL;
+    bool               is_reply       = false;
 
     // proc recv buff, copy recv data to config_sub_userdata json buffer, need 1B to save '\0'
     if (message->payload_len > (config_sub_userdata->json_buffer_len - 1)) {
@@ -95,6 +119,7 @@ static void _config_mqtt_message_callback(void *client, MQTTMessage *message, vo
     // reply data ?
     if (0 == strcmp(type, JSON_TYPE_STRING_REPLY)) {
         config_state->get_reply_ok = true;
+        is_reply                   = true;
 
         result = LITE_json_value_of("result", payload);
         if (NULL == result) {
@@ -132,6 +157,11 @@ exit:
     HAL_Free(result);
     HAL_Free(config_payload);
 
+    /* the reply is in json_buffer now, wake up IOT_Get_Config */
+    if (is_reply) {
+        qcloud_iot_completion_signal(&config_state->sync_done);
+    }
+
     return;
 }
 
@@ -147,6 +177,9 @@ static void _config_mqtt_sub_event_handler(void *client, MQTTEventType event_typ
             Log_d("mqtt config topic subscribe success");
 
             config_state->topic_sub_ok = true;
+            if (NULL != config_state->cache) {
+                _iot_config_cache_request(client);
+            }
             break;
 
         case MQTT_EVENT_SUBCRIBE_TIMEOUT:
@@ -169,12 +202,17 @@ static void _config_mqtt_sub_event_handler(void *client, MQTTEventType event_typ
             Log_i("mqtt config has been destroyed");
 
             config_state->topic_sub_ok = false;
+            if (NULL != config_state->cache) {
+                ((ConfigCache *)config_state->cache)->client = NULL;
+                config_state->cache                         = NULL;
+            }
             break;
         default:
             return;
     }
 
     config_state->get_reply_ok = true;
+    qcloud_iot_completion_signal(&config_state->sync_done);
 }
 
 static int _iot_config_mqtt_subscribe(void *client, ConfigSubscirbeUserData *config_sub_userdata)
@@ -212,11 +250,11 @@ int IOT_Subscribe_Config(void *client, ConfigSubscirbeUserData *config_sub_userd
     POINTER_SANITY_CHECK(client, QCLOUD_ERR_INVAL);
     Qcloud_IoT_Client *mqtt_client  = (Qcloud_IoT_Client *)client;
     ConfigMQTTState *  config_state = &mqtt_client->config_state;
-    Timer              timer;
-    int                packet_id = 0;
+    int                packet_id    = 0;
 
     config_state->topic_sub_ok = false;
     config_state->get_reply_ok = false;
+    qcloud_iot_completion_reset(&config_state->sync_done);
 
     ret = _iot_config_mqtt_subscribe(client, config_sub_userdata);
 
@@ -227,18 +265,7 @@ int IOT_Subscribe_Config(void *client, ConfigSubscirbeUserData *config_sub_userd
     }
     packet_id = ret;
     // wait for sub ack
-    InitTimer(&timer);
-    countdown_ms(&timer, subscribe_timeout);
-    while (false == config_state->get_reply_ok) {
-        if (expired(&timer)) {
-            ret = QCLOUD_ERR_MQTT_REQUEST_TIMEOUT;
-            break;
-        }
-        ret = qcloud_iot_mqtt_yield_mt(mqtt_client, 100);
-        if (QCLOUD_RET_SUCCESS != ret) {
-            break;
-        }
-    }
+    ret = qcloud_iot_mqtt_wait_completion(mqtt_client, &config_state->sync_done, subscribe_timeout);
     if (true == config_state->topic_sub_ok) {
         ret = packet_id;
     } else if (QCLOUD_RET_SUCCESS == ret) {  // multi thread nack
@@ -274,8 +301,7 @@ int IOT_Get_Config(void *client, char *json_buffer, int buffer_size, int reply_t
 {
     POINTER_SANITY_CHECK(client, QCLOUD_ERR_INVAL);
     int                ret         = 0;
-    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)client;
-    Timer              timer;
+    Qcloud_IoT_Client *mqtt_client    = (Qcloud_IoT_Client *)client;
     ConfigMQTTState *  config_state   = &mqtt_client->config_state;
     int32_t            rc_of_snprintf = 0;
 
@@ -294,6 +320,7 @@ int IOT_Get_Config(void *client, char *json_buffer, int buffer_size, int reply_t
     }
 
     config_state->get_reply_ok = false;
+    qcloud_iot_completion_reset(&config_state->sync_done);
 
     // publish msg to get config
     ret = _iot_config_report_mqtt_publish(mqtt_client, json_buffer);
@@ -302,21 +329,327 @@ int IOT_Get_Config(void *client, char *json_buffer, int buffer_size, int reply_t
         return ret;
     }
 
+    if (0 == reply_timeout) {
+        return QCLOUD_RET_SUCCESS;
+    }
+
     // wait for reply
-    InitTimer(&timer);
-    countdown_ms(&timer, reply_timeout);
-    while (false == config_state->get_reply_ok) {
-        if (expired(&timer)) {
-            ret = QCLOUD_ERR_MQTT_REQUEST_TIMEOUT;
-            Log_e("get config wait reply timeout");
-            break;
+    ret = qcloud_iot_mqtt_wait_completion(mqtt_client, &config_state->sync_done, reply_timeout);
+    if (QCLOUD_ERR_MQTT_REQUEST_TIMEOUT == ret) {
+        Log_e("get config wait reply timeout");
+    }
+    return ret;
+}
+
+static int _iot_config_cache_request(void *client)
+{
+    char json_buffer[32];
+
+    HAL_Snprintf(json_buffer, sizeof(json_buffer), "{\"type\":\"%s\"}", JSON_TYPE_STRING_GET);
+
+    int ret = _iot_config_report_mqtt_publish(client, json_buffer);
+    if (ret < 0) {
+        Log_e("client publish config topic failed :%d.", ret);
+    }
+
+    return ret;
+}
+
+/* persisted as {"version":N,"config":{...}} */
+#define CONFIG_CACHE_SAVE_FORMAT   "{\"version\":%u,\"config\":%s}"
+#define CONFIG_CACHE_SAVE_OVERHEAD 40
+
+static void _config_cache_save(ConfigCache *cache)
+{
+    int   len = cache->doc_size + CONFIG_CACHE_SAVE_OVERHEAD;
+    char *buf = HAL_Malloc(len);
+    if (NULL == buf) {
+        Log_e("malloc config save buffer failed");
+        return;
+    }
+
+    len = HAL_Snprintf(buf, len, CONFIG_CACHE_SAVE_FORMAT, (unsigned int)cache->version, cache->doc);
+    if (HAL_Config_Save(buf, len) != len) {
+        Log_w("save config version %u failed", (unsigned int)cache->version);
+    }
+    HAL_Free(buf);
+}
+
+static void _config_cache_load(ConfigCache *cache)
+{
+    int   len = cache->doc_size + CONFIG_CACHE_SAVE_OVERHEAD;
+    char *buf = HAL_Malloc(len + 1);
+    if (NULL == buf) {
+        Log_e("malloc config load buffer failed");
+        return;
+    }
+
+    len      = HAL_Config_Read(buf, len);
+    buf[len] = '\0';
+    if (len > 0) {
+        char *version = LITE_json_value_of("version", buf);
+        char *config  = LITE_json_value_of("config", buf);
+        if (NULL != version && NULL != config && strlen(config) < cache->doc_size) {
+            LITE_get_uint32(&cache->version, version);
+            strcpy(cache->doc, config);
+            Log_i("config version %u loaded", (unsigned int)cache->version);
+        } else {
+            Log_w("saved config invalid, ignored");
         }
-        ret = qcloud_iot_mqtt_yield_mt(mqtt_client, 100);
+        HAL_Free(version);
+        HAL_Free(config);
+    }
+    HAL_Free(buf);
+}
 
-        if (QCLOUD_RET_SUCCESS != ret) {
-            break;
+static void _config_cache_notify(ConfigCache *cache, const char *key, const char *value, int value_len)
+{
+    int i, num;
+
+    /* watchers are only appended, those below the count read under the lock are complete. Handlers run without
+     * the lock, they may read the cache */
+    HAL_MutexLock(cache->lock);
+    num = cache->watcher_num;
+    HAL_MutexUnlock(cache->lock);
+
+    for (i = 0; i < num; i++) {
+        ConfigKeyWatcher *watcher = &cache->watchers[i];
+        if (watcher->any_key || 0 == strcmp(watcher->key, key)) {
+            watcher->handler(cache, key, value, value_len, watcher->user_data);
+        }
+    }
+}
+
+/* call the watchers of every top level key which differs between the two documents */
+static void _config_cache_diff(ConfigCache *cache, char *old_doc, char *new_doc)
+{
+    char *pos, *key, *val, *other;
+    int   key_len, val_len, val_type, other_len;
+    char  key_str[MAX_CONFIG_KEY_LEN + 1];
+
+    json_object_for_each_kv(new_doc, pos, key, key_len, val, val_len, val_type)
+    {
+        if (key_len > MAX_CONFIG_KEY_LEN) {
+            continue;  // too long to be watched
+        }
+        memcpy(key_str, key, key_len);
+        key_str[key_len] = '\0';
+
+        other = json_get_value_by_name(old_doc, strlen(old_doc), key_str, &other_len, NULL);
+        if (NULL == other || other_len != val_len || 0 != memcmp(other, val, val_len)) {
+            _config_cache_notify(cache, key_str, val, val_len);
+        }
+    }
+
+    json_object_for_each_kv(old_doc, pos, key, key_len, val, val_len, val_type)
+    {
+        if (key_len > MAX_CONFIG_KEY_LEN) {
+            continue;
+        }
+        memcpy(key_str, key, key_len);
+        key_str[key_len] = '\0';
+
+        if (NULL == json_get_value_by_name(new_doc, strlen(new_doc), key_str, NULL, NULL)) {
+            _config_cache_notify(cache, key_str, NULL, 0);
+        }
+    }
+}
+
+/* runs in the yield context, the only writer of the cache */
+static void _config_cache_on_config(void *client, int config_reply_errcode, char *config_json, int config_json_len)
+{
+    ConfigCache *cache = (ConfigCache *)((Qcloud_IoT_Client *)client)->config_state.cache;
+
+    if (NULL == cache) {
+        return;
+    }
+
+    if (REMOTE_CONFIG_ERRCODE_SUCCESS != config_reply_errcode) {
+        Log_i("remote config errcode %d, keep config version %u", config_reply_errcode,
+              (unsigned int)cache->version);
+        return;
+    }
+
+    /* a reply or push without "payload" reaches here as "", it carries no config to replace the cache with */
+    if (0 == config_json_len) {
+        Log_i("remote config without payload, keep config version %u", (unsigned int)cache->version);
+        return;
+    }
+
+    if (0 == strcmp(cache->doc, config_json)) {
+        return;
+    }
+
+    // the new document becomes the cache, the old one stays in the receive buffer until the next message
+    HAL_MutexLock(cache->lock);
+    cache->sub_userdata.json_buffer = cache->doc;
+    cache->doc                      = config_json;
+    cache->version++;
+    HAL_MutexUnlock(cache->lock);
+
+    Log_i("config updated to version %u", (unsigned int)cache->version);
+    _config_cache_save(cache);
+    _config_cache_diff(cache, cache->sub_userdata.json_buffer, cache->doc);
+}
+
+void *IOT_Config_Cache_Init(int config_max_len)
+{
+    NUMBERIC_SANITY_CHECK(config_max_len, NULL);
+
+    ConfigCache *cache = HAL_Malloc(sizeof(ConfigCache));
+    if (NULL == cache) {
+        Log_e("malloc config cache failed");
+        return NULL;
+    }
+    memset(cache, 0, sizeof(ConfigCache));
+
+    // both buffers take the reply wrapper too, since they are swapped
+    cache->doc_size                     = REMOTE_CONFIG_JSON_BUFFER_MIN_LEN + config_max_len;
+    cache->sub_userdata.on_config_proc  = _config_cache_on_config;
+    cache->sub_userdata.json_buffer_len = cache->doc_size;
+    cache->sub_userdata.json_buffer     = HAL_Malloc(cache->sub_userdata.json_buffer_len);
+    cache->doc                          = HAL_Malloc(cache->doc_size);
+    cache->lock                         = HAL_MutexCreate();
+    if (NULL == cache->sub_userdata.json_buffer || NULL == cache->doc || NULL == cache->lock) {
+        Log_e("malloc config cache failed");
+        IOT_Config_Cache_Deinit(cache);
+        return NULL;
+    }
+    cache->doc[0] = '\0';
+
+    _config_cache_load(cache);
+
+    return cache;
+}
+
+void IOT_Config_Cache_Deinit(void *handle)
+{
+    POINTER_SANITY_CHECK_RTN(handle);
+
+    ConfigCache *cache = (ConfigCache *)handle;
+
+    if (NULL != cache->client) {
+        Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)cache->client;
+        DeviceInfo *       dev_info    = &mqtt_client->device_info;
+        char               topic_name[128];
+
+        mqtt_client->config_state.cache = NULL;
+        HAL_Snprintf(topic_name, sizeof(topic_name), CONFIG_SUBSCRIBE_TOPIC_FORMAT,
+                     STRING_PTR_PRINT_SANITY_CHECK(dev_info->product_id),
+                     STRING_PTR_PRINT_SANITY_CHECK(dev_info->device_name));
+        IOT_MQTT_Unsubscribe(mqtt_client, topic_name);
+    }
+
+    if (NULL != cache->lock) {
+        HAL_MutexDestroy(cache->lock);
+    }
+    HAL_Free(cache->sub_userdata.json_buffer);
+    HAL_Free(cache->doc);
+    HAL_Free(cache);
+}
+
+int IOT_Config_Cache_Watch(void *handle, const char *key, OnConfigKeyChangedHandler handler, void *user_data)
+{
+    POINTER_SANITY_CHECK(handle, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(handler, QCLOUD_ERR_INVAL);
+
+    ConfigCache *cache = (ConfigCache *)handle;
+
+    if (NULL != key && strlen(key) > MAX_CONFIG_KEY_LEN) {
+        Log_e("config key %s too long", key);
+        return QCLOUD_ERR_INVAL;
+    }
+
+    // the yield thread may be walking the watchers to notify a change
+    HAL_MutexLock(cache->lock);
+    if (cache->watcher_num >= MAX_CONFIG_KEY_WATCHERS) {
+        HAL_MutexUnlock(cache->lock);
+        Log_e("too many config watchers, max %d", MAX_CONFIG_KEY_WATCHERS);
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    ConfigKeyWatcher *watcher = &cache->watchers[cache->watcher_num];
+    watcher->any_key          = (NULL == key);
+    watcher->handler          = handler;
+    watcher->user_data        = user_data;
+    if (NULL != key) {
+        strcpy(watcher->key, key);
+    }
+    cache->watcher_num++;
+    HAL_MutexUnlock(cache->lock);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int IOT_Config_Cache_Bind(void *client, void *handle)
+{
+    POINTER_SANITY_CHECK(client, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(handle, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)client;
+    ConfigCache *      cache       = (ConfigCache *)handle;
+
+    mqtt_client->config_state.topic_sub_ok = false;
+    mqtt_client->config_state.cache        = cache;
+    cache->client                          = client;
+
+    // the config is requested from the sub event handler once the subscription is acked
+    int ret = _iot_config_mqtt_subscribe(client, &cache->sub_userdata);
+    if (ret < 0) {
+        Log_e("config topic subscribe failed, ret:%d", ret);
+        mqtt_client->config_state.cache = NULL;
+        cache->client                   = NULL;
+        return ret;
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int IOT_Config_Cache_Get(void *handle, char *json_buffer, int buffer_size, uint32_t *version)
+{
+    POINTER_SANITY_CHECK(handle, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(json_buffer, QCLOUD_ERR_INVAL);
+
+    ConfigCache *cache = (ConfigCache *)handle;
+    int          ret   = QCLOUD_RET_SUCCESS;
+
+    HAL_MutexLock(cache->lock);
+    if (strlen(cache->doc) < buffer_size) {
+        strcpy(json_buffer, cache->doc);
+        if (NULL != version) {
+            *version = cache->version;
         }
+    } else {
+        ret = QCLOUD_ERR_BUF_TOO_SHORT;
     }
+    HAL_MutexUnlock(cache->lock);
+
+    return ret;
+}
+
+int IOT_Config_Cache_Get_Value(void *handle, const char *key, char *value, int value_size)
+{
+    POINTER_SANITY_CHECK(handle, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(key, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(value, QCLOUD_ERR_INVAL);
+
+    ConfigCache *cache = (ConfigCache *)handle;
+    int          len   = 0;
+    int          ret;
+
+    HAL_MutexLock(cache->lock);
+    char *val = json_get_value_by_name(cache->doc, strlen(cache->doc), (char *)key, &len, NULL);
+    if (NULL == val) {
+        ret = QCLOUD_ERR_FAILURE;
+    } else if (len >= value_size) {
+        ret = QCLOUD_ERR_BUF_TOO_SHORT;
+    } else {
+        memcpy(value, val, len);
+        value[len] = '\0';
+        ret        = len;
+    }
+    HAL_MutexUnlock(cache->lock);
+
     return ret;
 }
 
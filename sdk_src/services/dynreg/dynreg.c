@@ -25,6 +25,7 @@ extern "C" {
 
 #include "lite-utils.h"
 #include "qcloud_iot_ca.h"
+#include "qcloud_iot_clock.h"
 #include "qcloud_iot_common.h"
 #include "qcloud_iot_device.h"
 #include "qcloud_iot_export.h"
@@ -33,6 +34,7 @@ extern "C" {
 #include "utils_base64.h"
 #include "utils_hmac.h"
 #include "utils_httpc.h"
+#include "utils_param_check.h"
 
 #define REG_URL_MAX_LEN             (128)
 #define DYN_REG_SIGN_LEN            (64)
@@ -40,6 +42,16 @@ extern "C" {
 #define BASE64_ENCODE_OUT_LEN(x)    (((x + 3) * 4) / 3)
 #define DYN_REG_RES_HTTP_TIMEOUT_MS (2000)
 
+/* requests sent ahead of their replies by IOT_DynReg_Device_Batch */
+#ifndef DYN_REG_BATCH_PIPELINE_DEPTH
+#define DYN_REG_BATCH_PIPELINE_DEPTH (4)
+#endif
+
+/* attempts per device when the connection drops before its reply */
+#ifndef DYN_REG_BATCH_MAX_TRY
+#define DYN_REG_BATCH_MAX_TRY (3)
+#endif
+
 #ifdef AUTH_MODE_CERT
 #define DYN_RESPONSE_BUFF_LEN (5 * 1024)
 #define DECODE_BUFF_LEN       (5 * 1024)
@@ -349,53 +361,74 @@ exit:
     return ret;
 }
 
-static int _post_reg_request_by_http(char *request_buf, DeviceInfo *pDevInfo)
+static void _dynreg_http_init(HTTPClient *http_client, char *url, int *port, const char **ca_crt)
 {
-    int            Ret = 0;
-    HTTPClient     http_client; /* http client */
-    HTTPClientData http_data;   /* http client data */
-
-    const char *url_format           = "%s://%s/register/dev";
-    char        url[REG_URL_MAX_LEN] = {0};
-    int         port;
-    const char *ca_crt = NULL;
-    char        respbuff[DYN_RESPONSE_BUFF_LEN];
+    const char *url_format = "%s://%s/register/dev";
 
     /*format URL*/
 #ifndef AUTH_WITH_NOTLS
     HAL_Snprintf(url, REG_URL_MAX_LEN, url_format, "https", DYN_REG_SERVER_URL);
-    port   = DYN_REG_SERVER_PORT_TLS;
-    ca_crt = iot_ca_get();
+    *port   = DYN_REG_SERVER_PORT_TLS;
+    *ca_crt = iot_ca_get();
 #else
     HAL_Snprintf(url, REG_URL_MAX_LEN, url_format, "http", DYN_REG_SERVER_URL);
-    port = DYN_REG_SERVER_PORT;
+    *port   = DYN_REG_SERVER_PORT;
+    *ca_crt = NULL;
 #endif
 
-    memset((char *)&http_client, 0, sizeof(HTTPClient));
-    memset((char *)&http_data, 0, sizeof(HTTPClientData));
+    memset((char *)http_client, 0, sizeof(HTTPClient));
+    http_client->header = "Accept: text/xml,application/json;*/*\r\n";
+}
 
-    http_client.header = "Accept: text/xml,application/json;*/*\r\n";
+/* send one request, connecting first if there is no connection to reuse */
+static int _dynreg_http_send(HTTPClient *http_client, const char *url, int port, const char *ca_crt,
+                             char *request_buf)
+{
+    HTTPClientData http_data;
 
+    memset((char *)&http_data, 0, sizeof(HTTPClientData));
     http_data.post_content_type = "application/x-www-form-urlencoded";
     http_data.post_buf          = request_buf;
     http_data.post_buf_len      = strlen(request_buf);
 
-    Ret = qcloud_http_client_common(&http_client, url, port, ca_crt, HTTP_POST, &http_data);
-    if (QCLOUD_RET_SUCCESS != Ret) {
-        Log_e("qcloud_http_client_common failed, Ret = %d", Ret);
-        return Ret;
-    }
+    return qcloud_http_client_common(http_client, url, port, ca_crt, HTTP_POST, &http_data);
+}
+
+static int _dynreg_http_recv(HTTPClient *http_client, char *respbuff)
+{
+    HTTPClientData http_data;
 
+    memset((char *)&http_data, 0, sizeof(HTTPClientData));
     memset(respbuff, 0, DYN_RESPONSE_BUFF_LEN);
     http_data.response_buf_len = DYN_RESPONSE_BUFF_LEN;
     http_data.response_buf     = respbuff;
 
-    Ret = qcloud_http_recv_data(&http_client, DYN_REG_RES_HTTP_TIMEOUT_MS, &http_data);
+    return qcloud_http_recv_data(http_client, DYN_REG_RES_HTTP_TIMEOUT_MS, &http_data);
+}
+
+static int _post_reg_request_by_http(char *request_buf, DeviceInfo *pDevInfo)
+{
+    int         Ret = 0;
+    HTTPClient  http_client; /* http client */
+    char        url[REG_URL_MAX_LEN] = {0};
+    int         port;
+    const char *ca_crt = NULL;
+    char        respbuff[DYN_RESPONSE_BUFF_LEN];
+
+    _dynreg_http_init(&http_client, url, &port, &ca_crt);
+
+    Ret = _dynreg_http_send(&http_client, url, port, ca_crt, request_buf);
+    if (QCLOUD_RET_SUCCESS != Ret) {
+        Log_e("qcloud_http_client_common failed, Ret = %d", Ret);
+        return Ret;
+    }
+
+    Ret = _dynreg_http_recv(&http_client, respbuff);
     if (QCLOUD_RET_SUCCESS != Ret) {
         Log_e("dynamic register response fail, Ret = %d", Ret);
     } else {
         /*Parse dev info*/
-        Ret = _parse_devinfo(http_data.response_buf, pDevInfo);
+        Ret = _parse_devinfo(respbuff, pDevInfo);
         if (QCLOUD_RET_SUCCESS != Ret) {
             Log_e("parse device info err");
         }
@@ -437,32 +470,26 @@ static int _cal_dynreg_sign(DeviceInfo *pDevInfo, char *signout, int max_signlen
     return (olen > max_signlen) ? QCLOUD_ERR_FAILURE : QCLOUD_RET_SUCCESS;
 }
 
-int IOT_DynReg_Device(DeviceInfo *pDevInfo)
+/* build the signed request body of one device, to be freed by caller */
+static char *_gen_dynreg_request(DeviceInfo *pDevInfo)
 {
     const char *para_format =
         "{\"deviceName\":\"%s\",\"nonce\":%d,\"productId\":\"%s\",\"timestamp\":%d,\"signature\":\"%s\"}";
     int      nonce;
-    int      Ret;
     uint32_t timestamp;
     int      len;
     char     sign[DYN_REG_SIGN_LEN] = {0};
     char *   pRequest               = NULL;
 
-    if (strlen(pDevInfo->product_secret) < UTILS_AES_BLOCK_LEN) {
-        Log_e("product key inllegal");
-        return QCLOUD_ERR_FAILURE;
-    }
-
-    srand_d(HAL_GetTimeMs());
     nonce     = rand_d();
-    timestamp = time(0);
+    timestamp = qcloud_iot_clock_now_sec();
 
     /*cal sign*/
     if (QCLOUD_RET_SUCCESS == _cal_dynreg_sign(pDevInfo, sign, DYN_REG_SIGN_LEN, nonce, timestamp)) {
         Log_d("sign:%s", sign);
     } else {
         Log_e("cal sign fail");
-        return QCLOUD_ERR_FAILURE;
+        return NULL;
     }
 
     /*format http request*/
@@ -471,12 +498,31 @@ int IOT_DynReg_Device(DeviceInfo *pDevInfo)
     pRequest = HAL_Malloc(len);
     if (!pRequest) {
         Log_e("malloc request memory fail");
-        return QCLOUD_ERR_FAILURE;
+        return NULL;
     }
     memset(pRequest, 0, len);
     HAL_Snprintf(pRequest, len, para_format, pDevInfo->device_name, nonce, pDevInfo->product_id, timestamp, sign);
     Log_d("request:%s", pRequest);
 
+    return pRequest;
+}
+
+int IOT_DynReg_Device(DeviceInfo *pDevInfo)
+{
+    int   Ret;
+    char *pRequest = NULL;
+
+    if (strlen(pDevInfo->product_secret) < UTILS_AES_BLOCK_LEN) {
+        Log_e("product key inllegal");
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    srand_d(HAL_GetTimeMs());
+    pRequest = _gen_dynreg_request(pDevInfo);
+    if (NULL == pRequest) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
     Log_d("resbuff len:%d", DYN_RESPONSE_BUFF_LEN);
     /*post request*/
     Ret = _post_reg_request_by_http(pRequest, pDevInfo);
@@ -491,6 +537,148 @@ int IOT_DynReg_Device(DeviceInfo *pDevInfo)
     return Ret;
 }
 
+/*
+ * Requests go out on one connection up to DYN_REG_BATCH_PIPELINE_DEPTH ahead of the
+ * replies, so while one reply is decoded and decrypted the server already works on
+ * the next ones. Replies come back in request order. When the connection drops, the
+ * requests in flight are lost with it and are sent again on a new connection; only
+ * the device whose reply was awaited is charged with a try. A server closing the
+ * connection after a reply does not keep it alive, the rest goes one per connection.
+ */
+int IOT_DynReg_Device_Batch(DeviceInfo *pDevInfos, int dev_num, int *results)
+{
+    HTTPClient  http_client;
+    char        url[REG_URL_MAX_LEN] = {0};
+    int         port;
+    const char *ca_crt = NULL;
+    char *      respbuff;
+    char *      pRequest;
+    uint8_t *   tries;
+    int         inflight[DYN_REG_BATCH_PIPELINE_DEPTH];
+    int         head = 0, num_inflight = 0;
+    int         depth = DYN_REG_BATCH_PIPELINE_DEPTH;
+    int         next  = 0;
+    int         i, idx, num_ok = 0;
+    int         rc = QCLOUD_RET_SUCCESS;
+
+    POINTER_SANITY_CHECK(pDevInfos, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(results, QCLOUD_ERR_INVAL);
+    NUMBERIC_SANITY_CHECK(dev_num, QCLOUD_ERR_INVAL);
+
+    respbuff = HAL_Malloc(DYN_RESPONSE_BUFF_LEN);
+    tries    = HAL_Malloc(dev_num);
+    if (NULL == respbuff || NULL == tries) {
+        Log_e("malloc batch register buff fail");
+        HAL_Free(respbuff);
+        HAL_Free(tries);
+        return QCLOUD_ERR_MALLOC;
+    }
+
+    for (i = 0; i < dev_num; i++) {
+        tries[i]   = 0;
+        results[i] = QCLOUD_ERR_FAILURE;
+        if (strlen(pDevInfos[i].product_secret) < UTILS_AES_BLOCK_LEN) {
+            Log_e("product key inllegal: %s", pDevInfos[i].device_name);
+            tries[i] = DYN_REG_BATCH_MAX_TRY;
+        }
+    }
+
+    srand_d(HAL_GetTimeMs());
+    _dynreg_http_init(&http_client, url, &port, &ca_crt);
+
+    while (next < dev_num || num_inflight) {
+        /* keep the pipeline full */
+        while (next < dev_num && num_inflight < depth) {
+            if (tries[next] >= DYN_REG_BATCH_MAX_TRY) {
+                next++;
+                continue;
+            }
+            if (num_inflight && 0 == http_client.network_stack.handle) {
+                /* a new connection would lose the replies still in flight */
+                break;
+            }
+
+            pRequest = _gen_dynreg_request(&pDevInfos[next]);
+            if (NULL == pRequest) {
+                tries[next++] = DYN_REG_BATCH_MAX_TRY;
+                continue;
+            }
+            rc = _dynreg_http_send(&http_client, url, port, ca_crt, pRequest);
+            HAL_Free(pRequest);
+            if (QCLOUD_RET_SUCCESS != rc) {
+                break;
+            }
+
+            inflight[(head + num_inflight) % DYN_REG_BATCH_PIPELINE_DEPTH] = next++;
+            num_inflight++;
+        }
+
+        if (!num_inflight) {
+            if (next < dev_num) {
+                /* could not even send the first request */
+                Log_e("dynamic register send fail, rc = %d", rc);
+                qcloud_http_client_close(&http_client);
+                results[next] = rc;
+                if (++tries[next] >= DYN_REG_BATCH_MAX_TRY) {
+                    /* server unreachable, no use trying the others */
+                    for (i = next; i < dev_num; i++) {
+                        if (tries[i] < DYN_REG_BATCH_MAX_TRY) {
+                            results[i] = rc;
+                        }
+                    }
+                    break;
+                }
+            }
+            continue;
+        }
+
+        idx = inflight[head];
+        if (0 == http_client.network_stack.handle && 0 == http_client.pending_len) {
+            rc = QCLOUD_ERR_HTTP_CLOSED;
+        } else {
+            rc = _dynreg_http_recv(&http_client, respbuff);
+        }
+
+        if (QCLOUD_ERR_HTTP_CLOSED == rc && depth > 1) {
+            /* closed by server after a reply, no keep alive: not the fault of the device */
+            Log_w("dynamic register server closed connection, %d requests to resend", num_inflight);
+            depth = 1;
+        } else if (QCLOUD_RET_SUCCESS != rc) {
+            Log_e("dynamic register response fail, dev: %s, rc = %d", pDevInfos[idx].device_name, rc);
+            results[idx] = rc;
+            tries[idx]++;
+        }
+
+        if (QCLOUD_RET_SUCCESS != rc) {
+            /* resend what was in flight on a new connection */
+            qcloud_http_client_close(&http_client);
+            next         = idx;
+            num_inflight = 0;
+            continue;
+        }
+
+        head = (head + 1) % DYN_REG_BATCH_PIPELINE_DEPTH;
+        num_inflight--;
+
+        /* a bad reply is final for its device, the connection stays usable */
+        results[idx] = _parse_devinfo(respbuff, &pDevInfos[idx]);
+        tries[idx]   = DYN_REG_BATCH_MAX_TRY;
+        if (QCLOUD_RET_SUCCESS == results[idx]) {
+            num_ok++;
+        } else {
+            Log_e("parse device info err, dev: %s", pDevInfos[idx].device_name);
+        }
+    }
+
+    qcloud_http_client_close(&http_client);
+    HAL_Free(respbuff);
+    HAL_Free(tries);
+
+    Log_i("dynamic register batch: %d of %d devices registered", num_ok, dev_num);
+
+    return (num_ok == dev_num) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+}
+
 #ifdef __cplusplus
 }
 #endif
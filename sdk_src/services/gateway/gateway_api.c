@@ -17,6 +17,7 @@
 
 #include "gateway_common.h"
 #include "mqtt_client.h"
+#include "qcloud_iot_clock.h"
 #include "utils_param_check.h"
 
 void _gateway_event_handler(void *client, void *context, MQTTEventMsg *msg)
@@ -34,6 +35,7 @@ void _gateway_event_handler(void *client, void *context, MQTTEventMsg *msg)
             Log_d("gateway sub|unsub(%d) success, packet-id=%u", msg->event_type, (unsigned int)packet_id);
             if (gateway->gateway_data.sync_status == packet_id) {
                 gateway->gateway_data.sync_status = 0;
+                qcloud_iot_completion_signal(&gateway->gateway_data.sync_done);
                 return;
             }
             break;
@@ -45,16 +47,25 @@ void _gateway_event_handler(void *client, void *context, MQTTEventMsg *msg)
             Log_d("gateway timeout|nack(%d) event, packet-id=%u", msg->event_type, (unsigned int)packet_id);
             if (gateway->gateway_data.sync_status == packet_id) {
                 gateway->gateway_data.sync_status = -1;
+                qcloud_iot_completion_signal(&gateway->gateway_data.sync_done);
                 return;
             }
             break;
 
         case MQTT_EVENT_PUBLISH_RECVEIVED:
+            if (gateway_route_message(gateway, topic_info)) {
+                return;
+            }
             Log_d("gateway topic message arrived but without any related handle: topic=%.*s, topic_msg=%.*s",
                   topic_info->topic_len, STRING_PTR_PRINT_SANITY_CHECK(topic_info->ptopic), topic_info->payload_len,
                   STRING_PTR_PRINT_SANITY_CHECK(topic_info->payload));
             break;
 
+        case MQTT_EVENT_RECONNECT:
+            /* the MQTT client only re-subscribes its own sub_handles */
+            gateway_route_reset(gateway);
+            break;
+
         default:
             break;
     }
@@ -79,6 +90,12 @@ void *IOT_Gateway_Construct(GatewayInitParam *init_param)
     }
 
     memset(gateway, 0, sizeof(Gateway));
+    if (QCLOUD_RET_SUCCESS != gateway_route_init(gateway)) {
+        Log_e("gateway route init failed");
+        HAL_Free(gateway);
+        IOT_FUNC_EXIT_RC(NULL);
+    }
+    qcloud_iot_completion_init(&gateway->gateway_data.sync_done);
 
     /* replace user event handle */
     gateway->event_handle.h_fp    = init_param->init_param.event_handle.h_fp;
@@ -92,6 +109,8 @@ void *IOT_Gateway_Construct(GatewayInitParam *init_param)
     gateway->mqtt = IOT_MQTT_Construct(&init_param->init_param);
     if (NULL == gateway->mqtt) {
         Log_e("construct MQTT failed");
+        qcloud_iot_completion_deinit(&gateway->gateway_data.sync_done);
+        gateway_route_release(gateway);
         HAL_Free(gateway);
         IOT_FUNC_EXIT_RC(NULL);
     }
@@ -333,7 +352,7 @@ int IOT_Gateway_Subdev_Bind(void *client, GatewayParam *param, DeviceInfo *pBind
 
     srand((unsigned)HAL_GetTimeMs());
     int  nonce     = rand();
-    long timestamp = HAL_Timer_current_sec();
+    long timestamp = qcloud_iot_clock_now_sec();
 
     /*cal sign*/
     char sign[SUBDEV_BIND_SIGN_LEN];
@@ -446,6 +465,8 @@ int IOT_Gateway_Destroy(void *client)
     }
 
     IOT_MQTT_Destroy(&gateway->mqtt);
+    qcloud_iot_completion_deinit(&gateway->gateway_data.sync_done);
+    gateway_route_release(gateway);
     HAL_Free(client);
 
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS)
@@ -456,7 +477,12 @@ int IOT_Gateway_Yield(void *client, uint32_t timeout_ms)
     Gateway *gateway = (Gateway *)client;
     POINTER_SANITY_CHECK(gateway, QCLOUD_ERR_INVAL);
 
-    return IOT_MQTT_Yield(gateway->mqtt, timeout_ms);
+    int rc = IOT_MQTT_Yield(gateway->mqtt, timeout_ms);
+
+    /* virtual client subscriptions deferred by a timeout */
+    gateway_route_pump(gateway);
+
+    return rc;
 }
 
 int IOT_Gateway_Subscribe(void *client, char *topic_filter, SubscribeParams *params)
@@ -490,3 +516,11 @@ int IOT_Gateway_Publish(void *client, char *topic_name, PublishParams *params)
 
     return IOT_MQTT_Publish(gateway->mqtt, topic_name, params);
 }
+
+int IOT_Gateway_Publish_Topic(void *client, const MQTTTopicHandle *topic, PublishParams *params)
+{
+    Gateway *gateway = (Gateway *)client;
+    POINTER_SANITY_CHECK(gateway, QCLOUD_ERR_INVAL);
+
+    return IOT_MQTT_Publish_Topic(gateway->mqtt, topic, params);
+}
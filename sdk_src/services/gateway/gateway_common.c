@@ -177,6 +177,7 @@ static void _gateway_message_handler(void *client, MQTTMessage *message, void *u
     if (strncmp(type, GATEWAY_DESCRIBE_SUBDEVIES_OP_STR, sizeof(GATEWAY_DESCRIBE_SUBDEVIES_OP_STR) - 1) == 0) {
         _subdev_proc_get_bindlist(gateway, devices);
         gateway->gateway_data.get_bindlist.result = 0;
+        qcloud_iot_completion_signal(&gateway->gateway_data.sync_done);
         HAL_Free(type);
         HAL_Free(devices);
         return;
@@ -222,21 +223,25 @@ static void _gateway_message_handler(void *client, MQTTMessage *message, void *u
         if (strncmp(client_id, gateway->gateway_data.online.client_id, size) == 0) {
             Log_i("client_id(%s), online result %d", client_id, result);
             gateway->gateway_data.online.result = result;
+            qcloud_iot_completion_signal(&gateway->gateway_data.sync_done);
         }
     } else if (strncmp(type, GATEWAY_OFFLIN_OP_STR, sizeof(GATEWAY_OFFLIN_OP_STR) - 1) == 0) {
         if (strncmp(client_id, gateway->gateway_data.offline.client_id, size) == 0) {
             Log_i("client_id(%s), offline result %d", client_id, result);
             gateway->gateway_data.offline.result = result;
+            qcloud_iot_completion_signal(&gateway->gateway_data.sync_done);
         }
     } else if (strncmp(type, GATEWAY_BIND_OP_STR, sizeof(GATEWAY_BIND_OP_STR) - 1) == 0) {
         if (strncmp(client_id, gateway->gateway_data.bind.client_id, size) == 0) {
             gateway->gateway_data.bind.result = result;
             Log_i("client_id(%s), bind result %d", client_id, gateway->gateway_data.bind.result);
+            qcloud_iot_completion_signal(&gateway->gateway_data.sync_done);
         }
     } else if (strncmp(type, GATEWAY_UNBIND_OP_STR, sizeof(GATEWAY_UNBIND_OP_STR) - 1) == 0) {
         if (strncmp(client_id, gateway->gateway_data.unbind.client_id, size) == 0) {
             gateway->gateway_data.unbind.result = result;
             Log_i("client_id(%s), unbind result %d", client_id, gateway->gateway_data.unbind.result);
+            qcloud_iot_completion_signal(&gateway->gateway_data.sync_done);
         }
     }
 
@@ -249,9 +254,8 @@ static void _gateway_message_handler(void *client, MQTTMessage *message, void *u
 
 int gateway_subscribe_unsubscribe_topic(Gateway *gateway, char *topic_filter, SubscribeParams *params, int is_subscribe)
 {
-    int      rc         = 0;
-    int      loop_count = 0;
-    uint32_t status     = -1;
+    int      rc     = 0;
+    uint32_t status = -1;
 
     POINTER_SANITY_CHECK(gateway, QCLOUD_ERR_INVAL);
     POINTER_SANITY_CHECK(params, QCLOUD_ERR_INVAL);
@@ -260,6 +264,7 @@ int gateway_subscribe_unsubscribe_topic(Gateway *gateway, char *topic_filter, Su
 
     params->qos                       = QOS1;
     gateway->gateway_data.sync_status = status;
+    qcloud_iot_completion_reset(&gateway->gateway_data.sync_done);
 
     if (is_subscribe) {
         /* subscribe */
@@ -275,14 +280,10 @@ int gateway_subscribe_unsubscribe_topic(Gateway *gateway, char *topic_filter, Su
     }
 
     gateway->gateway_data.sync_status = status = rc;
-    while (status == gateway->gateway_data.sync_status) {
-        if (loop_count > GATEWAY_LOOP_MAX_COUNT) {
-            Log_i("loop max count, time out");
-            IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
-        }
-
-        IOT_Gateway_Yield(gateway, 200);
-        loop_count++;
+    qcloud_iot_mqtt_wait_completion(gateway->mqtt, &gateway->gateway_data.sync_done, GATEWAY_WAIT_TIMEOUT_MS);
+    if (status == gateway->gateway_data.sync_status) {
+        Log_i("wait sub|unsub ack time out");
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
     }
 
     if (gateway->gateway_data.sync_status != 0) {
@@ -333,8 +334,7 @@ SubdevSession *subdev_find_session(Gateway *gateway, char *product_id, char *dev
 
     /* session is exist */
     while (session) {
-        if (0 == strncmp(session->product_id, product_id, strlen(product_id)) &&
-            0 == strncmp(session->device_name, device_name, strlen(device_name))) {
+        if (0 == strcmp(session->product_id, product_id) && 0 == strcmp(session->device_name, device_name)) {
             IOT_FUNC_EXIT_RC(session);
         }
         session = session->next;
@@ -391,8 +391,7 @@ int subdev_remove_session(Gateway *gateway, char *product_id, char *device_name)
 
     /* session is exist */
     while (cur_session) {
-        if (0 == strncmp(cur_session->product_id, product_id, strlen(product_id)) &&
-            0 == strncmp(cur_session->device_name, device_name, strlen(device_name))) {
+        if (0 == strcmp(cur_session->product_id, product_id) && 0 == strcmp(cur_session->device_name, device_name)) {
             if (cur_session == gateway->session_list) {
                 gateway->session_list = cur_session->next;
             } else {
@@ -410,12 +409,12 @@ int subdev_remove_session(Gateway *gateway, char *product_id, char *device_name)
 
 int gateway_publish_sync(Gateway *gateway, char *topic, PublishParams *params, int32_t *result)
 {
-    int     rc         = 0;
-    int     loop_count = 0;
-    int32_t res        = *result;
+    int     rc  = 0;
+    int32_t res = *result;
 
     POINTER_SANITY_CHECK(gateway, QCLOUD_ERR_INVAL);
 
+    qcloud_iot_completion_reset(&gateway->gateway_data.sync_done);
     rc = IOT_Gateway_Publish(gateway, topic, params);
     if (rc < 0) {
         Log_e("publish fail.");
@@ -423,14 +422,10 @@ int gateway_publish_sync(Gateway *gateway, char *topic, PublishParams *params, i
     }
 
     /* wait for response */
-    while (res == *result) {
-        if (loop_count > GATEWAY_LOOP_MAX_COUNT) {
-            Log_i("loop max count, time out.");
-            IOT_FUNC_EXIT_RC(QCLOUD_ERR_GATEWAY_SESSION_TIMEOUT);
-        }
-
-        IOT_Gateway_Yield(gateway, 200);
-        loop_count++;
+    qcloud_iot_mqtt_wait_completion(gateway->mqtt, &gateway->gateway_data.sync_done, GATEWAY_WAIT_TIMEOUT_MS);
+    if (res == *result) {
+        Log_i("wait reply time out.");
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_GATEWAY_SESSION_TIMEOUT);
     }
 
     if (*result != 0) {
@@ -0,0 +1,636 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+
+#include "gateway_common.h"
+#include "mqtt_client.h"
+#include "utils_mem.h"
+#include "utils_param_check.h"
+
+/*
+ * Virtual clients are sub-devices which publish and subscribe through the MQTT connection of the gateway.
+ * Their subscriptions are kept in a route table of the gateway instead of the sub_handles of the MQTT client:
+ * the SUBSCRIBEs go out as routed subscriptions, and the messages which match no sub_handles reach
+ * _gateway_event_handler, which looks the topic up here. route_lock guards the table, the pending list,
+ * the inflight slots and the list of virtual clients; it is never held while calling into the MQTT client or a
+ * user callback.
+ */
+
+/* NULL when the gateway was destroyed first, see gateway_route_release() */
+static Gateway *_vclient_gateway(VirtualClient *vclient)
+{
+    if (NULL == vclient->gateway) {
+        Log_e("gateway of virtual client %s/%s is destroyed", vclient->product_id, vclient->device_name);
+    }
+
+    return vclient->gateway;
+}
+
+static uint32_t _route_hash(const char *topic, size_t len)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+
+    while (len--) {
+        hash ^= (uint8_t)*topic++;
+        hash *= 16777619u;
+    }
+
+    return hash % GATEWAY_ROUTE_BUCKETS;
+}
+
+static bool _route_has_wildcard(const char *topic_filter)
+{
+    return NULL != strchr(topic_filter, '+') || NULL != strchr(topic_filter, '#');
+}
+
+static VirtualRoute **_route_head(Gateway *gateway, const char *topic_filter)
+{
+    if (_route_has_wildcard(topic_filter)) {
+        return &gateway->route_wildcards;
+    }
+
+    return &gateway->route_table[_route_hash(topic_filter, strlen(topic_filter))];
+}
+
+static VirtualRoute *_route_find(Gateway *gateway, const char *topic_filter)
+{
+    VirtualRoute *route;
+
+    if (NULL == gateway->route_table) {
+        return NULL;
+    }
+
+    for (route = *_route_head(gateway, topic_filter); route != NULL; route = route->next) {
+        if (0 == strcmp(route->topic_filter, topic_filter)) {
+            return route;
+        }
+    }
+
+    return NULL;
+}
+
+static VirtualRoute *_route_match(Gateway *gateway, const char *topic, uint16_t topic_len)
+{
+    VirtualRoute *route;
+
+    if (NULL == gateway->route_table) {
+        return NULL;
+    }
+
+    for (route = gateway->route_table[_route_hash(topic, topic_len)]; route != NULL; route = route->next) {
+        if (strlen(route->topic_filter) == topic_len && 0 == memcmp(route->topic_filter, topic, topic_len)) {
+            return route;
+        }
+    }
+
+    for (route = gateway->route_wildcards; route != NULL; route = route->next) {
+        if (qcloud_iot_mqtt_is_topic_matched(route->topic_filter, topic, topic_len)) {
+            return route;
+        }
+    }
+
+    return NULL;
+}
+
+static void _route_queue(Gateway *gateway, VirtualRoute *route)
+{
+    route->state = VIRTUAL_ROUTE_PENDING;
+    list_push(&gateway->route_pending, &route->pending_link);
+}
+
+static VirtualRoute *_route_take_inflight(Gateway *gateway, uint32_t sub_id)
+{
+    int           i;
+    VirtualRoute *route;
+
+    for (i = 0; i < GATEWAY_ROUTE_INFLIGHT; i++) {
+        route = gateway->route_inflight[i];
+        if (NULL != route && route->sub_id == sub_id) {
+            gateway->route_inflight[i] = NULL;
+            return route;
+        }
+    }
+
+    return NULL;
+}
+
+static int _route_free_slot(Gateway *gateway)
+{
+    int i;
+
+    for (i = 0; i < GATEWAY_ROUTE_INFLIGHT; i++) {
+        if (NULL == gateway->route_inflight[i]) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* take the route out of the table, the pending list and the inflight slots, it stays in routes of the owner */
+static void _route_detach(Gateway *gateway, VirtualRoute *route)
+{
+    VirtualRoute **link = _route_head(gateway, route->topic_filter);
+
+    while (*link != route) {
+        link = &(*link)->next;
+    }
+    *link = route->next;
+
+    if (VIRTUAL_ROUTE_PENDING == route->state) {
+        list_unlink(&gateway->route_pending, &route->pending_link);
+    } else if (VIRTUAL_ROUTE_INFLIGHT == route->state) {
+        (void)_route_take_inflight(gateway, route->sub_id);
+    }
+}
+
+/* unsubscribe the detached routes of a virtual client and free them */
+static void _route_free_detached(Gateway *gateway, List *routes)
+{
+    VirtualRoute *route, *next;
+
+    list_for_each_entry_safe(route, next, &routes->head, owner_link, VirtualRoute)
+    {
+        if ((VIRTUAL_ROUTE_INFLIGHT == route->state || VIRTUAL_ROUTE_READY == route->state) &&
+            IOT_MQTT_IsConnected(gateway->mqtt)) {
+            if (qcloud_iot_mqtt_unsubscribe_routed(gateway->mqtt, route->topic_filter) < 0) {
+                Log_w("unsubscribe %s failed, its messages go to the event handler", route->topic_filter);
+            }
+        }
+
+        list_unlink(routes, &route->owner_link);
+        utils_mem_free(route);
+    }
+}
+
+static void _route_sub_event_handler(void *pClient, MQTTEventType event_type, void *user_data)
+{
+    Gateway *         gateway = (Gateway *)((Qcloud_IoT_Client *)pClient)->event_handle.context;
+    VirtualRoute *    route;
+    VirtualClient *   owner;
+    OnSubEventHandler sub_event_handler;
+    void *            handler_user_data;
+
+    HAL_MutexLock(gateway->route_lock);
+    route = _route_take_inflight(gateway, (uint32_t)(uintptr_t)user_data);
+    if (NULL == route) {
+        /* unsubscribed meanwhile, or sent before a reconnect */
+        HAL_MutexUnlock(gateway->route_lock);
+        return;
+    }
+
+    switch (event_type) {
+        case MQTT_EVENT_SUBCRIBE_SUCCESS:
+            route->state = VIRTUAL_ROUTE_READY;
+            break;
+
+        case MQTT_EVENT_SUBCRIBE_NACK:
+            Log_e("subscribe %s rejected", route->topic_filter);
+            route->state = VIRTUAL_ROUTE_FAILED;
+            break;
+
+        default:
+            /* sent again after the next ack, publish or reconnect */
+            _route_queue(gateway, route);
+            break;
+    }
+
+    owner             = route->owner;
+    sub_event_handler = route->sub_event_handler;
+    handler_user_data = route->user_data;
+    HAL_MutexUnlock(gateway->route_lock);
+
+    if (NULL != sub_event_handler) {
+        sub_event_handler(owner, event_type, handler_user_data);
+    }
+
+    /* the timeout is reported with the ack list of the MQTT client locked, subscribing here would deadlock */
+    if (MQTT_EVENT_SUBCRIBE_TIMEOUT != event_type) {
+        gateway_route_pump(gateway);
+    }
+}
+
+int gateway_route_init(Gateway *gateway)
+{
+    gateway->route_lock = HAL_MutexCreate();
+    if (NULL == gateway->route_lock) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    list_init(&gateway->route_pending);
+    list_init(&gateway->vclients);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+void gateway_route_release(Gateway *gateway)
+{
+    int            i;
+    VirtualRoute * route, *next;
+    VirtualClient *vclient, *vnext;
+
+    /* virtual clients still alive keep their handles, but lose the gateway and the routes freed below */
+    list_for_each_entry_safe(vclient, vnext, &gateway->vclients.head, gateway_link, VirtualClient)
+    {
+        Log_w("virtual client %s/%s outlives its gateway", vclient->product_id, vclient->device_name);
+        list_unlink(&gateway->vclients, &vclient->gateway_link);
+        list_init(&vclient->routes);
+        vclient->gateway = NULL;
+    }
+
+    if (NULL != gateway->route_table) {
+        for (i = 0; i < GATEWAY_ROUTE_BUCKETS; i++) {
+            for (route = gateway->route_table[i]; route != NULL; route = next) {
+                next = route->next;
+                utils_mem_free(route);
+            }
+        }
+        utils_mem_free(gateway->route_table);
+        gateway->route_table = NULL;
+    }
+
+    for (route = gateway->route_wildcards; route != NULL; route = next) {
+        next = route->next;
+        utils_mem_free(route);
+    }
+    gateway->route_wildcards = NULL;
+
+    if (NULL != gateway->route_lock) {
+        HAL_MutexDestroy(gateway->route_lock);
+        gateway->route_lock = NULL;
+    }
+}
+
+void gateway_route_pump(Gateway *gateway)
+{
+    int             i, rc;
+    VirtualRoute *  route;
+    uint32_t        sub_id;
+    char            topic_filter[MAX_SIZE_OF_CLOUD_TOPIC + 1];
+    SubscribeParams params = DEFAULT_SUB_PARAMS;
+
+    while (IOT_MQTT_IsConnected(gateway->mqtt)) {
+        HAL_MutexLock(gateway->route_lock);
+        i = _route_free_slot(gateway);
+        if (i < 0 || 0 == gateway->route_pending.len) {
+            HAL_MutexUnlock(gateway->route_lock);
+            return;
+        }
+
+        /* the slot is taken before sending, the SUBACK may be handled before the subscribe returns */
+        route = list_first_entry(&gateway->route_pending.head, VirtualRoute, pending_link);
+        list_unlink(&gateway->route_pending, &route->pending_link);
+        route->state = VIRTUAL_ROUTE_INFLIGHT;
+        if (0 == ++gateway->route_next_id) {
+            ++gateway->route_next_id;
+        }
+        route->sub_id              = gateway->route_next_id;
+        gateway->route_inflight[i] = route;
+
+        sub_id = route->sub_id;
+        strncpy(topic_filter, route->topic_filter, sizeof(topic_filter) - 1);
+        topic_filter[sizeof(topic_filter) - 1] = '\0';
+        params.qos                             = route->qos;
+        params.on_sub_event_handler            = _route_sub_event_handler;
+        params.user_data                       = (void *)(uintptr_t)sub_id;
+        HAL_MutexUnlock(gateway->route_lock);
+
+        rc = qcloud_iot_mqtt_subscribe_routed(gateway->mqtt, topic_filter, &params);
+        if (rc < 0) {
+            /* the ack list is full or the connection is lost, wait for the next ack or reconnect */
+            Log_d("subscribe %s deferred: %d", topic_filter, rc);
+            HAL_MutexLock(gateway->route_lock);
+            route = _route_take_inflight(gateway, sub_id);
+            if (NULL != route) {
+                _route_queue(gateway, route);
+            }
+            HAL_MutexUnlock(gateway->route_lock);
+            return;
+        }
+    }
+}
+
+void gateway_route_reset(Gateway *gateway)
+{
+    int           i;
+    VirtualRoute *route;
+
+    HAL_MutexLock(gateway->route_lock);
+    for (i = 0; i < GATEWAY_ROUTE_INFLIGHT; i++) {
+        if (NULL != gateway->route_inflight[i]) {
+            _route_queue(gateway, gateway->route_inflight[i]);
+            gateway->route_inflight[i] = NULL;
+        }
+    }
+
+    for (i = 0; NULL != gateway->route_table && i < GATEWAY_ROUTE_BUCKETS; i++) {
+        for (route = gateway->route_table[i]; route != NULL; route = route->next) {
+            if (VIRTUAL_ROUTE_READY == route->state) {
+                _route_queue(gateway, route);
+            }
+        }
+    }
+
+    for (route = gateway->route_wildcards; route != NULL; route = route->next) {
+        if (VIRTUAL_ROUTE_READY == route->state) {
+            _route_queue(gateway, route);
+        }
+    }
+    HAL_MutexUnlock(gateway->route_lock);
+
+    gateway_route_pump(gateway);
+}
+
+bool gateway_route_message(Gateway *gateway, MQTTMessage *message)
+{
+    VirtualRoute *   route;
+    VirtualClient *  owner;
+    OnMessageHandler message_handler;
+    void *           user_data;
+
+    HAL_MutexLock(gateway->route_lock);
+    route = _route_match(gateway, message->ptopic, (uint16_t)message->topic_len);
+    if (NULL == route) {
+        HAL_MutexUnlock(gateway->route_lock);
+        return false;
+    }
+
+    owner           = route->owner;
+    message_handler = route->message_handler;
+    user_data       = route->user_data;
+    HAL_MutexUnlock(gateway->route_lock);
+
+    if (NULL != message_handler) {
+        message_handler(owner, message, user_data);
+    }
+
+    if (gateway->route_pending.len > 0) {
+        gateway_route_pump(gateway);
+    }
+
+    return true;
+}
+
+void *IOT_Gateway_Virtual_Construct(void *client, const char *subdev_product_id, const char *subdev_device_name)
+{
+    int                rc;
+    Gateway *          gateway = (Gateway *)client;
+    Qcloud_IoT_Client *mqtt_client;
+    VirtualClient *    vclient;
+    GatewayParam       param = DEFAULT_GATEWAY_PARAMS;
+
+    POINTER_SANITY_CHECK(gateway, NULL);
+    STRING_PTR_SANITY_CHECK(subdev_product_id, NULL);
+    STRING_PTR_SANITY_CHECK(subdev_device_name, NULL);
+
+    if (strlen(subdev_product_id) > MAX_SIZE_OF_PRODUCT_ID || strlen(subdev_device_name) > MAX_SIZE_OF_DEVICE_NAME) {
+        Log_e("sub-device product id or device name too long");
+        return NULL;
+    }
+
+    vclient = (VirtualClient *)utils_mem_alloc(MEM_TAG_GATEWAY, sizeof(VirtualClient));
+    if (NULL == vclient) {
+        Log_e("virtual client malloc failed");
+        return NULL;
+    }
+
+    memset(vclient, 0, sizeof(VirtualClient));
+    vclient->gateway = gateway;
+    strcpy(vclient->product_id, subdev_product_id);
+    strcpy(vclient->device_name, subdev_device_name);
+    list_init(&vclient->routes);
+
+    mqtt_client              = (Qcloud_IoT_Client *)gateway->mqtt;
+    param.product_id         = mqtt_client->device_info.product_id;
+    param.device_name        = mqtt_client->device_info.device_name;
+    param.subdev_product_id  = vclient->product_id;
+    param.subdev_device_name = vclient->device_name;
+
+    rc = IOT_Gateway_Subdev_Online(gateway, &param);
+    if (QCLOUD_RET_SUCCESS != rc && QCLOUD_ERR_GATEWAY_SUBDEV_ONLINE != rc) {
+        Log_e("sub-device %s/%s online failed: %d", vclient->product_id, vclient->device_name, rc);
+        utils_mem_free(vclient);
+        return NULL;
+    }
+
+    HAL_MutexLock(gateway->route_lock);
+    list_push(&gateway->vclients, &vclient->gateway_link);
+    HAL_MutexUnlock(gateway->route_lock);
+
+    return vclient;
+}
+
+int IOT_Gateway_Virtual_Destroy(void *vclient_handle)
+{
+    int                rc;
+    VirtualClient *    vclient = (VirtualClient *)vclient_handle;
+    Gateway *          gateway;
+    Qcloud_IoT_Client *mqtt_client;
+    VirtualRoute *     route;
+    GatewayParam       param = DEFAULT_GATEWAY_PARAMS;
+
+    POINTER_SANITY_CHECK(vclient, QCLOUD_ERR_INVAL);
+    gateway = vclient->gateway;
+
+    /* detached by the gateway destroyed first, nothing left but the handle */
+    if (NULL == gateway) {
+        utils_mem_free(vclient);
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    HAL_MutexLock(gateway->route_lock);
+    list_for_each_entry(route, &vclient->routes.head, owner_link, VirtualRoute)
+    {
+        _route_detach(gateway, route);
+    }
+    list_unlink(&gateway->vclients, &vclient->gateway_link);
+    HAL_MutexUnlock(gateway->route_lock);
+
+    _route_free_detached(gateway, &vclient->routes);
+
+    mqtt_client              = (Qcloud_IoT_Client *)gateway->mqtt;
+    param.product_id         = mqtt_client->device_info.product_id;
+    param.device_name        = mqtt_client->device_info.device_name;
+    param.subdev_product_id  = vclient->product_id;
+    param.subdev_device_name = vclient->device_name;
+
+    rc = IOT_Gateway_Subdev_Offline(gateway, &param);
+    if (QCLOUD_RET_SUCCESS != rc) {
+        Log_w("sub-device %s/%s offline failed: %d", vclient->product_id, vclient->device_name, rc);
+    }
+
+    utils_mem_free(vclient);
+
+    return rc;
+}
+
+int IOT_Gateway_Virtual_Publish(void *vclient_handle, char *topic_name, PublishParams *params)
+{
+    int            rc;
+    VirtualClient *vclient = (VirtualClient *)vclient_handle;
+    Gateway *      gateway;
+
+    POINTER_SANITY_CHECK(vclient, QCLOUD_ERR_INVAL);
+    if (NULL == (gateway = _vclient_gateway(vclient))) {
+        return QCLOUD_ERR_INVAL;
+    }
+
+    rc = IOT_MQTT_Publish(gateway->mqtt, topic_name, params);
+
+    /* subscriptions deferred by a full ack list go out on the next chance */
+    if (gateway->route_pending.len > 0) {
+        gateway_route_pump(gateway);
+    }
+
+    return rc;
+}
+
+int IOT_Gateway_Virtual_Subscribe(void *vclient_handle, char *topic_filter, SubscribeParams *params)
+{
+    VirtualClient *vclient = (VirtualClient *)vclient_handle;
+    Gateway *      gateway;
+    VirtualRoute * route;
+    VirtualRoute **head;
+    size_t         len;
+
+    POINTER_SANITY_CHECK(vclient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(params, QCLOUD_ERR_INVAL);
+    STRING_PTR_SANITY_CHECK(topic_filter, QCLOUD_ERR_INVAL);
+
+    len = strlen(topic_filter);
+    if (len > MAX_SIZE_OF_CLOUD_TOPIC) {
+        return QCLOUD_ERR_MAX_TOPIC_LENGTH;
+    }
+
+    if (QOS2 == params->qos) {
+        Log_e("QoS2 is not supported currently");
+        return QCLOUD_ERR_MQTT_QOS_NOT_SUPPORT;
+    }
+
+    if (NULL == (gateway = _vclient_gateway(vclient))) {
+        return QCLOUD_ERR_INVAL;
+    }
+    HAL_MutexLock(gateway->route_lock);
+    if (NULL == gateway->route_table) {
+        gateway->route_table =
+            (VirtualRoute **)utils_mem_alloc(MEM_TAG_GATEWAY, GATEWAY_ROUTE_BUCKETS * sizeof(VirtualRoute *));
+        if (NULL == gateway->route_table) {
+            HAL_MutexUnlock(gateway->route_lock);
+            Log_e("route table malloc failed");
+            return QCLOUD_ERR_MALLOC;
+        }
+        memset(gateway->route_table, 0, GATEWAY_ROUTE_BUCKETS * sizeof(VirtualRoute *));
+    }
+
+    route = _route_find(gateway, topic_filter);
+    if (NULL != route && route->owner != vclient) {
+        HAL_MutexUnlock(gateway->route_lock);
+        Log_e("topic %s is subscribed by %s/%s", topic_filter, route->owner->product_id, route->owner->device_name);
+        return QCLOUD_ERR_MQTT_SUB;
+    }
+
+    if (NULL == route) {
+        route = (VirtualRoute *)utils_mem_alloc(MEM_TAG_GATEWAY, sizeof(VirtualRoute) + len + 1);
+        if (NULL == route) {
+            HAL_MutexUnlock(gateway->route_lock);
+            Log_e("route malloc failed");
+            return QCLOUD_ERR_MALLOC;
+        }
+
+        memset(route, 0, sizeof(VirtualRoute));
+        route->topic_filter = (char *)(route + 1);
+        strcpy(route->topic_filter, topic_filter);
+        route->owner = vclient;
+
+        head        = _route_head(gateway, topic_filter);
+        route->next = *head;
+        *head       = route;
+        list_push(&vclient->routes, &route->owner_link);
+        _route_queue(gateway, route);
+    } else if (VIRTUAL_ROUTE_FAILED == route->state) {
+        _route_queue(gateway, route);
+    }
+
+    route->message_handler   = params->on_message_handler;
+    route->sub_event_handler = params->on_sub_event_handler;
+    route->user_data         = params->user_data;
+    route->qos               = params->qos;
+    HAL_MutexUnlock(gateway->route_lock);
+
+    gateway_route_pump(gateway);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int IOT_Gateway_Virtual_Unsubscribe(void *vclient_handle, char *topic_filter)
+{
+    VirtualClient *vclient = (VirtualClient *)vclient_handle;
+    Gateway *      gateway;
+    VirtualRoute * route;
+    List           detached;
+
+    POINTER_SANITY_CHECK(vclient, QCLOUD_ERR_INVAL);
+    STRING_PTR_SANITY_CHECK(topic_filter, QCLOUD_ERR_INVAL);
+
+    if (NULL == (gateway = _vclient_gateway(vclient))) {
+        return QCLOUD_ERR_INVAL;
+    }
+    list_init(&detached);
+
+    HAL_MutexLock(gateway->route_lock);
+    route = _route_find(gateway, topic_filter);
+    if (NULL == route || route->owner != vclient) {
+        HAL_MutexUnlock(gateway->route_lock);
+        Log_e("subscription does not exists: %s", topic_filter);
+        return QCLOUD_ERR_MQTT_UNSUB_FAIL;
+    }
+
+    _route_detach(gateway, route);
+    list_unlink(&vclient->routes, &route->owner_link);
+    list_push(&detached, &route->owner_link);
+    HAL_MutexUnlock(gateway->route_lock);
+
+    if (NULL != route->sub_event_handler) {
+        route->sub_event_handler(vclient, MQTT_EVENT_UNSUBSCRIBE, route->user_data);
+    }
+
+    _route_free_detached(gateway, &detached);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+bool IOT_Gateway_Virtual_IsSubReady(void *vclient_handle, char *topic_filter)
+{
+    VirtualClient *vclient = (VirtualClient *)vclient_handle;
+    Gateway *      gateway;
+    VirtualRoute * route;
+    bool           ready;
+
+    POINTER_SANITY_CHECK(vclient, false);
+    STRING_PTR_SANITY_CHECK(topic_filter, false);
+
+    if (NULL == (gateway = _vclient_gateway(vclient))) {
+        return false;
+    }
+
+    HAL_MutexLock(gateway->route_lock);
+    route = _route_find(gateway, topic_filter);
+    ready = NULL != route && route->owner == vclient && VIRTUAL_ROUTE_READY == route->state;
+    HAL_MutexUnlock(gateway->route_lock);
+
+    return ready;
+}
@@ -30,6 +30,7 @@ extern "C" {
 
 #include "lite-utils.h"
 #include "log_upload.h"
+#include "qcloud_iot_clock.h"
 #include "qcloud_iot_common.h"
 #include "utils_hmac.h"
 #include "utils_httpc.h"
@@ -136,6 +137,10 @@ static int _gen_key_from_file(const char *file_path)
 
 static long _get_system_time(void)
 {
+    /* once synced the SDK clock is as good as the server and costs no round trip */
+    if (qcloud_iot_clock_is_synced())
+        return qcloud_iot_clock_now_sec();
+
 #ifdef SYSTEM_COMM
     if (sg_uploader->mqtt_client == NULL)
         return 0;
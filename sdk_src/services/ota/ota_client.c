@@ -26,6 +26,7 @@ extern "C" {
 #include "ota_fetch.h"
 #include "ota_lib.h"
 #include "qcloud_iot_export.h"
+#include "utils_mem.h"
 #include "utils_param_check.h"
 #include "utils_timer.h"
 
@@ -44,9 +45,11 @@ typedef struct {
 
     char *purl;       /* point to URL */
     char *version;    /* point to string */
-    char  md5sum[33]; /* MD5 string */
+    char  md5sum[33];    /* MD5 string */
+    char  sha256sum[65]; /* SHA256 string, empty if cloud does not provide it */
 
-    void *md5;       /* MD5 handle */
+    uint32_t digest_types; /* mask of IOT_OTA_DigestType to compute */
+    void *   digest;       /* digest pipeline handle */
     void *ch_signal; /* channel handle of signal exchanged with OTA server */
     void *ch_fetch;  /* channel handle of download */
 
@@ -65,6 +68,17 @@ static int _ota_check_progress(IOT_OTA_Progress_Code progress)
     return ((progress >= IOT_OTAP_BURN_FAILED) && (progress <= IOT_OTAP_FETCH_PERCENTAGE_MAX));
 }
 
+/* the pipeline hashes from the first byte, so it is recreated whenever the set of digests changes */
+static int _ota_digest_set_types(OTA_Struct_t *h_ota, uint32_t types)
+{
+    if (types == h_ota->digest_types && NULL != h_ota->digest) {
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    h_ota->digest_types = types;
+    return IOT_OTA_ResetClientMD5(h_ota);
+}
+
 /* callback when OTA topic msg is received */
 static void _ota_callback(void *pcontext, const char *msg, uint32_t msg_len)
 {
@@ -116,6 +130,13 @@ static void _ota_callback(void *pcontext, const char *msg, uint32_t msg_len)
             goto End;
         }
 
+        if (QCLOUD_RET_SUCCESS != qcloud_otalib_get_sha256(msg, h_ota->sha256sum)) {
+            h_ota->sha256sum[0] = '\0';
+        } else if (QCLOUD_RET_SUCCESS != _ota_digest_set_types(h_ota, h_ota->digest_types | IOT_OTA_DIGEST_SHA256)) {
+            Log_e("initialize digest failed");
+            goto End;
+        }
+
         h_ota->state = IOT_OTAS_FETCHING;
     }
 
@@ -250,7 +271,7 @@ static int IOT_OTA_ReportUpgradeResult(void *handle, const char *version, IOT_OT
     }
 
     if ((IOT_OTAR_UPGRADE_FAIL == reportType) || (IOT_OTAR_UPGRADE_SUCCESS == reportType) ||
-        (IOT_OTAR_MD5_NOT_MATCH == reportType)) {
+        (IOT_OTAR_MD5_NOT_MATCH == reportType) || (IOT_OTAR_SHA256_NOT_MATCH == reportType)) {
         IOT_OTA_ResetStatus(h_ota);
     }
 
@@ -272,7 +293,7 @@ void *IOT_OTA_Init(const char *product_id, const char *device_name, void *ch_sig
 
     OTA_Struct_t *h_ota = NULL;
 
-    if (NULL == (h_ota = HAL_Malloc(sizeof(OTA_Struct_t)))) {
+    if (NULL == (h_ota = utils_mem_alloc(MEM_TAG_OTA, sizeof(OTA_Struct_t)))) {
         Log_e("allocate failed");
         return NULL;
     }
@@ -285,9 +306,10 @@ void *IOT_OTA_Init(const char *product_id, const char *device_name, void *ch_sig
         goto do_exit;
     }
 
-    h_ota->md5 = qcloud_otalib_md5_init();
-    if (NULL == h_ota->md5) {
-        Log_e("initialize md5 failed");
+    h_ota->digest_types = IOT_OTA_DIGEST_MD5;
+    h_ota->digest       = qcloud_otalib_digest_init(h_ota->digest_types);
+    if (NULL == h_ota->digest) {
+        Log_e("initialize digest failed");
         goto do_exit;
     }
 
@@ -307,12 +329,12 @@ do_exit:
         qcloud_osc_deinit(h_ota->ch_signal);
     }
 
-    if (NULL != h_ota->md5) {
-        qcloud_otalib_md5_deinit(h_ota->md5);
+    if (NULL != h_ota->digest) {
+        qcloud_otalib_digest_deinit(h_ota->digest);
     }
 
     if (NULL != h_ota) {
-        HAL_Free(h_ota);
+        utils_mem_free(h_ota);
     }
 
     return NULL;
@@ -338,7 +360,7 @@ int IOT_OTA_Destroy(void *handle)
 
     qcloud_osc_deinit(h_ota->ch_signal);
     qcloud_ofc_deinit(h_ota->ch_fetch);
-    qcloud_otalib_md5_deinit(h_ota->md5);
+    qcloud_otalib_digest_deinit(h_ota->digest);
 
     if (NULL != h_ota->purl) {
         HAL_Free(h_ota->purl);
@@ -348,7 +370,7 @@ int IOT_OTA_Destroy(void *handle)
         HAL_Free(h_ota->version);
     }
 
-    HAL_Free(h_ota);
+    utils_mem_free(h_ota);
     return QCLOUD_RET_SUCCESS;
 }
 
@@ -361,11 +383,11 @@ int IOT_OTA_StartDownload(void *handle, uint32_t offset, uint32_t size)
     Log_d("to download FW from offset: %u, size: %u", offset, size);
     h_ota->size_fetched = offset;
 
-    // reset md5 for new download
+    // reset digests for new download
     if (offset == 0) {
         Ret = IOT_OTA_ResetClientMD5(h_ota);
         if (Ret) {
-            Log_e("initialize md5 failed");
+            Log_e("initialize digest failed");
             return QCLOUD_ERR_FAILURE;
         }
     }
@@ -392,7 +414,7 @@ void IOT_OTA_UpdateClientMd5(void *handle, char *buff, uint32_t size)
 {
     OTA_Struct_t *h_ota = (OTA_Struct_t *)handle;
 
-    qcloud_otalib_md5_update(h_ota->md5, buff, size);
+    qcloud_otalib_digest_update(h_ota->digest, buff, size);
 }
 
 /*support continuous transmission of breakpoints*/
@@ -400,15 +422,61 @@ int IOT_OTA_ResetClientMD5(void *handle)
 {
     OTA_Struct_t *h_ota = (OTA_Struct_t *)handle;
 
-    qcloud_otalib_md5_deinit(h_ota->md5);
-    h_ota->md5 = qcloud_otalib_md5_init();
-    if (NULL == h_ota->md5) {
+    qcloud_otalib_digest_deinit(h_ota->digest);
+    h_ota->digest = qcloud_otalib_digest_init(h_ota->digest_types);
+    if (NULL == h_ota->digest) {
         return QCLOUD_ERR_FAILURE;
     }
 
     return QCLOUD_RET_SUCCESS;
 }
 
+int IOT_OTA_SetDigest(void *handle, uint32_t digests)
+{
+    OTA_Struct_t *h_ota = (OTA_Struct_t *)handle;
+
+    POINTER_SANITY_CHECK(handle, IOT_OTA_ERR_INVALID_PARAM);
+    if (digests & ~(uint32_t)(IOT_OTA_DIGEST_MD5 | IOT_OTA_DIGEST_SHA256)) {
+        return IOT_OTA_ERR_INVALID_PARAM;
+    }
+
+    if (IOT_OTAS_FETCHING == h_ota->state && h_ota->size_fetched > 0) {
+        Log_e("digests can't be changed while the firmware is being fetched");
+        return IOT_OTA_ERR_INVALID_STATE;
+    }
+
+    digests |= IOT_OTA_DIGEST_MD5;
+    if (h_ota->sha256sum[0]) {
+        digests |= IOT_OTA_DIGEST_SHA256;
+    }
+
+    return _ota_digest_set_types(h_ota, digests);
+}
+
+int IOT_OTA_GetDigest(void *handle, IOT_OTA_DigestType type, char *buf, size_t buf_len)
+{
+    OTA_Struct_t *h_ota = (OTA_Struct_t *)handle;
+
+    POINTER_SANITY_CHECK(handle, IOT_OTA_ERR_INVALID_PARAM);
+    POINTER_SANITY_CHECK(buf, IOT_OTA_ERR_INVALID_PARAM);
+
+    return qcloud_otalib_digest_finalize(h_ota->digest, type, buf, buf_len);
+}
+
+int IOT_OTA_GetDigestStat(void *handle, uint32_t *hashed_bytes, uint32_t *hash_ms)
+{
+    OTA_Struct_t *h_ota = (OTA_Struct_t *)handle;
+    uint32_t      types;
+
+    POINTER_SANITY_CHECK(handle, IOT_OTA_ERR_INVALID_PARAM);
+    POINTER_SANITY_CHECK(hashed_bytes, IOT_OTA_ERR_INVALID_PARAM);
+    POINTER_SANITY_CHECK(hash_ms, IOT_OTA_ERR_INVALID_PARAM);
+
+    qcloud_otalib_digest_stat(h_ota->digest, &types, hashed_bytes, hash_ms);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
 int IOT_OTA_ReportVersion(void *handle, const char *version)
 {
 #define MSG_INFORM_LEN (128)
@@ -593,7 +661,7 @@ int IOT_OTA_FetchYield(void *handle, char *buf, uint32_t buf_len, uint32_t timeo
         h_ota->state = IOT_OTAS_FETCHED;
     }
 
-    qcloud_otalib_md5_update(h_ota->md5, buf, ret);
+    qcloud_otalib_digest_update(h_ota->digest, buf, ret);
 
     return ret;
 }
@@ -642,6 +710,11 @@ int IOT_OTA_Ioctl(void *handle, IOT_OTA_CmdType type, void *buf, size_t buf_len)
             ((char *)buf)[buf_len - 1] = '\0';
             break;
 
+        case IOT_OTAG_SHA256SUM:
+            strncpy(buf, h_ota->sha256sum, buf_len);
+            ((char *)buf)[buf_len - 1] = '\0';
+            break;
+
         case IOT_OTAG_CHECK_FIRMWARE:
             if ((4 != buf_len) || (0 != ((unsigned long)buf & 0x3))) {
                 Log_e("Invalid parameter");
@@ -652,15 +725,40 @@ int IOT_OTA_Ioctl(void *handle, IOT_OTA_CmdType type, void *buf, size_t buf_len)
                 Log_e("Firmware can be checked in IOT_OTAS_FETCHED state only");
                 return QCLOUD_ERR_FAILURE;
             } else {
-                char md5_str[33];
-                qcloud_otalib_md5_finalize(h_ota->md5, md5_str);
+                char              md5_str[33];
+                char              sha256_str[65];
+                uint32_t          types, hashed_bytes, hash_ms;
+                IOT_OTAReportType report;
+
+                qcloud_otalib_digest_finalize(h_ota->digest, IOT_OTA_DIGEST_MD5, md5_str, sizeof(md5_str));
                 Log_i("FW MD5 check: origin=%s, now=%s", STRING_PTR_PRINT_SANITY_CHECK(h_ota->md5sum), md5_str);
-                if (0 == strcmp(h_ota->md5sum, md5_str)) {
-                    *((uint32_t *)buf) = 1;
-                } else {
-                    *((uint32_t *)buf) = 0;
-                    // report MD5 inconsistent
-                    IOT_OTA_ReportUpgradeResult(h_ota, h_ota->version, IOT_OTAR_MD5_NOT_MATCH);
+                *((uint32_t *)buf) = (0 == strcmp(h_ota->md5sum, md5_str));
+
+                report = *((uint32_t *)buf) ? IOT_OTAR_NONE : IOT_OTAR_MD5_NOT_MATCH;
+
+                // the cloud sent a SHA256, a firmware which was not hashed with it does not pass
+                if (h_ota->sha256sum[0] && IOT_OTAR_NONE == report) {
+                    if (QCLOUD_RET_SUCCESS != qcloud_otalib_digest_finalize(h_ota->digest, IOT_OTA_DIGEST_SHA256,
+                                                                            sha256_str, sizeof(sha256_str))) {
+                        Log_e("FW SHA256 check: origin=%s, not computed", h_ota->sha256sum);
+                        report = IOT_OTAR_SHA256_NOT_MATCH;
+                    } else {
+                        Log_i("FW SHA256 check: origin=%s, now=%s", h_ota->sha256sum, sha256_str);
+                        if (0 != strcmp(h_ota->sha256sum, sha256_str)) {
+                            report = IOT_OTAR_SHA256_NOT_MATCH;
+                        }
+                    }
+                    *((uint32_t *)buf) = (IOT_OTAR_NONE == report);
+                }
+
+                qcloud_otalib_digest_stat(h_ota->digest, &types, &hashed_bytes, &hash_ms);
+                Log_i("FW hashed %u bytes in %u ms (%u kB/s)%s", hashed_bytes, hash_ms,
+                      hash_ms ? hashed_bytes / hash_ms : 0,
+                      (types & IOT_OTA_DIGEST_SHA256) ? " with MD5 and SHA256" : " with MD5");
+
+                if (IOT_OTAR_NONE != report) {
+                    // report checksum inconsistent
+                    IOT_OTA_ReportUpgradeResult(h_ota, h_ota->version, report);
                 }
                 return 0;
             }
@@ -142,6 +142,9 @@ int qcloud_ofc_deinit(void *handle)
     if (h_odc->http.network_stack.is_connected(&h_odc->http.network_stack))
         h_odc->http.network_stack.disconnect(&h_odc->http.network_stack);
 
+    /* drops whatever the server sent past the firmware */
+    qcloud_http_client_close(&h_odc->http);
+
     HAL_Free(handle);
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
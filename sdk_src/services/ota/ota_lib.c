@@ -19,6 +19,7 @@ extern "C" {
 
 #include "ota_lib.h"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -27,6 +28,7 @@ extern "C" {
 #include "qcloud_iot_export.h"
 #include "qcloud_iot_import.h"
 #include "utils_md5.h"
+#include "utils_sha256.h"
 
 /* Get the specific @key value, and copy to @dest */
 /* 0, successful; -1, failed */
@@ -127,41 +129,170 @@ static int _qcloud_otalib_get_firmware_varlen_para(const char *json_doc, const c
 #undef OTA_FIRMWARE_JSON_VALUE_MAX_LENGTH
 }
 
-void *qcloud_otalib_md5_init(void)
+/* one entry per digest the pipeline can run, the context lives at ctx_offset in OTADigest */
+typedef struct {
+    IOT_OTA_DigestType type;
+    const char *       name;
+    size_t             ctx_offset;
+    size_t             len;
+    void (*starts)(void *ctx);
+    void (*update)(void *ctx, const unsigned char *input, size_t ilen);
+    void (*finish)(const void *ctx, unsigned char *output);
+} OTADigestOps;
+
+typedef struct {
+    uint32_t           types;
+    uint32_t           hashed_bytes;
+    uint32_t           hash_ms;
+    iot_md5_context    md5;
+    iot_sha256_context sha256;
+} OTADigest;
+
+static void _ota_md5_starts(void *ctx)
 {
-    iot_md5_context *ctx = HAL_Malloc(sizeof(iot_md5_context));
-    if (NULL == ctx) {
+    utils_md5_init(ctx);
+    utils_md5_starts(ctx);
+}
+
+static void _ota_md5_update(void *ctx, const unsigned char *input, size_t ilen)
+{
+    utils_md5_update(ctx, input, ilen);
+}
+
+static void _ota_md5_finish(const void *ctx, unsigned char *output)
+{
+    iot_md5_context tmp;
+
+    utils_md5_clone(&tmp, ctx);
+    utils_md5_finish(&tmp, output);
+}
+
+static void _ota_sha256_starts(void *ctx)
+{
+    utils_sha256_init(ctx);
+    utils_sha256_starts(ctx);
+}
+
+static void _ota_sha256_update(void *ctx, const unsigned char *input, size_t ilen)
+{
+    utils_sha256_update(ctx, input, ilen);
+}
+
+static void _ota_sha256_finish(const void *ctx, unsigned char *output)
+{
+    iot_sha256_context tmp;
+
+    utils_sha256_clone(&tmp, ctx);
+    utils_sha256_finish(&tmp, output);
+    utils_sha256_free(&tmp);
+}
+
+static const OTADigestOps sg_ota_digests[] = {
+    {IOT_OTA_DIGEST_MD5, "MD5", offsetof(OTADigest, md5), 16, _ota_md5_starts, _ota_md5_update, _ota_md5_finish},
+    {IOT_OTA_DIGEST_SHA256, "SHA256", offsetof(OTADigest, sha256), 32, _ota_sha256_starts, _ota_sha256_update,
+     _ota_sha256_finish},
+};
+
+#define OTA_DIGEST_NUM (sizeof(sg_ota_digests) / sizeof(sg_ota_digests[0]))
+
+void *qcloud_otalib_digest_init(uint32_t types)
+{
+    OTADigest *digest = HAL_Malloc(sizeof(OTADigest));
+    int        i;
+
+    if (NULL == digest) {
         return NULL;
     }
+    memset(digest, 0, sizeof(OTADigest));
 
-    utils_md5_init(ctx);
-    utils_md5_starts(ctx);
+    /* MD5 is what the cloud sends, it is always computed */
+    digest->types = types | IOT_OTA_DIGEST_MD5;
+    for (i = 0; i < OTA_DIGEST_NUM; i++) {
+        if (digest->types & sg_ota_digests[i].type) {
+            sg_ota_digests[i].starts((char *)digest + sg_ota_digests[i].ctx_offset);
+        }
+    }
 
-    return ctx;
+    return digest;
 }
 
-void qcloud_otalib_md5_update(void *md5, const char *buf, size_t buf_len)
+void qcloud_otalib_digest_update(void *digest, const char *buf, size_t buf_len)
 {
-    utils_md5_update(md5, (unsigned char *)buf, buf_len);
+    OTADigest *d     = (OTADigest *)digest;
+    uint32_t   start = HAL_GetTimeMs();
+    size_t     slice;
+    int        i;
+
+    /* run every digest over a slice before moving on, so the firmware is read from memory once
+     * and the other digests hit it in cache */
+    while (buf_len > 0) {
+        slice = buf_len > OTA_DIGEST_SLICE_LEN ? OTA_DIGEST_SLICE_LEN : buf_len;
+        for (i = 0; i < OTA_DIGEST_NUM; i++) {
+            if (d->types & sg_ota_digests[i].type) {
+                sg_ota_digests[i].update((char *)d + sg_ota_digests[i].ctx_offset, (const unsigned char *)buf, slice);
+            }
+        }
+        buf += slice;
+        buf_len -= slice;
+        d->hashed_bytes += slice;
+    }
+
+    /* ms deltas add up to the real time on average, even when each call is shorter than a tick */
+    d->hash_ms += HAL_GetTimeMs() - start;
 }
 
-void qcloud_otalib_md5_finalize(void *md5, char *output_str)
+int qcloud_otalib_digest_finalize(void *digest, IOT_OTA_DigestType type, char *output_str, size_t output_len)
 {
-    int           i;
-    unsigned char buf_out[16];
-    utils_md5_finish(md5, buf_out);
+    OTADigest *   d = (OTADigest *)digest;
+    unsigned char buf_out[32];
+    int           i, j;
+
+    for (i = 0; i < OTA_DIGEST_NUM; i++) {
+        if (sg_ota_digests[i].type == type) {
+            break;
+        }
+    }
+    if (i == OTA_DIGEST_NUM || !(d->types & type) || output_len < 2 * sg_ota_digests[i].len + 1) {
+        return IOT_OTA_ERR_INVALID_PARAM;
+    }
 
-    for (i = 0; i < 16; ++i) {
-        output_str[i * 2]     = utils_hb2hex(buf_out[i] >> 4);
-        output_str[i * 2 + 1] = utils_hb2hex(buf_out[i]);
+    /* finalize a copy, so it can be called again and the download can go on */
+    sg_ota_digests[i].finish((char *)d + sg_ota_digests[i].ctx_offset, buf_out);
+    for (j = 0; j < sg_ota_digests[i].len; ++j) {
+        output_str[j * 2]     = utils_hb2hex(buf_out[j] >> 4);
+        output_str[j * 2 + 1] = utils_hb2hex(buf_out[j]);
     }
-    output_str[32] = '\0';
+    output_str[2 * sg_ota_digests[i].len] = '\0';
+
+    return QCLOUD_RET_SUCCESS;
 }
 
-void qcloud_otalib_md5_deinit(void *md5)
+void qcloud_otalib_digest_stat(void *digest, uint32_t *types, uint32_t *hashed_bytes, uint32_t *hash_ms)
 {
-    if (NULL != md5) {
-        HAL_Free(md5);
+    OTADigest *d = (OTADigest *)digest;
+
+    *types        = d->types;
+    *hashed_bytes = d->hashed_bytes;
+    *hash_ms      = d->hash_ms;
+}
+
+const char *qcloud_otalib_digest_name(IOT_OTA_DigestType type)
+{
+    int i;
+
+    for (i = 0; i < OTA_DIGEST_NUM; i++) {
+        if (sg_ota_digests[i].type == type) {
+            return sg_ota_digests[i].name;
+        }
+    }
+
+    return "UNKNOWN";
+}
+
+void qcloud_otalib_digest_deinit(void *digest)
+{
+    if (NULL != digest) {
+        HAL_Free(digest);
     }
 }
 
@@ -234,6 +365,17 @@ int qcloud_otalib_get_params(const char *json, char **type, char **url, char **v
 #undef OTA_FILESIZE_STR_LEN
 }
 
+int qcloud_otalib_get_sha256(const char *json, char *sha256)
+{
+    /* optional, only firmware uploaded with a SHA-256 carries it */
+    if (NULL == strstr(json, "\"" SHA256_FIELD "\"")) {
+        return IOT_OTA_ERR_FAIL;
+    }
+
+    memset(sha256, 0, 65);
+    return _qcloud_otalib_get_firmware_fixlen_para(json, SHA256_FIELD, sha256, 64);
+}
+
 int qcloud_otalib_gen_info_msg(char *buf, size_t bufLen, uint32_t id, const char *version)
 {
     IOT_FUNC_ENTRY;
@@ -275,6 +417,7 @@ int qcloud_otalib_gen_report_msg(char *buf, size_t bufLen, uint32_t id, const ch
         case IOT_OTAR_DOWNLOAD_TIMEOUT:
         case IOT_OTAR_FILE_NOT_EXIST:
         case IOT_OTAR_MD5_NOT_MATCH:
+        case IOT_OTAR_SHA256_NOT_MATCH:
         case IOT_OTAR_AUTH_FAIL:
         case IOT_OTAR_UPGRADE_FAIL:
             ret = HAL_Snprintf(buf, bufLen,
@@ -34,6 +34,7 @@ typedef struct {
     const char *device_name;
 
     char                 topic_upgrade[OTA_MAX_TOPIC_LEN];  // OTA MQTT Topic
+    MQTTTopicHandle      topic_report;                      // topic of progress and version reports
     OnOTAMessageCallback msg_callback;
 
     void *context;
@@ -65,12 +66,11 @@ static int _otamqtt_gen_topic_name(char *buf, size_t bufLen, const char *OTATopi
 }
 
 /* report progress of OTA */
-static int _otamqtt_publish(OTA_MQTT_Struct_t *handle, const char *topicType, int qos, const char *msg)
+static int _otamqtt_publish(OTA_MQTT_Struct_t *handle, int qos, const char *msg)
 {
     IOT_FUNC_ENTRY;
 
     int           ret;
-    char          topic_name[OTA_MAX_TOPIC_LEN];
     PublishParams pub_params = DEFAULT_PUB_PARAMS;
 
     if (0 == qos) {
@@ -81,16 +81,9 @@ static int _otamqtt_publish(OTA_MQTT_Struct_t *handle, const char *topicType, in
     pub_params.payload     = (void *)msg;
     pub_params.payload_len = strlen(msg);
 
-    /* inform OTA to topic: "/ota/device/progress/$(product_id)/$(device_name)" */
-    ret = _otamqtt_gen_topic_name(topic_name, OTA_MAX_TOPIC_LEN, topicType, handle->product_id, handle->device_name);
+    ret = IOT_MQTT_Publish_Topic(handle->mqtt, &handle->topic_report, &pub_params);
     if (ret < 0) {
-        Log_e("generate topic name of info failed");
-        IOT_FUNC_EXIT_RC(IOT_OTA_ERR_FAIL);
-    }
-
-    ret = IOT_MQTT_Publish(handle->mqtt, topic_name, &pub_params);
-    if (ret < 0) {
-        Log_e("publish to topic: %s failed", topic_name);
+        Log_e("publish to topic: %s failed", (char *)handle->topic_report.wire + 2);
         IOT_FUNC_EXIT_RC(IOT_OTA_ERR_OSC_FAILED);
     }
 
@@ -166,6 +159,14 @@ void *qcloud_osc_init(const char *productId, const char *deviceName, void *chann
         goto do_exit;
     }
 
+    /* inform OTA to topic: "$ota/report/$(product_id)/$(device_name)" */
+    char topic_report[OTA_MAX_TOPIC_LEN];
+    ret = _otamqtt_gen_topic_name(topic_report, OTA_MAX_TOPIC_LEN, "report", productId, deviceName);
+    if (ret < 0 || IOT_MQTT_Topic_Init(&h_osc->topic_report, topic_report) != QCLOUD_RET_SUCCESS) {
+        Log_e("generate topic name of report failed");
+        goto do_exit;
+    }
+
     SubscribeParams sub_params      = DEFAULT_SUB_PARAMS;
     sub_params.on_message_handler   = _otamqtt_upgrage_cb;
     sub_params.on_sub_event_handler = _otamqtt_event_callback;
@@ -222,19 +223,19 @@ int qcloud_osc_deinit(void *handle)
 /* report progress of OTA */
 int qcloud_osc_report_progress(void *handle, const char *msg)
 {
-    return _otamqtt_publish(handle, "report", QOS0, msg);
+    return _otamqtt_publish(handle, QOS0, msg);
 }
 
 /* report version of OTA firmware */
 int qcloud_osc_report_version(void *handle, const char *msg)
 {
-    return _otamqtt_publish(handle, "report", QOS1, msg);
+    return _otamqtt_publish(handle, QOS1, msg);
 }
 
 /* report upgrade begin of OTA firmware */
 int qcloud_osc_report_upgrade_result(void *handle, const char *msg)
 {
-    return _otamqtt_publish(handle, "report", QOS1, msg);
+    return _otamqtt_publish(handle, QOS1, msg);
 }
 
 #endif
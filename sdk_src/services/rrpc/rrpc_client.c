@@ -26,7 +26,57 @@ extern "C" {
 
 #ifdef RRPC_ENABLED
 
-static char sg_process_id_buffer[MAX_RRPC_PROCESS_ID_LEN + 1] = {0};  // process id buffer
+#include "utils_timer.h"
+
+#ifndef RRPC_WORKER_STACK_SIZE
+#define RRPC_WORKER_STACK_SIZE 4096
+#endif
+
+/* how often an idle worker checks for shutdown */
+#define RRPC_WORKER_IDLE_MS 1000
+
+typedef enum {
+    eRRPC_REQ_FREE = 0,
+    eRRPC_REQ_QUEUED,      // payload copied, waiting for a worker
+    eRRPC_REQ_RUNNING,     // handler is running
+    eRRPC_REQ_WAIT_REPLY,  // handler returned without replying
+} eRRPCReqState;
+
+typedef struct {
+    sRRPCContext  ctx;
+    eRRPCReqState state;
+    Timer         deadline;
+    char *        msg;
+    uint32_t      msg_len;
+} RRPCRequest;
+
+/**
+ * Requests live in a fixed table of `concurrency` slots. A slot is held from
+ * arrival until the reply or the deadline, whichever comes first; replies find
+ * their slot by sequence number so a late reply can't hit a reused slot.
+ */
+typedef struct {
+    void *                client;
+    OnRRPCRequestCallback callback;
+    OnRRPCMessageCallback legacy_callback;
+    void *                user_context;
+    uint32_t              deadline_ms;
+    uint16_t              concurrency;
+    uint16_t              worker_num;
+    void *                lock;
+    uint32_t              seq;
+    sRRPCContext          last;  // most recent request, replied by IOT_RRPC_Reply
+    RRPCRequest *         reqs;
+#ifdef MULTITHREAD_ENABLED
+    uint16_t *        queue;  // ring of slot indexes waiting for a worker
+    uint16_t          queue_head;
+    uint16_t          queue_count;
+    void *            sem;
+    volatile bool     stop;
+    volatile uint16_t worker_alive;
+    ThreadParams      thread_params;  // read by the new threads after HAL_ThreadCreate returns
+#endif
+} RRPCDispatcher;
 
 static int _publish_rrpc_to_cloud(void *client, const char *processId, char *pJsonDoc)
 {
@@ -75,23 +125,290 @@ static int _rrpc_get_process_id(char *processIdBuffer, size_t sizeOfBuffer, cons
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
+/* called with d->lock held */
+static RRPCRequest *_rrpc_request_alloc(RRPCDispatcher *d)
+{
+    RRPCRequest *free_req = NULL;
+    int          i;
+
+    for (i = 0; i < d->concurrency; i++) {
+        RRPCRequest *req = &d->reqs[i];
+        if (req->state == eRRPC_REQ_WAIT_REPLY && expired(&req->deadline)) {
+            Log_w("rrpc %s not replied in %ums, dropped", req->ctx.process_id, d->deadline_ms);
+            req->state = eRRPC_REQ_FREE;
+        }
+        if (req->state == eRRPC_REQ_FREE && !free_req) {
+            free_req = req;
+        }
+    }
+
+    if (free_req) {
+        if (++d->seq == 0) {
+            d->seq = 1;
+        }
+        free_req->ctx.seq = d->seq;
+        InitTimer(&free_req->deadline);
+        countdown_ms(&free_req->deadline, d->deadline_ms);
+    }
+
+    return free_req;
+}
+
+/* called with d->lock held, after the handler of request seq returned */
+static void _rrpc_request_done(RRPCDispatcher *d, RRPCRequest *req, uint32_t seq)
+{
+    if (req->ctx.seq != seq || req->state != eRRPC_REQ_RUNNING) {
+        /* replied inside the handler, maybe reused already */
+        return;
+    }
+
+    req->state = expired(&req->deadline) ? eRRPC_REQ_FREE : eRRPC_REQ_WAIT_REPLY;
+}
+
+static void _rrpc_request_run(RRPCDispatcher *d, const sRRPCContext *ctx, const char *msg, uint32_t msg_len)
+{
+    if (d->legacy_callback) {
+        HAL_MutexLock(d->lock);
+        d->last = *ctx;
+        HAL_MutexUnlock(d->lock);
+        d->legacy_callback(d->client, msg, msg_len);
+    } else if (d->callback) {
+        d->callback(d->client, ctx, msg, msg_len, d->user_context);
+    }
+}
+
+#ifdef MULTITHREAD_ENABLED
+static void _rrpc_worker(void *arg)
+{
+    RRPCDispatcher *d = (RRPCDispatcher *)arg;
+
+    while (!d->stop) {
+        HAL_SemaphoreWait(d->sem, RRPC_WORKER_IDLE_MS);
+
+        for (;;) {
+            RRPCRequest *req;
+            sRRPCContext ctx;
+            char *       msg;
+            uint32_t     msg_len;
+
+            HAL_MutexLock(d->lock);
+            if (d->stop || d->queue_count == 0) {
+                HAL_MutexUnlock(d->lock);
+                break;
+            }
+
+            req           = &d->reqs[d->queue[d->queue_head]];
+            d->queue_head = (d->queue_head + 1) % d->concurrency;
+            d->queue_count--;
+            if (d->queue_count) {
+                /* the semaphore may be binary, pass the wakeup on to another worker */
+                HAL_SemaphorePost(d->sem);
+            }
+
+            msg      = req->msg;
+            req->msg = NULL;
+            if (expired(&req->deadline)) {
+                Log_w("rrpc %s expired in queue, dropped", req->ctx.process_id);
+                req->state = eRRPC_REQ_FREE;
+                HAL_MutexUnlock(d->lock);
+                HAL_Free(msg);
+                continue;
+            }
+            req->state = eRRPC_REQ_RUNNING;
+            ctx        = req->ctx;
+            msg_len    = req->msg_len;
+            HAL_MutexUnlock(d->lock);
+
+            _rrpc_request_run(d, &ctx, msg, msg_len);
+            HAL_Free(msg);
+
+            HAL_MutexLock(d->lock);
+            _rrpc_request_done(d, req, ctx.seq);
+            HAL_MutexUnlock(d->lock);
+        }
+    }
+
+    HAL_MutexLock(d->lock);
+    d->worker_alive--;
+    HAL_MutexUnlock(d->lock);
+}
+
+static int _rrpc_worker_start(RRPCDispatcher *d)
+{
+    ThreadParams *thread_params = &d->thread_params;
+    int           i;
+
+    thread_params->thread_func = _rrpc_worker;
+    thread_params->thread_name = "rrpc_worker";
+    thread_params->user_arg    = d;
+    thread_params->stack_size  = RRPC_WORKER_STACK_SIZE;
+    thread_params->priority    = 1;
+
+    for (i = 0; i < d->worker_num; i++) {
+        HAL_MutexLock(d->lock);
+        d->worker_alive++;
+        HAL_MutexUnlock(d->lock);
+
+        if (HAL_ThreadCreate(thread_params)) {
+            Log_e("create rrpc worker %d fail", i);
+            HAL_MutexLock(d->lock);
+            d->worker_alive--;
+            HAL_MutexUnlock(d->lock);
+            return QCLOUD_ERR_FAILURE;
+        }
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+#endif
+
+static void _rrpc_dispatcher_destroy(RRPCDispatcher *d)
+{
+    int i;
+
+#ifdef MULTITHREAD_ENABLED
+    if (d->sem) {
+        Timer timer;
+        InitTimer(&timer);
+        countdown_ms(&timer, d->deadline_ms + RRPC_WORKER_IDLE_MS);
+
+        d->stop = true;
+        for (i = 0; i < d->worker_num; i++) {
+            HAL_SemaphorePost(d->sem);
+        }
+        while (d->worker_alive && !expired(&timer)) {
+            HAL_SleepMs(10);
+        }
+        if (d->worker_alive) {
+            /* a handler is stuck, freeing under it would be worse than leaking */
+            Log_e("%u rrpc workers still busy, dispatcher leaked", d->worker_alive);
+            return;
+        }
+        HAL_SemaphoreDestroy(d->sem);
+    }
+    if (d->queue) {
+        HAL_Free(d->queue);
+    }
+#endif
+
+    for (i = 0; d->reqs && i < d->concurrency; i++) {
+        if (d->reqs[i].msg) {
+            HAL_Free(d->reqs[i].msg);
+        }
+    }
+    if (d->reqs) {
+        HAL_Free(d->reqs);
+    }
+    if (d->lock) {
+        HAL_MutexDestroy(d->lock);
+    }
+    HAL_Free(d);
+}
+
+static RRPCDispatcher *_rrpc_dispatcher_create(void *client, RRPCInitParams *params)
+{
+    RRPCDispatcher *d = (RRPCDispatcher *)HAL_Malloc(sizeof(RRPCDispatcher));
+    if (!d) {
+        Log_e("malloc rrpc dispatcher fail");
+        return NULL;
+    }
+    memset(d, 0, sizeof(RRPCDispatcher));
+
+    d->client      = client;
+    d->concurrency = params->concurrency ? params->concurrency : DEFAULT_RRPC_CONCURRENCY;
+    d->deadline_ms = params->deadline_ms ? params->deadline_ms : DEFAULT_RRPC_DEADLINE_MS;
+#ifdef MULTITHREAD_ENABLED
+    d->worker_num = params->worker_num;
+#else
+    if (params->worker_num) {
+        Log_w("rrpc workers need MULTITHREAD_ENABLED, handled on yield");
+    }
+#endif
+
+    d->lock = HAL_MutexCreate();
+    d->reqs = (RRPCRequest *)HAL_Malloc(d->concurrency * sizeof(RRPCRequest));
+    if (!d->lock || !d->reqs) {
+        goto error;
+    }
+    memset(d->reqs, 0, d->concurrency * sizeof(RRPCRequest));
+
+#ifdef MULTITHREAD_ENABLED
+    if (d->worker_num) {
+        d->queue = (uint16_t *)HAL_Malloc(d->concurrency * sizeof(uint16_t));
+        d->sem   = HAL_SemaphoreCreate();
+        if (!d->queue || !d->sem || _rrpc_worker_start(d) != QCLOUD_RET_SUCCESS) {
+            goto error;
+        }
+    }
+#endif
+
+    return d;
+
+error:
+    Log_e("rrpc dispatcher init fail");
+    _rrpc_dispatcher_destroy(d);
+    return NULL;
+}
+
 static void _rrpc_message_cb(void *pClient, MQTTMessage *message, void *pContext)
 {
-    OnRRPCMessageCallback callback = (OnRRPCMessageCallback)pContext;
+    RRPCDispatcher *d = (RRPCDispatcher *)pContext;
+    RRPCRequest *   req;
+    sRRPCContext    ctx;
 
     Log_d("topic=%.*s", message->topic_len, message->ptopic);
     Log_i("len=%u, topic_msg=%.*s", message->payload_len, message->payload_len,
           STRING_PTR_PRINT_SANITY_CHECK((char *)message->payload));
 
-    int rc = _rrpc_get_process_id(sg_process_id_buffer, MAX_RRPC_PROCESS_ID_LEN, message->ptopic, message->topic_len);
+    memset(&ctx, 0, sizeof(ctx));
+    int rc = _rrpc_get_process_id(ctx.process_id, MAX_RRPC_PROCESS_ID_LEN, message->ptopic, message->topic_len);
     if (rc != QCLOUD_RET_SUCCESS) {
         Log_e("rrpc get process id failed: %d", rc);
         return;
     }
 
-    if (callback) {
-        callback(pClient, message->payload, message->payload_len);
+    HAL_MutexLock(d->lock);
+    req = _rrpc_request_alloc(d);
+    if (!req) {
+        HAL_MutexUnlock(d->lock);
+        Log_w("rrpc %s dropped, %u requests in flight", ctx.process_id, d->concurrency);
+        return;
+    }
+    memcpy(req->ctx.process_id, ctx.process_id, sizeof(ctx.process_id));
+    ctx = req->ctx;
+
+#ifdef MULTITHREAD_ENABLED
+    if (d->worker_num) {
+        /* the payload lives in the MQTT read buffer, which the next packet overwrites */
+        req->msg = (char *)HAL_Malloc(message->payload_len + 1);
+        if (!req->msg) {
+            req->state = eRRPC_REQ_FREE;
+            HAL_MutexUnlock(d->lock);
+            Log_e("rrpc %s dropped, malloc fail", ctx.process_id);
+            return;
+        }
+        memcpy(req->msg, message->payload, message->payload_len);
+        req->msg[message->payload_len] = '\0';
+        req->msg_len                   = message->payload_len;
+        req->state                     = eRRPC_REQ_QUEUED;
+
+        d->queue[(d->queue_head + d->queue_count) % d->concurrency] = (uint16_t)(req - d->reqs);
+        d->queue_count++;
+        HAL_MutexUnlock(d->lock);
+
+        HAL_SemaphorePost(d->sem);
+        return;
     }
+#endif
+
+    req->state = eRRPC_REQ_RUNNING;
+    HAL_MutexUnlock(d->lock);
+
+    _rrpc_request_run(d, &ctx, message->payload, message->payload_len);
+
+    HAL_MutexLock(d->lock);
+    _rrpc_request_done(d, req, ctx.seq);
+    HAL_MutexUnlock(d->lock);
 }
 
 static void _rrpc_event_callback(void *pClient, MQTTEventType event_type, void *user_data)
@@ -116,26 +433,46 @@ static void _rrpc_event_callback(void *pClient, MQTTEventType event_type, void *
             break;
         case MQTT_EVENT_CLIENT_DESTROY:
             Log_i("mqtt client has been destroyed");
-            mqtt_client->rrpc_state = false;
+            mqtt_client->rrpc_state      = false;
+            mqtt_client->rrpc_dispatcher = NULL;
+            _rrpc_dispatcher_destroy((RRPCDispatcher *)user_data);
             break;
         default:
             return;
     }
+
+    qcloud_iot_completion_signal(&mqtt_client->rrpc_sub_done);
 }
 
-int IOT_RRPC_Init(void *pClient, OnRRPCMessageCallback callback)
+static int _rrpc_init(void *pClient, RRPCInitParams *params, OnRRPCMessageCallback legacy_callback)
 {
-    int  rc                                      = QCLOUD_RET_SUCCESS;
-    char rrpc_topic[MAX_SIZE_OF_CLOUD_TOPIC + 1] = {0};
+    int             rc                                      = QCLOUD_RET_SUCCESS;
+    char            rrpc_topic[MAX_SIZE_OF_CLOUD_TOPIC + 1] = {0};
+    RRPCDispatcher *d                                       = NULL;
 
     POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
     Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
 
+    if (!mqtt_client->rrpc_dispatcher) {
+        mqtt_client->rrpc_dispatcher = _rrpc_dispatcher_create(pClient, params);
+        if (!mqtt_client->rrpc_dispatcher) {
+            IOT_FUNC_EXIT_RC(QCLOUD_ERR_MALLOC);
+        }
+    }
+
+    /* a second init only swaps the handler, the pool keeps its size */
+    d = (RRPCDispatcher *)mqtt_client->rrpc_dispatcher;
+    HAL_MutexLock(d->lock);
+    d->callback        = params->callback;
+    d->user_context    = params->user_context;
+    d->legacy_callback = legacy_callback;
+    HAL_MutexUnlock(d->lock);
+
     SubscribeParams sub_params      = DEFAULT_SUB_PARAMS;
     sub_params.on_message_handler   = _rrpc_message_cb;
     sub_params.on_sub_event_handler = _rrpc_event_callback;
     sub_params.qos                  = QOS0;
-    sub_params.user_data            = callback;
+    sub_params.user_data            = d;
 
     HAL_Snprintf(rrpc_topic, MAX_SIZE_OF_CLOUD_TOPIC, "$rrpc/rxd/%s/%s/+",
                  STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.product_id),
@@ -143,17 +480,16 @@ int IOT_RRPC_Init(void *pClient, OnRRPCMessageCallback callback)
 
     if (!mqtt_client->rrpc_state) {
         for (int cntSub = 0; cntSub < 3; cntSub++) {
+            qcloud_iot_completion_reset(&mqtt_client->rrpc_sub_done);
             rc = IOT_MQTT_Subscribe(mqtt_client, rrpc_topic, &sub_params);
             if (rc < 0) {
                 Log_e("rrpc topic subscribe failed: %d, cnt: %d", rc, cntSub);
                 continue;
             }
 
-            /* wait for sub ack */
-            rc = qcloud_iot_mqtt_yield_mt(mqtt_client, 500);
-            if ((rc != QCLOUD_RET_SUCCESS) || mqtt_client->rrpc_state) {
-                break;
-            }
+            /* wait for sub ack, nack or its timeout */
+            qcloud_iot_mqtt_wait_completion(mqtt_client, &mqtt_client->rrpc_sub_done, mqtt_client->command_timeout_ms);
+            break;
         }
     }
 
@@ -164,10 +500,55 @@ int IOT_RRPC_Init(void *pClient, OnRRPCMessageCallback callback)
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
-int IOT_RRPC_Reply(void *pClient, char *pJsonDoc, size_t sizeOfBuffer, sRRPCReplyPara *replyPara)
+int IOT_RRPC_Init(void *pClient, OnRRPCMessageCallback callback)
+{
+    RRPCInitParams params = DEFAULT_RRPC_INIT_PARAMS;
+
+    return _rrpc_init(pClient, &params, callback);
+}
+
+int IOT_RRPC_Init_Dispatcher(void *pClient, RRPCInitParams *params)
+{
+    POINTER_SANITY_CHECK(params, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(params->callback, QCLOUD_ERR_INVAL);
+
+    return _rrpc_init(pClient, params, NULL);
+}
+
+int IOT_RRPC_Reply_Request(void *pClient, const sRRPCContext *ctx, char *pJsonDoc, size_t sizeOfBuffer,
+                           sRRPCReplyPara *replyPara)
 {
-    int rc = QCLOUD_RET_SUCCESS;
-    rc     = _publish_rrpc_to_cloud(pClient, sg_process_id_buffer, pJsonDoc);
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(ctx, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pJsonDoc, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+    RRPCDispatcher *   d           = (RRPCDispatcher *)mqtt_client->rrpc_dispatcher;
+    bool               found       = false;
+    int                rc, i;
+
+    if (!d) {
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_RRPC_REPLY_ERR);
+    }
+
+    /* take the request out of flight first, so it can only be replied once */
+    HAL_MutexLock(d->lock);
+    for (i = 0; ctx->seq && i < d->concurrency; i++) {
+        RRPCRequest *req = &d->reqs[i];
+        if (req->ctx.seq == ctx->seq && req->state != eRRPC_REQ_FREE) {
+            found      = !expired(&req->deadline);
+            req->state = eRRPC_REQ_FREE;
+            break;
+        }
+    }
+    HAL_MutexUnlock(d->lock);
+
+    if (!found) {
+        Log_w("rrpc %s expired or replied already", ctx->process_id);
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_RRPC_REPLY_TIMEOUT);
+    }
+
+    rc = _publish_rrpc_to_cloud(pClient, ctx->process_id, pJsonDoc);
     if (rc < 0) {
         Log_e("publish rrpc to cloud fail, %d", rc);
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_RRPC_REPLY_ERR);
@@ -176,6 +557,25 @@ int IOT_RRPC_Reply(void *pClient, char *pJsonDoc, size_t sizeOfBuffer, sRRPCRepl
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
+int IOT_RRPC_Reply(void *pClient, char *pJsonDoc, size_t sizeOfBuffer, sRRPCReplyPara *replyPara)
+{
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+    RRPCDispatcher *   d           = (RRPCDispatcher *)mqtt_client->rrpc_dispatcher;
+    sRRPCContext       ctx;
+
+    if (!d) {
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_RRPC_REPLY_ERR);
+    }
+
+    HAL_MutexLock(d->lock);
+    ctx = d->last;
+    HAL_MutexUnlock(d->lock);
+
+    return IOT_RRPC_Reply_Request(pClient, &ctx, pJsonDoc, sizeOfBuffer, replyPara);
+}
+
 #endif
 
 #ifdef __cplusplus
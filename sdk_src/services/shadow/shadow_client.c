@@ -23,10 +23,14 @@ extern "C" {
 #include <stdlib.h>
 #include <string.h>
 
+#include "shadow_client_cbor.h"
 #include "shadow_client_common.h"
 #include "shadow_client_json.h"
 #include "utils_param_check.h"
 
+/* pause of a sync request waiting for its timeout while the client is not connected */
+#define SHADOW_SYNC_RETRY_MS 100
+
 static void _init_request_params(RequestParams *pParams, Method method, OnRequestCallback callback, void *userContext,
                                  uint8_t timeout_sec)
 {
@@ -63,18 +67,24 @@ static void _shadow_event_handler(void *pclient, void *context, MQTTEventMsg *ms
     switch (msg->event_type) {
         case MQTT_EVENT_SUBCRIBE_SUCCESS:
             Log_d("shadow subscribe success, packet-id=%u", (unsigned int)packet_id);
-            if (shadow_client->inner_data.sync_status > 0)
+            if (shadow_client->inner_data.sync_status > 0) {
                 shadow_client->inner_data.sync_status = 0;
+                qcloud_iot_completion_signal(&shadow_client->inner_data.sync_done);
+            }
             break;
         case MQTT_EVENT_SUBCRIBE_TIMEOUT:
             Log_d("shadow subscribe wait ack timeout, packet-id=%u", (unsigned int)packet_id);
-            if (shadow_client->inner_data.sync_status > 0)
+            if (shadow_client->inner_data.sync_status > 0) {
                 shadow_client->inner_data.sync_status = -1;
+                qcloud_iot_completion_signal(&shadow_client->inner_data.sync_done);
+            }
             break;
         case MQTT_EVENT_SUBCRIBE_NACK:
             Log_d("shadow subscribe nack, packet-id=%u", (unsigned int)packet_id);
-            if (shadow_client->inner_data.sync_status > 0)
+            if (shadow_client->inner_data.sync_status > 0) {
                 shadow_client->inner_data.sync_status = -1;
+                qcloud_iot_completion_signal(&shadow_client->inner_data.sync_done);
+            }
             break;
         case MQTT_EVENT_PUBLISH_RECVEIVED:
             Log_d("shadow topic message arrived but without any related handle: topic=%.*s, topic_msg=%.*s",
@@ -106,6 +116,8 @@ static void _copy_shadow_init_params_to_mqtt(MQTTInitParams *pMqttInitParams, Sh
     pMqttInitParams->keep_alive_interval_ms = shadowInitParams->keep_alive_interval_ms;
     pMqttInitParams->clean_session          = shadowInitParams->clean_session;
     pMqttInitParams->auto_connect_enable    = shadowInitParams->auto_connect_enable;
+    pMqttInitParams->mqtt_version           = shadowInitParams->mqtt_version;
+    pMqttInitParams->host                   = shadowInitParams->host;
 }
 
 static void _update_ack_cb(void *pClient, Method method, RequestAck requestAck, const char *pReceivedJsonDocument,
@@ -120,6 +132,48 @@ static void _update_ack_cb(void *pClient, Method method, RequestAck requestAck,
     }
 
     *((RequestAck *)pUserdata) = requestAck;
+    qcloud_iot_completion_signal(&((Qcloud_IoT_Shadow *)pClient)->inner_data.sync_done);
+}
+
+/**
+ * @brief wait for the ack of a sync request. The ack lives on the stack of the caller, so this only returns
+ * after the request has left the list, either acked or reported as timeout.
+ *
+ * @param pShadow    shadow client
+ * @param pAck       ack written by _update_ack_cb
+ * @param timeout_ms timeout of the request (unit: ms)
+ */
+static void _wait_sync_ack(Qcloud_IoT_Shadow *pShadow, RequestAck *pAck, uint32_t timeout_ms)
+{
+    Timer timer;
+    int   rc;
+
+    InitTimer(&timer);
+    countdown_ms(&timer, timeout_ms);
+
+    while (1) {
+        /* reset before the check, a signal after it is kept for the wait below */
+        qcloud_iot_completion_reset(&pShadow->inner_data.sync_done);
+        if (ACK_NONE != *pAck || expired(&timer)) {
+            break;
+        }
+
+        rc = qcloud_iot_mqtt_wait_completion(pShadow->mqtt, &pShadow->inner_data.sync_done, left_ms(&timer));
+        if (QCLOUD_RET_SUCCESS != rc && QCLOUD_ERR_MQTT_REQUEST_TIMEOUT != rc) {
+            /* not connected, wait for the request to expire without spinning */
+            HAL_SleepMs(Max(Min(left_ms(&timer), SHADOW_SYNC_RETRY_MS), 0));
+        }
+    }
+
+    /* the request is due by now, report ACK_TIMEOUT unless the reply won the race */
+    if (ACK_NONE == *pAck) {
+        handle_expired_request(pShadow);
+    }
+
+    /* dropped without callback, eg. result code parse failed */
+    if (ACK_NONE == *pAck) {
+        *pAck = ACK_TIMEOUT;
+    }
 }
 
 void *IOT_Shadow_Construct(ShadowInitParams *pParams)
@@ -150,6 +204,13 @@ void *IOT_Shadow_Construct(ShadowInitParams *pParams)
     shadow_client->event_handle            = pParams->event_handle;
     shadow_client->inner_data.result_topic = NULL;
     shadow_client->inner_data.token_num    = 0;
+#ifdef CBOR_PAYLOAD_ENABLED
+    shadow_client->payload_format = pParams->payload_format;
+#else
+    if (pParams->payload_format != eSHADOW_PAYLOAD_JSON) {
+        Log_w("CBOR payload is not enabled, use JSON");
+    }
+#endif
 
     int rc;
 
@@ -165,7 +226,9 @@ void *IOT_Shadow_Construct(ShadowInitParams *pParams)
     } else {
         shadow_client->inner_data.sync_status = rc;
         while (rc == shadow_client->inner_data.sync_status) {
-            IOT_Shadow_Yield(shadow_client, 100);
+            qcloud_iot_mqtt_wait_completion(mqtt_client, &shadow_client->inner_data.sync_done,
+                                            ((Qcloud_IoT_Client *)mqtt_client)->command_timeout_ms);
+            qcloud_iot_completion_reset(&shadow_client->inner_data.sync_done);
         }
         if (0 == shadow_client->inner_data.sync_status) {
             Log_i("Sync device data successfully");
@@ -235,6 +298,7 @@ int IOT_Shadow_Destroy(void *handle)
     qcloud_iot_shadow_reset(handle);
 
     IOT_MQTT_Destroy(&shadow_client->mqtt);
+    qcloud_iot_completion_deinit(&shadow_client->inner_data.sync_done);
 
     if (NULL != shadow_client->mutex) {
         HAL_MutexDestroy(shadow_client->mutex);
@@ -288,6 +352,21 @@ int IOT_Shadow_Register_Property(void *handle, DeviceProperty *pProperty, OnProp
     IOT_FUNC_EXIT_RC(rc);
 }
 
+int IOT_Shadow_Register_Delta(void *handle, OnShadowDeltaCallback callback, void *userContext)
+{
+    IOT_FUNC_ENTRY;
+    POINTER_SANITY_CHECK(handle, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Shadow *pshadow = (Qcloud_IoT_Shadow *)handle;
+
+    HAL_MutexLock(pshadow->mutex);
+    pshadow->inner_data.delta_callback = callback;
+    pshadow->inner_data.delta_context  = userContext;
+    HAL_MutexUnlock(pshadow->mutex);
+
+    IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
+}
+
 int IOT_Shadow_UnRegister_Property(void *handle, DeviceProperty *pProperty)
 {
     IOT_FUNC_ENTRY;
@@ -357,9 +436,7 @@ int IOT_Shadow_Update_Sync(void *handle, char *pJsonDoc, size_t sizeOfBuffer, ui
     if (rc != QCLOUD_RET_SUCCESS)
         IOT_FUNC_EXIT_RC(rc);
 
-    while (ACK_NONE == ack_update) {
-        IOT_Shadow_Yield(handle, 200);
-    }
+    _wait_sync_ack(shadow, &ack_update, timeout_ms);
 
     if (ACK_ACCEPTED == ack_update) {
         rc = QCLOUD_RET_SUCCESS;
@@ -372,6 +449,39 @@ int IOT_Shadow_Update_Sync(void *handle, char *pJsonDoc, size_t sizeOfBuffer, ui
     IOT_FUNC_EXIT_RC(rc);
 }
 
+#ifdef CBOR_PAYLOAD_ENABLED
+int IOT_Shadow_Update_CBOR(void *handle, const uint8_t *pCborDoc, size_t docLength, OnRequestCallback callback,
+                           void *userContext, uint32_t timeout_ms)
+{
+    IOT_FUNC_ENTRY;
+    int rc;
+
+    POINTER_SANITY_CHECK(handle, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pCborDoc, QCLOUD_ERR_INVAL);
+    NUMBERIC_SANITY_CHECK(timeout_ms, QCLOUD_ERR_INVAL);
+
+    Qcloud_IoT_Shadow *shadow = (Qcloud_IoT_Shadow *)handle;
+
+    if (IOT_MQTT_IsConnected(shadow->mqtt) == false) {
+        Log_e("shadow is disconnected");
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_MQTT_NO_CONN);
+    }
+
+    // subscribe topic $shadow/operation/result if not subscribed yet
+    if (shadow->inner_data.sync_status < 0) {
+        subscribe_operation_result_to_cloud(shadow);
+    }
+
+    Log_d("UPDATE Request CBOR Document: %u bytes", (unsigned)docLength);
+
+    RequestParams request_params = DEFAULT_REQUEST_PARAMS;
+    _init_request_params(&request_params, UPDATE, callback, userContext, timeout_ms / 1000);
+
+    rc = do_shadow_cbor_request(shadow, &request_params, pCborDoc, docLength);
+    IOT_FUNC_EXIT_RC(rc);
+}
+#endif
+
 int IOT_Shadow_Get(void *handle, OnRequestCallback callback, void *userContext, uint32_t timeout_ms)
 {
     IOT_FUNC_ENTRY;
@@ -394,12 +504,25 @@ int IOT_Shadow_Get(void *handle, OnRequestCallback callback, void *userContext,
 
     char               getRequestJsonDoc[MAX_SIZE_OF_JSON_WITH_CLIENT_TOKEN];
     Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)shadow->mqtt;
-    build_empty_json(&(shadow->inner_data.token_num), getRequestJsonDoc, mqtt_client->device_info.product_id);
-    Log_d("GET Request Document: %s", getRequestJsonDoc);
 
     RequestParams request_params = DEFAULT_REQUEST_PARAMS;
     _init_request_params(&request_params, GET, callback, userContext, timeout_ms / 1000);
 
+#ifdef CBOR_PAYLOAD_ENABLED
+    if (shadow->payload_format == eSHADOW_PAYLOAD_CBOR) {
+        rc = build_empty_cbor(&(shadow->inner_data.token_num), (uint8_t *)getRequestJsonDoc, sizeof(getRequestJsonDoc),
+                              OPERATION_GET, mqtt_client->device_info.product_id);
+        if (rc < 0) {
+            IOT_FUNC_EXIT_RC(rc);
+        }
+        rc = do_shadow_cbor_request(shadow, &request_params, (uint8_t *)getRequestJsonDoc, rc);
+        IOT_FUNC_EXIT_RC(rc);
+    }
+#endif
+
+    build_empty_json(&(shadow->inner_data.token_num), getRequestJsonDoc, mqtt_client->device_info.product_id);
+    Log_d("GET Request Document: %s", getRequestJsonDoc);
+
     rc = do_shadow_request(shadow, &request_params, getRequestJsonDoc, MAX_SIZE_OF_JSON_WITH_CLIENT_TOKEN);
     IOT_FUNC_EXIT_RC(rc);
 }
@@ -423,9 +546,7 @@ int IOT_Shadow_Get_Sync(void *handle, uint32_t timeout_ms)
     if (rc != QCLOUD_RET_SUCCESS)
         IOT_FUNC_EXIT_RC(rc);
 
-    while (ACK_NONE == ack_update) {
-        IOT_Shadow_Yield(handle, 200);
-    }
+    _wait_sync_ack(shadow, &ack_update, timeout_ms);
 
     if (ACK_ACCEPTED == ack_update) {
         rc = QCLOUD_RET_SUCCESS;
@@ -581,6 +702,57 @@ int IOT_Shadow_JSON_ConstructReport(void *handle, char *jsonBuffer, size_t sizeO
     return rc;
 }
 
+int IOT_Shadow_JSON_ConstructReportEncoded(void *handle, char *jsonBuffer, size_t sizeOfBuffer,
+                                           OnShadowReportEncode encoder, void *userContext)
+{
+    Qcloud_IoT_Shadow *pshadow = (Qcloud_IoT_Shadow *)handle;
+    POINTER_SANITY_CHECK(pshadow, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(encoder, QCLOUD_ERR_INVAL);
+
+    int rc = IOT_Shadow_JSON_Init(pshadow, jsonBuffer, sizeOfBuffer, false);
+
+    if (rc != QCLOUD_RET_SUCCESS) {
+        Log_e("shadow json init failed: %d", rc);
+        return rc;
+    }
+
+    size_t  len            = strlen(jsonBuffer);
+    int32_t rc_of_snprintf = 0;
+
+    rc_of_snprintf = HAL_Snprintf(jsonBuffer + len, sizeOfBuffer - len, "\"reported\":{");
+    rc             = _check_snprintf_return(rc_of_snprintf, sizeOfBuffer - len);
+    if (rc != QCLOUD_RET_SUCCESS) {
+        return rc;
+    }
+    len += rc_of_snprintf;
+
+    /* members are written in place, no property list to walk */
+    rc_of_snprintf = encoder(jsonBuffer + len, sizeOfBuffer - len, userContext);
+    if (rc_of_snprintf < 0) {
+        Log_e("shadow json encode report failed: %d", rc_of_snprintf);
+        return rc_of_snprintf;
+    }
+    len += rc_of_snprintf;
+
+    /* "}," over the trailing ',' of the last member, if any */
+    if (jsonBuffer[len - 1] == ',') {
+        len--;
+    }
+    if (len + 2 >= sizeOfBuffer) {
+        return QCLOUD_ERR_JSON_BUFFER_TOO_SMALL;
+    }
+    jsonBuffer[len++] = '}';
+    jsonBuffer[len++] = ',';
+    jsonBuffer[len]   = '\0';
+
+    rc = IOT_Shadow_JSON_Finalize(pshadow, jsonBuffer, sizeOfBuffer);
+    if (rc != QCLOUD_RET_SUCCESS) {
+        Log_e("shadow json finalize failed: %d", rc);
+    }
+
+    return rc;
+}
+
 int IOT_Shadow_JSON_ConstructReportArray(void *handle, char *jsonBuffer, size_t sizeOfBuffer, uint8_t count,
                                          DeviceProperty *pDeviceProperties[])
 {
@@ -646,6 +818,55 @@ int IOT_Shadow_JSON_ConstructReportArray(void *handle, char *jsonBuffer, size_t
     return rc;
 }
 
+#ifdef CBOR_PAYLOAD_ENABLED
+int IOT_Shadow_CBOR_ConstructReportArray(void *handle, uint8_t *cborBuffer, size_t sizeOfBuffer, uint8_t count,
+                                         DeviceProperty *pDeviceProperties[])
+{
+    Qcloud_IoT_Shadow *pshadow = (Qcloud_IoT_Shadow *)handle;
+    POINTER_SANITY_CHECK(pshadow, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(cborBuffer, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pDeviceProperties, QCLOUD_ERR_INVAL);
+
+    LITE_cbor_writer   writer;
+    char               client_token[MAX_SIZE_OF_CLIENT_TOKEN];
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pshadow->mqtt;
+    int                rc;
+    int8_t             i;
+
+    /* the map head carries the count, so check the properties first */
+    for (i = 0; i < count; i++) {
+        if (pDeviceProperties[i] == NULL || pDeviceProperties[i]->key == NULL) {
+            return QCLOUD_ERR_INVAL;
+        }
+    }
+
+    LITE_cbor_writer_init(&writer, cborBuffer, sizeOfBuffer);
+    LITE_cbor_begin_map(&writer, 3);
+    LITE_cbor_put_string(&writer, TYPE_FIELD);
+    LITE_cbor_put_string(&writer, OPERATION_UPDATE);
+
+    LITE_cbor_put_string(&writer, "state");
+    LITE_cbor_begin_map(&writer, 1);
+    LITE_cbor_put_string(&writer, "reported");
+    LITE_cbor_begin_map(&writer, count);
+    for (i = 0; i < count; i++) {
+        put_cbor_node(&writer, pDeviceProperties[i]->key, pDeviceProperties[i]->data, pDeviceProperties[i]->type);
+    }
+
+    generate_client_token(client_token, sizeof(client_token), &(pshadow->inner_data.token_num),
+                          mqtt_client->device_info.product_id);
+    LITE_cbor_put_string(&writer, CLIENT_TOKEN_FIELD);
+    LITE_cbor_put_string(&writer, client_token);
+
+    rc = LITE_cbor_writer_finish(&writer);
+    if (rc < 0) {
+        Log_e("shadow cbor add report failed: %d", rc);
+    }
+
+    return rc;
+}
+#endif
+
 int IOT_Shadow_JSON_Construct_OverwriteReport(void *handle, char *jsonBuffer, size_t sizeOfBuffer, uint8_t count, ...)
 {
     Qcloud_IoT_Shadow *pshadow = (Qcloud_IoT_Shadow *)handle;
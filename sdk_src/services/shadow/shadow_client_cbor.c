@@ -0,0 +1,218 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "shadow_client_cbor.h"
+
+#include <string.h>
+
+#include "shadow_client.h"
+#include "shadow_client_json.h"
+
+#ifdef CBOR_PAYLOAD_ENABLED
+
+void put_cbor_node(LITE_cbor_writer *w, const char *pKey, void *pData, JsonDataType type)
+{
+    LITE_cbor_put_string(w, pKey);
+
+    if (pData == NULL) {
+        LITE_cbor_put_null(w);
+        return;
+    }
+
+    switch (type) {
+        case JINT32:
+            LITE_cbor_put_int(w, *(int32_t *)pData);
+            break;
+        case JINT16:
+            LITE_cbor_put_int(w, *(int16_t *)pData);
+            break;
+        case JINT8:
+            LITE_cbor_put_int(w, *(int8_t *)pData);
+            break;
+        case JUINT32:
+            LITE_cbor_put_uint(w, *(uint32_t *)pData);
+            break;
+        case JUINT16:
+            LITE_cbor_put_uint(w, *(uint16_t *)pData);
+            break;
+        case JUINT8:
+            LITE_cbor_put_uint(w, *(uint8_t *)pData);
+            break;
+        case JFLOAT:
+            LITE_cbor_put_float(w, *(float *)pData);
+            break;
+        case JDOUBLE:
+            LITE_cbor_put_double(w, *(double *)pData);
+            break;
+        case JBOOL:
+            LITE_cbor_put_bool(w, *(bool *)pData);
+            break;
+        case JSTRING:
+        case JOBJECT:
+            /* a JOBJECT is JSON text already, it goes as is */
+            LITE_cbor_put_string(w, (char *)pData);
+            break;
+        default:
+            LITE_cbor_put_null(w);
+            break;
+    }
+}
+
+int build_empty_cbor(uint32_t *tokenNumber, uint8_t *buf, size_t size, const char *type, char *product_id)
+{
+    LITE_cbor_writer w;
+    char             client_token[MAX_SIZE_OF_CLIENT_TOKEN];
+
+    generate_client_token(client_token, sizeof(client_token), tokenNumber, product_id);
+
+    LITE_cbor_writer_init(&w, buf, size);
+    LITE_cbor_begin_map(&w, 2);
+    LITE_cbor_put_string(&w, TYPE_FIELD);
+    LITE_cbor_put_string(&w, type);
+    LITE_cbor_put_string(&w, CLIENT_TOKEN_FIELD);
+    LITE_cbor_put_string(&w, client_token);
+
+    return LITE_cbor_writer_finish(&w);
+}
+
+bool parse_cbor_text(const uint8_t *pDoc, size_t len, const char *key, char *buf, size_t size)
+{
+    LITE_cbor_item item;
+
+    if (LITE_cbor_map_find(pDoc, len, key, &item) != QCLOUD_RET_SUCCESS || item.type != LITE_CBOR_TEXT ||
+        item.len >= size) {
+        return false;
+    }
+
+    memcpy(buf, item.ptr, item.len);
+    buf[item.len] = '\0';
+
+    return true;
+}
+
+bool parse_cbor_result_code(const uint8_t *pDoc, size_t len, int16_t *pResultCode)
+{
+    LITE_cbor_item item;
+    int64_t        code;
+
+    if (LITE_cbor_map_find(pDoc, len, RESULT_FIELD, &item) != QCLOUD_RET_SUCCESS ||
+        LITE_cbor_item_to_int64(&item, &code) != QCLOUD_RET_SUCCESS || code < INT16_MIN || code > INT16_MAX) {
+        Log_e("parse shadow result_code failed, errCode: %d", QCLOUD_ERR_JSON_PARSE);
+        return false;
+    }
+
+    *pResultCode = (int16_t)code;
+
+    return true;
+}
+
+static int _cbor_get_int(const LITE_cbor_item *value, int64_t min, int64_t max, int64_t *out)
+{
+    if (LITE_cbor_item_to_int64(value, out) != QCLOUD_RET_SUCCESS || *out < min || *out > max) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+static int _cbor_direct_update_value(const LITE_cbor_item *value, DeviceProperty *pProperty)
+{
+    int     rc = QCLOUD_RET_SUCCESS;
+    int64_t iv = 0;
+    double  dv = 0;
+
+    switch (pProperty->type) {
+        case JBOOL:
+            if (value->type == LITE_CBOR_TRUE || value->type == LITE_CBOR_FALSE) {
+                *(bool *)pProperty->data = (value->type == LITE_CBOR_TRUE);
+            } else if ((rc = _cbor_get_int(value, INT64_MIN, INT64_MAX, &iv)) == QCLOUD_RET_SUCCESS) {
+                *(bool *)pProperty->data = (iv != 0);
+            }
+            break;
+        case JINT32:
+            if ((rc = _cbor_get_int(value, INT32_MIN, INT32_MAX, &iv)) == QCLOUD_RET_SUCCESS) {
+                *(int32_t *)pProperty->data = (int32_t)iv;
+            }
+            break;
+        case JINT16:
+            if ((rc = _cbor_get_int(value, INT16_MIN, INT16_MAX, &iv)) == QCLOUD_RET_SUCCESS) {
+                *(int16_t *)pProperty->data = (int16_t)iv;
+            }
+            break;
+        case JINT8:
+            if ((rc = _cbor_get_int(value, INT8_MIN, INT8_MAX, &iv)) == QCLOUD_RET_SUCCESS) {
+                *(int8_t *)pProperty->data = (int8_t)iv;
+            }
+            break;
+        case JUINT32:
+            if ((rc = _cbor_get_int(value, 0, UINT32_MAX, &iv)) == QCLOUD_RET_SUCCESS) {
+                *(uint32_t *)pProperty->data = (uint32_t)iv;
+            }
+            break;
+        case JUINT16:
+            if ((rc = _cbor_get_int(value, 0, UINT16_MAX, &iv)) == QCLOUD_RET_SUCCESS) {
+                *(uint16_t *)pProperty->data = (uint16_t)iv;
+            }
+            break;
+        case JUINT8:
+            if ((rc = _cbor_get_int(value, 0, UINT8_MAX, &iv)) == QCLOUD_RET_SUCCESS) {
+                *(uint8_t *)pProperty->data = (uint8_t)iv;
+            }
+            break;
+        case JFLOAT:
+            if ((rc = LITE_cbor_item_to_double(value, &dv)) == QCLOUD_RET_SUCCESS) {
+                *(float *)pProperty->data = (float)dv;
+            }
+            break;
+        case JDOUBLE:
+            if ((rc = LITE_cbor_item_to_double(value, &dv)) == QCLOUD_RET_SUCCESS) {
+                *(double *)pProperty->data = dv;
+            }
+            break;
+        case JSTRING:
+        case JOBJECT:
+            /* left to the property callback, as for JSON */
+            break;
+        default:
+            Log_e("pProperty type unknow,%d", pProperty->type);
+            break;
+    }
+
+    return rc;
+}
+
+bool cbor_update_value_if_key_match(const uint8_t *pDelta, size_t len, DeviceProperty *pProperty)
+{
+    LITE_cbor_item value;
+
+    if (LITE_cbor_map_find(pDelta, len, pProperty->key, &value) != QCLOUD_RET_SUCCESS ||
+        value.type == LITE_CBOR_NULL) {
+        return false;
+    }
+
+    _cbor_direct_update_value(&value, pProperty);
+
+    return true;
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
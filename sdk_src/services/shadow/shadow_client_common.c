@@ -20,13 +20,14 @@ extern "C" {
 #include "shadow_client_common.h"
 
 #include "qcloud_iot_import.h"
+#include "utils_mem.h"
 
 static int _add_property_handle_to_list(Qcloud_IoT_Shadow *pShadow, DeviceProperty *pProperty,
                                         OnPropRegCallback callback)
 {
     IOT_FUNC_ENTRY;
 
-    PropertyHandler *property_handle = (PropertyHandler *)HAL_Malloc(sizeof(PropertyHandler));
+    PropertyHandler *property_handle = (PropertyHandler *)utils_mem_alloc(MEM_TAG_SHADOW, sizeof(PropertyHandler));
     if (NULL == property_handle) {
         Log_e("run memory malloc is error!");
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
@@ -35,40 +36,49 @@ static int _add_property_handle_to_list(Qcloud_IoT_Shadow *pShadow, DeviceProper
     property_handle->callback = callback;
     property_handle->property = pProperty;
 
-    ListNode *node = list_node_new(property_handle);
-    if (NULL == node) {
-        Log_e("run list_node_new is error!");
-        HAL_Free(property_handle);
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
-    }
-    list_rpush(pShadow->inner_data.property_handle_list, node);
+    list_push(&pShadow->inner_data.property_handle_list, &property_handle->list);
 
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
+static PropertyHandler *_find_property_handle(Qcloud_IoT_Shadow *pShadow, DeviceProperty *pProperty)
+{
+    PropertyHandler *property_handle;
+
+    list_for_each_entry(property_handle, &pShadow->inner_data.property_handle_list.head, list, PropertyHandler)
+    {
+        if (property_handle->property == pProperty) {
+            return property_handle;
+        }
+    }
+
+    return NULL;
+}
+
 int shadow_common_check_property_existence(Qcloud_IoT_Shadow *pshadow, DeviceProperty *pProperty)
 {
-    ListNode *node;
+    PropertyHandler *property_handle;
 
     HAL_MutexLock(pshadow->mutex);
-    node = list_find(pshadow->inner_data.property_handle_list, pProperty);
+    property_handle = _find_property_handle(pshadow, pProperty);
     HAL_MutexUnlock(pshadow->mutex);
 
-    return (NULL != node);
+    return (NULL != property_handle);
 }
 
 int shadow_common_remove_property(Qcloud_IoT_Shadow *pshadow, DeviceProperty *pProperty)
 {
     int rc = QCLOUD_RET_SUCCESS;
 
-    ListNode *node;
+    PropertyHandler *property_handle;
     HAL_MutexLock(pshadow->mutex);
-    node = list_find(pshadow->inner_data.property_handle_list, pProperty);
-    if (NULL == node) {
+    property_handle = _find_property_handle(pshadow, pProperty);
+    if (NULL == property_handle) {
         rc = QCLOUD_ERR_SHADOW_NOT_PROPERTY_EXIST;
         Log_e("Try to remove a non-existent property.");
     } else {
-        list_remove(pshadow->inner_data.property_handle_list, node);
+        list_unlink(&pshadow->inner_data.property_handle_list, &property_handle->list);
+        utils_mem_free(property_handle);
     }
     HAL_MutexUnlock(pshadow->mutex);
 
@@ -80,121 +80,79 @@ static inline int _check_snprintf_return(int32_t returnCode, size_t maxSizeOfWri
     return QCLOUD_RET_SUCCESS;
 }
 
-int put_json_node(char *jsonBuffer, size_t sizeOfBuffer, const char *pKey, void *pData, JsonDataType type)
+/* number as text, QCLOUD_ERR_FAILURE for non number types */
+static int _format_json_number(char *buf, size_t size, void *pData, JsonDataType type)
 {
-    int     rc;
-    int32_t rc_of_snprintf = 0;
-    size_t  remain_size    = 0;
-
-    if ((remain_size = sizeOfBuffer - strlen(jsonBuffer)) <= 1) {
-        return QCLOUD_ERR_JSON_BUFFER_TOO_SMALL;
-    }
-
-    rc_of_snprintf =
-        HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "\"%s\":", STRING_PTR_PRINT_SANITY_CHECK(pKey));
-    rc = _check_snprintf_return(rc_of_snprintf, remain_size);
-    if (rc != QCLOUD_RET_SUCCESS) {
-        return rc;
-    }
-
-    if ((remain_size = sizeOfBuffer - strlen(jsonBuffer)) <= 1) {
-        return QCLOUD_ERR_JSON_BUFFER_TOO_SMALL;
+    switch (type) {
+        case JINT32:
+            return LITE_int64_to_str(*(int32_t *)pData, buf, size);
+        case JINT16:
+            return LITE_int64_to_str(*(int16_t *)pData, buf, size);
+        case JINT8:
+            return LITE_int64_to_str(*(int8_t *)pData, buf, size);
+        case JUINT32:
+            return LITE_uint64_to_str(*(uint32_t *)pData, buf, size);
+        case JUINT16:
+            return LITE_uint64_to_str(*(uint16_t *)pData, buf, size);
+        case JUINT8:
+            return LITE_uint64_to_str(*(uint8_t *)pData, buf, size);
+        case JDOUBLE:
+            return LITE_double_to_str(*(double *)pData, buf, size);
+        case JFLOAT:
+            return LITE_float_to_str(*(float *)pData, buf, size);
+        default:
+            return QCLOUD_ERR_FAILURE;
     }
-
-    if (pData == NULL) {
-        rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "null,");
-    } else {
-        if (type == JINT32) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIi32 ",", *(int32_t *)(pData));
-        } else if (type == JINT16) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIi16 ",", *(int16_t *)(pData));
-        } else if (type == JINT8) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIi8 ",", *(int8_t *)(pData));
-        } else if (type == JUINT32) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIu32 ",", *(uint32_t *)(pData));
-        } else if (type == JUINT16) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIu16 ",", *(uint16_t *)(pData));
-        } else if (type == JUINT8) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIu8 ",", *(uint8_t *)(pData));
-        } else if (type == JDOUBLE) {
-            rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%f,", *(double *)(pData));
-        } else if (type == JFLOAT) {
-            rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%f,", *(float *)(pData));
-        } else if (type == JBOOL) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%s,", *(bool *)(pData) ? "true" : "false");
-        } else if (type == JSTRING) {
-            rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "\"%s\",", (char *)(pData));
-        } else if (type == JOBJECT) {
-            rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%s,", (char *)(pData));
-        }
-    }
-
-    rc = _check_snprintf_return(rc_of_snprintf, remain_size);
-
-    return rc;
 }
 
-int event_put_json_node(char *jsonBuffer, size_t sizeOfBuffer, const char *pKey, void *pData, JsonDataType type)
+static int _put_json_node(char *jsonBuffer, size_t sizeOfBuffer, const char *pKey, void *pData, JsonDataType type,
+                          bool bool_as_number)
 {
     int     rc;
     int32_t rc_of_snprintf = 0;
+    size_t  len            = strlen(jsonBuffer);
     size_t  remain_size    = 0;
+    char    number[LITE_NUMBER_STR_MAX_LEN];
 
-    if ((remain_size = sizeOfBuffer - strlen(jsonBuffer)) <= 1) {
+    if ((remain_size = sizeOfBuffer - len) <= 1) {
         return QCLOUD_ERR_JSON_BUFFER_TOO_SMALL;
     }
 
-    rc_of_snprintf =
-        HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "\"%s\":", STRING_PTR_PRINT_SANITY_CHECK(pKey));
-    rc = _check_snprintf_return(rc_of_snprintf, remain_size);
+    rc_of_snprintf = HAL_Snprintf(jsonBuffer + len, remain_size, "\"%s\":", STRING_PTR_PRINT_SANITY_CHECK(pKey));
+    rc             = _check_snprintf_return(rc_of_snprintf, remain_size);
     if (rc != QCLOUD_RET_SUCCESS) {
         return rc;
     }
 
-    if ((remain_size = sizeOfBuffer - strlen(jsonBuffer)) <= 1) {
+    len += rc_of_snprintf;
+    if ((remain_size = sizeOfBuffer - len) <= 1) {
         return QCLOUD_ERR_JSON_BUFFER_TOO_SMALL;
     }
 
     if (pData == NULL) {
-        rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "null,");
+        rc_of_snprintf = HAL_Snprintf(jsonBuffer + len, remain_size, "null,");
+    } else if (type == JBOOL) {
+        if (bool_as_number) {
+            rc_of_snprintf = HAL_Snprintf(jsonBuffer + len, remain_size, "%u,", *(bool *)(pData) ? 1 : 0);
+        } else {
+            rc_of_snprintf = HAL_Snprintf(jsonBuffer + len, remain_size, "%s,", *(bool *)(pData) ? "true" : "false");
+        }
+    } else if (type == JSTRING) {
+        rc_of_snprintf = HAL_Snprintf(jsonBuffer + len, remain_size, "\"%s\",", (char *)(pData));
+    } else if (type == JOBJECT) {
+        rc_of_snprintf = HAL_Snprintf(jsonBuffer + len, remain_size, "%s,", (char *)(pData));
     } else {
-        if (type == JINT32) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIi32 ",", *(int32_t *)(pData));
-        } else if (type == JINT16) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIi16 ",", *(int16_t *)(pData));
-        } else if (type == JINT8) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIi8 ",", *(int8_t *)(pData));
-        } else if (type == JUINT32) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIu32 ",", *(uint32_t *)(pData));
-        } else if (type == JUINT16) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIu16 ",", *(uint16_t *)(pData));
-        } else if (type == JUINT8) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%" PRIu8 ",", *(uint8_t *)(pData));
-        } else if (type == JDOUBLE) {
-            rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%f,", *(double *)(pData));
-        } else if (type == JFLOAT) {
-            rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%f,", *(float *)(pData));
-        } else if (type == JBOOL) {
-            rc_of_snprintf =
-                HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%u,", *(bool *)(pData) ? 1 : 0);
-        } else if (type == JSTRING) {
-            rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "\"%s\",", (char *)(pData));
-        } else if (type == JOBJECT) {
-            rc_of_snprintf = HAL_Snprintf(jsonBuffer + strlen(jsonBuffer), remain_size, "%s,", (char *)(pData));
+        /* numbers skip stdio, the bulk of a report */
+        rc_of_snprintf = _format_json_number(number, sizeof(number), pData, type);
+        if (rc_of_snprintf < 0) {
+            return QCLOUD_ERR_JSON;
+        }
+        if (rc_of_snprintf + 1 < remain_size) {
+            memcpy(jsonBuffer + len, number, rc_of_snprintf);
+            jsonBuffer[len + rc_of_snprintf]     = ',';
+            jsonBuffer[len + rc_of_snprintf + 1] = '\0';
         }
+        rc_of_snprintf++;
     }
 
     rc = _check_snprintf_return(rc_of_snprintf, remain_size);
@@ -202,6 +160,16 @@ int event_put_json_node(char *jsonBuffer, size_t sizeOfBuffer, const char *pKey,
     return rc;
 }
 
+int put_json_node(char *jsonBuffer, size_t sizeOfBuffer, const char *pKey, void *pData, JsonDataType type)
+{
+    return _put_json_node(jsonBuffer, sizeOfBuffer, pKey, pData, type, false);
+}
+
+int event_put_json_node(char *jsonBuffer, size_t sizeOfBuffer, const char *pKey, void *pData, JsonDataType type)
+{
+    return _put_json_node(jsonBuffer, sizeOfBuffer, pKey, pData, type, true);
+}
+
 int generate_client_token(char *pStrBuffer, size_t sizeOfBuffer, uint32_t *tokenNumber, char *product_id)
 {
     return HAL_Snprintf(pStrBuffer, sizeOfBuffer, "%s-%u", STRING_PTR_PRINT_SANITY_CHECK(product_id), (*tokenNumber)++);
@@ -227,7 +195,7 @@ bool parse_version_num(char *pJsonDoc, uint32_t *pVersionNumber)
     if (version_num == NULL)
         return false;
 
-    if (sscanf(version_num, "%" SCNu32, pVersionNumber) != 1) {
+    if (LITE_get_uint32(pVersionNumber, version_num) != QCLOUD_RET_SUCCESS) {
         Log_e("parse shadow version failed, errCode: %d", QCLOUD_ERR_JSON_PARSE);
     } else {
         ret = true;
@@ -252,7 +220,7 @@ bool parse_code_return(char *pJsonDoc, int32_t *pCode)
     if (code == NULL)
         return false;
 
-    if (sscanf(code, "%" SCNi32, pCode) != 1) {
+    if (LITE_get_int32(pCode, code) != QCLOUD_RET_SUCCESS) {
         Log_e("parse code failed, errCode: %d", QCLOUD_ERR_JSON_PARSE);
     } else {
         ret = true;
@@ -283,7 +251,7 @@ bool parse_shadow_operation_result_code(char *pJsonDoc, int16_t *pResultCode)
     if (result_code == NULL)
         return false;
 
-    if (sscanf(result_code, "%" SCNi16, pResultCode) != 1) {
+    if (LITE_get_int16(pResultCode, result_code) != QCLOUD_RET_SUCCESS) {
         Log_e("parse shadow result_code failed, errCode: %d", QCLOUD_ERR_JSON_PARSE);
     } else {
         ret = true;
@@ -24,14 +24,18 @@ extern "C" {
 
 #include "qcloud_iot_import.h"
 #include "shadow_client.h"
+#include "shadow_client_cbor.h"
 #include "shadow_client_json.h"
 #include "utils_list.h"
+#include "utils_mem.h"
 #include "utils_param_check.h"
 
 /**
  * @brief type for document request
  */
 typedef struct {
+    list_head_t list;  // link in request_list
+
     char   client_token[MAX_SIZE_OF_CLIENT_TOKEN];  // clientToken
     Method method;                                  // method type
 
@@ -41,30 +45,61 @@ typedef struct {
     OnRequestCallback callback;  // request response callback
 } Request;
 
-typedef void (*TraverseHandle)(Qcloud_IoT_Shadow *pShadow, ListNode **node, List *list, const char *pClientToken,
+typedef void (*TraverseHandle)(Qcloud_IoT_Shadow *pShadow, Request *request, List *list, const char *pClientToken,
                                const char *pType);
 
 static void _on_operation_result_handler(void *pClient, MQTTMessage *message, void *pUserdata);
 
 static void _handle_delta(Qcloud_IoT_Shadow *pShadow, char *delta_str);
 
+#ifdef CBOR_PAYLOAD_ENABLED
+static void _on_cbor_operation_result(Qcloud_IoT_Shadow *pShadow);
+#endif
+
 static int _set_shadow_json_type(char *pJsonDoc, size_t sizeOfBuffer, Method method);
 
-static int _publish_operation_to_cloud(Qcloud_IoT_Shadow *pShadow, Method method, char *pJsonDoc);
+static int _publish_operation_to_cloud(Qcloud_IoT_Shadow *pShadow, Method method, const char *pDoc, size_t docLength);
 
 static int _add_request_to_list(Qcloud_IoT_Shadow *pShadow, const char *pClientToken, RequestParams *pParams);
 
+static void _remove_request_from_list(Qcloud_IoT_Shadow *pShadow, const char *pClientToken);
+
 static int _unsubscribe_operation_result_to_cloud(Qcloud_IoT_Shadow *pShadow);
 
 static void _traverse_list(Qcloud_IoT_Shadow *pShadow, List *list, const char *pClientToken, const char *pType,
                            TraverseHandle traverseHandle);
 
-static void _handle_request_callback(Qcloud_IoT_Shadow *pShadow, ListNode **node, List *list, const char *pClientToken,
+static void _handle_request_callback(Qcloud_IoT_Shadow *pShadow, Request *request, List *list, const char *pClientToken,
                                      const char *pType);
 
-static void _handle_expired_request_callback(Qcloud_IoT_Shadow *pShadow, ListNode **node, List *list,
+static void _handle_expired_request_callback(Qcloud_IoT_Shadow *pShadow, Request *request, List *list,
                                              const char *pClientToken, const char *pType);
 
+/* encode the operation topic once, publishes from several threads then only read it */
+static int _init_operation_topic(Qcloud_IoT_Shadow *pShadow)
+{
+    char topic[MAX_SIZE_OF_CLOUD_TOPIC] = {0};
+    int  size;
+
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pShadow->mqtt;
+    if (eTEMPLATE == pShadow->shadow_type) {
+        size = HAL_Snprintf(topic, MAX_SIZE_OF_CLOUD_TOPIC, "$template/operation/%s/%s",
+                            STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.product_id),
+                            STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.device_name));
+    } else {
+        size = HAL_Snprintf(topic, MAX_SIZE_OF_CLOUD_TOPIC, "$shadow/operation/%s/%s",
+                            STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.product_id),
+                            STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.device_name));
+    }
+
+    if (size < 0 || size > MAX_SIZE_OF_CLOUD_TOPIC - 1) {
+        Log_e("buf size < topic length!");
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    return IOT_MQTT_Topic_Init(&pShadow->inner_data.operation_topic, topic);
+}
+
 int qcloud_iot_shadow_init(Qcloud_IoT_Shadow *pShadow)
 {
     IOT_FUNC_ENTRY;
@@ -75,23 +110,11 @@ int qcloud_iot_shadow_init(Qcloud_IoT_Shadow *pShadow)
     if (pShadow->mutex == NULL)
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
 
-    pShadow->inner_data.property_handle_list = list_new();
-    if (pShadow->inner_data.property_handle_list) {
-        pShadow->inner_data.property_handle_list->free = HAL_Free;
-    } else {
-        Log_e("no memory to allocate property_handle_list");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
-    }
-
-    pShadow->inner_data.request_list = list_new();
-    if (pShadow->inner_data.request_list) {
-        pShadow->inner_data.request_list->free = HAL_Free;
-    } else {
-        Log_e("no memory to allocate request_list");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
-    }
+    list_init(&pShadow->inner_data.property_handle_list);
+    list_init(&pShadow->inner_data.request_list);
+    qcloud_iot_completion_init(&pShadow->inner_data.sync_done);
 
-    IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
+    IOT_FUNC_EXIT_RC(_init_operation_topic(pShadow));
 }
 
 void qcloud_iot_shadow_reset(void *pClient)
@@ -99,14 +122,22 @@ void qcloud_iot_shadow_reset(void *pClient)
     POINTER_SANITY_CHECK_RTN(pClient);
 
     Qcloud_IoT_Shadow *shadow_client = (Qcloud_IoT_Shadow *)pClient;
-    if (shadow_client->inner_data.property_handle_list) {
-        list_destroy(shadow_client->inner_data.property_handle_list);
+    PropertyHandler *  property_handle, *property_next;
+    Request *          request, *request_next;
+
+    list_for_each_entry_safe(property_handle, property_next, &shadow_client->inner_data.property_handle_list.head, list,
+                             PropertyHandler)
+    {
+        list_unlink(&shadow_client->inner_data.property_handle_list, &property_handle->list);
+        utils_mem_free(property_handle);
     }
 
     _unsubscribe_operation_result_to_cloud(shadow_client);
 
-    if (shadow_client->inner_data.request_list) {
-        list_destroy(shadow_client->inner_data.request_list);
+    list_for_each_entry_safe(request, request_next, &shadow_client->inner_data.request_list.head, list, Request)
+    {
+        list_unlink(&shadow_client->inner_data.request_list, &request->list);
+        utils_mem_free(request);
     }
 }
 
@@ -114,7 +145,7 @@ void handle_expired_request(Qcloud_IoT_Shadow *pShadow)
 {
     IOT_FUNC_ENTRY;
 
-    _traverse_list(pShadow, pShadow->inner_data.request_list, NULL, NULL, _handle_expired_request_callback);
+    _traverse_list(pShadow, &pShadow->inner_data.request_list, NULL, NULL, _handle_expired_request_callback);
 
     IOT_FUNC_EXIT;
 }
@@ -142,18 +173,53 @@ int do_shadow_request(Qcloud_IoT_Shadow *pShadow, RequestParams *pParams, char *
     if (rc != QCLOUD_RET_SUCCESS)
         IOT_FUNC_EXIT_RC(rc);
 
+    /* listed before publishing, the yield thread may handle the reply before the publish returns */
+    rc = _add_request_to_list(pShadow, client_token, pParams);
     if (rc == QCLOUD_RET_SUCCESS) {
-        rc = _publish_operation_to_cloud(pShadow, pParams->method, pJsonDoc);
+        rc = _publish_operation_to_cloud(pShadow, pParams->method, pJsonDoc, strlen(pJsonDoc));
+        if (rc < 0) {
+            _remove_request_from_list(pShadow, client_token);
+        } else {
+            rc = QCLOUD_RET_SUCCESS;
+        }
     }
 
-    if (rc >= 0) {
-        rc = _add_request_to_list(pShadow, client_token, pParams);
+    HAL_Free(client_token);
+
+    IOT_FUNC_EXIT_RC(rc);
+}
+
+#ifdef CBOR_PAYLOAD_ENABLED
+int do_shadow_cbor_request(Qcloud_IoT_Shadow *pShadow, RequestParams *pParams, const uint8_t *pCborDoc,
+                           size_t docLength)
+{
+    IOT_FUNC_ENTRY;
+    int rc;
+
+    POINTER_SANITY_CHECK(pShadow, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pCborDoc, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(pParams, QCLOUD_ERR_INVAL);
+
+    char client_token[MAX_SIZE_OF_CLIENT_TOKEN];
+
+    if (!parse_cbor_text(pCborDoc, docLength, CLIENT_TOKEN_FIELD, client_token, sizeof(client_token))) {
+        Log_e("fail to parse client token!");
+        IOT_FUNC_EXIT_RC(QCLOUD_ERR_INVAL);
     }
 
-    HAL_Free(client_token);
+    rc = _add_request_to_list(pShadow, client_token, pParams);
+    if (rc == QCLOUD_RET_SUCCESS) {
+        rc = _publish_operation_to_cloud(pShadow, pParams->method, (const char *)pCborDoc, docLength);
+        if (rc < 0) {
+            _remove_request_from_list(pShadow, client_token);
+        } else {
+            rc = QCLOUD_RET_SUCCESS;
+        }
+    }
 
     IOT_FUNC_EXIT_RC(rc);
 }
+#endif
 
 int subscribe_operation_result_to_cloud(Qcloud_IoT_Shadow *pShadow)
 {
@@ -203,39 +269,21 @@ int subscribe_operation_result_to_cloud(Qcloud_IoT_Shadow *pShadow)
  *
  * @param pClient                   Qcloud_IoT_Client
  * @param method                    method type
- * @param pJsonDoc                  JSON to publish
+ * @param pDoc                      JSON or CBOR to publish
+ * @param docLength                 length of document
  * @return QCLOUD_RET_SUCCESS for success, or err code for failure
  */
-static int _publish_operation_to_cloud(Qcloud_IoT_Shadow *pShadow, Method method, char *pJsonDoc)
+static int _publish_operation_to_cloud(Qcloud_IoT_Shadow *pShadow, Method method, const char *pDoc, size_t docLength)
 {
     IOT_FUNC_ENTRY;
     int rc = QCLOUD_RET_SUCCESS;
 
-    char topic[MAX_SIZE_OF_CLOUD_TOPIC] = {0};
-    int  size;
-
-    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pShadow->mqtt;
-    if (eTEMPLATE == pShadow->shadow_type) {
-        size = HAL_Snprintf(topic, MAX_SIZE_OF_CLOUD_TOPIC, "$template/operation/%s/%s",
-                            STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.product_id),
-                            STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.device_name));
-    } else {
-        size = HAL_Snprintf(topic, MAX_SIZE_OF_CLOUD_TOPIC, "$shadow/operation/%s/%s",
-                            STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.product_id),
-                            STRING_PTR_PRINT_SANITY_CHECK(mqtt_client->device_info.device_name));
-    }
-
-    if (size < 0 || size > MAX_SIZE_OF_CLOUD_TOPIC - 1) {
-        Log_e("buf size < topic length!");
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
-    }
-
     PublishParams pubParams = DEFAULT_PUB_PARAMS;
     pubParams.qos           = QOS0;
-    pubParams.payload_len   = strlen(pJsonDoc);
-    pubParams.payload       = (char *)pJsonDoc;
+    pubParams.payload_len   = docLength;
+    pubParams.payload       = (char *)pDoc;
 
-    rc = IOT_MQTT_Publish(pShadow->mqtt, topic, &pubParams);
+    rc = IOT_MQTT_Publish_Topic(pShadow->mqtt, &pShadow->inner_data.operation_topic, &pubParams);
 
     IOT_FUNC_EXIT_RC(rc);
 }
@@ -270,6 +318,13 @@ static void _on_operation_result_handler(void *pClient, MQTTMessage *message, vo
     int cloud_rcv_len = Min(CLOUD_IOT_JSON_RX_BUF_LEN - 1, message->payload_len);
     memcpy(shadow_client->shadow_recv_buf, message->payload, cloud_rcv_len + 1);
     shadow_client->shadow_recv_buf[cloud_rcv_len] = '\0';  // jsmn_parse relies on a string
+#ifdef CBOR_PAYLOAD_ENABLED
+    shadow_client->shadow_recv_len = cloud_rcv_len;
+    if (LITE_cbor_is_map(shadow_client->shadow_recv_buf, cloud_rcv_len)) {
+        _on_cbor_operation_result(shadow_client);
+        goto End;
+    }
+#endif
     if (!parse_shadow_operation_type(shadow_client->shadow_recv_buf, &type_str)) {
         Log_e("Fail to parse type!");
         goto End;
@@ -296,7 +351,7 @@ static void _on_operation_result_handler(void *pClient, MQTTMessage *message, vo
     }
 
     if (shadow_client != NULL)
-        _traverse_list(shadow_client, shadow_client->inner_data.request_list, client_token, type_str,
+        _traverse_list(shadow_client, &shadow_client->inner_data.request_list, client_token, type_str,
                        _handle_request_callback);
 
 End:
@@ -306,42 +361,90 @@ End:
     IOT_FUNC_EXIT;
 }
 
-static void _handle_delta(Qcloud_IoT_Shadow *pShadow, char *delta_str)
+#ifdef CBOR_PAYLOAD_ENABLED
+static void _handle_cbor_delta(Qcloud_IoT_Shadow *pShadow, const uint8_t *delta, size_t len)
 {
     IOT_FUNC_ENTRY;
-    if (pShadow->inner_data.property_handle_list->len) {
-        ListIterator *   iter;
-        ListNode *       node            = NULL;
-        PropertyHandler *property_handle = NULL;
-
-        if (NULL == (iter = list_iterator_new(pShadow->inner_data.property_handle_list, LIST_TAIL))) {
-            HAL_MutexUnlock(pShadow->mutex);
-            IOT_FUNC_EXIT;
-        }
+    PropertyHandler *property_handle;
 
-        for (;;) {
-            node = list_iterator_next(iter);
-            if (NULL == node) {
-                break;
-            }
+    /* callbacks get the CBOR delta map, not JSON */
+    if (pShadow->inner_data.delta_callback != NULL) {
+        pShadow->inner_data.delta_callback(pShadow, (char *)delta, len, pShadow->inner_data.delta_context);
+    }
 
-            property_handle = (PropertyHandler *)(node->val);
-            if (NULL == property_handle) {
-                Log_e("node's value is invalid!");
-                continue;
+    list_for_each_entry(property_handle, &pShadow->inner_data.property_handle_list.head, list, PropertyHandler)
+    {
+        if (property_handle->property != NULL) {
+            if (cbor_update_value_if_key_match(delta, len, property_handle->property)) {
+                if (property_handle->callback != NULL) {
+                    property_handle->callback(pShadow, (const char *)delta, len, property_handle->property);
+                }
             }
+        }
+    }
+
+    IOT_FUNC_EXIT;
+}
+
+/**
+ * @brief operation result in CBOR, same fields as the JSON one
+ */
+static void _on_cbor_operation_result(Qcloud_IoT_Shadow *pShadow)
+{
+    IOT_FUNC_ENTRY;
+
+    const uint8_t *doc = (const uint8_t *)pShadow->shadow_recv_buf;
+    size_t         len = pShadow->shadow_recv_len;
+    LITE_cbor_item delta;
+    char           type_str[16];
+    char           client_token[MAX_SIZE_OF_CLIENT_TOKEN];
+
+    if (!parse_cbor_text(doc, len, TYPE_FIELD, type_str, sizeof(type_str))) {
+        Log_e("Fail to parse type!");
+        IOT_FUNC_EXIT;
+    }
+    Log_d("type: %s", type_str);
+
+    if (!strcmp(type_str, OPERATION_DELTA)) {
+        HAL_MutexLock(pShadow->mutex);
+        if (LITE_cbor_map_find(doc, len, PAYLOAD_STATE, &delta) == QCLOUD_RET_SUCCESS &&
+            delta.type == LITE_CBOR_MAP) {
+            _handle_cbor_delta(pShadow, delta.ptr, delta.len);
+        }
+        HAL_MutexUnlock(pShadow->mutex);
+        IOT_FUNC_EXIT;
+    }
+
+    // non-delta msg push is triggered by device side, parse client token first
+    if (!parse_cbor_text(doc, len, CLIENT_TOKEN_FIELD, client_token, sizeof(client_token))) {
+        Log_e("Fail to parse client token!");
+        IOT_FUNC_EXIT;
+    }
+
+    _traverse_list(pShadow, &pShadow->inner_data.request_list, client_token, type_str, _handle_request_callback);
+
+    IOT_FUNC_EXIT;
+}
+#endif
+
+static void _handle_delta(Qcloud_IoT_Shadow *pShadow, char *delta_str)
+{
+    IOT_FUNC_ENTRY;
+    PropertyHandler *property_handle;
+
+    if (pShadow->inner_data.delta_callback != NULL) {
+        pShadow->inner_data.delta_callback(pShadow, delta_str, strlen(delta_str), pShadow->inner_data.delta_context);
+    }
 
-            if (property_handle->property != NULL) {
-                if (update_value_if_key_match(delta_str, property_handle->property)) {
-                    if (property_handle->callback != NULL) {
-                        property_handle->callback(pShadow, delta_str, strlen(delta_str), property_handle->property);
-                    }
-                    node = NULL;
+    list_for_each_entry(property_handle, &pShadow->inner_data.property_handle_list.head, list, PropertyHandler)
+    {
+        if (property_handle->property != NULL) {
+            if (update_value_if_key_match(delta_str, property_handle->property)) {
+                if (property_handle->callback != NULL) {
+                    property_handle->callback(pShadow, delta_str, strlen(delta_str), property_handle->property);
                 }
             }
         }
-
-        list_iterator_destroy(iter);
     }
 
     IOT_FUNC_EXIT;
@@ -424,12 +527,12 @@ static int _add_request_to_list(Qcloud_IoT_Shadow *pShadow, const char *pClientT
     IOT_FUNC_ENTRY;
 
     HAL_MutexLock(pShadow->mutex);
-    if (pShadow->inner_data.request_list->len >= MAX_APPENDING_REQUEST_AT_ANY_GIVEN_TIME) {
+    if (pShadow->inner_data.request_list.len >= MAX_APPENDING_REQUEST_AT_ANY_GIVEN_TIME) {
         HAL_MutexUnlock(pShadow->mutex);
         IOT_FUNC_EXIT_RC(QCLOUD_ERR_MAX_APPENDING_REQUEST);
     }
 
-    Request *request = (Request *)HAL_Malloc(sizeof(Request));
+    Request *request = (Request *)utils_mem_alloc(MEM_TAG_SHADOW, sizeof(Request));
     if (NULL == request) {
         HAL_MutexUnlock(pShadow->mutex);
         Log_e("run memory malloc is error!");
@@ -445,21 +548,32 @@ static int _add_request_to_list(Qcloud_IoT_Shadow *pShadow, const char *pClientT
     InitTimer(&(request->timer));
     countdown(&(request->timer), pParams->timeout_sec);
 
-    ListNode *node = list_node_new(request);
-    if (NULL == node) {
-        HAL_MutexUnlock(pShadow->mutex);
-        Log_e("run list_node_new is error!");
-        HAL_Free(request);
-        IOT_FUNC_EXIT_RC(QCLOUD_ERR_FAILURE);
-    }
-
-    list_rpush(pShadow->inner_data.request_list, node);
+    list_push(&pShadow->inner_data.request_list, &request->list);
 
     HAL_MutexUnlock(pShadow->mutex);
 
     IOT_FUNC_EXIT_RC(QCLOUD_RET_SUCCESS);
 }
 
+/**
+ * @brief drop a request whose publish failed, without calling its callback
+ */
+static void _remove_request_from_list(Qcloud_IoT_Shadow *pShadow, const char *pClientToken)
+{
+    Request *request, *next;
+
+    HAL_MutexLock(pShadow->mutex);
+    list_for_each_entry_safe(request, next, &pShadow->inner_data.request_list.head, list, Request)
+    {
+        if (0 == strcmp(request->client_token, pClientToken)) {
+            list_unlink(&pShadow->inner_data.request_list, &request->list);
+            utils_mem_free(request);
+            break;
+        }
+    }
+    HAL_MutexUnlock(pShadow->mutex);
+}
+
 /**
  * @brief iterator list and call traverseHandle for each node
  */
@@ -468,47 +582,62 @@ static void _traverse_list(Qcloud_IoT_Shadow *pShadow, List *list, const char *p
 {
     IOT_FUNC_ENTRY;
 
+    Request *request, *next;
+
     HAL_MutexLock(pShadow->mutex);
+    /* the handle may remove the current request */
+    list_for_each_entry_safe(request, next, &list->head, list, Request)
+    {
+        traverseHandle(pShadow, request, list, pClientToken, pType);
+    }
+    HAL_MutexUnlock(pShadow->mutex);
 
-    if (list->len) {
-        ListIterator *iter;
-        ListNode *    node = NULL;
+    IOT_FUNC_EXIT;
+}
 
-        if (NULL == (iter = list_iterator_new(list, LIST_TAIL))) {
-            HAL_MutexUnlock(pShadow->mutex);
-            IOT_FUNC_EXIT;
-        }
+static bool _parse_result_code(Qcloud_IoT_Shadow *pShadow, int16_t *pResultCode)
+{
+#ifdef CBOR_PAYLOAD_ENABLED
+    if (LITE_cbor_is_map(pShadow->shadow_recv_buf, pShadow->shadow_recv_len)) {
+        return parse_cbor_result_code((const uint8_t *)pShadow->shadow_recv_buf, pShadow->shadow_recv_len,
+                                      pResultCode);
+    }
+#endif
 
-        for (;;) {
-            node = list_iterator_next(iter);
-            if (NULL == node) {
-                break;
-            }
+    return parse_shadow_operation_result_code(pShadow->shadow_recv_buf, pResultCode);
+}
 
-            if (NULL == node->val) {
-                Log_e("node's value is invalid!");
-                continue;
-            }
+/**
+ * @brief delta carried by the reply of get, or of a rejected update
+ */
+static void _handle_reply_delta(Qcloud_IoT_Shadow *pShadow)
+{
+    char *delta_str = NULL;
 
-            traverseHandle(pShadow, &node, list, pClientToken, pType);
-        }
+#ifdef CBOR_PAYLOAD_ENABLED
+    LITE_cbor_item delta;
 
-        list_iterator_destroy(iter);
+    if (LITE_cbor_is_map(pShadow->shadow_recv_buf, pShadow->shadow_recv_len)) {
+        if (LITE_cbor_map_find(pShadow->shadow_recv_buf, pShadow->shadow_recv_len, PAYLOAD_STATE_DELTA, &delta) ==
+                QCLOUD_RET_SUCCESS &&
+            delta.type == LITE_CBOR_MAP) {
+            _handle_cbor_delta(pShadow, delta.ptr, delta.len);
+        }
+        return;
     }
-    HAL_MutexUnlock(pShadow->mutex);
+#endif
 
-    IOT_FUNC_EXIT;
+    if (parse_shadow_operation_get(pShadow->shadow_recv_buf, &delta_str)) {
+        _handle_delta(pShadow, delta_str);
+        HAL_Free(delta_str);
+    }
 }
 
-static void _handle_request_callback(Qcloud_IoT_Shadow *pShadow, ListNode **node, List *list, const char *pClientToken,
+static void _handle_request_callback(Qcloud_IoT_Shadow *pShadow, Request *request, List *list, const char *pClientToken,
                                      const char *pType)
 {
     IOT_FUNC_ENTRY;
 
-    Request *request = (Request *)(*node)->val;
-    if (NULL == request)
-        IOT_FUNC_EXIT;
-
     if (strcmp(request->client_token, pClientToken) == 0) {
         RequestAck status = ACK_NONE;
 
@@ -516,7 +645,7 @@ static void _handle_request_callback(Qcloud_IoT_Shadow *pShadow, ListNode **node
         // result = 0 for success, result != 0 for fail
         int16_t result_code = 0;
 
-        bool parse_success = parse_shadow_operation_result_code(pShadow->shadow_recv_buf, &result_code);
+        bool parse_success = _parse_result_code(pShadow, &result_code);
         if (parse_success) {
             if (result_code == 0) {
                 status = ACK_ACCEPTED;
@@ -526,11 +655,7 @@ static void _handle_request_callback(Qcloud_IoT_Shadow *pShadow, ListNode **node
 
             if ((strcmp(pType, "get") == 0 && status == ACK_ACCEPTED) ||
                 (strcmp(pType, "update") && status == ACK_REJECTED)) {
-                char *delta_str = NULL;
-                if (parse_shadow_operation_get(pShadow->shadow_recv_buf, &delta_str)) {
-                    _handle_delta(pShadow, delta_str);
-                    HAL_Free(delta_str);
-                }
+                _handle_reply_delta(pShadow);
             }
 
             if (request->callback != NULL) {
@@ -540,29 +665,25 @@ static void _handle_request_callback(Qcloud_IoT_Shadow *pShadow, ListNode **node
             Log_e("parse shadow operation result code failed.");
         }
 
-        list_remove(list, *node);
-        *node = NULL;
+        list_unlink(list, &request->list);
+        utils_mem_free(request);
     }
 
     IOT_FUNC_EXIT;
 }
 
-static void _handle_expired_request_callback(Qcloud_IoT_Shadow *pShadow, ListNode **node, List *list,
+static void _handle_expired_request_callback(Qcloud_IoT_Shadow *pShadow, Request *request, List *list,
                                              const char *pClientToken, const char *pType)
 {
     IOT_FUNC_ENTRY;
 
-    Request *request = (Request *)(*node)->val;
-    if (NULL == request)
-        IOT_FUNC_EXIT;
-
     if (expired(&request->timer)) {
         if (request->callback != NULL) {
             request->callback(pShadow, request->method, ACK_TIMEOUT, pShadow->shadow_recv_buf, request->user_context);
         }
 
-        list_remove(list, *node);
-        *node = NULL;
+        list_unlink(list, &request->list);
+        utils_mem_free(request);
     }
 
     IOT_FUNC_EXIT;
@@ -25,8 +25,21 @@ extern "C" {
 
 #include "lite-utils.h"
 #include "mqtt_client.h"
+#include "qcloud_iot_clock.h"
 #include "qcloud_iot_device.h"
 #include "qcloud_iot_export_system.h"
+#include "utils_timer.h"
+
+static uint64_t _parse_ms(const char *str)
+{
+    uint64_t value = 0;
+
+    while (*str >= '0' && *str <= '9') {
+        value = value * 10 + (*str++ - '0');
+    }
+
+    return value;
+}
 
 static void _system_mqtt_message_callback(void *pClient, MQTTMessage *message, void *pUserData)
 {
@@ -34,6 +47,7 @@ static void _system_mqtt_message_callback(void *pClient, MQTTMessage *message, v
 
     POINTER_SANITY_CHECK_RTN(message);
 
+    uint32_t    recv_local_ms = HAL_GetTimeMs();
     static char rcv_buf[MAX_RECV_LEN + 1];
     size_t      len = (message->payload_len > MAX_RECV_LEN) ? MAX_RECV_LEN : (message->payload_len);
 
@@ -50,33 +64,26 @@ static void _system_mqtt_message_callback(void *pClient, MQTTMessage *message, v
     if (value != NULL)
         state->time = atol(value);
 
-    // ntp time 64bit platform parse ntp time
-    if (4 != sizeof(size_t)) {
-        char *ntptime1 = LITE_json_value_of("ntptime1", rcv_buf);
-        if (ntptime1 != NULL) {
-#ifdef _WIN64
-            state->ntptime1 = _atoi64(ntptime1);
-#else
-            state->ntptime1 = atol(ntptime1);
-#endif
-        } else {
-            state->ntptime1 = ((size_t)(state->time) * 1000);
-        }
-        char *ntptime2 = LITE_json_value_of("ntptime2", rcv_buf);
-        if (ntptime2 != NULL) {
-#ifdef _WIN64
-            state->ntptime2 = _atoi64(ntptime2);
-#else
-            state->ntptime2 = atol(ntptime2);
-#endif
-        } else {
-            state->ntptime2 = ((size_t)(state->time) * 1000);
-        }
-        HAL_Free(ntptime1);
-        HAL_Free(ntptime2);
+    // ntp time in ms, fall back to the second resolution time
+    char *ntptime1 = LITE_json_value_of("ntptime1", rcv_buf);
+    if (ntptime1 != NULL) {
+        state->ntptime1 = _parse_ms(ntptime1);
+    } else {
+        state->ntptime1 = ((uint64_t)(state->time) * 1000);
     }
+    char *ntptime2 = LITE_json_value_of("ntptime2", rcv_buf);
+    if (ntptime2 != NULL) {
+        state->ntptime2 = _parse_ms(ntptime2);
+    } else {
+        state->ntptime2 = ((uint64_t)(state->time) * 1000);
+    }
+    HAL_Free(ntptime1);
+    HAL_Free(ntptime2);
+
+    state->recv_local_ms  = recv_local_ms;
     state->result_recv_ok = true;
     HAL_Free(value);
+    qcloud_iot_completion_signal(&state->sync_done);
     return;
 }
 
@@ -112,6 +119,8 @@ static void _system_mqtt_sub_event_handler(void *pclient, MQTTEventType event_ty
         default:
             return;
     }
+
+    qcloud_iot_completion_signal(&state->sync_done);
 }
 
 static int _iot_system_info_get_publish(void *pClient)
@@ -163,31 +172,26 @@ static int _iot_system_info_result_subscribe(void *pClient)
     return IOT_MQTT_Subscribe(pClient, topic_name, &sub_params);
 }
 
-int IOT_Get_SysTime(void *pClient, long *time)
+static int _iot_system_info_result_subscribe_wait(Qcloud_IoT_Client *mqtt_client)
 {
-    int ret    = 0;
-    int cntSub = 0;
-    int cntRev = 0;
-
-    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
-    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
-
+    int           ret       = 0;
+    int           cntSub    = 0;
     SysMQTTState *sys_state = &mqtt_client->sys_state;
+
     // subscribe sys topic: $sys/operation/get/${productid}/${devicename}
     // skip this if the subscription is done and valid
     if (!sys_state->topic_sub_ok) {
         for (cntSub = 0; cntSub < 3; cntSub++) {
+            qcloud_iot_completion_reset(&sys_state->sync_done);
             ret = _iot_system_info_result_subscribe(mqtt_client);
             if (ret < 0) {
                 Log_w("_iot_system_info_result_subscribe failed: %d, cnt: %d", ret, cntSub);
                 continue;
             }
 
-            /* wait for sub ack */
-            ret = qcloud_iot_mqtt_yield_mt((Qcloud_IoT_Client *)pClient, 100);
-            if (ret || sys_state->topic_sub_ok) {
-                break;
-            }
+            /* wait for sub ack, nack or its timeout */
+            qcloud_iot_mqtt_wait_completion(mqtt_client, &sys_state->sync_done, mqtt_client->command_timeout_ms);
+            break;
         }
     }
 
@@ -197,7 +201,23 @@ int IOT_Get_SysTime(void *pClient, long *time)
         return QCLOUD_ERR_FAILURE;
     }
 
+    return QCLOUD_RET_SUCCESS;
+}
+
+/* one request/reply exchange, done as soon as the reply is in */
+static int _iot_system_time_exchange(Qcloud_IoT_Client *mqtt_client, ClockSample *sample)
+{
+    int           ret       = 0;
+    SysMQTTState *sys_state = &mqtt_client->sys_state;
+
+    ret = _iot_system_info_result_subscribe_wait(mqtt_client);
+    if (ret) {
+        return ret;
+    }
+
     sys_state->result_recv_ok = false;
+    qcloud_iot_completion_reset(&sys_state->sync_done);
+    sample->local_send_ms = HAL_GetTimeMs();
     // publish msg to get system timestamp
     ret = _iot_system_info_get_publish(mqtt_client);
     if (ret < 0) {
@@ -205,103 +225,108 @@ int IOT_Get_SysTime(void *pClient, long *time)
         return ret;
     }
 
-    do {
-        ret = qcloud_iot_mqtt_yield_mt((Qcloud_IoT_Client *)pClient, 100);
-        cntRev++;
-    } while (!ret && !sys_state->result_recv_ok && cntRev < 20);
+    qcloud_iot_mqtt_wait_completion(mqtt_client, &sys_state->sync_done, SYS_TIME_WAIT_TIMEOUT_MS);
 
-    if (sys_state->result_recv_ok) {
-        *time = sys_state->time;
-        ret   = QCLOUD_RET_SUCCESS;
-    } else {
+    if (!sys_state->result_recv_ok) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    sample->cloud_recv_ms = sys_state->ntptime1;
+    sample->cloud_send_ms = sys_state->ntptime2;
+    sample->local_recv_ms = sys_state->recv_local_ms;
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int IOT_Get_SysTime(void *pClient, long *time)
+{
+    int         ret = 0;
+    ClockSample sample;
+
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+    POINTER_SANITY_CHECK(time, QCLOUD_ERR_INVAL);
+    Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
+
+    ret = _iot_system_time_exchange(mqtt_client, &sample);
+    if (ret) {
         *time = 0;
-        ret   = QCLOUD_ERR_FAILURE;
+        return ret;
     }
 
-    return ret;
+    // every exchange is a free sample for the SDK clock
+    qcloud_iot_clock_update(&sample, 1);
+    *time = mqtt_client->sys_state.time;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
-int IOT_Sync_NTPTime(void *pClient)
+int IOT_Sync_Clock(void *pClient, int samples)
 {
-    int ret    = 0;
-    int cntSub = 0;
-    int cntRev = 0;
+    int         ret = 0;
+    int         num = 0;
+    ClockSample sample_list[MAX_CLOCK_SYNC_SAMPLES];
 
     POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
     Qcloud_IoT_Client *mqtt_client = (Qcloud_IoT_Client *)pClient;
 
-    SysMQTTState *sys_state = &mqtt_client->sys_state;
-    // subscribe sys topic: $sys/operation/get/${productid}/${devicename}
-    // skip this if the subscription is done and valid
-    if (!sys_state->topic_sub_ok) {
-        for (cntSub = 0; cntSub < 3; cntSub++) {
-            ret = _iot_system_info_result_subscribe(mqtt_client);
-            if (ret < 0) {
-                Log_w("_iot_system_info_result_subscribe failed: %d, cnt: %d", ret, cntSub);
-                continue;
-            }
+    if (samples <= 0) {
+        samples = DEFAULT_CLOCK_SYNC_SAMPLES;
+    } else if (samples > MAX_CLOCK_SYNC_SAMPLES) {
+        samples = MAX_CLOCK_SYNC_SAMPLES;
+    }
 
-            /* wait for sub ack */
-            ret = qcloud_iot_mqtt_yield_mt((Qcloud_IoT_Client *)pClient, 100);
-            if (ret || sys_state->topic_sub_ok) {
-                break;
-            }
+    while (samples--) {
+        ret = _iot_system_time_exchange(mqtt_client, &sample_list[num]);
+        if (ret) {
+            Log_w("time exchange failed: %d", ret);
+            continue;
         }
+        num++;
     }
 
-    // return failure if subscribe failed
-    if (!sys_state->topic_sub_ok) {
-        Log_e("Subscribe sys topic failed!");
+    if (0 == num) {
+        Log_e("clock sync failed, no reply from server");
         return QCLOUD_ERR_FAILURE;
     }
 
-    size_t localtime_before_ms = 0;
-    // 64bit platform
-    if (4 != sizeof(size_t)) {
-        localtime_before_ms = HAL_GetTimeMs();
-    }
-    sys_state->result_recv_ok = false;
-    // publish msg to get system timestamp
-    ret = _iot_system_info_get_publish(mqtt_client);
-    if (ret < 0) {
-        Log_e("client publish sys topic failed :%d.", ret);
+    return qcloud_iot_clock_update(sample_list, num);
+}
+
+int IOT_Sync_NTPTime(void *pClient)
+{
+    int ret = 0;
+
+    POINTER_SANITY_CHECK(pClient, QCLOUD_ERR_INVAL);
+
+    ret = IOT_Sync_Clock(pClient, 0);
+    if (ret) {
         return ret;
     }
 
-    do {
-        ret = qcloud_iot_mqtt_yield_mt((Qcloud_IoT_Client *)pClient, 100);
-        cntRev++;
-    } while (!ret && !sys_state->result_recv_ok && cntRev < 20);
-
-    if (sys_state->result_recv_ok) {
-        // 32bit platform
-        if (4 == sizeof(size_t)) {
-            ret = HAL_Timer_set_systime_sec(sys_state->time);
-            if (0 != ret) {
-                Log_e("set systime sec failed, timestamp %ld sec,  please check permission or other ret:%d",
-                      sys_state->time, ret);
-            } else {
-                Log_i("set systime sec success, timestamp %ld sec", sys_state->time);
-            }
+    // 32bit platform
+    if (4 == sizeof(size_t)) {
+        long time_sec = qcloud_iot_clock_now_sec();
+        ret           = HAL_Timer_set_systime_sec(time_sec);
+        if (0 != ret) {
+            Log_e("set systime sec failed, timestamp %ld sec,  please check permission or other ret:%d", time_sec,
+                  ret);
         } else {
-            // 64bit platform
-            size_t localtime_after_ms = HAL_GetTimeMs();
-            size_t local_ntptime =
-                ((sys_state->ntptime2 + sys_state->ntptime1 + localtime_after_ms - localtime_before_ms) / 2);
-            ret = HAL_Timer_set_systime_ms(local_ntptime);
-            if (0 != ret) {
-                Log_e("set systime ms failed, timestamp %lld, please check permission or other ret :%d", local_ntptime,
-                      ret);
-            } else {
-                Log_i("set systime ms success, timestamp %lld ms", local_ntptime);
-            }
+            Log_i("set systime sec success, timestamp %ld sec", time_sec);
         }
-        ret = QCLOUD_RET_SUCCESS;
     } else {
-        ret = QCLOUD_ERR_FAILURE;
+        // 64bit platform
+        size_t local_ntptime = (size_t)qcloud_iot_clock_now_ms();
+        ret                  = HAL_Timer_set_systime_ms(local_ntptime);
+        if (0 != ret) {
+            Log_e("set systime ms failed, timestamp %lld, please check permission or other ret :%d",
+                  (long long)local_ntptime, ret);
+        } else {
+            Log_i("set systime ms success, timestamp %lld ms", (long long)local_ntptime);
+        }
     }
 
-    return ret;
+    // the SDK clock is synced anyway, a failure to set the OS clock is only logged, see the API doc
+    return QCLOUD_RET_SUCCESS;
 }
 
 #ifdef __cplusplus
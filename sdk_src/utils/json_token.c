@@ -17,14 +17,6 @@
 #include "lite-utils.h"
 #include "qcloud_iot_export_error.h"
 
-#ifndef SCNi8
-#define SCNi8 "hhi"
-#endif
-
-#ifndef SCNu8
-#define SCNu8 "hhu"
-#endif
-
 char *LITE_json_value_of(char *key, char *src)
 {
     char *value     = NULL;
@@ -156,44 +148,113 @@ char *LITE_json_string_value_strip_transfer(char *key, char *src)
     return str;
 }
 
+typedef struct {
+    LITE_json_member_cb cb;
+    void *              ctx;
+} JsonMemberIter;
+
+static int _json_member_cb(char *p_cName, int iNameLen, char *p_cValue, int iValueLen, int iValueType, void *p_CBData)
+{
+    JsonMemberIter *iter = (JsonMemberIter *)p_CBData;
+
+    return iter->cb(p_cName, iNameLen, p_cValue, iValueLen, iter->ctx) ? JSON_PARSE_FINISH : JSON_PARSE_OK;
+}
+
+int LITE_json_for_each_member(char *src, int src_len, LITE_json_member_cb cb, void *ctx)
+{
+    JsonMemberIter iter = {cb, ctx};
+
+    return (JSON_RESULT_OK == json_parse_name_value(src, src_len, _json_member_cb, &iter)) ? QCLOUD_RET_SUCCESS
+                                                                                          : QCLOUD_ERR_FAILURE;
+}
+
 int LITE_get_int32(int32_t *value, char *src)
 {
-    return (sscanf(src, "%" SCNi32, value) == 1) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+    int64_t v;
+
+    if (QCLOUD_RET_SUCCESS != LITE_str_to_int64(src, INT32_MIN, INT32_MAX, &v)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+    *value = (int32_t)v;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
 int LITE_get_int16(int16_t *value, char *src)
 {
-    return (sscanf(src, "%" SCNi16, value) == 1) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+    int64_t v;
+
+    if (QCLOUD_RET_SUCCESS != LITE_str_to_int64(src, INT16_MIN, INT16_MAX, &v)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+    *value = (int16_t)v;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
 int LITE_get_int8(int8_t *value, char *src)
 {
-    return (sscanf(src, "%" SCNi8, value) == 1) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+    int64_t v;
+
+    if (QCLOUD_RET_SUCCESS != LITE_str_to_int64(src, INT8_MIN, INT8_MAX, &v)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+    *value = (int8_t)v;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
 int LITE_get_uint32(uint32_t *value, char *src)
 {
-    return (sscanf(src, "%" SCNu32, value) == 1) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+    uint64_t v;
+
+    if (QCLOUD_RET_SUCCESS != LITE_str_to_uint64(src, UINT32_MAX, &v)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+    *value = (uint32_t)v;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
 int LITE_get_uint16(uint16_t *value, char *src)
 {
-    return (sscanf(src, "%" SCNu16, value) == 1) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+    uint64_t v;
+
+    if (QCLOUD_RET_SUCCESS != LITE_str_to_uint64(src, UINT16_MAX, &v)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+    *value = (uint16_t)v;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
 int LITE_get_uint8(uint8_t *value, char *src)
 {
-    return (sscanf(src, "%" SCNu8, value) == 1) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+    uint64_t v;
+
+    if (QCLOUD_RET_SUCCESS != LITE_str_to_uint64(src, UINT8_MAX, &v)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+    *value = (uint8_t)v;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
 int LITE_get_float(float *value, char *src)
 {
-    return (sscanf(src, "%f", value) == 1) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+    double v;
+
+    if (QCLOUD_RET_SUCCESS != LITE_str_to_double(src, &v)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+    *value = (float)v;
+
+    return QCLOUD_RET_SUCCESS;
 }
 
 int LITE_get_double(double *value, char *src)
 {
-    return (sscanf(src, "%lf", value) == 1) ? QCLOUD_RET_SUCCESS : QCLOUD_ERR_FAILURE;
+    return LITE_str_to_double(src, value);
 }
 
 int LITE_get_boolean(bool *value, char *src)
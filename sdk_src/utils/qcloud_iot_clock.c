@@ -0,0 +1,196 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "qcloud_iot_clock.h"
+
+#include <string.h>
+
+#include "qcloud_iot_export.h"
+#include "qcloud_iot_import.h"
+#include "utils_param_check.h"
+
+/*
+ * cloud time = base_cloud_ms + elapsed + elapsed * drift_ppb / 10^9
+ * with elapsed = HAL_GetTimeMs() - base_local_ms, so reading the clock costs one
+ * HAL_GetTimeMs() and no network access. The anchor is moved forward before
+ * elapsed can wrap around the 32 bit counter.
+ */
+typedef struct {
+    void *   lock;
+    bool     synced;
+    uint32_t base_local_ms;
+    uint64_t base_cloud_ms;
+    int32_t  drift_ppb;
+    uint32_t rtt_ms;
+    uint32_t sync_local_ms;
+    uint64_t last_ms;  // last value handed out, to keep the clock monotonic
+} QcloudClock;
+
+#define CLOCK_REBASE_ELAPSED_MS (0x80000000u)
+
+static QcloudClock sg_clock      = {0};
+static int         sg_clock_once = 0;
+
+static void _clock_init(void)
+{
+    sg_clock.lock = HAL_MutexCreate();
+}
+
+static uint64_t _clock_at(uint32_t elapsed)
+{
+    return sg_clock.base_cloud_ms + elapsed + (int64_t)elapsed * sg_clock.drift_ppb / 1000000000;
+}
+
+static uint32_t _sample_rtt(const ClockSample *sample)
+{
+    int64_t rtt = (int64_t)(uint32_t)(sample->local_recv_ms - sample->local_send_ms) -
+                  (int64_t)(sample->cloud_send_ms - sample->cloud_recv_ms);
+
+    /* the cloud may only report seconds, its processing time is then unknown */
+    return rtt < 0 ? 0 : (uint32_t)rtt;
+}
+
+int qcloud_iot_clock_update(const ClockSample *samples, int num)
+{
+    POINTER_SANITY_CHECK(samples, QCLOUD_ERR_INVAL);
+    NUMBERIC_SANITY_CHECK(num, QCLOUD_ERR_INVAL);
+
+    int      i;
+    int      best     = 0;
+    uint32_t best_rtt = _sample_rtt(&samples[0]);
+    for (i = 1; i < num; i++) {
+        uint32_t rtt = _sample_rtt(&samples[i]);
+        if (rtt < best_rtt) {
+            best     = i;
+            best_rtt = rtt;
+        }
+    }
+
+    /* cloud time at reception: the request and the reply are assumed to take the same time */
+    const ClockSample *s          = &samples[best];
+    uint32_t           local_ms   = s->local_recv_ms;
+    uint64_t           cloud_ms   = (s->cloud_recv_ms + s->cloud_send_ms + (uint32_t)(local_ms - s->local_send_ms)) / 2;
+    int64_t            err_ms     = 0;
+    uint32_t           elapsed_ms = 0;
+
+    HAL_Once(&sg_clock_once, _clock_init);
+    if (NULL == sg_clock.lock) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    HAL_MutexLock(sg_clock.lock);
+    if (sg_clock.synced) {
+        elapsed_ms = local_ms - sg_clock.base_local_ms;
+        if (elapsed_ms < CLOCK_REBASE_ELAPSED_MS) {
+            err_ms = (int64_t)(cloud_ms - _clock_at(elapsed_ms));
+        }
+
+        if (elapsed_ms >= QCLOUD_CLOCK_DRIFT_MIN_INTERVAL_MS && elapsed_ms < CLOCK_REBASE_ELAPSED_MS) {
+            int64_t drift_ppb = 0;
+            if (err_ms < elapsed_ms && -err_ms < elapsed_ms) {
+                drift_ppb = sg_clock.drift_ppb + err_ms * 1000000000 / elapsed_ms / 2;
+            }
+            if (drift_ppb > QCLOUD_CLOCK_DRIFT_MAX_PPM * 1000 || drift_ppb < -QCLOUD_CLOCK_DRIFT_MAX_PPM * 1000) {
+                /* not an oscillator error: the cloud clock was stepped, start over */
+                drift_ppb = 0;
+            }
+            sg_clock.drift_ppb = (int32_t)drift_ppb;
+        }
+
+        /* small backward corrections are absorbed by holding the clock until it catches up */
+        if (err_ms <= -QCLOUD_CLOCK_STEP_THRESHOLD_MS) {
+            sg_clock.last_ms = 0;
+        }
+    }
+
+    sg_clock.base_local_ms = local_ms;
+    sg_clock.base_cloud_ms = cloud_ms;
+    sg_clock.rtt_ms        = best_rtt;
+    sg_clock.sync_local_ms = local_ms;
+    sg_clock.synced        = true;
+    HAL_MutexUnlock(sg_clock.lock);
+
+    Log_d("clock synced, rtt %u ms, correction %d ms, drift %d ppb", best_rtt, (int)err_ms, (int)sg_clock.drift_ppb);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+bool qcloud_iot_clock_is_synced(void)
+{
+    return sg_clock.synced;
+}
+
+uint64_t qcloud_iot_clock_now_ms(void)
+{
+    if (!sg_clock.synced) {
+        return (uint64_t)HAL_Timer_current_sec() * 1000;
+    }
+
+    HAL_MutexLock(sg_clock.lock);
+    uint32_t local_ms   = HAL_GetTimeMs();
+    uint32_t elapsed_ms = local_ms - sg_clock.base_local_ms;
+    uint64_t now_ms     = _clock_at(elapsed_ms);
+
+    if (elapsed_ms >= CLOCK_REBASE_ELAPSED_MS) {
+        sg_clock.base_local_ms = local_ms;
+        sg_clock.base_cloud_ms = now_ms;
+    }
+
+    if (now_ms < sg_clock.last_ms) {
+        now_ms = sg_clock.last_ms;
+    } else {
+        sg_clock.last_ms = now_ms;
+    }
+    HAL_MutexUnlock(sg_clock.lock);
+
+    return now_ms;
+}
+
+long qcloud_iot_clock_now_sec(void)
+{
+    return (long)(qcloud_iot_clock_now_ms() / 1000);
+}
+
+uint64_t IOT_Get_Clock_Ms(void)
+{
+    return qcloud_iot_clock_now_ms();
+}
+
+int IOT_Get_Clock_Status(ClockStatus *status)
+{
+    POINTER_SANITY_CHECK(status, QCLOUD_ERR_INVAL);
+
+    memset(status, 0, sizeof(ClockStatus));
+    if (!sg_clock.synced) {
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    HAL_MutexLock(sg_clock.lock);
+    status->synced        = true;
+    status->rtt_ms        = sg_clock.rtt_ms;
+    status->drift_ppb     = sg_clock.drift_ppb;
+    status->since_sync_ms = HAL_GetTimeMs() - sg_clock.sync_local_ms;
+    HAL_MutexUnlock(sg_clock.lock);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
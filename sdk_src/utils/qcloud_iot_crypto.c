@@ -0,0 +1,448 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "qcloud_iot_crypto.h"
+
+#include <string.h>
+
+#include "qcloud_iot_export.h"
+#include "qcloud_iot_import.h"
+#include "utils_aes.h"
+#include "utils_hmac.h"
+#include "utils_md5.h"
+#include "utils_param_check.h"
+#include "utils_sha1.h"
+#include "utils_sha256.h"
+
+/* SHA-NI and AES-NI are reached through function level target attributes, so the rest of the SDK
+ * keeps being built for the baseline ISA and the instructions are only executed when CPUID has them */
+#if defined(CRYPTO_HW_ACCEL) && (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define CRYPTO_ACCEL_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static int      sg_accel_probed = 0;
+static uint32_t sg_accel_cpu    = 0;
+static uint32_t sg_accel_allow  = IOT_CRYPTO_ACCEL_SHA1 | IOT_CRYPTO_ACCEL_AES | IOT_CRYPTO_ACCEL_SHA256;
+
+static uint32_t _crypto_probe_cpu(void)
+{
+    uint32_t mask = 0;
+#ifdef CRYPTO_ACCEL_X86
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+
+    if (ecx & (1u << 25)) {
+        mask |= IOT_CRYPTO_ACCEL_AES;
+    }
+
+    /* the SHA paths also byte swap with SSSE3 and extracts E with SSE4.1 */
+    if ((ecx & (1u << 9)) && (ecx & (1u << 19)) && __get_cpuid_max(0, NULL) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        if (ebx & (1u << 29)) {
+            mask |= IOT_CRYPTO_ACCEL_SHA1 | IOT_CRYPTO_ACCEL_SHA256;
+        }
+    }
+#endif
+    return mask;
+}
+
+uint32_t qcloud_iot_crypto_accel(void)
+{
+    /* probing twice from racing threads gives the same answer, no lock needed */
+    if (!sg_accel_probed) {
+        sg_accel_cpu    = _crypto_probe_cpu();
+        sg_accel_probed = 1;
+    }
+
+    return sg_accel_cpu & sg_accel_allow;
+}
+
+#ifdef CRYPTO_ACCEL_X86
+/* one group of 4 rounds of the Intel SHA extensions schedule, g is the group index 1..19,
+ * mc is the message word of the group and mn/mp/mpp the ones of groups g+1, g-1 and g-2 */
+#define SHA1_NI_QUAD(g, ein, eout, mc, mn, mp, mpp)     \
+    do {                                                \
+        ein  = _mm_sha1nexte_epu32(ein, mc);            \
+        eout = abcd;                                    \
+        if ((g) >= 3 && (g) <= 18) {                    \
+            mn = _mm_sha1msg2_epu32(mn, mc);            \
+        }                                               \
+        abcd = _mm_sha1rnds4_epu32(abcd, ein, (g) / 5); \
+        if ((g) <= 16) {                                \
+            mp = _mm_sha1msg1_epu32(mp, mc);            \
+        }                                               \
+        if ((g) >= 2 && (g) <= 17) {                    \
+            mpp = _mm_xor_si128(mpp, mc);               \
+        }                                               \
+    } while (0)
+
+__attribute__((target("sha,sse4.1"))) void qcloud_iot_crypto_sha1_blocks(uint32_t state[5],
+                                                                           const unsigned char *data, size_t blocks)
+{
+    __m128i abcd, abcd_save, e0, e0_save, e1, m0, m1, m2, m3;
+    __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1B);
+    e0   = _mm_set_epi32((int)state[4], 0, 0, 0);
+    m2   = _mm_setzero_si128();
+    m3   = _mm_setzero_si128();
+
+    while (blocks--) {
+        abcd_save = abcd;
+        e0_save   = e0;
+
+        m0   = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)), mask);
+        e0   = _mm_add_epi32(e0, m0);
+        e1   = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+        SHA1_NI_QUAD(1, e1, e0, m1, m2, m0, m3);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+        SHA1_NI_QUAD(2, e0, e1, m2, m3, m1, m0);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+        SHA1_NI_QUAD(3, e1, e0, m3, m0, m2, m1);
+        SHA1_NI_QUAD(4, e0, e1, m0, m1, m3, m2);
+        SHA1_NI_QUAD(5, e1, e0, m1, m2, m0, m3);
+        SHA1_NI_QUAD(6, e0, e1, m2, m3, m1, m0);
+        SHA1_NI_QUAD(7, e1, e0, m3, m0, m2, m1);
+        SHA1_NI_QUAD(8, e0, e1, m0, m1, m3, m2);
+        SHA1_NI_QUAD(9, e1, e0, m1, m2, m0, m3);
+        SHA1_NI_QUAD(10, e0, e1, m2, m3, m1, m0);
+        SHA1_NI_QUAD(11, e1, e0, m3, m0, m2, m1);
+        SHA1_NI_QUAD(12, e0, e1, m0, m1, m3, m2);
+        SHA1_NI_QUAD(13, e1, e0, m1, m2, m0, m3);
+        SHA1_NI_QUAD(14, e0, e1, m2, m3, m1, m0);
+        SHA1_NI_QUAD(15, e1, e0, m3, m0, m2, m1);
+        SHA1_NI_QUAD(16, e0, e1, m0, m1, m3, m2);
+        SHA1_NI_QUAD(17, e1, e0, m1, m2, m0, m3);
+        SHA1_NI_QUAD(18, e0, e1, m2, m3, m1, m0);
+        SHA1_NI_QUAD(19, e1, e0, m3, m0, m2, m1);
+
+        e0   = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+        data += 64;
+    }
+
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+static const uint32_t sg_sha256_k[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+/* 4 rounds of the Intel SHA extensions schedule, g is the group index 0..15, mc is the message
+ * word of the group and mn/mp the ones of groups g+1 and g-1 */
+#define SHA256_NI_QUAD(g, mc, mn, mp)                                                        \
+    do {                                                                                     \
+        msg    = _mm_add_epi32(mc, _mm_loadu_si128((const __m128i *)&sg_sha256_k[4 * (g)])); \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);                                 \
+        if ((g) >= 3 && (g) <= 14) {                                                         \
+            mn = _mm_add_epi32(mn, _mm_alignr_epi8(mc, mp, 4));                              \
+            mn = _mm_sha256msg2_epu32(mn, mc);                                               \
+        }                                                                                    \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));        \
+        if ((g) >= 1 && (g) <= 12) {                                                         \
+            mp = _mm_sha256msg1_epu32(mp, mc);                                               \
+        }                                                                                    \
+    } while (0)
+
+__attribute__((target("sha,sse4.1"))) void qcloud_iot_crypto_sha256_blocks(uint32_t state[8],
+                                                                             const unsigned char *data, size_t blocks)
+{
+    __m128i state0, state1, abef_save, cdgh_save, msg, tmp, m0, m1, m2, m3;
+    __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    /* the instructions work on ABEF/CDGH halves of the state */
+    tmp    = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1);
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B);
+    state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    m3     = _mm_setzero_si128();
+
+    while (blocks--) {
+        abef_save = state0;
+        cdgh_save = state1;
+
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)), mask);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), mask);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), mask);
+        SHA256_NI_QUAD(0, m0, m1, m3);
+        SHA256_NI_QUAD(1, m1, m2, m0);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), mask);
+        SHA256_NI_QUAD(2, m2, m3, m1);
+        SHA256_NI_QUAD(3, m3, m0, m2);
+        SHA256_NI_QUAD(4, m0, m1, m3);
+        SHA256_NI_QUAD(5, m1, m2, m0);
+        SHA256_NI_QUAD(6, m2, m3, m1);
+        SHA256_NI_QUAD(7, m3, m0, m2);
+        SHA256_NI_QUAD(8, m0, m1, m3);
+        SHA256_NI_QUAD(9, m1, m2, m0);
+        SHA256_NI_QUAD(10, m2, m3, m1);
+        SHA256_NI_QUAD(11, m3, m0, m2);
+        SHA256_NI_QUAD(12, m0, m1, m3);
+        SHA256_NI_QUAD(13, m1, m2, m0);
+        SHA256_NI_QUAD(14, m2, m3, m1);
+        SHA256_NI_QUAD(15, m3, m0, m2);
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+        data += 64;
+    }
+
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+/* utils_aes round keys are little endian words, which is the byte order AES-NI wants, and the
+ * decryption schedule is already the one of the equivalent inverse cipher that aesdec expects */
+__attribute__((target("aes,sse2"))) static void _aes_ni_load_keys(int nr, const uint32_t *rk, __m128i keys[15])
+{
+    int i;
+
+    for (i = 0; i <= nr; i++) {
+        keys[i] = _mm_loadu_si128((const __m128i *)(rk + 4 * i));
+    }
+}
+
+__attribute__((target("aes,sse2"))) static __m128i _aes_ni_block(int nr, const __m128i keys[15], int mode,
+                                                                  __m128i b)
+{
+    int i;
+
+    b = _mm_xor_si128(b, keys[0]);
+    if (mode == UTILS_AES_ENCRYPT) {
+        for (i = 1; i < nr; i++) {
+            b = _mm_aesenc_si128(b, keys[i]);
+        }
+        return _mm_aesenclast_si128(b, keys[nr]);
+    }
+
+    for (i = 1; i < nr; i++) {
+        b = _mm_aesdec_si128(b, keys[i]);
+    }
+    return _mm_aesdeclast_si128(b, keys[nr]);
+}
+
+__attribute__((target("aes,sse2"))) void qcloud_iot_crypto_aes_ecb(int nr, const uint32_t *rk, int mode,
+                                                                    const unsigned char input[16],
+                                                                    unsigned char output[16])
+{
+    __m128i keys[15];
+
+    _aes_ni_load_keys(nr, rk, keys);
+    _mm_storeu_si128((__m128i *)output, _aes_ni_block(nr, keys, mode, _mm_loadu_si128((const __m128i *)input)));
+}
+
+__attribute__((target("aes,sse2"))) void qcloud_iot_crypto_aes_cbc(int nr, const uint32_t *rk, int mode,
+                                                                    size_t length, unsigned char iv[16],
+                                                                    const unsigned char *input, unsigned char *output)
+{
+    __m128i keys[15];
+    __m128i chain = _mm_loadu_si128((const __m128i *)iv);
+    int     i;
+
+    _aes_ni_load_keys(nr, rk, keys);
+
+    if (mode == UTILS_AES_ENCRYPT) {
+        for (; length > 0; length -= 16, input += 16, output += 16) {
+            chain = _mm_xor_si128(chain, _mm_loadu_si128((const __m128i *)input));
+            chain = _aes_ni_block(nr, keys, mode, chain);
+            _mm_storeu_si128((__m128i *)output, chain);
+        }
+        _mm_storeu_si128((__m128i *)iv, chain);
+        return;
+    }
+
+    /* decryption has no dependency between blocks, 4 of them keep the AES unit busy */
+    for (; length >= 64; length -= 64, input += 64, output += 64) {
+        __m128i c0 = _mm_loadu_si128((const __m128i *)(input + 0));
+        __m128i c1 = _mm_loadu_si128((const __m128i *)(input + 16));
+        __m128i c2 = _mm_loadu_si128((const __m128i *)(input + 32));
+        __m128i c3 = _mm_loadu_si128((const __m128i *)(input + 48));
+        __m128i b0 = _mm_xor_si128(c0, keys[0]);
+        __m128i b1 = _mm_xor_si128(c1, keys[0]);
+        __m128i b2 = _mm_xor_si128(c2, keys[0]);
+        __m128i b3 = _mm_xor_si128(c3, keys[0]);
+
+        for (i = 1; i < nr; i++) {
+            b0 = _mm_aesdec_si128(b0, keys[i]);
+            b1 = _mm_aesdec_si128(b1, keys[i]);
+            b2 = _mm_aesdec_si128(b2, keys[i]);
+            b3 = _mm_aesdec_si128(b3, keys[i]);
+        }
+        b0 = _mm_xor_si128(_mm_aesdeclast_si128(b0, keys[nr]), chain);
+        b1 = _mm_xor_si128(_mm_aesdeclast_si128(b1, keys[nr]), c0);
+        b2 = _mm_xor_si128(_mm_aesdeclast_si128(b2, keys[nr]), c1);
+        b3 = _mm_xor_si128(_mm_aesdeclast_si128(b3, keys[nr]), c2);
+        chain = c3;
+
+        /* stores after loads, so in place decryption works */
+        _mm_storeu_si128((__m128i *)(output + 0), b0);
+        _mm_storeu_si128((__m128i *)(output + 16), b1);
+        _mm_storeu_si128((__m128i *)(output + 32), b2);
+        _mm_storeu_si128((__m128i *)(output + 48), b3);
+    }
+
+    for (; length > 0; length -= 16, input += 16, output += 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)input);
+
+        _mm_storeu_si128((__m128i *)output, _mm_xor_si128(_aes_ni_block(nr, keys, mode, c), chain));
+        chain = c;
+    }
+    _mm_storeu_si128((__m128i *)iv, chain);
+}
+#else
+/* never dispatched to, qcloud_iot_crypto_accel() is 0 without instructions to run on */
+void qcloud_iot_crypto_sha1_blocks(uint32_t state[5], const unsigned char *data, size_t blocks)
+{
+}
+
+void qcloud_iot_crypto_sha256_blocks(uint32_t state[8], const unsigned char *data, size_t blocks)
+{
+}
+
+void qcloud_iot_crypto_aes_ecb(int nr, const uint32_t *rk, int mode, const unsigned char input[16],
+                               unsigned char output[16])
+{
+}
+
+void qcloud_iot_crypto_aes_cbc(int nr, const uint32_t *rk, int mode, size_t length, unsigned char iv[16],
+                               const unsigned char *input, unsigned char *output)
+{
+}
+#endif
+
+uint32_t IOT_Crypto_Get_Accel(void)
+{
+    return qcloud_iot_crypto_accel();
+}
+
+uint32_t IOT_Crypto_Set_Accel(uint32_t mask)
+{
+    sg_accel_allow = mask;
+
+    return qcloud_iot_crypto_accel();
+}
+
+const char *IOT_Crypto_Algo_Name(IotCryptoAlgo algo)
+{
+    static const char *names[IOT_CRYPTO_ALGO_MAX] = {"MD5",           "SHA1",            "HMAC-SHA1",
+                                                     "AES-128-CBC-ENC", "AES-128-CBC-DEC", "SHA256"};
+
+    return (algo >= 0 && algo < IOT_CRYPTO_ALGO_MAX) ? names[algo] : "UNKNOWN";
+}
+
+int IOT_Crypto_Benchmark(IotCryptoAlgo algo, size_t buf_len, uint32_t duration_ms, uint32_t *kb_per_sec)
+{
+    static const unsigned char key[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                          0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+    utils_aes_context          aes;
+    unsigned char              iv[16];
+    unsigned char              digest[41];
+    unsigned char *            in, *out;
+    uint64_t                   done = 0;
+    uint32_t                   start, elapsed;
+    size_t                     i;
+
+    POINTER_SANITY_CHECK(kb_per_sec, QCLOUD_ERR_INVAL);
+    NUMBERIC_SANITY_CHECK(buf_len, QCLOUD_ERR_INVAL);
+    NUMBERIC_SANITY_CHECK(duration_ms, QCLOUD_ERR_INVAL);
+    if (algo < 0 || algo >= IOT_CRYPTO_ALGO_MAX) {
+        return QCLOUD_ERR_INVAL;
+    }
+    if ((algo == IOT_CRYPTO_AES128_CBC_ENC || algo == IOT_CRYPTO_AES128_CBC_DEC) && (buf_len % 16)) {
+        return QCLOUD_ERR_INVAL;
+    }
+
+    in  = HAL_Malloc(buf_len);
+    out = HAL_Malloc(buf_len);
+    if (in == NULL || out == NULL) {
+        HAL_Free(in);
+        HAL_Free(out);
+        return QCLOUD_ERR_MALLOC;
+    }
+    for (i = 0; i < buf_len; i++) {
+        in[i] = (unsigned char)(i * 31 + 7);
+    }
+
+    utils_aes_init(&aes);
+    if (algo == IOT_CRYPTO_AES128_CBC_DEC) {
+        utils_aes_setkey_dec(&aes, key, AES_KEY_BITS_128);
+    } else {
+        utils_aes_setkey_enc(&aes, key, AES_KEY_BITS_128);
+    }
+    memset(iv, 0, sizeof(iv));
+
+    start = HAL_GetTimeMs();
+    do {
+        switch (algo) {
+            case IOT_CRYPTO_MD5:
+                utils_md5(in, buf_len, digest);
+                break;
+            case IOT_CRYPTO_SHA1:
+                utils_sha1(in, buf_len, digest);
+                break;
+            case IOT_CRYPTO_SHA256:
+                utils_sha256(in, buf_len, digest);
+                break;
+            case IOT_CRYPTO_HMAC_SHA1:
+                utils_hmac_sha1((const char *)in, (int)buf_len, (char *)digest, (const char *)key, sizeof(key));
+                break;
+            case IOT_CRYPTO_AES128_CBC_ENC:
+            case IOT_CRYPTO_AES128_CBC_DEC:
+                utils_aes_crypt_cbc(&aes, algo == IOT_CRYPTO_AES128_CBC_ENC ? UTILS_AES_ENCRYPT : UTILS_AES_DECRYPT,
+                                    buf_len, iv, in, out);
+                break;
+            default:
+                break;
+        }
+        done += buf_len;
+        elapsed = HAL_GetTimeMs() - start;
+    } while (elapsed < duration_ms);
+
+    utils_aes_free(&aes);
+    HAL_Free(in);
+    HAL_Free(out);
+
+    /* bytes per ms is kB per second */
+    *kb_per_sec = (uint32_t)(done / (elapsed ? elapsed : 1));
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -21,6 +21,7 @@ extern "C" {
 #include <stdio.h>
 #include <string.h>
 
+#include "qcloud_iot_crypto.h"
 #include "qcloud_iot_export.h"
 #include "qcloud_iot_import.h"
 
@@ -761,6 +762,13 @@ int utils_aes_crypt_ecb(utils_aes_context *ctx, int mode, const unsigned char in
     AES_VALIDATE_RET(output != NULL);
     AES_VALIDATE_RET(mode == UTILS_AES_ENCRYPT || mode == UTILS_AES_DECRYPT);
 
+#ifdef CRYPTO_HW_ACCEL
+    if (qcloud_iot_crypto_accel() & IOT_CRYPTO_ACCEL_AES) {
+        qcloud_iot_crypto_aes_ecb(ctx->nr, ctx->rk, mode, input, output);
+        return (0);
+    }
+#endif
+
     if (mode == UTILS_AES_ENCRYPT)
         return (utils_internal_aes_encrypt(ctx, input, output));
     else
@@ -786,6 +794,13 @@ int utils_aes_crypt_cbc(utils_aes_context *ctx, int mode, size_t length, unsigne
     if (length % 16)
         return (UTILS_ERR_AES_INVALID_INPUT_LENGTH);
 
+#ifdef CRYPTO_HW_ACCEL
+    if (qcloud_iot_crypto_accel() & IOT_CRYPTO_ACCEL_AES) {
+        qcloud_iot_crypto_aes_cbc(ctx->nr, ctx->rk, mode, length, iv, input, output);
+        return (0);
+    }
+#endif
+
     if (mode == UTILS_AES_DECRYPT) {
         while (length > 0) {
             memcpy(temp, input, 16);
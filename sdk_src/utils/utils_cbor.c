@@ -0,0 +1,625 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <float.h>
+#include <string.h>
+
+#include "lite-cbor.h"
+#include "qcloud_iot_export.h"
+
+#ifdef CBOR_PAYLOAD_ENABLED
+
+/* major types, in the top 3 bits of the initial byte */
+#define CBOR_MAJOR_UINT   (0)
+#define CBOR_MAJOR_NINT   (1)
+#define CBOR_MAJOR_BYTES  (2)
+#define CBOR_MAJOR_TEXT   (3)
+#define CBOR_MAJOR_ARRAY  (4)
+#define CBOR_MAJOR_MAP    (5)
+#define CBOR_MAJOR_TAG    (6)
+#define CBOR_MAJOR_SIMPLE (7)
+
+#define CBOR_INFO_INDEFINITE (31)
+
+#define CBOR_FALSE      (0xf4)
+#define CBOR_TRUE       (0xf5)
+#define CBOR_NULL       (0xf6)
+#define CBOR_HALF       (0xf9)
+#define CBOR_SINGLE     (0xfa)
+#define CBOR_DOUBLE     (0xfb)
+#define CBOR_BREAK      (0xff)
+#define CBOR_HALF_NAN   (0x7e00)
+#define CBOR_HALF_INF   (0x7c00)
+#define CBOR_HALF_SIGN  (0x8000)
+#define CBOR_MAX_HEAD   (9)
+
+static void _cbor_put_raw(LITE_cbor_writer *w, const void *data, size_t len)
+{
+    /* len only grows, so nothing is written once an item did not fit */
+    if (w->len + len <= w->size) {
+        memcpy(w->buf + w->len, data, len);
+    }
+    w->len += len;
+}
+
+static void _cbor_put_be(uint8_t *p, uint64_t value, int n)
+{
+    while (n--) {
+        p[n] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+/* initial byte and argument, in the shortest form */
+static void _cbor_put_head(LITE_cbor_writer *w, uint8_t major, uint64_t arg)
+{
+    uint8_t head[CBOR_MAX_HEAD];
+    int     n;
+
+    major <<= 5;
+    if (arg < 24) {
+        head[0] = major | (uint8_t)arg;
+        n       = 0;
+    } else if (arg <= 0xff) {
+        head[0] = major | 24;
+        n       = 1;
+    } else if (arg <= 0xffff) {
+        head[0] = major | 25;
+        n       = 2;
+    } else if (arg <= 0xffffffff) {
+        head[0] = major | 26;
+        n       = 4;
+    } else {
+        head[0] = major | 27;
+        n       = 8;
+    }
+    _cbor_put_be(head + 1, arg, n);
+    _cbor_put_raw(w, head, n + 1);
+}
+
+static void _cbor_put_byte(LITE_cbor_writer *w, uint8_t byte)
+{
+    _cbor_put_raw(w, &byte, 1);
+}
+
+static void _cbor_put_half(LITE_cbor_writer *w, uint16_t half)
+{
+    uint8_t head[3] = {CBOR_HALF, (uint8_t)(half >> 8), (uint8_t)half};
+
+    _cbor_put_raw(w, head, sizeof(head));
+}
+
+/* half precision bits of the single precision bits, false if that loses anything */
+static bool _cbor_float_to_half(uint32_t bits, uint16_t *half)
+{
+    uint16_t sign = (bits >> 16) & CBOR_HALF_SIGN;
+    int      exp  = (bits >> 23) & 0xff;
+    uint32_t mant = bits & 0x7fffff;
+    int      shift;
+
+    if (exp == 0xff) {
+        *half = mant ? CBOR_HALF_NAN : (sign | CBOR_HALF_INF);
+        return true;
+    }
+    if (exp == 0) {
+        /* single precision subnormals are far below the half range */
+        *half = sign;
+        return mant == 0;
+    }
+
+    exp = exp - 127 + 15;
+    if (exp >= 1 && exp <= 30) {
+        *half = sign | (exp << 10) | (mant >> 13);
+        return (mant & 0x1fff) == 0;
+    }
+    if (exp <= 0 && exp >= -10) {
+        /* half subnormal: mantissa with the hidden bit, scaled to units of 2^-24 */
+        mant |= 0x800000;
+        shift = 14 - exp;
+        *half = sign | (mant >> shift);
+        return (mant & ((1U << shift) - 1)) == 0;
+    }
+
+    return false;
+}
+
+static float _cbor_half_to_float(uint16_t half)
+{
+    uint32_t sign = (uint32_t)(half & CBOR_HALF_SIGN) << 16;
+    uint32_t exp  = (half >> 10) & 0x1f;
+    uint32_t mant = half & 0x3ff;
+    uint32_t bits;
+    float    value;
+
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000 | (mant << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+    } else if (mant == 0) {
+        bits = sign;
+    } else {
+        /* half subnormals are normal in single precision */
+        exp = 127 - 15 + 1;
+        while (!(mant & 0x400)) {
+            mant <<= 1;
+            exp--;
+        }
+        bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+void LITE_cbor_writer_init(LITE_cbor_writer *w, void *buf, size_t size)
+{
+    w->buf  = (uint8_t *)buf;
+    w->size = buf ? size : 0;
+    w->len  = 0;
+}
+
+int LITE_cbor_writer_finish(LITE_cbor_writer *w)
+{
+    return (w->len <= w->size) ? (int)w->len : QCLOUD_ERR_BUF_TOO_SHORT;
+}
+
+void LITE_cbor_put_uint(LITE_cbor_writer *w, uint64_t value)
+{
+    _cbor_put_head(w, CBOR_MAJOR_UINT, value);
+}
+
+void LITE_cbor_put_int(LITE_cbor_writer *w, int64_t value)
+{
+    if (value >= 0) {
+        _cbor_put_head(w, CBOR_MAJOR_UINT, (uint64_t)value);
+    } else {
+        /* -1 - value, without overflow at INT64_MIN */
+        _cbor_put_head(w, CBOR_MAJOR_NINT, ~(uint64_t)value);
+    }
+}
+
+void LITE_cbor_put_float(LITE_cbor_writer *w, float value)
+{
+    uint8_t  head[5] = {CBOR_SINGLE};
+    uint32_t bits;
+    uint16_t half;
+
+    memcpy(&bits, &value, sizeof(bits));
+    if (_cbor_float_to_half(bits, &half)) {
+        _cbor_put_half(w, half);
+        return;
+    }
+
+    _cbor_put_be(head + 1, bits, 4);
+    _cbor_put_raw(w, head, sizeof(head));
+}
+
+void LITE_cbor_put_double(LITE_cbor_writer *w, double value)
+{
+    uint8_t  head[9] = {CBOR_DOUBLE};
+    uint64_t bits;
+    float    single;
+
+    if (value != value) {
+        _cbor_put_half(w, CBOR_HALF_NAN);
+        return;
+    }
+    if (value > DBL_MAX || value < -DBL_MAX) {
+        _cbor_put_half(w, (value < 0 ? CBOR_HALF_SIGN : 0) | CBOR_HALF_INF);
+        return;
+    }
+    if (value >= -FLT_MAX && value <= FLT_MAX) {
+        single = (float)value;
+        if ((double)single == value) {
+            LITE_cbor_put_float(w, single);
+            return;
+        }
+    }
+
+    memcpy(&bits, &value, sizeof(bits));
+    _cbor_put_be(head + 1, bits, 8);
+    _cbor_put_raw(w, head, sizeof(head));
+}
+
+void LITE_cbor_put_bool(LITE_cbor_writer *w, bool value)
+{
+    _cbor_put_byte(w, value ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void LITE_cbor_put_null(LITE_cbor_writer *w)
+{
+    _cbor_put_byte(w, CBOR_NULL);
+}
+
+void LITE_cbor_put_text(LITE_cbor_writer *w, const char *str, size_t len)
+{
+    _cbor_put_head(w, CBOR_MAJOR_TEXT, len);
+    _cbor_put_raw(w, str, len);
+}
+
+void LITE_cbor_put_string(LITE_cbor_writer *w, const char *str)
+{
+    LITE_cbor_put_text(w, str, strlen(str));
+}
+
+void LITE_cbor_put_bytes(LITE_cbor_writer *w, const void *data, size_t len)
+{
+    _cbor_put_head(w, CBOR_MAJOR_BYTES, len);
+    _cbor_put_raw(w, data, len);
+}
+
+static void _cbor_begin(LITE_cbor_writer *w, uint8_t major, size_t count)
+{
+    if (count == LITE_CBOR_INDEFINITE) {
+        _cbor_put_byte(w, (major << 5) | CBOR_INFO_INDEFINITE);
+    } else {
+        _cbor_put_head(w, major, count);
+    }
+}
+
+void LITE_cbor_begin_array(LITE_cbor_writer *w, size_t count)
+{
+    _cbor_begin(w, CBOR_MAJOR_ARRAY, count);
+}
+
+void LITE_cbor_begin_map(LITE_cbor_writer *w, size_t count)
+{
+    _cbor_begin(w, CBOR_MAJOR_MAP, count);
+}
+
+void LITE_cbor_end(LITE_cbor_writer *w)
+{
+    _cbor_put_byte(w, CBOR_BREAK);
+}
+
+void LITE_cbor_reader_init(LITE_cbor_reader *r, const void *buf, size_t len)
+{
+    r->pos = (const uint8_t *)buf;
+    r->end = r->pos + (buf ? len : 0);
+}
+
+static int _cbor_read_arg(LITE_cbor_reader *r, uint8_t info, uint64_t *arg)
+{
+    size_t n;
+
+    if (info < 24) {
+        *arg = info;
+        return QCLOUD_RET_SUCCESS;
+    }
+    if (info > 27) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    n = (size_t)1 << (info - 24);
+    if ((size_t)(r->end - r->pos) < n) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    *arg = 0;
+    while (n--) {
+        *arg = (*arg << 8) | *r->pos++;
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+static int _cbor_read_simple(LITE_cbor_reader *r, uint8_t info, LITE_cbor_item *item)
+{
+    uint64_t arg;
+    uint32_t single;
+    float    value;
+
+    switch (info) {
+        case 20:
+            item->type = LITE_CBOR_FALSE;
+            return QCLOUD_RET_SUCCESS;
+        case 21:
+            item->type = LITE_CBOR_TRUE;
+            return QCLOUD_RET_SUCCESS;
+        case 22:
+            item->type = LITE_CBOR_NULL;
+            return QCLOUD_RET_SUCCESS;
+        case CBOR_INFO_INDEFINITE:
+            item->type = LITE_CBOR_BREAK;
+            return QCLOUD_RET_SUCCESS;
+        default:
+            break;
+    }
+
+    if (_cbor_read_arg(r, info, &arg) != QCLOUD_RET_SUCCESS) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    item->type = LITE_CBOR_FLOAT;
+    if (info == 25) {
+        item->d = _cbor_half_to_float((uint16_t)arg);
+    } else if (info == 26) {
+        single = (uint32_t)arg;
+        memcpy(&value, &single, sizeof(value));
+        item->d = value;
+    } else if (info == 27) {
+        memcpy(&item->d, &arg, sizeof(item->d));
+    } else {
+        /* unassigned simple values */
+        item->type = LITE_CBOR_UNDEFINED;
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int LITE_cbor_read(LITE_cbor_reader *r, LITE_cbor_item *item)
+{
+    uint8_t  major, info;
+    uint64_t arg;
+    size_t   left;
+
+    if (r->pos >= r->end) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    item->ptr = r->pos;
+    item->len = 0;
+    item->u   = 0;
+    major     = *r->pos >> 5;
+    info      = *r->pos & 0x1f;
+    r->pos++;
+
+    if (major == CBOR_MAJOR_SIMPLE) {
+        return _cbor_read_simple(r, info, item);
+    }
+
+    if (info == CBOR_INFO_INDEFINITE && (major == CBOR_MAJOR_ARRAY || major == CBOR_MAJOR_MAP)) {
+        item->type = (major == CBOR_MAJOR_ARRAY) ? LITE_CBOR_ARRAY : LITE_CBOR_MAP;
+        item->u    = LITE_CBOR_INDEFINITE;
+        return QCLOUD_RET_SUCCESS;
+    }
+
+    /* chunked strings are not supported */
+    if (_cbor_read_arg(r, info, &arg) != QCLOUD_RET_SUCCESS) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    left    = r->end - r->pos;
+    item->u = arg;
+    switch (major) {
+        case CBOR_MAJOR_UINT:
+            item->type = LITE_CBOR_UINT;
+            break;
+        case CBOR_MAJOR_NINT:
+            item->type = LITE_CBOR_NINT;
+            break;
+        case CBOR_MAJOR_BYTES:
+        case CBOR_MAJOR_TEXT:
+            if (arg > left) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            item->type = (major == CBOR_MAJOR_BYTES) ? LITE_CBOR_BYTES : LITE_CBOR_TEXT;
+            item->ptr  = r->pos;
+            item->len  = (size_t)arg;
+            r->pos += arg;
+            break;
+        case CBOR_MAJOR_ARRAY:
+        case CBOR_MAJOR_MAP:
+            /* each child takes a byte at least, so larger counts are truncated data */
+            if (arg > left || (major == CBOR_MAJOR_MAP && arg > left / 2)) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            item->type = (major == CBOR_MAJOR_ARRAY) ? LITE_CBOR_ARRAY : LITE_CBOR_MAP;
+            break;
+        default:
+            item->type = LITE_CBOR_TAG;
+            break;
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+static int _cbor_skip(LITE_cbor_reader *r, const LITE_cbor_item *item, int depth)
+{
+    LITE_cbor_item child;
+    uint64_t       count;
+
+    if (item->type != LITE_CBOR_ARRAY && item->type != LITE_CBOR_MAP && item->type != LITE_CBOR_TAG) {
+        return QCLOUD_RET_SUCCESS;
+    }
+    if (depth >= LITE_CBOR_MAX_DEPTH) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    if (item->type == LITE_CBOR_TAG) {
+        count = 1;
+    } else if (item->u == LITE_CBOR_INDEFINITE) {
+        count = UINT64_MAX;
+    } else {
+        count = (item->type == LITE_CBOR_MAP) ? item->u * 2 : item->u;
+    }
+
+    while (count--) {
+        if (LITE_cbor_read(r, &child) != QCLOUD_RET_SUCCESS) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        if (child.type == LITE_CBOR_BREAK) {
+            return (item->u == LITE_CBOR_INDEFINITE && item->type != LITE_CBOR_TAG) ? QCLOUD_RET_SUCCESS
+                                                                                    : QCLOUD_ERR_FAILURE;
+        }
+        if (_cbor_skip(r, &child, depth + 1) != QCLOUD_RET_SUCCESS) {
+            return QCLOUD_ERR_FAILURE;
+        }
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int LITE_cbor_skip(LITE_cbor_reader *r, LITE_cbor_item *item)
+{
+    if (_cbor_skip(r, item, 0) != QCLOUD_RET_SUCCESS) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    if (item->type == LITE_CBOR_ARRAY || item->type == LITE_CBOR_MAP) {
+        item->len = r->pos - item->ptr;
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int LITE_cbor_item_to_int64(const LITE_cbor_item *item, int64_t *value)
+{
+    switch (item->type) {
+        case LITE_CBOR_UINT:
+            if (item->u > INT64_MAX) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            *value = (int64_t)item->u;
+            return QCLOUD_RET_SUCCESS;
+        case LITE_CBOR_NINT:
+            if (item->u > INT64_MAX) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            *value = -1 - (int64_t)item->u;
+            return QCLOUD_RET_SUCCESS;
+        case LITE_CBOR_FLOAT:
+            /* integral floats only, -2^63 <= d < 2^63 */
+            if (!(item->d >= -9223372036854775808.0 && item->d < 9223372036854775808.0) ||
+                (double)(int64_t)item->d != item->d) {
+                return QCLOUD_ERR_FAILURE;
+            }
+            *value = (int64_t)item->d;
+            return QCLOUD_RET_SUCCESS;
+        default:
+            return QCLOUD_ERR_FAILURE;
+    }
+}
+
+int LITE_cbor_item_to_double(const LITE_cbor_item *item, double *value)
+{
+    switch (item->type) {
+        case LITE_CBOR_UINT:
+            *value = (double)item->u;
+            return QCLOUD_RET_SUCCESS;
+        case LITE_CBOR_NINT:
+            *value = -1.0 - (double)item->u;
+            return QCLOUD_RET_SUCCESS;
+        case LITE_CBOR_FLOAT:
+            *value = item->d;
+            return QCLOUD_RET_SUCCESS;
+        default:
+            return QCLOUD_ERR_FAILURE;
+    }
+}
+
+bool LITE_cbor_is_map(const void *buf, size_t len)
+{
+    return buf != NULL && len > 0 && (*(const uint8_t *)buf >> 5) == CBOR_MAJOR_MAP;
+}
+
+/* the value item with any tags in front of it dropped, containers skipped */
+static int _cbor_read_value(LITE_cbor_reader *r, LITE_cbor_item *value)
+{
+    do {
+        if (LITE_cbor_read(r, value) != QCLOUD_RET_SUCCESS) {
+            return QCLOUD_ERR_FAILURE;
+        }
+    } while (value->type == LITE_CBOR_TAG);
+
+    return LITE_cbor_skip(r, value);
+}
+
+int LITE_cbor_for_each_member(const void *buf, size_t len, LITE_cbor_member_cb cb, void *ctx)
+{
+    LITE_cbor_reader reader;
+    LITE_cbor_item   map, key, value;
+    uint64_t         count;
+
+    LITE_cbor_reader_init(&reader, buf, len);
+    if (LITE_cbor_read(&reader, &map) != QCLOUD_RET_SUCCESS || map.type != LITE_CBOR_MAP) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    count = map.u;
+    while (count == LITE_CBOR_INDEFINITE || count--) {
+        if (LITE_cbor_read(&reader, &key) != QCLOUD_RET_SUCCESS) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        if (key.type == LITE_CBOR_BREAK && count == LITE_CBOR_INDEFINITE) {
+            break;
+        }
+        if (LITE_cbor_skip(&reader, &key) != QCLOUD_RET_SUCCESS ||
+            _cbor_read_value(&reader, &value) != QCLOUD_RET_SUCCESS) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        if (key.type == LITE_CBOR_TEXT && cb((const char *)key.ptr, (int)key.len, &value, ctx)) {
+            break;
+        }
+    }
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+typedef struct {
+    const char *    key;
+    size_t          key_len;
+    LITE_cbor_item *value;
+    bool            found;
+} CborFindContext;
+
+static int _cbor_find_cb(const char *key, int key_len, const LITE_cbor_item *value, void *ctx)
+{
+    CborFindContext *find = (CborFindContext *)ctx;
+
+    if ((size_t)key_len != find->key_len || memcmp(key, find->key, key_len)) {
+        return 0;
+    }
+    *find->value = *value;
+    find->found  = true;
+
+    return 1;
+}
+
+int LITE_cbor_map_find(const void *buf, size_t len, const char *key, LITE_cbor_item *value)
+{
+    CborFindContext find = {key, 0, value, false};
+    const char *    dot;
+
+    for (;;) {
+        dot          = strchr(find.key, '.');
+        find.key_len = dot ? (size_t)(dot - find.key) : strlen(find.key);
+        find.found   = false;
+        if (LITE_cbor_for_each_member(buf, len, _cbor_find_cb, &find) != QCLOUD_RET_SUCCESS || !find.found) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        if (!dot) {
+            return QCLOUD_RET_SUCCESS;
+        }
+
+        /* descend into the member found */
+        if (value->type != LITE_CBOR_MAP) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        buf      = value->ptr;
+        len      = value->len;
+        find.key = dot + 1;
+    }
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,277 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "utils_mem.h"
+
+#include <string.h>
+
+#include "qcloud_iot_export.h"
+#include "qcloud_iot_import.h"
+#include "utils_param_check.h"
+
+#define MEM_HEAD_MAGIC 0x4d45
+#define MEM_FROM_HEAP  0xff
+
+/* in front of every block, 8 bytes keep the payload 8-byte aligned */
+typedef struct {
+    uint32_t size;
+    uint8_t  tag;
+    uint8_t  pool;
+    uint16_t magic;
+} MemHead;
+
+#ifdef MEM_POOL_ENABLED
+typedef struct {
+    uint16_t  block_size;
+    uint16_t  block_num;
+    uint64_t *area;
+    void *    free_list;  // free blocks are chained through their first word
+    uint16_t  used;
+    uint16_t  peak;
+    uint32_t  exhausted;
+} MemPool;
+
+#define MEM_POOL_AREA(size, num) static uint64_t sg_mem_area_##size[((size) + sizeof(MemHead)) / 8 * (num) + 1]
+
+MEM_POOL_AREA(32, MEM_POOL_32_NUM);
+MEM_POOL_AREA(64, MEM_POOL_64_NUM);
+MEM_POOL_AREA(128, MEM_POOL_128_NUM);
+MEM_POOL_AREA(256, MEM_POOL_256_NUM);
+MEM_POOL_AREA(512, MEM_POOL_512_NUM);
+
+static MemPool sg_mem_pools[] = {
+    {32, MEM_POOL_32_NUM, sg_mem_area_32},    {64, MEM_POOL_64_NUM, sg_mem_area_64},
+    {128, MEM_POOL_128_NUM, sg_mem_area_128}, {256, MEM_POOL_256_NUM, sg_mem_area_256},
+    {512, MEM_POOL_512_NUM, sg_mem_area_512},
+};
+
+#define MEM_POOL_NUM (sizeof(sg_mem_pools) / sizeof(sg_mem_pools[0]))
+#endif
+
+static void *   sg_mem_lock   = NULL;
+static int      sg_mem_once   = 0;
+static bool     sg_mem_strict = false;
+static uint32_t sg_mem_strict_violations;
+static MemStat  sg_mem_stat[MEM_TAG_MAX];
+
+static void _mem_lock(void)
+{
+    if (sg_mem_lock) {
+        HAL_MutexLock(sg_mem_lock);
+    }
+}
+
+static void _mem_unlock(void)
+{
+    if (sg_mem_lock) {
+        HAL_MutexUnlock(sg_mem_lock);
+    }
+}
+
+/* run once through HAL_Once by the first allocation, concurrent first allocations wait for it */
+static void _mem_init(void)
+{
+#ifdef MEM_POOL_ENABLED
+    int i, j;
+
+    for (i = 0; i < MEM_POOL_NUM; i++) {
+        MemPool *pool   = &sg_mem_pools[i];
+        size_t   stride = pool->block_size + sizeof(MemHead);
+
+        pool->free_list = NULL;
+        for (j = pool->block_num - 1; j >= 0; j--) {
+            void **block    = (void **)((char *)pool->area + j * stride + sizeof(MemHead));
+            *block          = pool->free_list;
+            pool->free_list = block;
+        }
+    }
+#endif
+
+    sg_mem_lock = HAL_MutexCreate();
+}
+
+#ifdef MEM_POOL_ENABLED
+static MemHead *_mem_pool_take(size_t size, uint8_t *index)
+{
+    int  i;
+    bool fitted = false;
+
+    for (i = 0; i < MEM_POOL_NUM; i++) {
+        MemPool *pool = &sg_mem_pools[i];
+        if (size > pool->block_size || 0 == pool->block_num) {
+            continue;
+        }
+
+        if (NULL == pool->free_list) {
+            // account the shortage to the best fitting pool, then try a larger one
+            if (!fitted) {
+                pool->exhausted++;
+            }
+            fitted = true;
+            continue;
+        }
+
+        void **block    = (void **)pool->free_list;
+        pool->free_list = *block;
+        if (++pool->used > pool->peak) {
+            pool->peak = pool->used;
+        }
+        *index = i;
+
+        return (MemHead *)block - 1;
+    }
+
+    return NULL;
+}
+#endif
+
+void *utils_mem_alloc(MemTag tag, size_t size)
+{
+    MemHead *head = NULL;
+    uint8_t  pool = MEM_FROM_HEAP;
+
+    if (tag >= MEM_TAG_MAX) {
+        tag = MEM_TAG_OTHER;
+    }
+
+    HAL_Once(&sg_mem_once, _mem_init);
+
+#ifdef MEM_POOL_ENABLED
+    _mem_lock();
+    head = _mem_pool_take(size, &pool);
+    _mem_unlock();
+#endif
+
+    if (NULL == head) {
+        head = (MemHead *)HAL_Malloc(sizeof(MemHead) + size);
+    }
+
+    _mem_lock();
+    MemStat *stat = &sg_mem_stat[tag];
+    if (NULL == head) {
+        stat->fail_cnt++;
+        _mem_unlock();
+        return NULL;
+    }
+
+    stat->alloc_cnt++;
+    stat->cur_bytes += size;
+    if (stat->cur_bytes > stat->peak_bytes) {
+        stat->peak_bytes = stat->cur_bytes;
+    }
+    if (MEM_FROM_HEAP == pool) {
+        stat->heap_cnt++;
+        if (sg_mem_strict) {
+            sg_mem_strict_violations++;
+        }
+    }
+    _mem_unlock();
+
+    if (MEM_FROM_HEAP == pool && sg_mem_strict) {
+        Log_w("heap allocation in strict mode, tag %d size %u", tag, (unsigned)size);
+    }
+
+    head->size  = size;
+    head->tag   = tag;
+    head->pool  = pool;
+    head->magic = MEM_HEAD_MAGIC;
+
+    return head + 1;
+}
+
+void utils_mem_free(void *ptr)
+{
+    if (NULL == ptr) {
+        return;
+    }
+
+    MemHead *head = (MemHead *)ptr - 1;
+    if (MEM_HEAD_MAGIC != head->magic) {
+        Log_e("free of %p which is not from utils_mem_alloc or already freed", ptr);
+        return;
+    }
+    head->magic = 0;
+
+    _mem_lock();
+    sg_mem_stat[head->tag].cur_bytes -= head->size;
+#ifdef MEM_POOL_ENABLED
+    if (MEM_FROM_HEAP != head->pool) {
+        MemPool *pool   = &sg_mem_pools[head->pool];
+        *(void **)ptr   = pool->free_list;
+        pool->free_list = ptr;
+        pool->used--;
+        _mem_unlock();
+        return;
+    }
+#endif
+    _mem_unlock();
+
+    HAL_Free(head);
+}
+
+int IOT_Mem_Get_Stat(MemTag tag, MemStat *stat)
+{
+    POINTER_SANITY_CHECK(stat, QCLOUD_ERR_INVAL);
+    if (tag >= MEM_TAG_MAX) {
+        return QCLOUD_ERR_INVAL;
+    }
+
+    _mem_lock();
+    *stat = sg_mem_stat[tag];
+    _mem_unlock();
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int IOT_Mem_Get_Pool_Stat(int index, MemPoolStat *stat)
+{
+    POINTER_SANITY_CHECK(stat, QCLOUD_ERR_INVAL);
+
+#ifdef MEM_POOL_ENABLED
+    if (index < 0 || index >= MEM_POOL_NUM) {
+        return QCLOUD_ERR_INVAL;
+    }
+
+    _mem_lock();
+    stat->block_size = sg_mem_pools[index].block_size;
+    stat->block_num  = sg_mem_pools[index].block_num;
+    stat->used       = sg_mem_pools[index].used;
+    stat->peak       = sg_mem_pools[index].peak;
+    stat->exhausted  = sg_mem_pools[index].exhausted;
+    _mem_unlock();
+
+    return QCLOUD_RET_SUCCESS;
+#else
+    return QCLOUD_ERR_INVAL;
+#endif
+}
+
+void IOT_Mem_Set_Strict(bool enable)
+{
+    sg_mem_strict = enable;
+}
+
+uint32_t IOT_Mem_Strict_Violations(void)
+{
+    return sg_mem_strict_violations;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,681 @@
+/*
+ * Tencent is pleased to support the open source community by making IoT Hub available.
+ * Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+
+ * Licensed under the MIT License (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://opensource.org/licenses/MIT
+
+ * Unless required by applicable law or agreed to in writing, software distributed under the License is
+ * distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+ * either express or implied. See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lite-utils.h"
+#include "qcloud_iot_export_error.h"
+
+/* "00" "01" ... "99", two digits per division */
+static const char sg_digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const double sg_exact_pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static const uint64_t sg_pow10_u64[] = {1ULL,
+                                        10ULL,
+                                        100ULL,
+                                        1000ULL,
+                                        10000ULL,
+                                        100000ULL,
+                                        1000000ULL,
+                                        10000000ULL,
+                                        100000000ULL,
+                                        1000000000ULL,
+                                        10000000000ULL,
+                                        100000000000ULL,
+                                        1000000000000ULL,
+                                        10000000000000ULL,
+                                        100000000000000ULL,
+                                        1000000000000000ULL,
+                                        10000000000000000ULL,
+                                        100000000000000000ULL,
+                                        1000000000000000000ULL,
+                                        10000000000000000000ULL};
+
+#define POW10_U64_NUM       (sizeof(sg_pow10_u64) / sizeof(sg_pow10_u64[0]))
+#define MAX_EXACT_MANTISSA  (1ULL << 53)
+#define MAX_MANTISSA_DIGITS (19)
+#define MAX_EXPONENT_VALUE  (100000)
+
+/*========================== integer ==========================*/
+
+static const char *_skip_space(const char *s)
+{
+    while (*s == ' ' || (*s >= '\t' && *s <= '\r')) {
+        s++;
+    }
+
+    return s;
+}
+
+static int _parse_digits(const char **src, uint64_t *value)
+{
+    const char *s = *src;
+    uint64_t    v = 0;
+
+    if (!LITE_isdigit(*s)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    for (; LITE_isdigit(*s); s++) {
+        unsigned d = *s - '0';
+
+        if (v > (UINT64_MAX - d) / 10) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        v = v * 10 + d;
+    }
+
+    *src   = s;
+    *value = v;
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int LITE_str_to_int64(const char *src, int64_t min, int64_t max, int64_t *value)
+{
+    const char *s   = _skip_space(src);
+    bool        neg = (*s == '-');
+    uint64_t    mag;
+    int64_t     v;
+
+    if (*s == '-' || *s == '+') {
+        s++;
+    }
+
+    if (QCLOUD_RET_SUCCESS != _parse_digits(&s, &mag)) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    if (neg) {
+        if (mag > (uint64_t)INT64_MAX + 1) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        v = mag ? -(int64_t)(mag - 1) - 1 : 0;
+    } else {
+        if (mag > (uint64_t)INT64_MAX) {
+            return QCLOUD_ERR_FAILURE;
+        }
+        v = (int64_t)mag;
+    }
+
+    if (v < min || v > max) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    *value = v;
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+int LITE_str_to_uint64(const char *src, uint64_t max, uint64_t *value)
+{
+    const char *s = _skip_space(src);
+    uint64_t    v;
+
+    if (*s == '+') {
+        s++;
+    }
+
+    if (QCLOUD_RET_SUCCESS != _parse_digits(&s, &v) || v > max) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    *value = v;
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+/* digits of value right aligned to end, returns the first one */
+static char *_format_digits(uint64_t value, char *end)
+{
+    char *   p = end;
+    uint32_t v32;
+    unsigned i;
+
+    /* 64 bit division is a library call on most MCUs, leave it early */
+    while (value > UINT32_MAX) {
+        i = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--p = sg_digit_pairs[i + 1];
+        *--p = sg_digit_pairs[i];
+    }
+
+    v32 = (uint32_t)value;
+    while (v32 >= 100) {
+        i = (v32 % 100) * 2;
+        v32 /= 100;
+        *--p = sg_digit_pairs[i + 1];
+        *--p = sg_digit_pairs[i];
+    }
+
+    if (v32 >= 10) {
+        i    = v32 * 2;
+        *--p = sg_digit_pairs[i + 1];
+        *--p = sg_digit_pairs[i];
+    } else {
+        *--p = '0' + v32;
+    }
+
+    return p;
+}
+
+static int _format_integer(bool neg, uint64_t mag, char *buf, size_t size)
+{
+    char  tmp[LITE_NUMBER_STR_MAX_LEN];
+    char *end = tmp + sizeof(tmp);
+    char *p   = _format_digits(mag, end);
+    int   len;
+
+    if (neg) {
+        *--p = '-';
+    }
+
+    len = end - p;
+    if ((size_t)len >= size) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+
+    return len;
+}
+
+int LITE_int64_to_str(int64_t value, char *buf, size_t size)
+{
+    return (value < 0) ? _format_integer(true, 0 - (uint64_t)value, buf, size)
+                       : _format_integer(false, (uint64_t)value, buf, size);
+}
+
+int LITE_uint64_to_str(uint64_t value, char *buf, size_t size)
+{
+    return _format_integer(false, value, buf, size);
+}
+
+/*========================== floating point parse ==========================*/
+
+/*
+ * Up to 19 significant digits are gathered into an integer. When it and the power of
+ * ten are both exact doubles one multiplication or division rounds correctly (Clinger's
+ * fast path), which covers what devices and the cloud exchange. Longer or far out
+ * numbers are left to strtod.
+ */
+int LITE_str_to_double(const char *src, double *value)
+{
+    const char *s         = _skip_space(src);
+    bool        neg       = false;
+    bool        truncated = false;
+    bool        any       = false;
+    uint64_t    mant      = 0;
+    int         digits    = 0;
+    int         exp10     = 0;
+    double      result;
+
+    if (*s == '-' || *s == '+') {
+        neg = (*s++ == '-');
+    }
+
+    for (; LITE_isdigit(*s); s++) {
+        any = true;
+        if (digits < MAX_MANTISSA_DIGITS) {
+            mant = mant * 10 + (*s - '0');
+            digits += (mant != 0);
+        } else {
+            exp10++;
+            truncated |= (*s != '0');
+        }
+    }
+
+    if (*s == '.') {
+        for (s++; LITE_isdigit(*s); s++) {
+            any = true;
+            if (digits < MAX_MANTISSA_DIGITS) {
+                mant = mant * 10 + (*s - '0');
+                digits += (mant != 0);
+                exp10--;
+            } else {
+                truncated |= (*s != '0');
+            }
+        }
+    }
+
+    if (!any) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    if (*s == 'e' || *s == 'E') {
+        const char *e       = s + 1;
+        bool        exp_neg = false;
+        int         exp_val = 0;
+
+        if (*e == '-' || *e == '+') {
+            exp_neg = (*e++ == '-');
+        }
+        /* "1e" is 1 followed by garbage, as for strtod */
+        if (LITE_isdigit(*e)) {
+            for (; LITE_isdigit(*e); e++) {
+                if (exp_val < MAX_EXPONENT_VALUE) {
+                    exp_val = exp_val * 10 + (*e - '0');
+                }
+            }
+            exp10 += exp_neg ? -exp_val : exp_val;
+        }
+    }
+
+    if (0 == mant) {
+        result = 0.0;
+    } else if (truncated || mant > MAX_EXACT_MANTISSA) {
+        goto slow_path;
+    } else if (exp10 >= 0 && exp10 <= 22) {
+        result = (double)mant * sg_exact_pow10[exp10];
+    } else if (exp10 < 0 && exp10 >= -22) {
+        result = (double)mant / sg_exact_pow10[-exp10];
+    } else if (exp10 > 22 && exp10 - 22 < MAX_MANTISSA_DIGITS &&
+               mant <= MAX_EXACT_MANTISSA / sg_pow10_u64[exp10 - 22]) {
+        /* 123e25 is 123000e22, still an exact mantissa */
+        result = (double)(mant * sg_pow10_u64[exp10 - 22]) * sg_exact_pow10[22];
+    } else {
+        goto slow_path;
+    }
+
+    *value = neg ? -result : result;
+
+    return QCLOUD_RET_SUCCESS;
+
+slow_path:
+    *value = strtod(src, NULL);
+
+    return QCLOUD_RET_SUCCESS;
+}
+
+/*========================== floating point format ==========================*/
+
+/*
+ * Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+ * with Integers"): the digits generated always read back to the same value, and are
+ * the shortest such digits for all but a tiny fraction of inputs.
+ */
+
+typedef struct {
+    uint64_t f;
+    int      e;
+} DiyFp;
+
+/* normalized 10^-348, 10^-340, ..., 10^340 */
+static const uint64_t sg_cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t sg_cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066,
+};
+
+static DiyFp _diyfp_mul(DiyFp x, DiyFp y)
+{
+    const uint64_t M32 = 0xFFFFFFFFULL;
+    uint64_t       a = x.f >> 32, b = x.f & M32;
+    uint64_t       c = y.f >> 32, d = y.f & M32;
+    uint64_t       ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t       tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    DiyFp          r;
+
+    tmp += 1U << 31; /* round */
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+
+    return r;
+}
+
+static DiyFp _diyfp_normalize(DiyFp x)
+{
+    while (!(x.f & 0xFF00000000000000ULL)) {
+        x.f <<= 8;
+        x.e -= 8;
+    }
+    while (!(x.f & 0x8000000000000000ULL)) {
+        x.f <<= 1;
+        x.e--;
+    }
+
+    return x;
+}
+
+/* halfway points to the neighbours of v, both with the exponent of normalized v */
+static void _diyfp_boundaries(DiyFp v, uint64_t hidden_bit, DiyFp *minus, DiyFp *plus)
+{
+    DiyFp pl, mi;
+
+    pl.f = (v.f << 1) + 1;
+    pl.e = v.e - 1;
+    pl   = _diyfp_normalize(pl);
+
+    /* the gap below a power of two is half as wide */
+    if (v.f == hidden_bit) {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    } else {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    *minus = mi;
+    *plus  = pl;
+}
+
+/* 10^-K such that multiplying by it brings e into [-60, -32] */
+static DiyFp _cached_power(int e, int *K)
+{
+    double   dk    = (-61 - e) * 0.30102999566398114 + 347;
+    int      k     = (int)dk;
+    unsigned index;
+    DiyFp    r;
+
+    if (dk - k > 0.0) {
+        k++;
+    }
+
+    index = (unsigned)((k >> 3) + 1);
+    *K    = -(-348 + (int)(index << 3));
+    r.f   = sg_cached_powers_f[index];
+    r.e   = sg_cached_powers_e[index];
+
+    return r;
+}
+
+static void _grisu_round(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static int _digit_gen(DiyFp W, DiyFp Mp, uint64_t delta, char *buf, int *K)
+{
+    const int      shift = -Mp.e;
+    const uint64_t one   = 1ULL << shift;
+    const uint64_t wp_w  = Mp.f - W.f;
+    uint32_t       p1    = (uint32_t)(Mp.f >> shift);
+    uint64_t       p2    = Mp.f & (one - 1);
+    int            kappa = 1;
+    int            len   = 0;
+
+    while (kappa < 10 && p1 >= sg_pow10_u64[kappa]) {
+        kappa++;
+    }
+
+    while (kappa > 0) {
+        uint32_t d;
+        uint64_t rest;
+
+        kappa--;
+        d = p1 / (uint32_t)sg_pow10_u64[kappa];
+        p1 %= (uint32_t)sg_pow10_u64[kappa];
+        if (d || len) {
+            buf[len++] = '0' + d;
+        }
+
+        rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta) {
+            *K += kappa;
+            _grisu_round(buf, len, delta, rest, sg_pow10_u64[kappa] << shift, wp_w);
+            return len;
+        }
+    }
+
+    for (;;) {
+        char d;
+
+        p2 *= 10;
+        delta *= 10;
+        d = (char)(p2 >> shift);
+        if (d || len) {
+            buf[len++] = '0' + d;
+        }
+        p2 &= one - 1;
+        kappa--;
+
+        if (p2 < delta) {
+            *K += kappa;
+            _grisu_round(buf, len, delta, p2, one,
+                         wp_w * (-kappa < (int)POW10_U64_NUM ? sg_pow10_u64[-kappa] : 0));
+            return len;
+        }
+    }
+}
+
+static int _grisu2(DiyFp v, uint64_t hidden_bit, char *buf, int *K)
+{
+    DiyFp w_m, w_p, c_mk, W, Wp, Wm;
+
+    _diyfp_boundaries(v, hidden_bit, &w_m, &w_p);
+    c_mk = _cached_power(w_p.e, K);
+    W    = _diyfp_mul(_diyfp_normalize(v), c_mk);
+    Wp   = _diyfp_mul(w_p, c_mk);
+    Wm   = _diyfp_mul(w_m, c_mk);
+
+    /* stay strictly inside the rounding interval */
+    Wm.f++;
+    Wp.f--;
+
+    return _digit_gen(W, Wp, Wp.f - Wm.f, buf, K);
+}
+
+static int _write_exponent(int K, char *buf)
+{
+    char *end = buf + 4;
+    char *p;
+    int   len = 0;
+
+    if (K < 0) {
+        buf[len++] = '-';
+        K          = -K;
+    }
+
+    p = _format_digits((uint64_t)K, end);
+    memmove(buf + len, p, end - p);
+
+    return len + (int)(end - p);
+}
+
+/* digits * 10^k as plain decimal when short, else as d.ddde[-]x, JSON grammar either way */
+static int _prettify(char *buf, int length, int k)
+{
+    const int kk = length + k; /* 10^(kk-1) <= v < 10^kk */
+    int       i;
+
+    if (k >= 0 && kk <= 21) {
+        /* 1234e7 -> 12340000000.0 */
+        for (i = length; i < kk; i++) {
+            buf[i] = '0';
+        }
+        buf[kk]     = '.';
+        buf[kk + 1] = '0';
+        return kk + 2;
+    } else if (kk > 0 && kk <= 21) {
+        /* 1234e-2 -> 12.34 */
+        memmove(&buf[kk + 1], &buf[kk], length - kk);
+        buf[kk] = '.';
+        return length + 1;
+    } else if (kk > -6 && kk <= 0) {
+        /* 1234e-6 -> 0.001234 */
+        const int offset = 2 - kk;
+
+        memmove(&buf[offset], &buf[0], length);
+        buf[0] = '0';
+        buf[1] = '.';
+        for (i = 2; i < offset; i++) {
+            buf[i] = '0';
+        }
+        return length + offset;
+    } else if (length == 1) {
+        /* 1e30 */
+        buf[1] = 'e';
+        return 2 + _write_exponent(kk - 1, &buf[2]);
+    } else {
+        /* 1234e30 -> 1.234e33 */
+        memmove(&buf[2], &buf[1], length - 1);
+        buf[1]          = '.';
+        buf[length + 1] = 'e';
+        return length + 2 + _write_exponent(kk - 1, &buf[length + 2]);
+    }
+}
+
+static int _format_float(bool neg, DiyFp v, uint64_t hidden_bit, char *buf, size_t size)
+{
+    char tmp[LITE_NUMBER_STR_MAX_LEN];
+    int  len = 0;
+    int  K;
+
+    if (neg) {
+        tmp[len++] = '-';
+    }
+
+    if (0 == v.f) {
+        tmp[len++] = '0';
+        tmp[len++] = '.';
+        tmp[len++] = '0';
+    } else {
+        int digits = _grisu2(v, hidden_bit, tmp + len, &K);
+        len += _prettify(tmp + len, digits, K);
+    }
+
+    if ((size_t)len >= size) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    memcpy(buf, tmp, len);
+    buf[len] = '\0';
+
+    return len;
+}
+
+/* NaN and infinity have no JSON form */
+static int _format_null(char *buf, size_t size)
+{
+    if (size <= 4) {
+        return QCLOUD_ERR_FAILURE;
+    }
+
+    memcpy(buf, "null", 5);
+
+    return 4;
+}
+
+int LITE_double_to_str(double value, char *buf, size_t size)
+{
+    const uint64_t hidden_bit = 1ULL << 52;
+    uint64_t       bits;
+    int            biased_e;
+    DiyFp          v;
+
+    memcpy(&bits, &value, sizeof(bits));
+    biased_e = (int)((bits >> 52) & 0x7FF);
+    v.f      = bits & (hidden_bit - 1);
+
+    if (0x7FF == biased_e) {
+        return _format_null(buf, size);
+    }
+
+    if (biased_e) {
+        v.f += hidden_bit;
+        v.e = biased_e - 1075;
+    } else {
+        v.e = -1074;
+    }
+
+    return _format_float(bits >> 63, v, hidden_bit, buf, size);
+}
+
+int LITE_float_to_str(float value, char *buf, size_t size)
+{
+    const uint32_t hidden_bit = 1UL << 23;
+    uint32_t       bits;
+    int            biased_e;
+    DiyFp          v;
+
+    memcpy(&bits, &value, sizeof(bits));
+    biased_e = (int)((bits >> 23) & 0xFF);
+    v.f      = bits & (hidden_bit - 1);
+
+    if (0xFF == biased_e) {
+        return _format_null(buf, size);
+    }
+
+    if (biased_e) {
+        v.f += hidden_bit;
+        v.e = biased_e - 150;
+    } else {
+        v.e = -149;
+    }
+
+    return _format_float(bits >> 31, v, hidden_bit, buf, size);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,73 +18,133 @@
 #include <stdio.h>
 #include <string.h>
 
+/* the index owned by the other side is read with acquire, our own index is published with release */
+#if defined(__GNUC__) || defined(__clang__)
+#define RING_LOAD_ACQUIRE(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define RING_STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+/* aligned 32bit access is atomic on supported MCUs, volatile keeps compiler from reordering */
+#define RING_LOAD_ACQUIRE(p)     (*(volatile uint32_t*)(p))
+#define RING_STORE_RELEASE(p, v) (*(volatile uint32_t*)(p) = (v))
+#endif
+
 int ring_buff_init(sRingbuff* ring_buff, char* buff, uint32_t size)
 {
+    uint32_t pow2 = 1;
+
+    if (size == 0) {
+        return RINGBUFF_ERR;
+    }
+
+    while ((pow2 << 1) != 0 && (pow2 << 1) <= size) {
+        pow2 <<= 1;
+    }
+
     ring_buff->buffer     = buff;
-    ring_buff->size       = size;
+    ring_buff->size       = pow2;
+    ring_buff->mask       = pow2 - 1;
     ring_buff->readpoint  = 0;
     ring_buff->writepoint = 0;
+    ring_buff->dropped    = 0;
     memset(ring_buff->buffer, 0, ring_buff->size);
-    ring_buff->full = false;
 
     return RINGBUFF_OK;
 }
 
 int ring_buff_flush(sRingbuff* ring_buff)
 {
-    ring_buff->readpoint  = 0;
-    ring_buff->writepoint = 0;
-    memset(ring_buff->buffer, 0, ring_buff->size);
-    ring_buff->full = false;
+    RING_STORE_RELEASE(&ring_buff->readpoint, RING_LOAD_ACQUIRE(&ring_buff->writepoint));
 
     return RINGBUFF_OK;
 }
 
+uint32_t ring_buff_used(sRingbuff* ring_buff)
+{
+    return RING_LOAD_ACQUIRE(&ring_buff->writepoint) - ring_buff->readpoint;
+}
+
+uint32_t ring_buff_free(sRingbuff* ring_buff)
+{
+    return ring_buff->size - (ring_buff->writepoint - RING_LOAD_ACQUIRE(&ring_buff->readpoint));
+}
+
+uint32_t ring_buff_read_span(sRingbuff* ring_buff, const char** span)
+{
+    uint32_t used   = ring_buff_used(ring_buff);
+    uint32_t offset = ring_buff->readpoint & ring_buff->mask;
+    uint32_t tail   = ring_buff->size - offset;
+
+    *span = ring_buff->buffer + offset;
+    return (used < tail) ? used : tail;
+}
+
+void ring_buff_consume(sRingbuff* ring_buff, uint32_t len)
+{
+    RING_STORE_RELEASE(&ring_buff->readpoint, ring_buff->readpoint + len);
+}
+
+uint32_t ring_buff_write_span(sRingbuff* ring_buff, char** span)
+{
+    uint32_t room   = ring_buff_free(ring_buff);
+    uint32_t offset = ring_buff->writepoint & ring_buff->mask;
+    uint32_t tail   = ring_buff->size - offset;
+
+    *span = ring_buff->buffer + offset;
+    return (room < tail) ? room : tail;
+}
+
+void ring_buff_commit(sRingbuff* ring_buff, uint32_t len)
+{
+    RING_STORE_RELEASE(&ring_buff->writepoint, ring_buff->writepoint + len);
+}
+
 int ring_buff_push_data(sRingbuff* ring_buff, uint8_t* pData, int len)
 {
-    int i;
+    uint32_t room, offset, first;
+    int      rc = RINGBUFF_OK;
 
     if (len > ring_buff->size) {
         return RINGBUFF_TOO_SHORT;
     }
 
-    for (i = 0; i < len; i++) {
-        if (((ring_buff->writepoint + 1) % ring_buff->size) == ring_buff->readpoint) {
-            ring_buff->full = true;
-            return RINGBUFF_FULL;
-        } else {
-            if (ring_buff->writepoint < (ring_buff->size - 1)) {
-                ring_buff->writepoint++;
-            } else {
-                ring_buff->writepoint = 0;
-            }
-            ring_buff->buffer[ring_buff->writepoint] = pData[i];
-        }
+    room = ring_buff_free(ring_buff);
+    if (room < (uint32_t)len) {
+        ring_buff->dropped += len - room;
+        len = room;
+        rc  = RINGBUFF_FULL;
     }
 
-    return RINGBUFF_OK;
+    offset = ring_buff->writepoint & ring_buff->mask;
+    first  = ring_buff->size - offset;
+    if (first > (uint32_t)len) {
+        first = len;
+    }
+    memcpy(ring_buff->buffer + offset, pData, first);
+    memcpy(ring_buff->buffer, pData + first, len - first);
+
+    ring_buff_commit(ring_buff, len);
+
+    return rc;
 }
 
 int ring_buff_pop_data(sRingbuff* ring_buff, uint8_t* pData, int len)
 {
-    int i;
+    uint32_t used, offset, first;
 
-    if (len > ring_buff->size) {
-        return RINGBUFF_TOO_SHORT;
+    used = ring_buff_used(ring_buff);
+    if (used < (uint32_t)len) {
+        len = used;
     }
 
-    for (i = 0; i < len; i++) {
-        if (ring_buff->writepoint == ring_buff->readpoint) {
-            break;
-        } else {
-            if (ring_buff->readpoint == (ring_buff->size - 1)) {
-                ring_buff->readpoint = 0;
-            } else {
-                ring_buff->readpoint++;
-            }
-            pData[i] = ring_buff->buffer[ring_buff->readpoint];
-        }
+    offset = ring_buff->readpoint & ring_buff->mask;
+    first  = ring_buff->size - offset;
+    if (first > (uint32_t)len) {
+        first = len;
     }
+    memcpy(pData, ring_buff->buffer + offset, first);
+    memcpy(pData + first, ring_buff->buffer, len - first);
+
+    ring_buff_consume(ring_buff, len);
 
-    return i;
+    return len;
 }
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "qcloud_iot_crypto.h"
 #include "qcloud_iot_export_log.h"
 #include "qcloud_iot_import.h"
 
@@ -89,6 +90,13 @@ void utils_sha1_process(iot_sha1_context *ctx, const unsigned char data[64])
 {
     uint32_t temp, W[16], A, B, C, D, E;
 
+#ifdef CRYPTO_HW_ACCEL
+    if (qcloud_iot_crypto_accel() & IOT_CRYPTO_ACCEL_SHA1) {
+        qcloud_iot_crypto_sha1_blocks(ctx->state, data, 1);
+        return;
+    }
+#endif
+
     IOT_SHA1_GET_UINT32_BE(W[0], data, 0);
     IOT_SHA1_GET_UINT32_BE(W[1], data, 4);
     IOT_SHA1_GET_UINT32_BE(W[2], data, 8);
@@ -268,6 +276,14 @@ void utils_sha1_update(iot_sha1_context *ctx, const unsigned char *input, size_t
         left = 0;
     }
 
+#ifdef CRYPTO_HW_ACCEL
+    if (ilen >= 64 && (qcloud_iot_crypto_accel() & IOT_CRYPTO_ACCEL_SHA1)) {
+        qcloud_iot_crypto_sha1_blocks(ctx->state, input, ilen / 64);
+        input += ilen & ~(size_t)0x3F;
+        ilen &= 0x3F;
+    }
+#endif
+
     while (ilen >= 64) {
         utils_sha1_process(ctx, input);
         input += 64;
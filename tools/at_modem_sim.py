@@ -0,0 +1,469 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# Tencent is pleased to support the open source community by making IoT Hub available.
+# Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+#
+# Licensed under the MIT License (the "License"); you may not use this file except in
+# compliance with the License. You may obtain a copy of the License at
+# http://opensource.org/licenses/MIT
+#
+# Unless required by applicable law or agreed to in writing, software distributed under the License is
+# distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+# either express or implied. See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+ESP8266 AT modem simulator on a Linux pseudo-terminal.
+
+It speaks the command subset used by platform/at_device/esp8266 and bridges
+each link to a real TCP/UDP socket, so the whole AT path (HAL_AT_UART_linux,
+at_client, at_socket_inf, network_at_tcp) can run on a plain Linux box.
+
+    ./tools/at_modem_sim.py --link /tmp/at_modem --baud 115200
+    AT_UART_LINUX_DEV=/tmp/at_modem ./output/release/bin/mqtt_sample
+
+The serial side can be throttled to a baud rate, and responses can be delayed
+or turned into errors to exercise the parser and retry paths. Traffic and
+command latency stats are printed on exit (Ctrl-C) and every --stats seconds.
+"""
+
+import argparse
+import os
+import random
+import select
+import socket
+import sys
+import time
+import tty
+
+MAX_LINKS = 5
+IPD_MAX_LEN = 1460
+SEND_MAX_LEN = 2048
+RX_QUEUE_LEN = 4096
+
+
+class Bucket(object):
+    """token bucket pacing one direction of the serial line at baud/10 bytes per second"""
+
+    def __init__(self, baud):
+        self.rate = baud / 10.0 if baud > 0 else 0
+        self.burst = max(self.rate / 100.0, 64)
+        self.credit = self.burst
+        self.last = time.time()
+
+    def available(self):
+        if not self.rate:
+            return 1 << 20
+        now = time.time()
+        self.credit = min(self.credit + (now - self.last) * self.rate, self.burst)
+        self.last = now
+        return int(self.credit)
+
+    def take(self, n):
+        if self.rate:
+            self.credit -= n
+
+    def wait(self):
+        """seconds until at least one byte may pass"""
+        return 0 if not self.rate else max((1 - self.credit) / self.rate, 0)
+
+
+class Uart(object):
+    """master side of the pty, each direction paced like a real uart"""
+
+    def __init__(self, fd, baud, trace=False):
+        self.fd = fd
+        self.trace = trace
+        self.tx = Bucket(baud)
+        self.rx = Bucket(baud)
+        self.out = bytearray()
+        self.inq = bytearray()  # read from the pty, waiting for rx pacing
+        self.pending = []  # (due time, data) for delayed responses, kept in order
+        self.last_due = 0.0
+        self.tx_bytes = 0
+        self.rx_bytes = 0
+
+    def write(self, data, delay=0.0):
+        if delay > 0 or self.pending:
+            # never let a later response overtake an earlier one
+            self.last_due = max(time.time() + delay, self.last_due)
+            self.pending.append((self.last_due, bytes(data)))
+        else:
+            self.out += data
+
+    def want_write(self):
+        return len(self.out) > 0 and self.tx.available() > 0
+
+    def want_read(self):
+        return len(self.inq) < RX_QUEUE_LEN
+
+    def flush(self):
+        now = time.time()
+        while self.pending and self.pending[0][0] <= now:
+            self.out += self.pending.pop(0)[1]
+        if not self.out:
+            return
+        size = min(len(self.out), self.tx.available())
+        if size <= 0:
+            return
+        try:
+            n = os.write(self.fd, bytes(self.out[:size]))
+        except BlockingIOError:
+            return
+        if self.trace:
+            sys.stderr.write("<< %r\n" % bytes(self.out[:n]))
+        del self.out[:n]
+        self.tx.take(n)
+        self.tx_bytes += n
+
+    def read(self):
+        """pull everything pending off the pty, pacing is applied in drain()"""
+        try:
+            data = os.read(self.fd, RX_QUEUE_LEN - len(self.inq))
+        except (BlockingIOError, OSError):
+            return
+        if self.trace:
+            sys.stderr.write(">> %r\n" % data)
+        self.inq += data
+
+    def drain(self):
+        """bytes the host has sent that a uart at this baud would have received by now"""
+        size = min(len(self.inq), self.rx.available())
+        data = bytes(self.inq[:size])
+        del self.inq[:size]
+        self.rx.take(size)
+        self.rx_bytes += size
+        return data
+
+    def next_timeout(self):
+        t = None
+        if self.out:
+            t = self.tx.wait()
+        if self.inq:
+            w = self.rx.wait()
+            t = w if t is None else min(t, w)
+        if self.pending:
+            d = max(self.pending[0][0] - time.time(), 0)
+            t = d if t is None else min(t, d)
+        return t
+
+
+class Stats(object):
+    def __init__(self):
+        self.start = time.time()
+        self.cmds = {}
+        self.up_bytes = 0
+        self.down_bytes = 0
+        self.ipd = 0
+        self.sends = 0
+        self.errors = 0
+
+    def cmd(self, name, latency):
+        n, total, worst = self.cmds.get(name, (0, 0.0, 0.0))
+        self.cmds[name] = (n + 1, total + latency, max(worst, latency))
+
+    def dump(self, uart):
+        elapsed = max(time.time() - self.start, 1e-6)
+        out = sys.stderr
+        out.write("--- at modem sim: %.1fs ---\n" % elapsed)
+        out.write("uart  tx %d B (%.1f KB/s)  rx %d B (%.1f KB/s)\n" %
+                  (uart.tx_bytes, uart.tx_bytes / elapsed / 1024, uart.rx_bytes, uart.rx_bytes / elapsed / 1024))
+        out.write("net   up %d B in %d CIPSEND, down %d B in %d +IPD, %d injected errors\n" %
+                  (self.up_bytes, self.sends, self.down_bytes, self.ipd, self.errors))
+        for name in sorted(self.cmds):
+            n, total, worst = self.cmds[name]
+            out.write("  %-12s n=%-6d avg=%.2fms max=%.2fms\n" % (name, n, total * 1000 / n, worst * 1000))
+        out.flush()
+
+
+class Modem(object):
+    def __init__(self, uart, args):
+        self.uart = uart
+        self.args = args
+        self.stats = Stats()
+        self.echo = True
+        self.links = {}     # link id -> socket
+        self.rx = bytearray()
+        self.send_link = None
+        self.send_left = 0
+        self.send_buf = bytearray()
+        self.send_start = 0.0
+
+    # ---- responses ----
+
+    def delay(self):
+        d = self.args.delay_ms + random.uniform(0, self.args.jitter_ms)
+        return d / 1000.0
+
+    def reply(self, text, delay=None):
+        self.uart.write(text.encode() if isinstance(text, str) else text, self.delay() if delay is None else delay)
+
+    def inject(self, rate):
+        if rate > 0 and random.random() < rate:
+            self.stats.errors += 1
+            return True
+        return False
+
+    # ---- command handling ----
+
+    def feed(self, data):
+        self.rx += data
+        while self.rx:
+            if self.send_link is not None:
+                take = min(self.send_left, len(self.rx))
+                self.send_buf += self.rx[:take]
+                del self.rx[:take]
+                self.send_left -= take
+                if self.send_left:
+                    return
+                self.finish_send()
+                continue
+
+            end = self.rx.find(b"\r\n")
+            if end < 0:
+                if len(self.rx) > 4096:
+                    del self.rx[:]
+                return
+            line = bytes(self.rx[:end]).decode("latin-1")
+            del self.rx[:end + 2]
+            if line:
+                self.command(line)
+
+    def command(self, line):
+        start = time.time()
+        if self.echo:
+            self.uart.write((line + "\r\n").encode())
+
+        name = line.split("=", 1)[0].split("?", 1)[0]
+        arg = line.split("=", 1)[1] if "=" in line else ""
+
+        if self.inject(self.args.error_rate):
+            self.reply("\r\nERROR\r\n")
+            self.stats.cmd(name, time.time() - start)
+            return
+
+        handler = {
+            "AT": lambda a: "\r\nOK\r\n",
+            "ATE0": self.at_echo_off,
+            "ATE1": self.at_echo_on,
+            "AT+RST": self.at_rst,
+            "AT+GMR": lambda a: "AT version:1.7.4.0(simulated)\r\nSDK version:3.0.4\r\n\r\nOK\r\n",
+            "AT+CWMODE": lambda a: "\r\nOK\r\n",
+            "AT+CWJAP": self.at_cwjap,
+            "AT+CIPMUX": lambda a: "\r\nOK\r\n",
+            "AT+CIPDOMAIN": self.at_cipdomain,
+            "AT+CIPSTART": self.at_cipstart,
+            "AT+CIPSEND": self.at_cipsend,
+            "AT+CIPCLOSE": self.at_cipclose,
+        }.get(name)
+
+        if handler is None:
+            self.reply("\r\nERROR\r\n")
+        else:
+            resp = handler(arg)
+            if resp:
+                self.reply(resp)
+        if name != "AT+CIPSEND":
+            self.stats.cmd(name, time.time() - start)
+
+    def at_echo_off(self, arg):
+        self.echo = False
+        return "\r\nOK\r\n"
+
+    def at_echo_on(self, arg):
+        self.echo = True
+        return "\r\nOK\r\n"
+
+    def at_rst(self, arg):
+        for link in list(self.links):
+            self.close_link(link, notify=False)
+        self.echo = True
+        return "\r\nOK\r\n\r\nready\r\n"
+
+    def at_cwjap(self, arg):
+        return "WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n"
+
+    def at_cipdomain(self, arg):
+        host = arg.strip('"')
+        try:
+            ip = socket.gethostbyname(self.args.resolve or host)
+        except socket.error:
+            return "DNS Fail\r\n\r\nERROR\r\n"
+        return "+CIPDOMAIN:%s\r\n\r\nOK\r\n" % ip
+
+    def at_cipstart(self, arg):
+        parts = [p.strip('"') for p in arg.split(",")]
+        try:
+            link, proto, host, port = int(parts[0]), parts[1], parts[2], int(parts[3])
+        except (IndexError, ValueError):
+            return "\r\nERROR\r\n"
+        if link in self.links:
+            return "ALREADY CONNECTED\r\n\r\nERROR\r\n"
+        if link < 0 or link >= MAX_LINKS:
+            return "\r\nERROR\r\n"
+        if self.args.bridge:
+            host, port = self.args.bridge.rsplit(":", 1)
+            port = int(port)
+        kind = socket.SOCK_DGRAM if proto == "UDP" else socket.SOCK_STREAM
+        try:
+            sock = socket.socket(socket.AF_INET, kind)
+            sock.settimeout(5)
+            sock.connect((host, port))
+            sock.setblocking(False)
+            if kind == socket.SOCK_STREAM:
+                sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        except socket.error as e:
+            sys.stderr.write("link %d connect %s:%d failed: %s\n" % (link, host, port, e))
+            return "%d,CLOSED\r\n\r\nERROR\r\n" % link
+        self.links[link] = sock
+        return "%d,CONNECT\r\n\r\nOK\r\n" % link
+
+    def at_cipsend(self, arg):
+        try:
+            link, length = [int(p) for p in arg.split(",")]
+        except ValueError:
+            return "\r\nERROR\r\n"
+        if link not in self.links:
+            return "link is not valid\r\n\r\nERROR\r\n"
+        if length <= 0 or length > SEND_MAX_LEN:
+            return "\r\nERROR\r\n"
+        self.send_link = link
+        self.send_left = length
+        self.send_buf = bytearray()
+        self.send_start = time.time()
+        return "\r\nOK\r\n> "
+
+    def finish_send(self):
+        link, data = self.send_link, bytes(self.send_buf)
+        self.send_link = None
+        self.send_buf = bytearray()
+        resp = "\r\nRecv %d bytes\r\n" % len(data)
+        sock = self.links.get(link)
+        if sock is None or self.inject(self.args.send_fail_rate):
+            resp += "\r\nSEND FAIL\r\n"
+        else:
+            try:
+                sock.sendall(data) if sock.type == socket.SOCK_STREAM else sock.send(data)
+                self.stats.up_bytes += len(data)
+                self.stats.sends += 1
+                resp += "\r\nSEND OK\r\n"
+            except socket.error:
+                resp += "\r\nSEND FAIL\r\n"
+        self.reply(resp)
+        self.stats.cmd("AT+CIPSEND", time.time() - self.send_start)
+
+    def at_cipclose(self, arg):
+        try:
+            link = int(arg)
+        except ValueError:
+            return "\r\nERROR\r\n"
+        if link not in self.links:
+            return "UNLINK\r\n\r\nERROR\r\n"
+        self.close_link(link, notify=False)
+        return "%d,CLOSED\r\n\r\nOK\r\n" % link
+
+    def close_link(self, link, notify=True):
+        sock = self.links.pop(link, None)
+        if sock:
+            sock.close()
+        if notify:
+            self.reply("%d,CLOSED\r\n" % link)
+
+    # ---- network side ----
+
+    def on_readable(self, link):
+        sock = self.links[link]
+        try:
+            data = sock.recv(self.args.ipd_max)
+        except (BlockingIOError, InterruptedError):
+            return
+        except socket.error:
+            data = b""
+        if not data:
+            self.close_link(link)
+            return
+        self.stats.down_bytes += len(data)
+        self.stats.ipd += 1
+        self.reply(b"\r\n+IPD,%d,%d:" % (link, len(data)) + data, delay=self.delay())
+
+
+def open_pty(link):
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    name = os.ttyname(slave)
+    if link:
+        if os.path.islink(link):
+            os.unlink(link)
+        os.symlink(name, link)
+    os.set_blocking(master, False)
+    return master, slave, name
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ESP8266 AT modem simulator over a pty")
+    parser.add_argument("--link", default="/tmp/at_modem", help="symlink pointing to the pty slave")
+    parser.add_argument("--baud", type=int, default=115200, help="serial pacing, 0 for unlimited")
+    parser.add_argument("--bridge", help="host:port all links connect to instead of the requested one")
+    parser.add_argument("--resolve", help="address AT+CIPDOMAIN resolves every name to")
+    parser.add_argument("--delay-ms", type=float, default=0, help="extra latency before each response")
+    parser.add_argument("--jitter-ms", type=float, default=0, help="random extra latency up to this value")
+    parser.add_argument("--error-rate", type=float, default=0, help="probability a command answers ERROR")
+    parser.add_argument("--send-fail-rate", type=float, default=0, help="probability CIPSEND answers SEND FAIL")
+    parser.add_argument("--ipd-max", type=int, default=IPD_MAX_LEN, help="max payload of one +IPD")
+    parser.add_argument("--stats", type=float, default=0, help="print stats every N seconds")
+    parser.add_argument("--seed", type=int, help="random seed for repeatable error injection")
+    parser.add_argument("--trace", action="store_true", help="dump serial traffic to stderr")
+    args = parser.parse_args()
+
+    if args.seed is not None:
+        random.seed(args.seed)
+
+    master, slave, name = open_pty(args.link)
+    sys.stderr.write("at modem sim on %s%s, baud %s\n" %
+                     (name, " (" + args.link + ")" if args.link else "", args.baud or "unlimited"))
+
+    uart = Uart(master, args.baud, args.trace)
+    modem = Modem(uart, args)
+    next_stats = time.time() + args.stats if args.stats else None
+
+    try:
+        while True:
+            rlist = list(modem.links.values())
+            if uart.want_read():
+                rlist.append(master)
+            wlist = [master] if uart.want_write() else []
+            timeout = uart.next_timeout()
+            if next_stats:
+                d = max(next_stats - time.time(), 0)
+                timeout = d if timeout is None else min(timeout, d)
+            readable, _, _ = select.select(rlist, wlist, [], timeout)
+
+            for r in readable:
+                if r == master:
+                    uart.read()
+                else:
+                    for link, sock in list(modem.links.items()):
+                        if sock is r:
+                            modem.on_readable(link)
+            data = uart.drain()
+            if data:
+                modem.feed(data)
+            uart.flush()
+
+            if next_stats and time.time() >= next_stats:
+                modem.stats.dump(uart)
+                next_stats += args.stats
+    except KeyboardInterrupt:
+        pass
+    finally:
+        modem.stats.dump(uart)
+        if args.link and os.path.islink(args.link):
+            os.unlink(args.link)
+        os.close(slave)
+        os.close(master)
+
+
+if __name__ == "__main__":
+    main()
@@ -25,6 +25,10 @@ SWITCH_VARS := \
     FEATURE_BROADCAST_ENABLED \
     FEATURE_RRPC_ENABLED \
     FEATURE_REMOTE_CONFIG_MQTT_ENABLED \
+    FEATURE_MEM_POOL_ENABLED \
+    FEATURE_CRYPTO_HW_ACCEL_ENABLED \
+    FEATURE_CBOR_PAYLOAD_ENABLED \
+    FEATURE_MQTT5_ENABLED \
     
 $(foreach v, \
     $(SETTING_VARS) $(SWITCH_VARS), \
@@ -95,6 +99,14 @@ ifeq (y, $(strip $(FEATURE_LOG_UPLOAD_ENABLED)))
 CFLAGS += -DLOG_UPLOAD
 endif
 
+ifeq (y, $(strip $(FEATURE_CRYPTO_HW_ACCEL_ENABLED)))
+CFLAGS += -DCRYPTO_HW_ACCEL
+endif
+
+ifeq (linux, $(strip $(PLATFORM_OS)))
+CFLAGS += -DHAL_TCP_SOCKET_ENABLED
+endif
+
 ifeq (y, $(strip $(FEATURE_AT_TCP_ENABLED)))
 CFLAGS += -DAT_TCP_ENABLED
 ifeq (y, $(strip $(FEATURE_AT_UART_RECV_IRQ)))
@@ -136,6 +136,81 @@ class iot_field:
     def get_meta_define_str(self, var_name):
         return '{{ "{}", &{}.{}, {} }},' \
                     .format(self.id, var_name, self.get_id_c_member_name(), self.type_id)
+
+    def get_codec_key_fragment(self):
+        return '"\\"{}\\":"'.format(self.id)
+
+    def get_codec_value_max_len(self):
+        if self.type_id == "TYPE_TEMPLATE_STRING":
+            return int(self.max_value) + 2
+        elif self.type_id == "TYPE_TEMPLATE_FLOAT":
+            return 24
+        elif self.type_id == "TYPE_TEMPLATE_BOOL":
+            return 1
+        elif self.type_id == "TYPE_TEMPLATE_TIME":
+            return 10
+        else:
+            return 11
+
+    def get_codec_decode_case(self, index):
+        member = "pData->{}".format(self.get_id_c_member_name())
+        result = "        case {}: /* {} */\n".format(index, self.id)
+        if self.type_id == "TYPE_TEMPLATE_STRING":
+            result += "            if (value_len > {}) {{\n".format(self.max_value)
+            result += "                return 0;\n            }\n"
+            result += "            memcpy({}, value, value_len);\n".format(member)
+            result += "            {}[value_len] = '\\0';\n".format(member)
+        elif self.type_id == "TYPE_TEMPLATE_FLOAT":
+            result += "            if (LITE_str_to_double(value, &dv) || dv < {!r} || dv > {!r}) {{\n" \
+                .format(float(self.min_value), float(self.max_value))
+            result += "                return 0;\n            }\n"
+            result += "            {} = (TYPE_DEF_TEMPLATE_FLOAT)dv;\n".format(member)
+        elif self.type_id == "TYPE_TEMPLATE_BOOL":
+            result += "            if (*value == 't' || *value == '1') {\n"
+            result += "                {} = 1;\n".format(member)
+            result += "            } else if (*value == 'f' || *value == '0') {\n"
+            result += "                {} = 0;\n".format(member)
+            result += "            } else {\n                return 0;\n            }\n"
+        elif self.type_id == "TYPE_TEMPLATE_TIME":
+            result += "            if (LITE_str_to_uint64(value, UINT32_MAX, &uv)) {\n"
+            result += "                return 0;\n            }\n"
+            result += "            {} = (TYPE_DEF_TEMPLATE_TIME)uv;\n".format(member)
+        else:
+            if self.type_name == "enum":
+                values = sorted(int(enum.index) for enum in self.enums)
+                min_value, max_value = values[0], values[-1]
+            else:
+                values = None
+                min_value, max_value = int(self.min_value), int(self.max_value)
+            result += "            if (LITE_str_to_int64(value, {}, {}, &iv)) {{\n".format(min_value, max_value)
+            result += "                return 0;\n            }\n"
+            if values and values != list(range(min_value, max_value + 1)):
+                result += "            if ({}) {{\n".format(" && ".join("iv != {}".format(v) for v in values))
+                result += "                return 0;\n            }\n"
+            result += "            {} = ({})iv;\n".format(member, self.type_define)
+        result += "            break;\n"
+        return result
+
+    def get_codec_encode_case(self, index):
+        member = "pData->{}".format(self.get_id_c_member_name())
+        result = "            case {}: /* {} */\n".format(index, self.id)
+        if self.type_id == "TYPE_TEMPLATE_STRING":
+            result += "                n = strlen({});\n".format(member)
+            result += "                buf[len]         = '\"';\n"
+            result += "                memcpy(buf + len + 1, {}, n);\n".format(member)
+            result += "                buf[len + n + 1] = '\"';\n"
+            result += "                n += 2;\n"
+        elif self.type_id == "TYPE_TEMPLATE_FLOAT":
+            result += "                n = LITE_float_to_str({}, buf + len, size - len);\n".format(member)
+        elif self.type_id == "TYPE_TEMPLATE_BOOL":
+            result += "                buf[len] = {} ? '1' : '0';\n".format(member)
+            result += "                n        = 1;\n"
+        elif self.type_id == "TYPE_TEMPLATE_TIME":
+            result += "                n = LITE_uint64_to_str({}, buf + len, size - len);\n".format(member)
+        else:
+            result += "                n = LITE_int64_to_str({}, buf + len, size - len);\n".format(member)
+        result += "                break;\n"
+        return result
 class iot_event:
     def __init__(self,id, name, index, event):
         self.index = index
@@ -181,6 +256,71 @@ class iot_event:
 
 
 
+def codec_hash(key, seed):
+    # FNV-1a, same as _codec_hash() in the generated code
+    h = (2166136261 ^ seed) & 0xFFFFFFFF
+    for c in bytearray(key.encode("utf-8")):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def codec_mix(h):
+    # murmur3 finalizer, same as _codec_mix() in the generated code
+    h ^= h >> 16
+    h = (h * 0x85EBCA6B) & 0xFFFFFFFF
+    h ^= h >> 13
+    h = (h * 0xC2B2AE35) & 0xFFFFFFFF
+    h ^= h >> 16
+    return h
+
+
+def next_pow2(n):
+    size = 1
+    while size < n:
+        size <<= 1
+    return size
+
+
+def build_perfect_hash(keys):
+    """hash and displace: bucket by hash, then find per bucket a displacement moving all its keys to free slots"""
+    slot_size = next_pow2(len(keys))
+    disp_size = next_pow2(max(1, len(keys) // 2))
+
+    for seed in range(256):
+        hashes = [codec_hash(key, seed) for key in keys]
+        buckets = [[] for i in range(disp_size)]
+        for i, h in enumerate(hashes):
+            buckets[h & (disp_size - 1)].append(i)
+
+        slots = [-1] * slot_size
+        disps = [0] * disp_size
+        found = True
+        for bucket in sorted(range(disp_size), key=lambda b: -len(buckets[b])):
+            if not buckets[bucket]:
+                break
+            for d in range(65536):
+                pos = [codec_mix((hashes[i] + d) & 0xFFFFFFFF) & (slot_size - 1) for i in buckets[bucket]]
+                if len(set(pos)) == len(pos) and all(slots[p] < 0 for p in pos):
+                    break
+            else:
+                found = False
+                break
+            disps[bucket] = d
+            for i, p in zip(buckets[bucket], pos):
+                slots[p] = i
+        if found:
+            return seed, disps, slots
+
+    raise ValueError("错误：无法为属性 id 生成完美哈希表")
+
+
+def c_array_body(values, per_line=12):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    return "\n".join(lines)
+
+
 class iot_struct:
     def __init__(self, model):
         self.version = model["version"]
@@ -265,6 +405,102 @@ class iot_struct:
         data_config += "{}".format(self.property_data_initializer())
         return data_config
 
+    def gen_data_codec(self, struct_name="ProductDataDefine"):
+        seed, disps, slots = build_perfect_hash([field.id for field in self.fields])
+        count = len(self.fields)
+        slot_type = "int8_t" if count < 128 else "int16_t"
+        disp_type = "uint8_t" if max(disps) < 256 else "uint16_t"
+        report_max = sum(len(field.id) + 3 + field.get_codec_value_max_len() + 1 for field in self.fields) + 1
+
+        codec = ""
+        codec += "/*-----------------data codec start  -------------------*/ \n\n"
+        codec += "/* include after data_config.c, needs lite-utils.h */\n\n"
+        codec += "#define CODEC_HASH_SEED     ({})\n".format(seed)
+        codec += "#define CODEC_DISP_SIZE     ({})\n".format(len(disps))
+        codec += "#define CODEC_SLOT_SIZE     ({})\n".format(len(slots))
+        codec += "#define CODEC_CHANGED_WORDS ((TOTAL_PROPERTY_COUNT + 31) / 32)\n"
+        codec += "/* longest report of all properties, '\\0' included */\n"
+        codec += "#define CODEC_REPORT_MAX_LEN ({})\n\n".format(report_max)
+
+        codec += "/* \"key\": written as is in reports, key text at +1 for lookup */\n"
+        codec += "static const char *const sg_codec_keys[TOTAL_PROPERTY_COUNT] = {\n"
+        for field in self.fields:
+            codec += "    {},\n".format(field.get_codec_key_fragment())
+        codec += "};\n\n"
+        codec += "static const uint8_t sg_codec_key_lens[TOTAL_PROPERTY_COUNT] = {{\n{}\n}};\n\n" \
+            .format(c_array_body([len(field.id) + 3 for field in self.fields]))
+        codec += "/* key fragment, longest value and ',' */\n"
+        codec += "static const uint16_t sg_codec_member_max[TOTAL_PROPERTY_COUNT] = {{\n{}\n}};\n\n" \
+            .format(c_array_body([len(field.id) + 3 + field.get_codec_value_max_len() + 1 for field in self.fields]))
+        codec += "static const {} sg_codec_disps[CODEC_DISP_SIZE] = {{\n{}\n}};\n\n".format(disp_type,
+                                                                                           c_array_body(disps))
+        codec += "static const {} sg_codec_slots[CODEC_SLOT_SIZE] = {{\n{}\n}};\n\n".format(slot_type,
+                                                                                           c_array_body(slots))
+
+        codec += "static uint32_t _codec_hash(const char *key, int len)\n{\n"
+        codec += "    uint32_t h = 2166136261U ^ CODEC_HASH_SEED;\n\n"
+        codec += "    while (len--) {\n"
+        codec += "        h = (h ^ (uint8_t)*key++) * 16777619U;\n"
+        codec += "    }\n\n    return h;\n}\n\n"
+        codec += "static uint32_t _codec_mix(uint32_t h)\n{\n"
+        codec += "    h ^= h >> 16;\n    h *= 0x85EBCA6BU;\n    h ^= h >> 13;\n    h *= 0xC2B2AE35U;\n"
+        codec += "    h ^= h >> 16;\n\n    return h;\n}\n\n"
+        codec += "/* property index of key, -1 for keys not in the template */\n"
+        codec += "static int _codec_lookup(const char *key, int len)\n{\n"
+        codec += "    uint32_t h     = _codec_hash(key, len);\n"
+        codec += "    uint32_t slot  = _codec_mix(h + sg_codec_disps[h & (CODEC_DISP_SIZE - 1)]) & (CODEC_SLOT_SIZE - 1);\n"
+        codec += "    int      index = sg_codec_slots[slot];\n\n"
+        codec += "    /* the only compare, against the one candidate */\n"
+        codec += "    if (index < 0 || len != sg_codec_key_lens[index] - 3 || memcmp(key, sg_codec_keys[index] + 1, len)) {\n"
+        codec += "        return -1;\n    }\n\n    return index;\n}\n\n"
+
+        codec += "typedef struct {\n"
+        codec += "    {} *pData;\n".format(struct_name)
+        codec += "    uint32_t *changed;\n"
+        codec += "} CodecDeltaContext;\n\n"
+        codec += "static int _codec_decode_member(const char *key, int key_len, const char *value, int value_len, void *ctx)\n{\n"
+        codec += "    CodecDeltaContext *pCtx  = (CodecDeltaContext *)ctx;\n"
+        codec += "    {} *pData = pCtx->pData;\n".format(struct_name)
+        codec += "    int      index = _codec_lookup(key, key_len);\n"
+        codec += "    int64_t  iv;\n    uint64_t uv;\n    double   dv;\n\n"
+        codec += "    (void)iv;\n    (void)uv;\n    (void)dv;\n\n"
+        codec += "    /* values out of the template range are dropped */\n"
+        codec += "    switch (index) {\n"
+        for field in self.fields:
+            codec += field.get_codec_decode_case(field.index)
+        codec += "        default:\n            return 0;\n    }\n\n"
+        codec += "    pCtx->changed[index / 32] |= 1U << (index % 32);\n\n    return 0;\n}\n\n"
+
+        codec += "/* decode a shadow delta into pData in one pass, a bit set in changed for each property written */\n"
+        codec += "static int _codec_decode_delta(char *pJsonDelta, int len, {} *pData, uint32_t changed[CODEC_CHANGED_WORDS])\n{{\n".format(struct_name)
+        codec += "    CodecDeltaContext ctx = {pData, changed};\n\n"
+        codec += "    memset(changed, 0, CODEC_CHANGED_WORDS * sizeof(uint32_t));\n\n"
+        codec += "    return LITE_json_for_each_member(pJsonDelta, len, _codec_decode_member, &ctx);\n}\n\n"
+
+        codec += "typedef struct {\n"
+        codec += "    const {} *pData;\n".format(struct_name)
+        codec += "    const uint32_t *mask;\n"
+        codec += "} CodecReportContext;\n\n"
+        codec += "/* OnShadowReportEncode: \"key\":value, of each property in mask, for IOT_Shadow_JSON_ConstructReportEncoded */\n"
+        codec += "static int _codec_encode_report(char *buf, size_t size, void *userContext)\n{\n"
+        codec += "    CodecReportContext *pCtx  = (CodecReportContext *)userContext;\n"
+        codec += "    const {} *pData = pCtx->pData;\n".format(struct_name)
+        codec += "    size_t len = 0;\n    int    n = 0;\n    int    i;\n\n"
+        codec += "    for (i = 0; i < TOTAL_PROPERTY_COUNT; i++) {\n"
+        codec += "        if (!(pCtx->mask[i / 32] & (1U << (i % 32)))) {\n            continue;\n        }\n"
+        codec += "        /* worst case of this member checked once, no check per write */\n"
+        codec += "        if (len + sg_codec_member_max[i] >= size) {\n"
+        codec += "            return QCLOUD_ERR_JSON_BUFFER_TOO_SMALL;\n        }\n\n"
+        codec += "        memcpy(buf + len, sg_codec_keys[i], sg_codec_key_lens[i]);\n"
+        codec += "        len += sg_codec_key_lens[i];\n\n"
+        codec += "        switch (i) {\n"
+        for field in self.fields:
+            codec += field.get_codec_encode_case(field.index)
+        codec += "        }\n"
+        codec += "        len += n;\n        buf[len++] = ',';\n    }\n"
+        codec += "    buf[len] = '\\0';\n\n    return (int)len;\n}\n"
+        return codec
+
     def gen_event_config(self):
         resault = ""
         event_config = ""
@@ -289,7 +525,7 @@ class iot_struct:
 def main():
     parser = argparse.ArgumentParser(description='Iothub datatemplate and events config code generator.', usage='use "./codegen.py -c xx/config.json" gen config code')
     parser.add_argument('-c','--config', dest='config',metavar='xxx.json', required=False,default='xxx.json',
-                        help='copy the generated file (data_config.c and events_config.c) to datatemplate_sample dir '
+                        help='copy the generated file (data_config.c, events_config.c and data_codec.c) to datatemplate_sample dir '
                              'or your own code dir with datatemplate. '
                               '\nconfig file can be download from tencent iot-hub platfrom. https://console.cloud.tencent.com/iotcloud')
     parser.add_argument('-d','--dest', dest='dest', required=False,default='.',
@@ -338,8 +574,14 @@ def main():
         output_file.close()
 
 
+        output_data_codec_file_name = args.dest + "/data_codec.c"
+        output_file = open(output_data_codec_file_name, "w")
+        output_file.write("{}".format(snippet.gen_data_codec()))
+        output_file.close()
+
         print(u"文件 {} 生成成功".format(output_data_config_file_name))
         print(u"文件 {} 生成成功".format(output_event_config_file_name))
+        print(u"文件 {} 生成成功".format(output_data_codec_file_name))
 
         return 0
     except ValueError as e:
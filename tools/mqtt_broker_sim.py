@@ -0,0 +1,609 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# Tencent is pleased to support the open source community by making IoT Hub available.
+# Copyright (C) 2018-2020 THL A29 Limited, a Tencent company. All rights reserved.
+#
+# Licensed under the MIT License (the "License"); you may not use this file except in
+# compliance with the License. You may obtain a copy of the License at
+# http://opensource.org/licenses/MIT
+#
+# Unless required by applicable law or agreed to in writing, software distributed under the License is
+# distributed on an "AS IS" basis, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+# either express or implied. See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Local MQTT 3.1.1/5.0 broker stand-in for the SDK MQTT client.
+
+It accepts plain TCP connections and speaks the packet subset used by
+sdk_src/protocol/mqtt: CONNECT, SUBSCRIBE, UNSUBSCRIBE, PUBLISH QoS0/1,
+PUBACK, PINGREQ and DISCONNECT. Publishes are routed to every matching
+subscription, so a client subscribed to its own topic gets an echo.
+
+For MQTT 5 it announces Receive Maximum, Topic Alias Maximum and Maximum
+Packet Size in CONNACK and enforces them like a strict broker, closing the
+connection with the matching reason code on a violation. Build the SDK
+with FEATURE_AUTH_WITH_NOTLS = y and point the sample at it with -H:
+
+    ./tools/mqtt_broker_sim.py --port 1883 --alias-max 8 --receive-max 4
+    ./output/release/bin/mqtt_sample -H 127.0.0.1 -v 5 -l
+
+Per connection byte counts, and the topic bytes saved by topic alias, are
+printed when a client disconnects, every --stats seconds and on exit. Sockets
+are polled through epoll and publishes are routed through a topic index, so a
+fleet of several thousand simulated devices can be served; --quiet keeps the
+per connection log down to errors and the stats.
+
+With --services it also plays the cloud side of the JSON shadow, system time,
+remote config and gateway requests: a request on $<service>/operation/<pid>/<dev>
+is answered at once on $<service>/operation/result/<pid>/<dev>, so the latency
+of the sync APIs can be measured against a local round trip.
+"""
+
+import argparse
+import json
+import selectors
+import socket
+import struct
+import sys
+import time
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 1, 2, 3, 4
+SUBSCRIBE, SUBACK, UNSUBSCRIBE, UNSUBACK = 8, 9, 10, 11
+PINGREQ, PINGRESP, DISCONNECT = 12, 13, 14
+
+# property identifier -> value type, MQTT v5.0 Specification 2.2.2.2
+PROP_TYPES = {
+    0x01: "byte", 0x17: "byte", 0x19: "byte", 0x24: "byte", 0x25: "byte", 0x28: "byte", 0x29: "byte", 0x2A: "byte",
+    0x13: "u16", 0x21: "u16", 0x22: "u16", 0x23: "u16",
+    0x02: "u32", 0x11: "u32", 0x18: "u32", 0x27: "u32",
+    0x0B: "vbi",
+    0x03: "bin", 0x08: "bin", 0x09: "bin", 0x12: "bin", 0x15: "bin", 0x16: "bin", 0x1A: "bin", 0x1C: "bin",
+    0x1F: "bin",
+    0x26: "pair",
+}
+
+RC_MALFORMED = 0x81
+RC_PROTOCOL_ERROR = 0x82
+RC_RECEIVE_MAX_EXCEEDED = 0x93
+RC_TOPIC_ALIAS_INVALID = 0x94
+RC_PACKET_TOO_LARGE = 0x95
+
+
+class ProtocolError(Exception):
+    def __init__(self, reason, text):
+        Exception.__init__(self, text)
+        self.reason = reason
+
+
+def encode_vbi(n):
+    out = bytearray()
+    while True:
+        b = n % 128
+        n //= 128
+        out.append(b | 0x80 if n else b)
+        if not n:
+            return bytes(out)
+
+
+def encode_str(s):
+    return struct.pack(">H", len(s)) + s
+
+
+def packet(ptype, flags, body):
+    return bytes([(ptype << 4) | flags]) + encode_vbi(len(body)) + body
+
+
+class Reader(object):
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def left(self):
+        return len(self.data) - self.pos
+
+    def take(self, n):
+        if n > self.left():
+            raise ProtocolError(RC_MALFORMED, "packet too short")
+        v = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return v
+
+    def byte(self):
+        return self.take(1)[0]
+
+    def u16(self):
+        return struct.unpack(">H", self.take(2))[0]
+
+    def u32(self):
+        return struct.unpack(">I", self.take(4))[0]
+
+    def vbi(self):
+        value, mult = 0, 1
+        for _ in range(4):
+            b = self.byte()
+            value += (b & 127) * mult
+            if not b & 128:
+                return value
+            mult *= 128
+        raise ProtocolError(RC_MALFORMED, "bad variable byte integer")
+
+    def string(self):
+        return bytes(self.take(self.u16()))
+
+    def properties(self):
+        end = self.vbi()
+        end += self.pos
+        if end > len(self.data):
+            raise ProtocolError(RC_MALFORMED, "property length out of packet")
+        props = {}
+        while self.pos < end:
+            pid = self.byte()
+            kind = PROP_TYPES.get(pid)
+            if kind is None:
+                raise ProtocolError(RC_MALFORMED, "unknown property 0x%02x" % pid)
+            if kind == "byte":
+                props[pid] = self.byte()
+            elif kind == "u16":
+                props[pid] = self.u16()
+            elif kind == "u32":
+                props[pid] = self.u32()
+            elif kind == "vbi":
+                props[pid] = self.vbi()
+            elif kind == "bin":
+                props[pid] = self.string()
+            else:
+                props.setdefault(pid, []).append((self.string(), self.string()))
+        return props
+
+
+def service_reply(service, request):
+    """reply document of the cloud service for a JSON request, None if there is none"""
+    now_ms = int(time.time() * 1000)
+    kind = request.get("type")
+    if service == "shadow" and kind in ("get", "update"):
+        reply = {"type": kind, "result": 0, "timestamp": now_ms // 1000, "clientToken": request.get("clientToken")}
+        if kind == "get":
+            reply["payload"] = {"state": {"reported": {}}, "metadata": {}, "version": 1, "timestamp": now_ms}
+        else:
+            reply["payload"] = {"state": request.get("state", {}), "version": request.get("version", 0) + 1}
+        return reply
+    if service == "sys" and kind == "get":
+        return {"type": "get", "time": now_ms // 1000, "ntptime1": now_ms, "ntptime2": now_ms}
+    if service == "config" and kind == "get":
+        return {"type": "reply", "result": 0, "payload": {}}
+    if service == "gateway" and kind in ("online", "offline", "bind", "unbind"):
+        devices = request.get("payload", {}).get("devices", [])
+        return {"type": kind, "payload": {"devices": [{"product_id": d.get("product_id"),
+                                                       "device_name": d.get("device_name"), "result": 0}
+                                                      for d in devices]}}
+    if service == "gateway" and kind == "describe_sub_devices":
+        return {"type": kind, "payload": {"devices": []}}
+    return None
+
+
+def topic_matches(topic_filter, topic):
+    fparts, tparts = topic_filter.split("/"), topic.split("/")
+    for i, f in enumerate(fparts):
+        if f == "#":
+            return True
+        if i >= len(tparts) or (f != "+" and f != tparts[i]):
+            return False
+    return len(fparts) == len(tparts)
+
+
+class Session(object):
+    """one client connection"""
+
+    def __init__(self, broker, sock, addr):
+        self.broker = broker
+        self.sock = sock
+        self.addr = "%s:%d" % addr[:2]
+        self.rx = bytearray()
+        self.tx = bytearray()
+        self.version = 0
+        self.client_id = "?"
+        self.subs = {}
+        self.aliases = {}
+        self.inflight = {}
+        self.next_id = 1
+        self.client_max_packet = 0
+        self.closing = False
+        self.writing = False
+        self.start = time.time()
+        self.bytes_in = self.bytes_out = 0
+        self.publish_in = 0
+        self.topic_bytes = 0
+        self.topic_wire_bytes = 0
+        self.alias_hits = 0
+
+    # --- transport ---------------------------------------------------------------------------------------------
+
+    def send(self, data):
+        self.tx += data
+        self.bytes_out += len(data)
+        self.broker.busy.add(self)
+
+    def flush(self):
+        if self.tx:
+            n = self.sock.send(self.tx)
+            del self.tx[:n]
+
+    def on_readable(self):
+        data = self.sock.recv(65536)
+        if not data:
+            raise EOFError()
+        self.rx += data
+        self.bytes_in += len(data)
+        while True:
+            pkt = self.next_packet()
+            if pkt is None:
+                break
+            self.handle(*pkt)
+
+    def next_packet(self):
+        if len(self.rx) < 2:
+            return None
+        rem, mult, i = 0, 1, 1
+        while True:
+            if i >= len(self.rx):
+                return None
+            b = self.rx[i]
+            rem += (b & 127) * mult
+            mult *= 128
+            i += 1
+            if not b & 128:
+                break
+            if i > 4:
+                raise ProtocolError(RC_MALFORMED, "bad remaining length")
+        if self.version == 5 and self.broker.args.max_packet and i + rem > self.broker.args.max_packet:
+            raise ProtocolError(RC_PACKET_TOO_LARGE, "packet of %d bytes" % (i + rem))
+        if len(self.rx) < i + rem:
+            return None
+        header = self.rx[0]
+        body = bytes(self.rx[i:i + rem])
+        del self.rx[:i + rem]
+        return header >> 4, header & 0x0F, body
+
+    def disconnect(self, reason, text):
+        self.say("protocol error: %s" % text)
+        if self.version == 5:
+            self.send(packet(DISCONNECT, 0, bytes([reason, 0])))
+        self.closing = True
+
+    def log(self, text):
+        if self.broker.args.quiet:
+            return
+        self.say(text)
+
+    def say(self, text):
+        sys.stderr.write("[%s %s] %s\n" % (self.addr, self.client_id, text))
+
+    # --- packets -----------------------------------------------------------------------------------------------
+
+    def handle(self, ptype, flags, body):
+        if self.closing:
+            return
+        r = Reader(body)
+        if self.version == 0 and ptype != CONNECT:
+            raise ProtocolError(RC_PROTOCOL_ERROR, "first packet is not CONNECT")
+        if ptype == CONNECT:
+            self.on_connect(r)
+        elif ptype == PUBLISH:
+            self.on_publish(flags, r, len(body))
+        elif ptype == PUBACK:
+            self.on_puback(r)
+        elif ptype == SUBSCRIBE:
+            self.on_subscribe(r)
+        elif ptype == UNSUBSCRIBE:
+            self.on_unsubscribe(r)
+        elif ptype == PINGREQ:
+            self.send(packet(PINGRESP, 0, b""))
+        elif ptype == DISCONNECT:
+            self.closing = True
+        else:
+            raise ProtocolError(RC_PROTOCOL_ERROR, "unexpected packet type %d" % ptype)
+
+    def on_connect(self, r):
+        if self.version:
+            raise ProtocolError(RC_PROTOCOL_ERROR, "second CONNECT")
+        name = r.string()
+        level = r.byte()
+        if name != b"MQTT" or level not in (4, 5):
+            self.log("unsupported protocol %r level %d" % (name, level))
+            self.send(packet(CONNACK, 0, bytes([0, 0x84 if level == 5 else 0x01])))
+            self.closing = True
+            return
+        self.version = level
+        r.byte()  # connect flags
+        keep_alive = r.u16()
+        props = r.properties() if level == 5 else {}
+        self.client_id = r.string().decode("utf-8", "replace")
+        self.client_max_packet = props.get(0x27, 0)
+
+        args = self.broker.args
+        if level == 5:
+            out = bytearray()
+            if args.receive_max:
+                out += bytes([0x21]) + struct.pack(">H", args.receive_max)
+            if args.alias_max:
+                out += bytes([0x22]) + struct.pack(">H", args.alias_max)
+            if args.max_packet:
+                out += bytes([0x27]) + struct.pack(">I", args.max_packet)
+            if args.server_keep_alive:
+                out += bytes([0x13]) + struct.pack(">H", args.server_keep_alive)
+            self.send(packet(CONNACK, 0, bytes([0, 0]) + encode_vbi(len(out)) + bytes(out)))
+        else:
+            self.send(packet(CONNACK, 0, bytes([0, 0])))
+        self.log("connected, MQTT %s, keep alive %d s, client props %s" %
+                 ("5.0" if level == 5 else "3.1.1", keep_alive, dict((hex(k), v) for k, v in props.items())))
+
+    def on_publish(self, flags, r, body_len):
+        qos = (flags >> 1) & 3
+        topic = r.string()
+        self.topic_wire_bytes += 2 + len(topic)
+        pid = r.u16() if qos else 0
+        if qos > 1:
+            raise ProtocolError(RC_PROTOCOL_ERROR, "QoS %d" % qos)
+
+        if self.version == 5:
+            props = r.properties()
+            alias = props.get(0x23)
+            if alias is not None:
+                self.topic_wire_bytes += 3
+                if alias == 0 or alias > self.broker.args.alias_max:
+                    raise ProtocolError(RC_TOPIC_ALIAS_INVALID, "topic alias %d" % alias)
+                if topic:
+                    self.aliases[alias] = topic
+                elif alias in self.aliases:
+                    topic = self.aliases[alias]
+                    self.alias_hits += 1
+                else:
+                    raise ProtocolError(RC_PROTOCOL_ERROR, "topic alias %d is not mapped" % alias)
+            elif not topic:
+                raise ProtocolError(RC_PROTOCOL_ERROR, "empty topic without alias")
+            if qos and len(self.inflight) >= self.broker.args.receive_max:
+                raise ProtocolError(RC_RECEIVE_MAX_EXCEEDED, "%d QoS1 publish in flight" % (len(self.inflight) + 1))
+        self.publish_in += 1
+        self.topic_bytes += 2 + len(topic)
+        payload = r.take(r.left())
+
+        if qos:
+            due = time.time() + self.broker.args.puback_delay_ms / 1000.0
+            self.inflight[pid] = due
+            self.broker.busy.add(self)
+        if self.broker.args.trace:
+            self.log("PUBLISH qos%d id %d %s %d bytes" % (qos, pid, topic.decode("utf-8", "replace"), len(payload)))
+        self.broker.route(topic, qos, payload)
+        if self.broker.args.services:
+            self.broker.answer(topic, payload)
+
+    def ack_due(self, now):
+        for pid, due in sorted(self.inflight.items(), key=lambda kv: kv[1]):
+            if due > now:
+                break
+            del self.inflight[pid]
+            self.send(packet(PUBACK, 0, struct.pack(">H", pid)))
+
+    def next_due(self):
+        return min(self.inflight.values()) if self.inflight else None
+
+    def on_puback(self, r):
+        r.u16()
+
+    def on_subscribe(self, r):
+        pid = r.u16()
+        if self.version == 5:
+            r.properties()
+        codes = bytearray()
+        while r.left():
+            topic_filter = r.string().decode("utf-8", "replace")
+            options = r.byte()
+            granted = min(options & 3, 1)
+            self.subs[topic_filter] = granted
+            self.broker.index_add(self, topic_filter)
+            codes.append(granted)
+            self.log("subscribe %s qos%d" % (topic_filter, granted))
+        props = b"\x00" if self.version == 5 else b""
+        self.send(packet(SUBACK, 0, struct.pack(">H", pid) + props + bytes(codes)))
+
+    def on_unsubscribe(self, r):
+        pid = r.u16()
+        if self.version == 5:
+            r.properties()
+        codes = bytearray()
+        while r.left():
+            topic_filter = r.string().decode("utf-8", "replace")
+            codes.append(0 if self.subs.pop(topic_filter, None) is not None else 0x11)
+            self.broker.index_remove(self, topic_filter)
+        body = struct.pack(">H", pid)
+        if self.version == 5:
+            body += b"\x00" + bytes(codes)
+        self.send(packet(UNSUBACK, 0, body))
+
+    def deliver(self, topic, qos, payload):
+        text = topic.decode("utf-8", "replace")
+        granted = [q for f, q in self.subs.items() if topic_matches(f, text)]
+        if not granted:
+            return
+        qos = min(qos, max(granted))
+        body = encode_str(topic)
+        if qos:
+            body += struct.pack(">H", self.next_id)
+            self.next_id = self.next_id % 65535 + 1
+        if self.version == 5:
+            body += b"\x00"
+        data = packet(PUBLISH, qos << 1, body + payload)
+        if self.client_max_packet and len(data) > self.client_max_packet:
+            self.log("drop %d bytes publish over client maximum packet size" % len(data))
+            return
+        self.send(data)
+
+    def stats(self):
+        saved = self.topic_bytes - self.topic_wire_bytes
+        return ("MQTT %s, %.0f s, in %d bytes, out %d bytes, %d publish, topic bytes %d on wire for %d (saved %d, "
+                "%d alias hits)" % ("5.0" if self.version == 5 else "3.1.1", time.time() - self.start, self.bytes_in,
+                                    self.bytes_out, self.publish_in, self.topic_wire_bytes, self.topic_bytes, saved,
+                                    self.alias_hits))
+
+
+class Broker(object):
+    def __init__(self, args):
+        self.args = args
+        self.sessions = {}
+        self.exact = {}  # topic filter without wildcards -> sessions subscribed to it
+        self.wild = {}  # session -> number of its filters with wildcards
+        self.busy = set()  # sessions with output queued or PUBACK held
+
+    def index_add(self, session, topic_filter):
+        if "+" in topic_filter or "#" in topic_filter:
+            self.wild[session] = self.wild.get(session, 0) + 1
+        else:
+            self.exact.setdefault(topic_filter, set()).add(session)
+
+    def index_remove(self, session, topic_filter):
+        if "+" in topic_filter or "#" in topic_filter:
+            left = self.wild.get(session, 0) - 1
+            if left > 0:
+                self.wild[session] = left
+            else:
+                self.wild.pop(session, None)
+        else:
+            subscribers = self.exact.get(topic_filter)
+            if subscribers is not None:
+                subscribers.discard(session)
+                if not subscribers:
+                    del self.exact[topic_filter]
+
+    def route(self, topic, qos, payload):
+        targets = set(self.exact.get(topic.decode("utf-8", "replace"), ()))
+        targets.update(self.wild)
+        for s in targets:
+            if not s.closing:
+                s.deliver(topic, qos, payload)
+
+    def answer(self, topic, payload):
+        levels = topic.decode("utf-8", "replace").split("/")
+        if len(levels) != 4 or levels[1] != "operation" or not levels[0].startswith("$"):
+            return
+        try:
+            request = json.loads(payload.decode("utf-8"))
+        except ValueError:
+            return
+        reply = service_reply(levels[0][1:], request) if isinstance(request, dict) else None
+        if reply is not None:
+            result_topic = "%s/operation/result/%s/%s" % (levels[0], levels[2], levels[3])
+            self.route(result_topic.encode("utf-8"), 0, json.dumps(reply).encode("utf-8"))
+
+    def close(self, sock):
+        s = self.sessions.pop(sock)
+        self.busy.discard(s)
+        for topic_filter in list(s.subs):
+            self.index_remove(s, topic_filter)
+        try:
+            s.flush()
+        except socket.error:
+            pass
+        s.log("closed, " + s.stats())
+        sock.close()
+
+    def dump(self):
+        if self.args.quiet:
+            publish_in = sum(s.publish_in for s in self.sessions.values())
+            sys.stderr.write("%d sessions, %d subscriptions, %d publish received\n" %
+                             (len(self.sessions), sum(len(s.subs) for s in self.sessions.values()), publish_in))
+            return
+        for s in self.sessions.values():
+            s.log(s.stats())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1", help="listen address")
+    parser.add_argument("--port", type=int, default=1883, help="listen port, the SDK uses 1883 without TLS")
+    parser.add_argument("--receive-max", type=int, default=10, help="MQTT 5 Receive Maximum announced and enforced")
+    parser.add_argument("--alias-max", type=int, default=10, help="MQTT 5 Topic Alias Maximum, 0 disables alias")
+    parser.add_argument("--max-packet", type=int, default=0, help="MQTT 5 Maximum Packet Size, 0 for no limit")
+    parser.add_argument("--server-keep-alive", type=int, default=0, help="MQTT 5 Server Keep Alive to announce")
+    parser.add_argument("--puback-delay-ms", type=float, default=0, help="hold PUBACK to exercise flow control")
+    parser.add_argument("--stats", type=float, default=0, help="print stats every N seconds")
+    parser.add_argument("--trace", action="store_true", help="log every PUBLISH")
+    parser.add_argument("--services", action="store_true", help="answer shadow, sys, config and gateway requests")
+    parser.add_argument("--quiet", action="store_true", help="log only errors and the session totals")
+    args = parser.parse_args()
+
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind((args.host, args.port))
+    listener.listen(1024)
+    poller = selectors.DefaultSelector()
+    poller.register(listener, selectors.EVENT_READ)
+    sys.stderr.write("MQTT broker stand-in listening on %s:%d\n" % (args.host, args.port))
+
+    broker = Broker(args)
+    next_stats = time.time() + args.stats if args.stats else None
+
+    try:
+        while True:
+            now = time.time()
+            timeout = None
+            for s in list(broker.busy):
+                s.ack_due(now)
+                due = s.next_due()
+                if due is not None:
+                    timeout = max(due - now, 0) if timeout is None else min(timeout, max(due - now, 0))
+            if next_stats:
+                d = max(next_stats - now, 0)
+                timeout = d if timeout is None else min(timeout, d)
+
+            for s in list(broker.busy):
+                if bool(s.tx) != s.writing:
+                    s.writing = bool(s.tx)
+                    poller.modify(s.sock, selectors.EVENT_READ | (selectors.EVENT_WRITE if s.writing else 0))
+                if not s.tx and not s.inflight:
+                    broker.busy.discard(s)
+            events = poller.select(timeout)
+            closing = []
+
+            for key, mask in events:
+                sock = key.fileobj
+                if sock is listener:
+                    conn, addr = listener.accept()
+                    conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+                    broker.sessions[conn] = Session(broker, conn, addr)
+                    poller.register(conn, selectors.EVENT_READ)
+                    continue
+                s = broker.sessions.get(sock)
+                if s is None:
+                    continue
+                try:
+                    if mask & selectors.EVENT_READ:
+                        s.on_readable()
+                    if mask & selectors.EVENT_WRITE:
+                        s.flush()
+                except ProtocolError as e:
+                    s.disconnect(e.reason, str(e))
+                except (EOFError, socket.error):
+                    s.closing = True
+                if s.closing:
+                    closing.append(sock)
+                else:
+                    broker.busy.add(s)
+            for sock in closing:
+                poller.unregister(sock)
+                broker.close(sock)
+
+            if next_stats and time.time() >= next_stats:
+                broker.dump()
+                next_stats += args.stats
+    except KeyboardInterrupt:
+        pass
+    finally:
+        broker.dump()
+        poller.close()
+        listener.close()
+
+
+if __name__ == "__main__":
+    main()